@@ -0,0 +1,227 @@
+import Benchmark
+import ExampleExtensions
+import Foundation
+import SQLiteExtensionKit
+
+// Every query benchmark scans `rowCount` rows per iteration, so per-row costs are the
+// reported wall clock, instruction and malloc counts divided by `rowCount`. Run with
+// `swift package benchmark` from this directory, and compare releases with
+// `swift package benchmark baseline update <name>` and
+// `swift package benchmark baseline compare <name>`. The SQLite C API comes from
+// SQLiteExtensionKit, which re-exports CSQLite.
+
+let rowCount = 10_000
+
+let benchmarks: @Sendable () -> Void = {
+    Benchmark.defaultConfiguration = .init(
+        metrics: [.wallClock, .cpuTotal, .instructions, .throughput, .mallocCountTotal, .peakMemoryResident],
+        maxDuration: .seconds(2),
+        maxIterations: 1_000
+    )
+
+    // MARK: Scalar call overhead
+
+    // `abs` is a built-in C function: the floor for any scalar call.
+    queryBenchmark("Scalar/native abs", "SELECT sum(abs(value)) FROM numbers")
+    queryBenchmark("Scalar/C callback", "SELECT sum(c_identity(value)) FROM numbers")
+    queryBenchmark("Scalar/borrowing closure", "SELECT sum(kit_identity(value)) FROM numbers")
+    queryBenchmark("Scalar/typed closure", "SELECT sum(typed_identity(value)) FROM numbers")
+    queryBenchmark("Scalar/array closure", "SELECT sum(array_identity(value)) FROM numbers")
+    queryBenchmark("Scalar/text result", "SELECT sum(length(hex_encode(payload))) FROM numbers")
+
+    Benchmark("Scalar/instrumented closure") { benchmark in
+        let fixture = BenchmarkFixture()
+        SQLiteInstrumentation.isEnabled = true
+        defer { SQLiteInstrumentation.isEnabled = false }
+        try fixture.database.createScalarFunction(name: "instrumented_identity", argumentCount: 1) { context, args in
+            context.result(args[0].intValue)
+        }
+        let statement = fixture.prepare("SELECT sum(instrumented_identity(value)) FROM numbers")
+        defer { sqlite3_finalize(statement) }
+        benchmark.startMeasurement()
+        for _ in benchmark.scaledIterations {
+            blackHole(BenchmarkFixture.run(statement))
+        }
+    }
+
+    // MARK: Aggregate step cost
+
+    queryBenchmark("Aggregate/native avg", "SELECT avg(x) FROM numbers")
+    queryBenchmark("Aggregate/std_dev", "SELECT std_dev(x) FROM numbers")
+    queryBenchmark("Aggregate/median", "SELECT median(x) FROM numbers")
+    queryBenchmark("Aggregate/product", "SELECT product(1.0 + x / 1e9) FROM numbers")
+
+    // MARK: Virtual table scans
+
+    queryBenchmark("VirtualTable/native scan", "SELECT count(*) FROM native_kv")
+    queryBenchmark("VirtualTable/keyvalue scan", "SELECT count(*) FROM kv")
+    queryBenchmark("VirtualTable/keyvalue one column", "SELECT sum(length(value)) FROM kv")
+    queryBenchmark("VirtualTable/keyvalue two columns", "SELECT sum(length(key) + length(value)) FROM kv")
+    queryBenchmark("VirtualTable/series", "SELECT sum(value) FROM series(1, \(rowCount))")
+
+    // MARK: Planning
+
+    // Preparing runs xBestIndex once per candidate plan; nothing is stepped.
+    Benchmark("Planning/native prepare") { benchmark in
+        let fixture = BenchmarkFixture()
+        benchmark.startMeasurement()
+        for _ in benchmark.scaledIterations {
+            blackHole(fixture.prepareOnly("SELECT value FROM native_kv WHERE key = ?1"))
+        }
+    }
+    Benchmark("Planning/keyvalue bestIndex") { benchmark in
+        let fixture = BenchmarkFixture()
+        benchmark.startMeasurement()
+        for _ in benchmark.scaledIterations {
+            blackHole(fixture.prepareOnly("SELECT value FROM kv WHERE key = ?1"))
+        }
+    }
+
+    // MARK: Registration
+
+    Benchmark("Registration/closures per connection") { benchmark in
+        for _ in benchmark.scaledIterations {
+            let connection = openConnection()
+            benchmark.startMeasurement()
+            let database = SQLiteDatabase(connection)
+            for index in 0..<16 {
+                try? database.createScalarFunction(name: "identity_\(index)", argumentCount: 1, deterministic: true) { context, args in
+                    context.result(args[0].intValue)
+                }
+            }
+            benchmark.stopMeasurement()
+            sqlite3_close(connection)
+        }
+    }
+    Benchmark("Registration/shared registry") { benchmark in
+        for _ in benchmark.scaledIterations {
+            let connection = openConnection()
+            benchmark.startMeasurement()
+            try? identityRegistry.register(with: SQLiteDatabase(connection))
+            benchmark.stopMeasurement()
+            sqlite3_close(connection)
+        }
+    }
+}
+
+/// Registers a benchmark that steps `sql` to completion once per iteration.
+func queryBenchmark(_ name: String, _ sql: String) {
+    Benchmark(name) { benchmark in
+        let fixture = BenchmarkFixture()
+        let statement = fixture.prepare(sql)
+        defer { sqlite3_finalize(statement) }
+        benchmark.startMeasurement()
+        for _ in benchmark.scaledIterations {
+            blackHole(BenchmarkFixture.run(statement))
+        }
+    }
+}
+
+/// Sixteen identity functions, built once for every connection.
+let identityRegistry = SQLiteFunctionRegistry { functions in
+    for index in 0..<16 {
+        functions.createScalarFunction(name: "identity_\(index)", argumentCount: 1, deterministic: true) { context, args in
+            context.result(args[0].intValue)
+        }
+    }
+}
+
+func openConnection() -> OpaquePointer {
+    var db: OpaquePointer?
+    guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db else {
+        fatalError("Could not open an in-memory database")
+    }
+    return db
+}
+
+/// An in-memory database with every benchmarked function and table.
+final class BenchmarkFixture {
+    let connection: OpaquePointer
+
+    var database: SQLiteDatabase {
+        SQLiteDatabase(connection)
+    }
+
+    init() {
+        connection = openConnection()
+        let database = SQLiteDatabase(connection)
+        do {
+            try MathFunctionsExtension.register(with: database)
+            try WindowFunctionsExtension.register(with: database)
+            try DataFunctionsExtension.register(with: database)
+            try KeyValueTableExtension.register(with: database)
+            try TableFunctionsExtension.register(with: database)
+
+            try database.createScalarFunction(name: "kit_identity", argumentCount: 1, deterministic: true) { context, args in
+                context.result(args[0].intValue)
+            }
+            try database.createScalarFunction(name: "typed_identity", deterministic: true) { (value: Int64) in
+                value
+            }
+            let arrayIdentity: ScalarFunction = { context, args in
+                context.result(args[0].intValue)
+            }
+            try database.createScalarFunction(
+                name: "array_identity",
+                argumentCount: 1,
+                deterministic: true,
+                function: arrayIdentity
+            )
+        } catch {
+            fatalError("Registration failed: \(error)")
+        }
+
+        let result = sqlite3_create_function_v2(
+            connection, "c_identity", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nil,
+            { context, _, argv in sqlite3_result_int64(context, sqlite3_value_int64(argv![0])) },
+            nil, nil, nil
+        )
+        precondition(result == SQLITE_OK)
+
+        execute("""
+        CREATE TABLE numbers (value INTEGER, x REAL, payload BLOB);
+        WITH RECURSIVE r(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM r WHERE n < \(rowCount))
+        INSERT INTO numbers SELECT n, n * 0.5, randomblob(16) FROM r;
+        CREATE TABLE native_kv (key TEXT PRIMARY KEY, value TEXT);
+        INSERT INTO native_kv SELECT 'key' || value, printf('%032d', value) FROM numbers;
+        CREATE VIRTUAL TABLE kv USING keyvalue;
+        INSERT INTO kv SELECT key, value FROM native_kv;
+        """)
+    }
+
+    deinit {
+        sqlite3_close(connection)
+    }
+
+    func execute(_ sql: String) {
+        var message: UnsafeMutablePointer<CChar>?
+        guard sqlite3_exec(connection, sql, nil, nil, &message) == SQLITE_OK else {
+            fatalError("Setup failed: \(message.map { String(cString: $0) } ?? "unknown error")")
+        }
+    }
+
+    func prepare(_ sql: String) -> OpaquePointer {
+        var statement: OpaquePointer?
+        guard sqlite3_prepare_v2(connection, sql, -1, &statement, nil) == SQLITE_OK, let statement else {
+            fatalError("Prepare failed: \(String(cString: sqlite3_errmsg(connection)))")
+        }
+        return statement
+    }
+
+    /// Prepares and finalizes a statement, returning its column count.
+    func prepareOnly(_ sql: String) -> Int32 {
+        let statement = prepare(sql)
+        defer { sqlite3_finalize(statement) }
+        return sqlite3_column_count(statement)
+    }
+
+    /// Steps a statement to completion and returns the first column of its last row.
+    static func run(_ statement: OpaquePointer) -> Int64 {
+        var last: Int64 = 0
+        while sqlite3_step(statement) == SQLITE_ROW {
+            last = sqlite3_column_int64(statement, 0)
+        }
+        sqlite3_reset(statement)
+        return last
+    }
+}
@@ -0,0 +1,39 @@
+// swift-tools-version: 6.0
+
+import Foundation
+import PackageDescription
+
+// Benchmarks live in their own package so that depending on SQLiteExtensionKit does not
+// pull in package-benchmark and its jemalloc requirement.
+
+// SwiftPM names a path dependency after its directory, so the root package's identity is
+// whatever the checkout is called rather than always `sqlite-extension-kit`.
+let rootPackage = URL(fileURLWithPath: Context.packageDirectory)
+    .deletingLastPathComponent()
+    .lastPathComponent
+    .lowercased()
+
+let package = Package(
+    name: "SQLiteExtensionKitBenchmarks",
+    platforms: [
+        .macOS(.v15)
+    ],
+    dependencies: [
+        .package(url: "https://github.com/ordo-one/package-benchmark.git", from: "1.27.0"),
+        .package(path: "..")
+    ],
+    targets: [
+        .executableTarget(
+            name: "BridgeBenchmarks",
+            dependencies: [
+                .product(name: "Benchmark", package: "package-benchmark"),
+                .product(name: "SQLiteExtensionKit", package: rootPackage),
+                .product(name: "ExampleExtensions", package: rootPackage)
+            ],
+            path: "Benchmarks/BridgeBenchmarks",
+            plugins: [
+                .plugin(name: "BenchmarkPlugin", package: "package-benchmark")
+            ]
+        )
+    ]
+)
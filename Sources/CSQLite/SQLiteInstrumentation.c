@@ -0,0 +1,31 @@
+#include "SQLiteInstrumentation.h"
+#include <time.h>
+
+uint64_t SQLiteExtensionKit_MonotonicNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static unsigned nextStripe = 0;
+static _Thread_local unsigned threadStripe = 0;
+
+unsigned SQLiteExtensionKit_ThreadStripe(void) {
+    // Zero marks a thread that has not been assigned a stripe yet.
+    if (threadStripe == 0) {
+        threadStripe = __atomic_add_fetch(&nextStripe, 1, __ATOMIC_RELAXED) | 0x80000000u;
+    }
+    return threadStripe & 0x7fffffffu;
+}
+
+void SQLiteExtensionKit_CounterAdd(uint64_t *counter, uint64_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+uint64_t SQLiteExtensionKit_CounterLoad(const uint64_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+void SQLiteExtensionKit_CounterStore(uint64_t *counter, uint64_t value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
@@ -1,5 +1,6 @@
 #include "SQLiteVirtualTable.h"
 #include <stddef.h>
+#include <string.h>
 
 extern int SQLiteExtensionKit_VirtualTableCreate(
     void *context,
@@ -35,7 +36,6 @@ extern int SQLiteExtensionKit_VirtualTableFilter(
 );
 
 extern int SQLiteExtensionKit_VirtualTableNext(SQLiteVirtualCursor *cursor);
-extern int SQLiteExtensionKit_VirtualTableEof(SQLiteVirtualCursor *cursor);
 
 extern int SQLiteExtensionKit_VirtualTableColumn(
     SQLiteVirtualCursor *cursor,
@@ -48,6 +48,8 @@ extern int SQLiteExtensionKit_VirtualTableRowid(
     sqlite3_int64 *rowid
 );
 
+extern int SQLiteExtensionKit_VirtualTableFillBatch(SQLiteVirtualCursor *cursor);
+
 extern int SQLiteExtensionKit_VirtualTableUpdate(
     SQLiteVirtualTable *table,
     int argc,
@@ -55,6 +57,36 @@ extern int SQLiteExtensionKit_VirtualTableUpdate(
     sqlite3_int64 *rowid
 );
 
+/* Event codes for SQLiteExtensionKit_VirtualTableTransaction. */
+enum {
+    SwiftTransactionBegin = 0,
+    SwiftTransactionSync = 1,
+    SwiftTransactionCommit = 2,
+    SwiftTransactionRollback = 3,
+    SwiftTransactionSavepoint = 4,
+    SwiftTransactionRelease = 5,
+    SwiftTransactionRollbackTo = 6
+};
+
+extern int SQLiteExtensionKit_VirtualTableTransaction(
+    SQLiteVirtualTable *table,
+    int event,
+    int savepoint
+);
+
+extern int SQLiteExtensionKit_VirtualTableFindFunction(
+    SQLiteVirtualTable *table,
+    int argc,
+    const char *name,
+    void **ppArg
+);
+
+extern void SQLiteExtensionKit_VirtualTableCallFunction(
+    sqlite3_context *context,
+    int argc,
+    sqlite3_value **argv
+);
+
 static int swiftCreate(
     sqlite3 *db,
     void *context,
@@ -154,11 +186,83 @@ static int swiftFilter(
 }
 
 static int swiftNext(sqlite3_vtab_cursor *pCursor) {
-    return SQLiteExtensionKit_VirtualTableNext((SQLiteVirtualCursor *)pCursor);
+    SQLiteVirtualCursor *cursor = (SQLiteVirtualCursor *)pCursor;
+    SQLiteVirtualBatch *batch = cursor->batch;
+
+    if (batch) {
+        if (batch->position < batch->rowCount) {
+            batch->position++;
+        }
+        if (batch->position < batch->rowCount || batch->rowCount == 0) {
+            return SQLITE_OK;
+        }
+        return SQLiteExtensionKit_VirtualTableFillBatch(cursor);
+    }
+
+    return SQLiteExtensionKit_VirtualTableNext(cursor);
 }
 
 static int swiftEof(sqlite3_vtab_cursor *pCursor) {
-    return SQLiteExtensionKit_VirtualTableEof((SQLiteVirtualCursor *)pCursor);
+    SQLiteVirtualCursor *cursor = (SQLiteVirtualCursor *)pCursor;
+
+    if (cursor->batch) {
+        return cursor->batch->position >= cursor->batch->rowCount;
+    }
+
+    return cursor->eof;
+}
+
+static void batchColumnResult(
+    const SQLiteVirtualBatch *batch,
+    sqlite3_context *context,
+    int column
+) {
+    size_t cell;
+
+    if (batch->position >= batch->rowCount || column < 0 || column >= batch->columnCount) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    cell = (size_t)column * (size_t)batch->capacity + (size_t)batch->position;
+
+    switch (batch->types[cell]) {
+    case SQLITE_INTEGER:
+        sqlite3_result_int64(context, batch->integers[cell]);
+        break;
+    case SQLITE_FLOAT:
+        sqlite3_result_double(context, batch->reals[cell]);
+        break;
+    case SQLITE_TEXT:
+        /* The arena is NULL until a cell needs it, and NULL reads back as SQL NULL. */
+        if (batch->lengths[cell] == 0) {
+            sqlite3_result_text(context, "", 0, SQLITE_STATIC);
+            break;
+        }
+        sqlite3_result_text64(
+            context,
+            (const char *)batch->arena + batch->offsets[cell],
+            (sqlite3_uint64)batch->lengths[cell],
+            SQLITE_TRANSIENT,
+            SQLITE_UTF8
+        );
+        break;
+    case SQLITE_BLOB:
+        if (batch->lengths[cell] == 0) {
+            sqlite3_result_zeroblob(context, 0);
+            break;
+        }
+        sqlite3_result_blob64(
+            context,
+            batch->arena + batch->offsets[cell],
+            (sqlite3_uint64)batch->lengths[cell],
+            SQLITE_TRANSIENT
+        );
+        break;
+    default:
+        sqlite3_result_null(context);
+        break;
+    }
 }
 
 static int swiftColumn(
@@ -166,16 +270,31 @@ static int swiftColumn(
     sqlite3_context *context,
     int column
 ) {
+    SQLiteVirtualCursor *cursor = (SQLiteVirtualCursor *)pCursor;
+
+    if (cursor->batch) {
+        batchColumnResult(cursor->batch, context, column);
+        return SQLITE_OK;
+    }
+
     return SQLiteExtensionKit_VirtualTableColumn(
-        (SQLiteVirtualCursor *)pCursor,
+        cursor,
         context,
         column
     );
 }
 
 static int swiftRowid(sqlite3_vtab_cursor *pCursor, sqlite3_int64 *rowid) {
+    SQLiteVirtualCursor *cursor = (SQLiteVirtualCursor *)pCursor;
+    SQLiteVirtualBatch *batch = cursor->batch;
+
+    if (batch) {
+        *rowid = batch->position < batch->rowCount ? batch->rowids[batch->position] : 0;
+        return SQLITE_OK;
+    }
+
     return SQLiteExtensionKit_VirtualTableRowid(
-        (SQLiteVirtualCursor *)pCursor,
+        cursor,
         rowid
     );
 }
@@ -194,8 +313,86 @@ static int swiftUpdate(
     );
 }
 
+static int swiftBegin(sqlite3_vtab *pVTab) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionBegin,
+        0
+    );
+}
+
+static int swiftSync(sqlite3_vtab *pVTab) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionSync,
+        0
+    );
+}
+
+static int swiftCommit(sqlite3_vtab *pVTab) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionCommit,
+        0
+    );
+}
+
+static int swiftRollback(sqlite3_vtab *pVTab) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionRollback,
+        0
+    );
+}
+
+static int swiftSavepoint(sqlite3_vtab *pVTab, int savepoint) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionSavepoint,
+        savepoint
+    );
+}
+
+static int swiftRelease(sqlite3_vtab *pVTab, int savepoint) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionRelease,
+        savepoint
+    );
+}
+
+static int swiftRollbackTo(sqlite3_vtab *pVTab, int savepoint) {
+    return SQLiteExtensionKit_VirtualTableTransaction(
+        (SQLiteVirtualTable *)pVTab,
+        SwiftTransactionRollbackTo,
+        savepoint
+    );
+}
+
+static int swiftFindFunction(
+    sqlite3_vtab *pVTab,
+    int nArg,
+    const char *zName,
+    void (**pxFunc)(sqlite3_context *, int, sqlite3_value **),
+    void **ppArg
+) {
+    int rc = SQLiteExtensionKit_VirtualTableFindFunction(
+        (SQLiteVirtualTable *)pVTab,
+        nArg,
+        zName,
+        ppArg
+    );
+
+    if (rc) {
+        *pxFunc = SQLiteExtensionKit_VirtualTableCallFunction;
+    }
+
+    return rc;
+}
+
+/* iVersion 2 is the first with the savepoint callbacks. */
 static const sqlite3_module SwiftVirtualTableModule = {
-    1,                      /* iVersion */
+    2,                      /* iVersion */
     swiftCreateThunk,       /* xCreate */
     swiftConnectThunk,      /* xConnect */
     swiftBestIndex,         /* xBestIndex */
@@ -209,6 +406,45 @@ static const sqlite3_module SwiftVirtualTableModule = {
     swiftColumn,            /* xColumn */
     swiftRowid,             /* xRowid */
     swiftUpdate,            /* xUpdate */
+    swiftBegin,             /* xBegin */
+    swiftSync,              /* xSync */
+    swiftCommit,            /* xCommit */
+    swiftRollback,          /* xRollback */
+    swiftFindFunction,      /* xFindFunction */
+    NULL,                   /* xRename */
+    swiftSavepoint,         /* xSavepoint */
+    swiftRelease,           /* xRelease */
+    swiftRollbackTo         /* xRollbackTo */
+};
+
+int SQLiteExtensionKit_CreateVirtualTableModule(
+    sqlite3 *db,
+    const char *name,
+    void *context,
+    void (*xDestroy)(void *)
+) {
+    return sqlite3_create_module_v2(db, name, &SwiftVirtualTableModule, context, xDestroy);
+}
+
+/*
+ * Eponymous-only tables such as table-valued functions have no xCreate and are
+ * read-only, so they need neither xUpdate nor the transaction callbacks.
+ */
+static const sqlite3_module SwiftEponymousVirtualTableModule = {
+    1,                      /* iVersion */
+    NULL,                   /* xCreate */
+    swiftConnectThunk,      /* xConnect */
+    swiftBestIndex,         /* xBestIndex */
+    swiftDisconnect,        /* xDisconnect */
+    swiftDestroy,           /* xDestroy */
+    swiftOpen,              /* xOpen */
+    swiftClose,             /* xClose */
+    swiftFilter,            /* xFilter */
+    swiftNext,              /* xNext */
+    swiftEof,               /* xEof */
+    swiftColumn,            /* xColumn */
+    swiftRowid,             /* xRowid */
+    NULL,                   /* xUpdate */
     NULL,                   /* xBegin */
     NULL,                   /* xSync */
     NULL,                   /* xCommit */
@@ -220,13 +456,13 @@ static const sqlite3_module SwiftVirtualTableModule = {
     NULL                    /* xRollbackTo */
 };
 
-int SQLiteExtensionKit_CreateVirtualTableModule(
+int SQLiteExtensionKit_CreateEponymousVirtualTableModule(
     sqlite3 *db,
     const char *name,
     void *context,
     void (*xDestroy)(void *)
 ) {
-    return sqlite3_create_module_v2(db, name, &SwiftVirtualTableModule, context, xDestroy);
+    return sqlite3_create_module_v2(db, name, &SwiftEponymousVirtualTableModule, context, xDestroy);
 }
 
 void SQLiteExtensionKit_VirtualTableSetError(sqlite3_vtab *vtab, const char *message) {
@@ -237,3 +473,175 @@ void SQLiteExtensionKit_VirtualTableSetError(sqlite3_vtab *vtab, const char *mes
     sqlite3_free(vtab->zErrMsg);
     vtab->zErrMsg = sqlite3_mprintf("%s", message ? message : "Virtual table error");
 }
+
+/* Batch buffers */
+
+SQLiteVirtualBatch *SQLiteExtensionKit_BatchCreate(int columnCount, int capacity) {
+    SQLiteVirtualBatch *batch;
+    sqlite3_uint64 cells;
+
+    if (columnCount < 0 || capacity <= 0) {
+        return NULL;
+    }
+
+    batch = sqlite3_malloc64(sizeof(SQLiteVirtualBatch));
+    if (!batch) {
+        return NULL;
+    }
+    memset(batch, 0, sizeof(SQLiteVirtualBatch));
+
+    cells = (sqlite3_uint64)columnCount * (sqlite3_uint64)capacity;
+    batch->capacity = capacity;
+    batch->columnCount = columnCount;
+    batch->rowids = sqlite3_malloc64(sizeof(sqlite3_int64) * (sqlite3_uint64)capacity);
+    batch->types = sqlite3_malloc64(cells ? cells : 1);
+    batch->integers = sqlite3_malloc64(sizeof(sqlite3_int64) * (cells ? cells : 1));
+    batch->reals = sqlite3_malloc64(sizeof(double) * (cells ? cells : 1));
+    batch->offsets = sqlite3_malloc64(sizeof(sqlite3_int64) * (cells ? cells : 1));
+    batch->lengths = sqlite3_malloc64(sizeof(sqlite3_int64) * (cells ? cells : 1));
+
+    if (!batch->rowids || !batch->types || !batch->integers || !batch->reals
+        || !batch->offsets || !batch->lengths) {
+        SQLiteExtensionKit_BatchFree(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+void SQLiteExtensionKit_BatchFree(SQLiteVirtualBatch *batch) {
+    if (!batch) {
+        return;
+    }
+
+    sqlite3_free(batch->rowids);
+    sqlite3_free(batch->types);
+    sqlite3_free(batch->integers);
+    sqlite3_free(batch->reals);
+    sqlite3_free(batch->offsets);
+    sqlite3_free(batch->lengths);
+    sqlite3_free(batch->arena);
+    sqlite3_free(batch);
+}
+
+void SQLiteExtensionKit_BatchReset(SQLiteVirtualBatch *batch) {
+    if (!batch) {
+        return;
+    }
+
+    batch->rowCount = 0;
+    batch->position = 0;
+    batch->arenaUsed = 0;
+}
+
+int SQLiteExtensionKit_BatchAppendRow(SQLiteVirtualBatch *batch, sqlite3_int64 rowid) {
+    int row;
+    int column;
+
+    if (!batch || batch->rowCount >= batch->capacity) {
+        return -1;
+    }
+
+    row = batch->rowCount++;
+    batch->rowids[row] = rowid;
+    for (column = 0; column < batch->columnCount; column++) {
+        batch->types[(size_t)column * (size_t)batch->capacity + (size_t)row] = SQLITE_NULL;
+    }
+
+    return row;
+}
+
+int SQLiteExtensionKit_BatchSetBytes(
+    SQLiteVirtualBatch *batch,
+    int row,
+    int column,
+    const void *bytes,
+    sqlite3_int64 length,
+    int type
+) {
+    size_t cell;
+
+    if (!batch || row < 0 || row >= batch->rowCount || column < 0
+        || column >= batch->columnCount || length < 0) {
+        return SQLITE_MISUSE;
+    }
+
+    if (batch->arenaUsed + length > batch->arenaCapacity) {
+        sqlite3_int64 capacity = batch->arenaCapacity ? batch->arenaCapacity : 4096;
+        unsigned char *arena;
+
+        while (capacity < batch->arenaUsed + length) {
+            capacity *= 2;
+        }
+
+        arena = sqlite3_realloc64(batch->arena, (sqlite3_uint64)capacity);
+        if (!arena) {
+            return SQLITE_NOMEM;
+        }
+        batch->arena = arena;
+        batch->arenaCapacity = capacity;
+    }
+
+    cell = (size_t)column * (size_t)batch->capacity + (size_t)row;
+    if (length > 0) {
+        memcpy(batch->arena + batch->arenaUsed, bytes, (size_t)length);
+    }
+    batch->types[cell] = (unsigned char)type;
+    batch->offsets[cell] = batch->arenaUsed;
+    batch->lengths[cell] = length;
+    batch->arenaUsed += length;
+    return SQLITE_OK;
+}
+
+/* Copies a sqlite3_value into a cell, keeping its storage class. */
+int SQLiteExtensionKit_BatchSetValue(
+    SQLiteVirtualBatch *batch,
+    int row,
+    int column,
+    sqlite3_value *value
+) {
+    size_t cell;
+
+    if (!batch || row < 0 || row >= batch->rowCount || column < 0
+        || column >= batch->columnCount) {
+        return SQLITE_MISUSE;
+    }
+
+    cell = (size_t)column * (size_t)batch->capacity + (size_t)row;
+
+    switch (sqlite3_value_type(value)) {
+    case SQLITE_INTEGER:
+        batch->integers[cell] = sqlite3_value_int64(value);
+        batch->types[cell] = SQLITE_INTEGER;
+        return SQLITE_OK;
+    case SQLITE_FLOAT:
+        batch->reals[cell] = sqlite3_value_double(value);
+        batch->types[cell] = SQLITE_FLOAT;
+        return SQLITE_OK;
+    case SQLITE_TEXT: {
+        const unsigned char *text = sqlite3_value_text(value);
+        return SQLiteExtensionKit_BatchSetBytes(
+            batch,
+            row,
+            column,
+            text,
+            text ? sqlite3_value_bytes(value) : 0,
+            SQLITE_TEXT
+        );
+    }
+    case SQLITE_BLOB: {
+        const void *blob = sqlite3_value_blob(value);
+        return SQLiteExtensionKit_BatchSetBytes(
+            batch,
+            row,
+            column,
+            blob,
+            blob ? sqlite3_value_bytes(value) : 0,
+            SQLITE_BLOB
+        );
+    }
+    default:
+        batch->types[cell] = SQLITE_NULL;
+        return SQLITE_OK;
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SQLITE_INSTRUMENTATION_SHIM_H
+#define SQLITE_INSTRUMENTATION_SHIM_H
+
+#include <stdint.h>
+
+/*
+** Counters for the opt-in instrumentation layer.
+**
+** Each probe owns a block of 64-bit counters split into stripes. A thread
+** always adds to the same stripe, so concurrent callers rarely share a cache
+** line, and readers sum the stripes. All accesses are relaxed atomics.
+*/
+
+/* Monotonic time in nanoseconds. */
+uint64_t SQLiteExtensionKit_MonotonicNanoseconds(void);
+
+/* A small integer fixed for the calling thread, assigned round-robin. */
+unsigned SQLiteExtensionKit_ThreadStripe(void);
+
+void SQLiteExtensionKit_CounterAdd(uint64_t *counter, uint64_t value);
+uint64_t SQLiteExtensionKit_CounterLoad(const uint64_t *counter);
+void SQLiteExtensionKit_CounterStore(uint64_t *counter, uint64_t value);
+
+#endif /* SQLITE_INSTRUMENTATION_SHIM_H */
@@ -5,6 +5,7 @@
 
 typedef struct SQLiteVirtualTable SQLiteVirtualTable;
 typedef struct SQLiteVirtualCursor SQLiteVirtualCursor;
+typedef struct SQLiteVirtualBatch SQLiteVirtualBatch;
 
 struct SQLiteVirtualTable {
     sqlite3_vtab base;
@@ -12,14 +13,65 @@ struct SQLiteVirtualTable {
     void *moduleContext;
 };
 
+/*
+** Fixed-capacity columnar row buffer filled by batch cursors.
+**
+** Cells are stored column-major: the cell for (row, column) lives at
+** index column * capacity + row of every per-cell array. Text and blob
+** bytes are appended to a shared arena and addressed by offset/length.
+** The arena and row count are reset before each refill.
+*/
+struct SQLiteVirtualBatch {
+    int capacity;
+    int columnCount;
+    int rowCount;
+    int position;
+    sqlite3_int64 *rowids;
+    unsigned char *types;
+    sqlite3_int64 *integers;
+    double *reals;
+    sqlite3_int64 *offsets;
+    sqlite3_int64 *lengths;
+    unsigned char *arena;
+    sqlite3_int64 arenaUsed;
+    sqlite3_int64 arenaCapacity;
+};
+
+/*
+** The eof flag is written by Swift after every xFilter and xNext, so xEof
+** is answered here without calling into Swift. Batch cursors use the batch
+** position instead.
+*/
 struct SQLiteVirtualCursor {
     sqlite3_vtab_cursor base;
     void *swiftCursor;
     SQLiteVirtualTable *table;
+    SQLiteVirtualBatch *batch;
+    int eof;
 };
 
 int SQLiteExtensionKit_CreateVirtualTableModule(sqlite3 *db, const char *name, void *context, void (*xDestroy)(void *));
+int SQLiteExtensionKit_CreateEponymousVirtualTableModule(sqlite3 *db, const char *name, void *context, void (*xDestroy)(void *));
 
 void SQLiteExtensionKit_VirtualTableSetError(sqlite3_vtab *vtab, const char *message);
 
+SQLiteVirtualBatch *SQLiteExtensionKit_BatchCreate(int columnCount, int capacity);
+void SQLiteExtensionKit_BatchFree(SQLiteVirtualBatch *batch);
+void SQLiteExtensionKit_BatchReset(SQLiteVirtualBatch *batch);
+int SQLiteExtensionKit_BatchAppendRow(SQLiteVirtualBatch *batch, sqlite3_int64 rowid);
+int SQLiteExtensionKit_BatchSetBytes(
+    SQLiteVirtualBatch *batch,
+    int row,
+    int column,
+    const void *bytes,
+    sqlite3_int64 length,
+    int type
+);
+int SQLiteExtensionKit_BatchSetValue(
+    SQLiteVirtualBatch *batch,
+    int row,
+    int column,
+    sqlite3_value *value
+);
+
 #endif /* SQLITE_VIRTUAL_TABLE_SHIM_H */
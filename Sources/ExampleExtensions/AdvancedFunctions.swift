@@ -27,102 +27,64 @@ public struct AdvancedFunctionsExtension: SQLiteExtensionModule {
     public static let name = "advanced_functions"
 
     public static func register(with db: SQLiteDatabase) throws {
-        // JSON extraction function
+        // JSON extraction function, reading only as far as the path needs
         try db.createScalarFunction(name: "json_extract_simple", argumentCount: 2, deterministic: true) { context, args in
             guard args.count == 2 else {
                 context.resultError("json_extract_simple() requires 2 arguments")
                 return
             }
-
-            let jsonString = args[0].textValue
-            let path = args[1].textValue
-
-            guard let data = jsonString.data(using: .utf8) else {
+            guard !args[0].isNull else {
                 context.resultNull()
                 return
             }
 
+            let path: JSONPath
             do {
-                let json = try JSONSerialization.jsonObject(with: data)
-
-                // Simple path extraction (supports $.key or $.key.subkey)
-                let keys = path.dropFirst(2).split(separator: ".").map(String.init)
+                path = try context.auxiliaryData(forArgument: 1) {
+                    try JSONPath(args[1].textValue)
+                }
+            } catch {
+                context.resultError("json_extract_simple() invalid path: \(args[1].textValue)")
+                return
+            }
 
-                var current: Any = json
-                for key in keys {
-                    if let dict = current as? [String: Any] {
-                        guard let value = dict[key] else {
-                            context.resultNull()
-                            return
-                        }
-                        current = value
-                    } else if let array = current as? [Any], let index = Int(key) {
-                        guard index < array.count else {
-                            context.resultNull()
-                            return
-                        }
-                        current = array[index]
-                    } else {
+            args[0].withUTF8Bytes { utf8 in
+                var scanner = JSONScanner(UnsafeRawBufferPointer(utf8))
+                do {
+                    guard try path.locate(in: &scanner) else {
                         context.resultNull()
                         return
                     }
+                    try scanner.setResult(in: context)
+                } catch {
+                    context.resultError("Invalid JSON: \(error)")
                 }
-
-                // Convert result to appropriate type
-                if let string = current as? String {
-                    context.result(string)
-                } else if let number = current as? Int {
-                    context.result(Int64(number))
-                } else if let number = current as? Double {
-                    context.result(number)
-                } else if let bool = current as? Bool {
-                    context.result(Int64(bool ? 1 : 0))
-                } else {
-                    // For complex types, return as JSON string
-                    let resultData = try JSONSerialization.data(withJSONObject: current)
-                    context.result(String(data: resultData, encoding: .utf8) ?? "")
-                }
-            } catch {
-                context.resultError("Invalid JSON: \(error.localizedDescription)")
             }
         }
 
-        // JSON array contains
+        // JSON array contains, stopping at the first match
         try db.createScalarFunction(name: "json_array_contains", argumentCount: 2, deterministic: true) { context, args in
             guard args.count == 2 else {
                 context.resultError("json_array_contains() requires 2 arguments")
                 return
             }
 
-            let jsonString = args[0].textValue
-            let searchValue = args[1].textValue
-
-            guard let data = jsonString.data(using: .utf8) else {
-                context.result(Int64(0))
-                return
+            let search = context.auxiliaryData(forArgument: 1) {
+                JSONArraySearch(args[1].textValue)
             }
 
-            do {
-                guard let array = try JSONSerialization.jsonObject(with: data) as? [Any] else {
-                    context.result(Int64(0))
-                    return
-                }
-
-                let contains = array.contains { element in
-                    if let str = element as? String {
-                        return str == searchValue
-                    } else if let num = element as? Int {
-                        return String(num) == searchValue
-                    } else if let num = element as? Double {
-                        return String(num) == searchValue
+            let contains = args[0].withUTF8Bytes { utf8 in
+                var scanner = JSONScanner(UnsafeRawBufferPointer(utf8))
+                do {
+                    guard try scanner.valueKind() == .array else { return false }
+                    return try scanner.forEachElement { element in
+                        try !search.matches(&element)
                     }
+                } catch {
                     return false
                 }
-
-                context.result(Int64(contains ? 1 : 0))
-            } catch {
-                context.result(Int64(0))
             }
+            context.result(Int64(contains ? 1 : 0))
         }
 
         // Regular expression matching
@@ -133,10 +95,9 @@ public struct AdvancedFunctionsExtension: SQLiteExtensionModule {
             }
 
             let text = args[0].textValue
-            let pattern = args[1].textValue
 
             do {
-                let regex = try NSRegularExpression(pattern: pattern)
+                let regex = try compiledRegex(context: context, pattern: args[1]).expression
                 let range = NSRange(text.startIndex..., in: text)
                 let matches = regex.firstMatch(in: text, range: range) != nil
                 context.result(Int64(matches ? 1 : 0))
@@ -153,11 +114,10 @@ public struct AdvancedFunctionsExtension: SQLiteExtensionModule {
             }
 
             let text = args[0].textValue
-            let pattern = args[1].textValue
             let replacement = args[2].textValue
 
             do {
-                let regex = try NSRegularExpression(pattern: pattern)
+                let regex = try compiledRegex(context: context, pattern: args[1]).expression
                 let range = NSRange(text.startIndex..., in: text)
                 let result = regex.stringByReplacingMatches(
                     in: text,
@@ -170,19 +130,35 @@ public struct AdvancedFunctionsExtension: SQLiteExtensionModule {
             }
         }
 
-        // Levenshtein distance (edit distance)
-        try db.createScalarFunction(name: "levenshtein", argumentCount: 2, deterministic: true) { context, args in
-            guard args.count == 2 else {
-                context.resultError("levenshtein() requires 2 arguments")
+        // Levenshtein distance (edit distance), optionally bounded by a maximum distance
+        let editDistance = EditDistanceCalculator()
+        let levenshtein: BorrowingScalarFunction = { context, args in
+            guard !args[0].isNull, !args[1].isNull else {
+                context.resultNull()
                 return
             }
+            var maximum: Int?
+            if args.count > 2, !args[2].isNull {
+                guard args[2].intValue >= 0 else {
+                    context.resultError("levenshtein() max_distance must not be negative")
+                    return
+                }
+                maximum = Int(clamping: args[2].intValue)
+            }
 
-            let s1 = args[0].textValue
-            let s2 = args[1].textValue
-
-            let distance = calculateLevenshtein(s1, s2)
+            let distance = args[0].withUTF8Bytes { left in
+                args[1].withUTF8Bytes { right in
+                    editDistance.distance(
+                        UnsafeRawBufferPointer(left),
+                        UnsafeRawBufferPointer(right),
+                        maximum: maximum
+                    )
+                }
+            }
             context.result(Int64(distance))
         }
+        try db.createScalarFunction(name: "levenshtein", argumentCount: 2, deterministic: true, function: levenshtein)
+        try db.createScalarFunction(name: "levenshtein", argumentCount: 3, deterministic: true, function: levenshtein)
 
         // UUID generation
         try db.createScalarFunction(name: "uuid", argumentCount: 0, deterministic: false) { context, _ in
@@ -206,9 +182,14 @@ public struct AdvancedFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let text = first.textValue
-            let encoded = text.addingPercentEncoding(withAllowedCharacters: .urlQueryAllowed) ?? text
-            context.result(encoded)
+            first.withUTF8Bytes { utf8 in
+                let bytes = UnsafeRawBufferPointer(utf8)
+                let count = TextKernels.urlEncodedCount(bytes)
+                context.result(capacity: count) { output in
+                    TextKernels.urlEncode(bytes, into: output.baseAddress!)
+                    return .text(count: count)
+                }
+            }
         }
 
         try db.createScalarFunction(name: "url_decode", argumentCount: 1, deterministic: true) { context, args in
@@ -226,33 +207,29 @@ public struct AdvancedFunctionsExtension: SQLiteExtensionModule {
 
 // MARK: - Helper Functions
 
-/// Calculates Levenshtein distance between two strings
-private func calculateLevenshtein(_ s1: String, _ s2: String) -> Int {
-    let s1Array = Array(s1)
-    let s2Array = Array(s2)
-
-    var matrix = Array(repeating: Array(repeating: 0, count: s2Array.count + 1), count: s1Array.count + 1)
+/// A compiled regular expression shared between rows and connections.
+final class CompiledRegex: @unchecked Sendable {
+    let expression: NSRegularExpression
 
-    for i in 0...s1Array.count {
-        matrix[i][0] = i
+    init(pattern: String) throws {
+        expression = try NSRegularExpression(pattern: pattern)
     }
+}
 
-    for j in 0...s2Array.count {
-        matrix[0][j] = j
-    }
+/// Recently used patterns, for queries whose pattern argument changes per row.
+let regexCache = SQLiteLRUCache<String, CompiledRegex>(capacity: 64)
 
-    for i in 1...s1Array.count {
-        for j in 1...s2Array.count {
-            let cost = s1Array[i - 1] == s2Array[j - 1] ? 0 : 1
-            matrix[i][j] = min(
-                matrix[i - 1][j] + 1,      // deletion
-                matrix[i][j - 1] + 1,      // insertion
-                matrix[i - 1][j - 1] + cost // substitution
-            )
+/// Returns the compiled form of the pattern argument at index 1.
+///
+/// Constant patterns are compiled once per prepared statement and kept as auxiliary
+/// data on the argument. Patterns that vary per row fall back to `regexCache`.
+private func compiledRegex(context: SQLiteContext, pattern: SQLiteValue) throws -> CompiledRegex {
+    try context.auxiliaryData(forArgument: 1) {
+        let pattern = pattern.textValue
+        return try regexCache.value(forKey: pattern) {
+            try CompiledRegex(pattern: pattern)
         }
     }
-
-    return matrix[s1Array.count][s2Array.count]
 }
 
 /// Entry point for the advanced functions extension.
@@ -0,0 +1,324 @@
+/// Vectorised byte kernels behind the data functions.
+///
+/// Every kernel reads a borrowed input buffer and writes into caller-provided output, so a
+/// function can encode straight into its result allocation. The main loops work on 16
+/// bytes at a time with portable `SIMD` vectors, which lower to SSE on x86-64 and NEON on
+/// ARM, and validation is a vector mask test per block; only the last partial block, or a
+/// block that fails validation, is handled one byte at a time. Vector loads and stores are
+/// unaligned, and lanes wider than a byte assume a little-endian host, as on every
+/// platform this package supports.
+enum ByteKernels {
+    enum HexDecodeError: Error {
+        case invalidDigit
+        case oddLength
+    }
+
+    // MARK: Hex
+
+    /// Writes two hexadecimal digits per input byte, `2 * input.count` bytes in total.
+    static func hexEncode(
+        _ input: UnsafeRawBufferPointer,
+        into output: UnsafeMutableRawPointer,
+        uppercase: Bool = true
+    ) {
+        guard let source = input.baseAddress else { return }
+        let letterOffset: UInt8 = uppercase ? 55 : 87  // "A" - 10 or "a" - 10
+        let count = input.count
+        var index = 0
+
+        while index + 16 <= count {
+            let bytes = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            let high = hexDigits(bytes &>> 4, letterOffset: letterOffset)
+            let low = hexDigits(bytes & 0x0F, letterOffset: letterOffset)
+            // Each 16-bit lane holds a high digit followed by its low digit.
+            let pairs = SIMD16<UInt16>(truncatingIfNeeded: high) | (SIMD16<UInt16>(truncatingIfNeeded: low) &<< 8)
+            output.storeBytes(of: pairs, toByteOffset: index * 2, as: SIMD16<UInt16>.self)
+            index += 16
+        }
+
+        while index < count {
+            let byte = source.load(fromByteOffset: index, as: UInt8.self)
+            output.storeBytes(of: hexDigit(byte >> 4, letterOffset: letterOffset), toByteOffset: index * 2, as: UInt8.self)
+            output.storeBytes(of: hexDigit(byte & 0x0F, letterOffset: letterOffset), toByteOffset: index * 2 + 1, as: UInt8.self)
+            index += 1
+        }
+    }
+
+    /// Decodes hexadecimal digits in either case, ignoring spaces, into at most
+    /// `input.count / 2` bytes.
+    ///
+    /// - Returns: The number of bytes written, or why the input is not valid hex.
+    static func hexDecode(
+        _ input: UnsafeRawBufferPointer,
+        into output: UnsafeMutableRawPointer
+    ) -> Result<Int, HexDecodeError> {
+        guard let source = input.baseAddress else { return .success(0) }
+        let count = input.count
+        var index = 0
+        var written = 0
+
+        // 32 digits without separators become 16 bytes. A block with a space or an invalid
+        // digit leaves the rest of the input to the byte loop, which reports the error.
+        while index + 32 <= count {
+            let first = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt16>.self)
+            guard let high = hexValues(SIMD16<UInt8>(truncatingIfNeeded: first)),
+                  let low = hexValues(SIMD16<UInt8>(truncatingIfNeeded: first &>> 8)) else {
+                break
+            }
+            output.storeBytes(of: (high &<< 4) | low, toByteOffset: written, as: SIMD16<UInt8>.self)
+            index += 32
+            written += 16
+        }
+
+        var pending: UInt8?
+        while index < count {
+            let character = source.load(fromByteOffset: index, as: UInt8.self)
+            index += 1
+            if character == UInt8(ascii: " ") {
+                continue
+            }
+            guard let nibble = hexValue(character) else {
+                return .failure(.invalidDigit)
+            }
+            if let high = pending {
+                output.storeBytes(of: high << 4 | nibble, toByteOffset: written, as: UInt8.self)
+                written += 1
+                pending = nil
+            } else {
+                pending = nibble
+            }
+        }
+
+        return pending == nil ? .success(written) : .failure(.oddLength)
+    }
+
+    private static func hexDigits(_ nibbles: SIMD16<UInt8>, letterOffset: UInt8) -> SIMD16<UInt8> {
+        var digits = nibbles &+ 48  // "0"
+        digits.replace(with: nibbles &+ letterOffset, where: nibbles .> 9)
+        return digits
+    }
+
+    private static func hexDigit(_ nibble: UInt8, letterOffset: UInt8) -> UInt8 {
+        nibble > 9 ? nibble &+ letterOffset : nibble &+ 48
+    }
+
+    /// The values of 16 hex digits, or `nil` if any byte is not one.
+    private static func hexValues(_ characters: SIMD16<UInt8>) -> SIMD16<UInt8>? {
+        let digits = characters &- 48            // "0"
+        let letters = (characters | 0x20) &- 97  // "a", folding case
+        let isDigit = digits .< 10
+        guard all(isDigit .| (letters .< 6)) else { return nil }
+        var values = letters &+ 10
+        values.replace(with: digits, where: isDigit)
+        return values
+    }
+
+    private static func hexValue(_ character: UInt8) -> UInt8? {
+        let digit = character &- 48
+        if digit < 10 { return digit }
+        let letter = (character | 0x20) &- 97
+        return letter < 6 ? letter + 10 : nil
+    }
+
+    // MARK: Base64
+
+    /// The length of the padded base64 encoding of `count` bytes.
+    static func base64EncodedCount(_ count: Int) -> Int {
+        (count + 2) / 3 * 4
+    }
+
+    /// Writes the standard, padded base64 encoding, ``base64EncodedCount(_:)`` bytes.
+    static func base64Encode(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) {
+        guard let source = input.baseAddress else { return }
+        let count = input.count
+        var index = 0
+        var written = 0
+
+        // 12 input bytes become 16 characters: each 32-bit lane holds one 3-byte group and
+        // is split into four sextets in place. The last lane reads one byte past its group.
+        while index + 13 <= count {
+            let words = SIMD4<UInt32>(
+                UInt32(littleEndian: source.loadUnaligned(fromByteOffset: index, as: UInt32.self)),
+                UInt32(littleEndian: source.loadUnaligned(fromByteOffset: index + 3, as: UInt32.self)),
+                UInt32(littleEndian: source.loadUnaligned(fromByteOffset: index + 6, as: UInt32.self)),
+                UInt32(littleEndian: source.loadUnaligned(fromByteOffset: index + 9, as: UInt32.self))
+            )
+            let first = (words &>> 2) & 0x3F
+            let second = ((words &<< 4) & 0x30) | ((words &>> 12) & 0x0F)
+            let third = ((words &>> 6) & 0x3C) | ((words &>> 22) & 0x03)
+            let fourth = (words &>> 16) & 0x3F
+            let sextets = first | (second &<< 8) | (third &<< 16) | (fourth &<< 24)
+            let characters = base64Characters(unsafeBitCast(sextets, to: SIMD16<UInt8>.self))
+            output.storeBytes(of: characters, toByteOffset: written, as: SIMD16<UInt8>.self)
+            index += 12
+            written += 16
+        }
+
+        func put(_ character: UInt8) {
+            output.storeBytes(of: character, toByteOffset: written, as: UInt8.self)
+            written += 1
+        }
+
+        while index < count {
+            let remaining = count - index
+            let b0 = source.load(fromByteOffset: index, as: UInt8.self)
+            let b1 = remaining > 1 ? source.load(fromByteOffset: index + 1, as: UInt8.self) : 0
+            let b2 = remaining > 2 ? source.load(fromByteOffset: index + 2, as: UInt8.self) : 0
+            put(base64Alphabet[Int(b0 >> 2)])
+            put(base64Alphabet[Int((b0 & 0x03) << 4 | b1 >> 4)])
+            put(remaining > 1 ? base64Alphabet[Int((b1 & 0x0F) << 2 | b2 >> 6)] : UInt8(ascii: "="))
+            put(remaining > 2 ? base64Alphabet[Int(b2 & 0x3F)] : UInt8(ascii: "="))
+            index += 3
+        }
+    }
+
+    /// Decodes standard, padded base64 into at most `input.count / 4 * 3` bytes.
+    ///
+    /// The input length must be a multiple of four and `=` may only pad the final group.
+    ///
+    /// - Returns: The number of bytes written, or `nil` if the input is not valid base64.
+    static func base64Decode(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) -> Int? {
+        let count = input.count
+        guard count % 4 == 0 else { return nil }
+        guard let source = input.baseAddress else { return 0 }
+        var index = 0
+        var written = 0
+
+        // 16 characters become 12 bytes. The final group, which may be padded, is always
+        // left to the scalar loop; stopping there also leaves room for the 4-byte stores.
+        while index + 20 <= count {
+            let characters = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            guard let values = base64Values(characters) else { break }
+            let words = unsafeBitCast(values, to: SIMD4<UInt32>.self)
+            let first = words & 0x3F
+            let second = (words &>> 8) & 0x3F
+            let third = (words &>> 16) & 0x3F
+            let fourth = words &>> 24
+            let bytes = ((first &<< 2) | (second &>> 4))
+                | ((((second & 0x0F) &<< 4) | (third &>> 2)) &<< 8)
+                | ((((third & 0x03) &<< 6) | fourth) &<< 16)
+            for lane in 0..<4 {
+                output.storeBytes(of: bytes[lane].littleEndian, toByteOffset: written + lane * 3, as: UInt32.self)
+            }
+            index += 16
+            written += 12
+        }
+
+        while index < count {
+            let isFinal = index + 4 == count
+            var group: UInt32 = 0
+            var padding = 0
+            for offset in 0..<4 {
+                let character = source.load(fromByteOffset: index + offset, as: UInt8.self)
+                if character == UInt8(ascii: "="), isFinal, offset >= 2 {
+                    padding += 1
+                    group <<= 6
+                    continue
+                }
+                guard padding == 0, let value = base64Value(character) else { return nil }
+                group = group << 6 | UInt32(value)
+            }
+            output.storeBytes(of: UInt8(truncatingIfNeeded: group >> 16), toByteOffset: written, as: UInt8.self)
+            if padding < 2 {
+                output.storeBytes(of: UInt8(truncatingIfNeeded: group >> 8), toByteOffset: written + 1, as: UInt8.self)
+            }
+            if padding < 1 {
+                output.storeBytes(of: UInt8(truncatingIfNeeded: group), toByteOffset: written + 2, as: UInt8.self)
+            }
+            written += 3 - padding
+            index += 4
+        }
+        return written
+    }
+
+    /// Maps sextets to the standard alphabet by adding a per-range offset.
+    private static func base64Characters(_ sextets: SIMD16<UInt8>) -> SIMD16<UInt8> {
+        var offsets = SIMD16<UInt8>(repeating: 65)            // "A" for 0...25
+        offsets.replace(with: 71, where: sextets .>= 26)      // "a" - 26
+        offsets.replace(with: 252, where: sextets .>= 52)     // "0" - 52, wrapping
+        offsets.replace(with: 237, where: sextets .== 62)     // "+" - 62, wrapping
+        offsets.replace(with: 240, where: sextets .== 63)     // "/" - 63, wrapping
+        return sextets &+ offsets
+    }
+
+    /// The sextets of 16 base64 characters, or `nil` if any is outside the alphabet.
+    private static func base64Values(_ characters: SIMD16<UInt8>) -> SIMD16<UInt8>? {
+        let upper = characters &- 65
+        let lower = characters &- 97
+        let digit = characters &- 48
+        var values = SIMD16<UInt8>(repeating: 0xFF)
+        values.replace(with: upper, where: upper .< 26)
+        values.replace(with: lower &+ 26, where: lower .< 26)
+        values.replace(with: digit &+ 52, where: digit .< 10)
+        values.replace(with: 62, where: characters .== 43)  // "+"
+        values.replace(with: 63, where: characters .== 47)  // "/"
+        guard all(values .< 64) else { return nil }
+        return values
+    }
+
+    private static func base64Value(_ character: UInt8) -> UInt8? {
+        switch character {
+        case UInt8(ascii: "A")...UInt8(ascii: "Z"): return character - 65
+        case UInt8(ascii: "a")...UInt8(ascii: "z"): return character - 71
+        case UInt8(ascii: "0")...UInt8(ascii: "9"): return character + 4
+        case UInt8(ascii: "+"): return 62
+        case UInt8(ascii: "/"): return 63
+        default: return nil
+        }
+    }
+
+    private static let base64Alphabet: [UInt8] = Array(
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/".utf8
+    )
+
+    // MARK: Bytes
+
+    /// Writes `input` in reverse order, `input.count` bytes.
+    static func reverse(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) {
+        guard let source = input.baseAddress else { return }
+        let count = input.count
+        var index = 0
+
+        // Byte-swapping the two words that end 16 bytes from the back reverses a block.
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: count - index - 16, as: SIMD2<UInt64>.self)
+            output.storeBytes(
+                of: SIMD2(block[1].byteSwapped, block[0].byteSwapped),
+                toByteOffset: index,
+                as: SIMD2<UInt64>.self
+            )
+            index += 16
+        }
+
+        while index < count {
+            output.storeBytes(
+                of: source.load(fromByteOffset: count - index - 1, as: UInt8.self),
+                toByteOffset: index,
+                as: UInt8.self
+            )
+            index += 1
+        }
+    }
+
+    /// Whether `bytes` is valid UTF-8, checked 16 bytes at a time while they are ASCII.
+    static func isValidUTF8(_ bytes: UnsafeRawBufferPointer) -> Bool {
+        guard let source = bytes.baseAddress else { return true }
+        var index = 0
+        while index + 16 <= bytes.count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            guard all(block .< 0x80) else { break }
+            index += 16
+        }
+        guard index < bytes.count else { return true }
+
+        let rest = UnsafeRawBufferPointer(rebasing: bytes[index...])
+        let hadError = transcode(
+            rest.makeIterator(),
+            from: UTF8.self,
+            to: UTF8.self,
+            stoppingOnError: true,
+            into: { _ in }
+        )
+        return !hadError
+    }
+}
@@ -12,6 +12,10 @@ import CryptoKit
 /// - `base64_encode(blob)`: Encodes binary data as base64
 /// - `base64_decode(text)`: Decodes base64 to binary data
 /// - `sha256(data)`: Computes SHA-256 hash (when CryptoKit is available)
+/// - `sha256_blob(table, column, rowid [, schema])`: Hashes a stored blob in 64 KiB chunks
+///   without loading it into memory (when CryptoKit is available)
+/// - `blob_chunks(table, column, rowid [, chunk_size [, schema]])`: Returns a stored blob as
+///   rows of `start` and `chunk`, reading one chunk per row
 ///
 /// ## Usage in SQL
 /// ```sql
@@ -20,6 +24,8 @@ import CryptoKit
 /// SELECT base64_encode('Hello');           -- Returns 'SGVsbG8='
 /// SELECT base64_decode('SGVsbG8=');        -- Returns 'Hello'
 /// SELECT sha256('Hello, World!');          -- Returns hash as hex string
+/// SELECT sha256_blob('firmware', 'image', 42);
+/// SELECT start, length(chunk) FROM blob_chunks('firmware', 'image', 42, 1048576);
 /// ```
 public struct DataFunctionsExtension: SQLiteExtensionModule {
     public static let name = "data_functions"
@@ -32,9 +38,12 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let data = first.blobValue
-            let hexString = data.map { String(format: "%02X", $0) }.joined()
-            context.result(hexString)
+            first.withBlobBytes { bytes in
+                context.result(capacity: bytes.count * 2) { output in
+                    ByteKernels.hexEncode(bytes, into: output.baseAddress!)
+                    return .text(count: bytes.count * 2)
+                }
+            }
         }
 
         // Hex decode
@@ -44,30 +53,20 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let hexString = first.textValue.replacingOccurrences(of: " ", with: "")
-
-            guard hexString.count % 2 == 0 else {
-                context.resultError("hex_decode() requires even-length hex string")
-                return
-            }
-
-            var data = Data()
-            var index = hexString.startIndex
-
-            while index < hexString.endIndex {
-                let nextIndex = hexString.index(index, offsetBy: 2)
-                let byteString = hexString[index..<nextIndex]
-
-                guard let byte = UInt8(byteString, radix: 16) else {
-                    context.resultError("hex_decode() invalid hex string")
-                    return
+            first.withUTF8Bytes { utf8 in
+                context.result(capacity: utf8.count / 2) { output in
+                    switch ByteKernels.hexDecode(UnsafeRawBufferPointer(utf8), into: output.baseAddress!) {
+                    case .success(let count):
+                        return .blob(count: count)
+                    case .failure(.invalidDigit):
+                        context.resultError("hex_decode() invalid hex string")
+                        return nil
+                    case .failure(.oddLength):
+                        context.resultError("hex_decode() requires even-length hex string")
+                        return nil
+                    }
                 }
-
-                data.append(byte)
-                index = nextIndex
             }
-
-            context.result(data)
         }
 
         // Base64 encode
@@ -77,15 +76,14 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let data: Data
-            if first.type == .blob {
-                data = first.blobValue
-            } else {
-                data = first.textValue.data(using: .utf8) ?? Data()
+            // Text values expose their UTF-8 encoding, so both cases borrow the same buffer.
+            first.withBlobBytes { bytes in
+                let count = ByteKernels.base64EncodedCount(bytes.count)
+                context.result(capacity: count) { output in
+                    ByteKernels.base64Encode(bytes, into: output.baseAddress!)
+                    return .text(count: count)
+                }
             }
-
-            let base64 = data.base64EncodedString()
-            context.result(base64)
         }
 
         // Base64 decode
@@ -95,18 +93,17 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let base64String = first.textValue
-
-            guard let data = Data(base64Encoded: base64String) else {
-                context.resultError("base64_decode() invalid base64 string")
-                return
-            }
+            first.withUTF8Bytes { utf8 in
+                context.result(capacity: utf8.count / 4 * 3) { output in
+                    guard let count = ByteKernels.base64Decode(UnsafeRawBufferPointer(utf8), into: output.baseAddress!) else {
+                        context.resultError("base64_decode() invalid base64 string")
+                        return nil
+                    }
 
-            // Try to decode as UTF-8 string, otherwise return as blob
-            if let string = String(data: data, encoding: .utf8) {
-                context.result(string)
-            } else {
-                context.result(data)
+                    // Return valid UTF-8 as text, anything else as a blob
+                    let decoded = UnsafeRawBufferPointer(start: output.baseAddress, count: count)
+                    return ByteKernels.isValidUTF8(decoded) ? .text(count: count) : .blob(count: count)
+                }
             }
         }
 
@@ -117,6 +114,7 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
+            // sqlite3_value_bytes reports the length without reading the value.
             let count = first.bytes
             context.result(Int64(count))
         }
@@ -129,19 +127,73 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let data: Data
-            if first.type == .blob {
-                data = first.blobValue
-            } else {
-                data = first.textValue.data(using: .utf8) ?? Data()
+            let hash = first.withBlobBytes { bytes in
+                SHA256.hash(data: bytes)
+            }
+            hash.withUnsafeBytes { digest in
+                context.result(capacity: digest.count * 2) { output in
+                    ByteKernels.hexEncode(digest, into: output.baseAddress!, uppercase: false)
+                    return .text(count: digest.count * 2)
+                }
+            }
+        }
+
+        // SHA-256 of a stored blob, read incrementally so memory stays at one chunk
+        let hashStoredBlob: BorrowingScalarFunction = { context, args in
+            guard !args[0].isNull, !args[1].isNull, !args[2].isNull else {
+                context.resultNull()
+                return
+            }
+
+            var hasher = SHA256()
+            do {
+                let blob = try db.openBlob(
+                    table: args[0].textValue,
+                    column: args[1].textValue,
+                    rowid: args[2].intValue,
+                    schema: args.count > 3 ? args[3].textValue : "main"
+                )
+                try blob.forEachChunk { chunk in
+                    hasher.update(bufferPointer: chunk)
+                }
+            } catch {
+                context.resultError("sha256_blob() \(String(cString: sqlite3_errmsg(db.pointer)))")
+                return
             }
 
-            let hash = SHA256.hash(data: data)
-            let hashString = hash.map { String(format: "%02x", $0) }.joined()
-            context.result(hashString)
+            hasher.finalize().withUnsafeBytes { digest in
+                context.result(capacity: digest.count * 2) { output in
+                    ByteKernels.hexEncode(digest, into: output.baseAddress!, uppercase: false)
+                    return .text(count: digest.count * 2)
+                }
+            }
         }
+        try db.createScalarFunction(name: "sha256_blob", argumentCount: 3, function: hashStoredBlob)
+        try db.createScalarFunction(name: "sha256_blob", argumentCount: 4, function: hashStoredBlob)
         #endif
 
+        // A stored blob as a sequence of chunks, one read per row
+        try db.createTableValuedFunction(
+            name: "blob_chunks",
+            columns: ["start INTEGER", "chunk BLOB"],
+            parameters: ["source_table", "source_column", "source_rowid", "chunk_size", "source_schema"]
+        ) { arguments in
+            guard let table = arguments[0], let column = arguments[1], let rowid = arguments[2] else {
+                return BlobChunks(blob: nil, chunkSize: 0)
+            }
+            let chunkSize = arguments[3].map { Int(clamping: $0.intValue) } ?? SQLiteBlob.defaultChunkSize
+            guard chunkSize > 0 else {
+                throw SQLiteExtensionError.sqliteError(code: SQLITE_RANGE)
+            }
+            let blob = try db.openBlob(
+                table: table.textValue,
+                column: column.textValue,
+                rowid: rowid.intValue,
+                schema: arguments[4]?.textValue ?? "main"
+            )
+            return BlobChunks(blob: blob, chunkSize: chunkSize)
+        }
+
         // Reverse bytes
         try db.createScalarFunction(name: "reverse_bytes", argumentCount: 1, deterministic: true) { context, args in
             guard let first = args.first else {
@@ -149,9 +201,47 @@ public struct DataFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let data = first.blobValue
-            context.result(Data(data.reversed()))
+            first.withBlobBytes { bytes in
+                context.result(capacity: bytes.count) { output in
+                    ByteKernels.reverse(bytes, into: output.baseAddress!)
+                    return .blob(count: bytes.count)
+                }
+            }
+        }
+    }
+}
+
+/// The rows of `blob_chunks`: each reads the next chunk of the blob into a buffer that
+/// is handed to SQLite without another copy.
+///
+/// A read that fails, because the row changed during the scan, ends the rows with its
+/// error, which fails the statement.
+struct BlobChunks: Sequence, FailableRowIterator {
+    let blob: SQLiteBlob?
+    let chunkSize: Int
+    private(set) var failure: (any Error)?
+    private var offset = 0
+
+    init(blob: SQLiteBlob?, chunkSize: Int) {
+        self.blob = blob
+        self.chunkSize = chunkSize
+    }
+
+    mutating func next() -> [ColumnValue]? {
+        guard let blob, failure == nil, offset < blob.count else { return nil }
+        let length = min(chunkSize, blob.count - offset)
+        let chunk: SQLiteResultBuffer
+        do {
+            chunk = try SQLiteResultBuffer(capacity: length) { buffer in
+                try blob.read(into: buffer, at: offset)
+                return length
+            }
+        } catch {
+            failure = error
+            return nil
         }
+        defer { offset += length }
+        return [.integer(Int64(offset)), .blobBuffer(chunk)]
     }
 }
 
@@ -0,0 +1,558 @@
+import SQLiteExtensionKit
+import Foundation
+
+// MARK: - JSON Scanner
+
+/// An on-demand reader over borrowed JSON text.
+///
+/// The scanner never builds a document tree. It reads only as far as a lookup needs:
+/// members and elements before the one wanted are skipped without being decoded, and the
+/// rest of the document after it is never read. Skipping works 16 bytes at a time with
+/// portable `SIMD` vectors, in the spirit of simdjson's structural index: inside a string
+/// a block without `"` or `\` is passed over whole, and inside a container so is a block
+/// without quotes or brackets.
+///
+/// Because unread input is not examined, a document that is malformed after the value
+/// found is not reported as invalid.
+struct JSONScanner {
+    /// Why the input could not be scanned.
+    enum ScanError: Error, CustomStringConvertible {
+        case unexpectedCharacter(offset: Int)
+        case unexpectedEnd
+
+        var description: String {
+            switch self {
+            case .unexpectedCharacter(let offset):
+                return "unexpected character at byte \(offset)"
+            case .unexpectedEnd:
+                return "unexpected end of input"
+            }
+        }
+    }
+
+    /// The kinds of JSON value, as told by their first byte.
+    enum ValueKind {
+        case string, number, object, array, boolean, null
+    }
+
+    private let bytes: UnsafeRawBufferPointer
+    private(set) var position = 0
+
+    init(_ bytes: UnsafeRawBufferPointer) {
+        self.bytes = bytes
+    }
+
+    private var count: Int { bytes.count }
+
+    /// The byte at the current position, or zero at the end.
+    private func peek() -> UInt8 {
+        position < count ? bytes[position] : 0
+    }
+
+    private func loadBlock(at offset: Int) -> SIMD16<UInt8> {
+        bytes.baseAddress!.loadUnaligned(fromByteOffset: offset, as: SIMD16<UInt8>.self)
+    }
+
+    private func unexpected() -> ScanError {
+        position < count ? .unexpectedCharacter(offset: position) : .unexpectedEnd
+    }
+
+    private mutating func expect(_ byte: UInt8) throws {
+        guard peek() == byte else { throw unexpected() }
+        position += 1
+    }
+
+    mutating func skipWhitespace() {
+        while position + 16 <= count {
+            let block = loadBlock(at: position)
+            let whitespace = (block .== 0x20) .| (block .== 0x0A) .| (block .== 0x0D) .| (block .== 0x09)
+            guard all(whitespace) else { break }
+            position += 16
+        }
+        while position < count {
+            switch bytes[position] {
+            case 0x20, 0x0A, 0x0D, 0x09:
+                position += 1
+            default:
+                return
+            }
+        }
+    }
+
+    /// The kind of the value at the current position, after any whitespace.
+    mutating func valueKind() throws -> ValueKind {
+        skipWhitespace()
+        switch peek() {
+        case UInt8(ascii: "\""): return .string
+        case UInt8(ascii: "{"): return .object
+        case UInt8(ascii: "["): return .array
+        case UInt8(ascii: "t"), UInt8(ascii: "f"): return .boolean
+        case UInt8(ascii: "n"): return .null
+        case UInt8(ascii: "-"), UInt8(ascii: "0")...UInt8(ascii: "9"): return .number
+        default: throw unexpected()
+        }
+    }
+
+    // MARK: Reading Values
+
+    /// Reads a string, returning the bytes between its quotes, still escaped.
+    mutating func readString() throws -> (contents: UnsafeRawBufferPointer, hasEscapes: Bool) {
+        try expect(UInt8(ascii: "\""))
+        let start = position
+        var hasEscapes = false
+
+        while true {
+            while position + 16 <= count {
+                let block = loadBlock(at: position)
+                guard !any((block .== 0x22) .| (block .== 0x5C)) else { break }  // " or \
+                position += 16
+            }
+            guard position < count else { throw ScanError.unexpectedEnd }
+
+            switch bytes[position] {
+            case UInt8(ascii: "\""):
+                let contents = UnsafeRawBufferPointer(rebasing: bytes[start..<position])
+                position += 1
+                return (contents, hasEscapes)
+            case UInt8(ascii: "\\"):
+                hasEscapes = true
+                position += 2
+            default:
+                position += 1
+            }
+        }
+    }
+
+    /// Reads a number, returning its literal text and whether it is written as an integer.
+    mutating func readNumber() throws -> (literal: UnsafeRawBufferPointer, isInteger: Bool) {
+        let start = position
+        var isInteger = true
+        scan: while position < count {
+            switch bytes[position] {
+            case UInt8(ascii: "0")...UInt8(ascii: "9"), UInt8(ascii: "-"), UInt8(ascii: "+"):
+                break
+            case UInt8(ascii: "."), UInt8(ascii: "e"), UInt8(ascii: "E"):
+                isInteger = false
+            default:
+                break scan
+            }
+            position += 1
+        }
+        guard position > start else { throw unexpected() }
+        return (UnsafeRawBufferPointer(rebasing: bytes[start..<position]), isInteger)
+    }
+
+    /// Reads `true` or `false`.
+    mutating func readBoolean() throws -> Bool {
+        let value = peek() == UInt8(ascii: "t")
+        try readLiteral(value ? "true" : "false")
+        return value
+    }
+
+    /// Reads a literal such as `null`.
+    mutating func readLiteral(_ literal: StaticString) throws {
+        let length = literal.utf8CodeUnitCount
+        guard position + length <= count,
+              memcmp(bytes.baseAddress! + position, literal.utf8Start, length) == 0 else {
+            throw unexpected()
+        }
+        position += length
+    }
+
+    /// Reads an object or array without decoding it, returning its text.
+    mutating func readContainer() throws -> UnsafeRawBufferPointer {
+        let start = position
+        try skipValue()
+        return UnsafeRawBufferPointer(rebasing: bytes[start..<position])
+    }
+
+    /// Moves past the value at the current position.
+    mutating func skipValue() throws {
+        switch try valueKind() {
+        case .string:
+            _ = try readString()
+        case .number:
+            _ = try readNumber()
+        case .boolean:
+            _ = try readBoolean()
+        case .null:
+            try readLiteral("null")
+        case .object, .array:
+            try skipContainer()
+        }
+    }
+
+    /// Moves past a container by counting brackets, skipping whole blocks without
+    /// quotes or brackets.
+    private mutating func skipContainer() throws {
+        var depth = 0
+        while true {
+            while position + 16 <= count {
+                let block = loadBlock(at: position)
+                let folded = block | 0x20  // [ ] become { }
+                let structural = (block .== 0x22) .| (folded .== 0x7B) .| (folded .== 0x7D)
+                guard !any(structural) else { break }
+                position += 16
+            }
+            guard position < count else { throw ScanError.unexpectedEnd }
+
+            switch bytes[position] {
+            case UInt8(ascii: "\""):
+                _ = try readString()
+            case UInt8(ascii: "{"), UInt8(ascii: "["):
+                depth += 1
+                position += 1
+            case UInt8(ascii: "}"), UInt8(ascii: "]"):
+                depth -= 1
+                position += 1
+                if depth == 0 {
+                    return
+                }
+            default:
+                position += 1
+            }
+        }
+    }
+
+    // MARK: Navigating
+
+    /// Moves to the value of the first member named `key` of the object at the current
+    /// position, skipping the members before it.
+    ///
+    /// - Returns: `false` if the object has no such member.
+    mutating func moveToMember(_ key: UnsafeRawBufferPointer) throws -> Bool {
+        skipWhitespace()
+        try expect(UInt8(ascii: "{"))
+        skipWhitespace()
+        if peek() == UInt8(ascii: "}") {
+            return false
+        }
+
+        while true {
+            skipWhitespace()
+            let name = try readString()
+            skipWhitespace()
+            try expect(UInt8(ascii: ":"))
+            if Self.equals(name.contents, hasEscapes: name.hasEscapes, key) {
+                return true
+            }
+            try skipValue()
+            skipWhitespace()
+            switch peek() {
+            case UInt8(ascii: ","):
+                position += 1
+            case UInt8(ascii: "}"):
+                return false
+            default:
+                throw unexpected()
+            }
+        }
+    }
+
+    /// Moves to element `index` of the array at the current position, skipping the
+    /// elements before it.
+    ///
+    /// - Returns: `false` if the array is shorter.
+    mutating func moveToElement(_ index: Int) throws -> Bool {
+        var remaining = index
+        return try forEachElement { scanner in
+            guard remaining > 0 else { return false }
+            remaining -= 1
+            try scanner.skipValue()
+            return true
+        }
+    }
+
+    /// Calls `body` at each element of the array at the current position. `body` must
+    /// either move past the element and return `true`, or return `false` to stop there.
+    ///
+    /// - Returns: `true` if `body` stopped at an element, `false` if the array ended.
+    mutating func forEachElement(_ body: (inout JSONScanner) throws -> Bool) throws -> Bool {
+        skipWhitespace()
+        try expect(UInt8(ascii: "["))
+        skipWhitespace()
+        if peek() == UInt8(ascii: "]") {
+            return false
+        }
+
+        while true {
+            _ = try valueKind()
+            guard try body(&self) else { return true }
+            skipWhitespace()
+            switch peek() {
+            case UInt8(ascii: ","):
+                position += 1
+            case UInt8(ascii: "]"):
+                position += 1
+                return false
+            default:
+                throw unexpected()
+            }
+        }
+    }
+
+    // MARK: Strings
+
+    /// Whether the contents of a JSON string equal `other` once unescaped.
+    static func equals(_ contents: UnsafeRawBufferPointer, hasEscapes: Bool, _ other: UnsafeRawBufferPointer) -> Bool {
+        guard hasEscapes else {
+            return contents.count == other.count
+                && (contents.isEmpty || memcmp(contents.baseAddress!, other.baseAddress!, contents.count) == 0)
+        }
+        // Unescaping never lengthens a string.
+        return withUnsafeTemporaryAllocation(byteCount: max(contents.count, 1), alignment: 1) { buffer in
+            let length = unescape(contents, into: buffer.baseAddress!)
+            return length == other.count
+                && (length == 0 || memcmp(buffer.baseAddress!, other.baseAddress!, length) == 0)
+        }
+    }
+
+    /// Writes the unescaped UTF-8 of a JSON string's contents, at most `contents.count`
+    /// bytes. Unpaired surrogate escapes become U+FFFD.
+    ///
+    /// - Returns: The number of bytes written.
+    static func unescape(_ contents: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) -> Int {
+        var index = 0
+        var written = 0
+
+        func put(_ byte: UInt8) {
+            output.storeBytes(of: byte, toByteOffset: written, as: UInt8.self)
+            written += 1
+        }
+
+        func hexQuad(at offset: Int) -> UInt32? {
+            guard offset + 4 <= contents.count else { return nil }
+            var value: UInt32 = 0
+            for byte in contents[offset..<(offset + 4)] {
+                let digit = byte &- 48
+                let letter = (byte | 0x20) &- 97
+                guard digit < 10 || letter < 6 else { return nil }
+                value = value << 4 | UInt32(digit < 10 ? digit : letter + 10)
+            }
+            return value
+        }
+
+        while index < contents.count {
+            let byte = contents[index]
+            guard byte == UInt8(ascii: "\\"), index + 1 < contents.count else {
+                put(byte)
+                index += 1
+                continue
+            }
+
+            let escape = contents[index + 1]
+            index += 2
+            switch escape {
+            case UInt8(ascii: "b"): put(0x08)
+            case UInt8(ascii: "f"): put(0x0C)
+            case UInt8(ascii: "n"): put(0x0A)
+            case UInt8(ascii: "r"): put(0x0D)
+            case UInt8(ascii: "t"): put(0x09)
+            case UInt8(ascii: "u"):
+                guard var scalar = hexQuad(at: index) else {
+                    put(escape)
+                    continue
+                }
+                index += 4
+                if (0xD800..<0xDC00).contains(scalar) {
+                    if index + 6 <= contents.count, contents[index] == UInt8(ascii: "\\"),
+                       contents[index + 1] == UInt8(ascii: "u"),
+                       let low = hexQuad(at: index + 2), (0xDC00..<0xE000).contains(low) {
+                        scalar = 0x10000 + ((scalar - 0xD800) << 10) + (low - 0xDC00)
+                        index += 6
+                    } else {
+                        scalar = 0xFFFD
+                    }
+                } else if (0xDC00..<0xE000).contains(scalar) {
+                    scalar = 0xFFFD
+                }
+                for unit in UTF8.encode(Unicode.Scalar(scalar)!)! {
+                    put(unit)
+                }
+            default:
+                // \" \\ \/ stand for themselves.
+                put(escape)
+            }
+        }
+        return written
+    }
+
+    // MARK: Numbers
+
+    /// Parses an integer literal, or returns `nil` if it does not fit in 64 bits.
+    static func integerValue(_ literal: UnsafeRawBufferPointer) -> Int64? {
+        let isNegative = literal.first == UInt8(ascii: "-")
+        guard literal.count > (isNegative ? 1 : 0) else { return nil }
+        var value: Int64 = 0
+        for byte in literal.dropFirst(isNegative ? 1 : 0) {
+            let digit = byte &- 48
+            guard digit < 10 else { return nil }
+            let (shifted, overflow) = value.multipliedReportingOverflow(by: 10)
+            let (next, carry) = isNegative
+                ? shifted.subtractingReportingOverflow(Int64(digit))
+                : shifted.addingReportingOverflow(Int64(digit))
+            guard !overflow, !carry else { return nil }
+            value = next
+        }
+        return value
+    }
+
+    /// Parses any number literal as a `Double`.
+    static func doubleValue(_ literal: UnsafeRawBufferPointer) -> Double? {
+        // Short literals fit in a small string, which needs no allocation.
+        Double(String(decoding: literal, as: UTF8.self))
+    }
+}
+
+// MARK: - Paths
+
+/// A compiled `json_extract_simple` path such as `$.address.city` or `$.items[2].name`.
+///
+/// Dotted components name object members, or array elements when they are numeric, as in
+/// `$.items.2`; bracketed components are array indices. Paths are compiled once per
+/// statement and kept as auxiliary data on the path argument.
+final class JSONPath {
+    struct Component {
+        /// The member name, if the component can name a member.
+        let key: [UInt8]?
+        /// The element index, if the component can index an array.
+        let index: Int?
+    }
+
+    enum ParseError: Error {
+        case invalid(String)
+    }
+
+    let components: [Component]
+
+    /// Compiles a path.
+    ///
+    /// - Throws: ``ParseError`` unless the path is `$` followed by `.key` and `[n]`
+    ///   components.
+    init(_ path: String) throws {
+        var bytes = path.utf8[...]
+        guard bytes.first == UInt8(ascii: "$") else { throw ParseError.invalid(path) }
+        bytes = bytes.dropFirst()
+
+        var components: [Component] = []
+        while let first = bytes.first {
+            bytes = bytes.dropFirst()
+            switch first {
+            case UInt8(ascii: "."):
+                let key = bytes.prefix { $0 != UInt8(ascii: ".") && $0 != UInt8(ascii: "[") }
+                bytes = bytes.dropFirst(key.count)
+                // Empty components, as in `$.a..b`, are ignored.
+                if !key.isEmpty {
+                    components.append(Component(key: Array(key), index: Int(String(decoding: key, as: UTF8.self))))
+                }
+            case UInt8(ascii: "["):
+                let digits = bytes.prefix { $0 != UInt8(ascii: "]") }
+                bytes = bytes.dropFirst(digits.count)
+                guard bytes.first == UInt8(ascii: "]"),
+                      let index = Int(String(decoding: digits, as: UTF8.self)), index >= 0 else {
+                    throw ParseError.invalid(path)
+                }
+                bytes = bytes.dropFirst()
+                components.append(Component(key: nil, index: index))
+            default:
+                throw ParseError.invalid(path)
+            }
+        }
+        self.components = components
+    }
+
+    /// Moves `scanner` to the value the path names.
+    ///
+    /// - Returns: `false` if the document has no such value.
+    func locate(in scanner: inout JSONScanner) throws -> Bool {
+        for component in components {
+            switch try scanner.valueKind() {
+            case .object:
+                guard let key = component.key else { return false }
+                let found = try key.withUnsafeBytes { try scanner.moveToMember($0) }
+                guard found else { return false }
+            case .array:
+                guard let index = component.index, index >= 0 else { return false }
+                guard try scanner.moveToElement(index) else { return false }
+            default:
+                return false
+            }
+        }
+        return true
+    }
+}
+
+/// A compiled `json_array_contains` search value, kept as auxiliary data.
+///
+/// An element matches when it is a string equal to the value, or a number whose decimal
+/// description equals it: integers compare as integers, so `'3'` matches `3`, and other
+/// numbers as `Double`, so `'2.5'` matches `2.5` and `25e-1`.
+final class JSONArraySearch {
+    let text: [UInt8]
+    let integer: Int64?
+    let double: Double?
+
+    init(_ value: String) {
+        text = Array(value.utf8)
+        integer = Int64(value).flatMap { String($0) == value ? $0 : nil }
+        double = Double(value).flatMap { $0.isFinite && String($0) == value ? $0 : nil }
+    }
+
+    /// Whether the element at the scanner's position matches, moving past it.
+    func matches(_ scanner: inout JSONScanner) throws -> Bool {
+        switch try scanner.valueKind() {
+        case .string:
+            let string = try scanner.readString()
+            return text.withUnsafeBytes { JSONScanner.equals(string.contents, hasEscapes: string.hasEscapes, $0) }
+        case .number:
+            let number = try scanner.readNumber()
+            if number.isInteger, let value = JSONScanner.integerValue(number.literal) {
+                return value == integer
+            }
+            return double != nil && JSONScanner.doubleValue(number.literal) == double
+        default:
+            try scanner.skipValue()
+            return false
+        }
+    }
+}
+
+extension JSONScanner {
+    /// Sets the value at the current position as the function result: strings as text,
+    /// numbers as integers or reals, booleans as `1` or `0`, `null` as NULL, and objects
+    /// and arrays as their JSON text, exactly as written in the document.
+    mutating func setResult(in context: SQLiteContext) throws {
+        switch try valueKind() {
+        case .string:
+            let string = try readString()
+            context.result(capacity: string.contents.count) { output in
+                guard string.hasEscapes else {
+                    output.copyMemory(from: string.contents)
+                    return .text(count: string.contents.count)
+                }
+                return .text(count: Self.unescape(string.contents, into: output.baseAddress!))
+            }
+        case .number:
+            let number = try readNumber()
+            if number.isInteger, let value = Self.integerValue(number.literal) {
+                context.result(value)
+            } else if let value = Self.doubleValue(number.literal) {
+                context.result(value)
+            } else {
+                throw ScanError.unexpectedCharacter(offset: position - number.literal.count)
+            }
+        case .boolean:
+            let value = try readBoolean()
+            context.result(Int64(value ? 1 : 0))
+        case .null:
+            try readLiteral("null")
+            context.resultNull()
+        case .object, .array:
+            let text = try readContainer()
+            context.result(capacity: text.count) { output in
+                output.copyMemory(from: text)
+                return .text(count: text.count)
+            }
+        }
+    }
+}
@@ -0,0 +1,372 @@
+import Foundation
+import Synchronization
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+/// An append-only file of the commits to a ``KeyValueVirtualTable`` store, replayed when
+/// the store is opened.
+///
+/// ## File Format
+/// All integers are little-endian. The file is a sequence of frames, one per commit or
+/// cancellation, numbered from 1:
+///
+/// | Size | Field |
+/// | --- | --- |
+/// | 4 | Payload byte count |
+/// | 4 | FNV-1a hash of the payload |
+/// | n | Changes |
+///
+/// A change is a tag byte, 1 to set a key or 2 to remove one. A set is followed by the
+/// rowid as an `Int64`, the key and the value; a removal by the key alone. Keys and values
+/// are a `UInt32` byte count followed by UTF-8 bytes.
+///
+/// A cancellation frame holds the tag byte 3 and the number of an earlier frame as an
+/// `Int64`. It is written when a transaction logged in `xSync` is rolled back after all,
+/// and replay skips the frame it names.
+///
+/// A frame cut short by a crash fails its length or hash check. Replay stops there and the
+/// file is truncated to the last complete frame, so the store comes back as of its last
+/// complete commit.
+///
+/// ## Group Commit
+/// ``append(_:)`` writes a frame and ``sync(through:)`` makes it durable. A store appends
+/// under its own lock and syncs after releasing it, so commits that arrive while one
+/// `fsync` is in progress append behind it and are then covered together by the next.
+///
+/// ## Compaction
+/// Superseded changes are never rewritten in place. Once the file is twice the size it had
+/// after the last compaction, and at least ``compactionThreshold`` bytes larger,
+/// ``compactIfNeeded(_:)`` writes the live rows to a new file as a single frame, renames
+/// it over the old one and syncs the directory.
+final class KeyValueLog: Sendable {
+    enum LogError: Error {
+        case io(operation: String, path: String, errno: Int32)
+    }
+
+    /// The growth since the last compaction below which the log is never compacted.
+    static let compactionThreshold = 1 << 20
+
+    private struct State {
+        var descriptor: Int32
+        var size: Int
+        var compactedSize: Int
+        /// The number of frames in the file, the last of which has this number.
+        var frames: Int
+        /// The number of frames appended, used as their sequence numbers.
+        var appended = 0
+        /// Set when the directory entry of a compacted log may not be on disk yet, so the
+        /// next sync must also sync the directory.
+        var directoryUnsynced = false
+    }
+
+    let path: String
+    private let state: Mutex<State>
+    /// The sequence number of the last frame known to be on disk. Held for the whole of an
+    /// `fsync`, and taken before ``state`` whenever both are needed.
+    private let synced = Mutex(0)
+
+    private init(path: String, descriptor: Int32, size: Int, frames: Int) {
+        self.path = path
+        state = Mutex(State(descriptor: descriptor, size: size, compactedSize: size, frames: frames))
+    }
+
+    deinit {
+        state.withLock { _ = close($0.descriptor) }
+    }
+
+    /// Opens the log at `path`, creating it if needed.
+    ///
+    /// - Returns: The log, and the changes of its complete frames in commit order, without
+    ///   those of cancelled frames.
+    /// - Throws: ``LogError`` if the file cannot be read, opened or truncated.
+    static func load(path: String) throws -> (log: KeyValueLog, changes: [KeyValueVirtualTable.Change]) {
+        let contents: Data
+        if FileManager.default.fileExists(atPath: path) {
+            do {
+                contents = try Data(contentsOf: URL(fileURLWithPath: path))
+            } catch {
+                throw LogError.io(operation: "read", path: path, errno: EIO)
+            }
+        } else {
+            contents = Data()
+        }
+
+        var frames: [[KeyValueVirtualTable.Change]] = []
+        var cancelled = Set<Int>()
+        let valid = contents.withUnsafeBytes { bytes in
+            var reader = LogReader(bytes: bytes)
+            var valid = 0
+            frames: while let length = reader.read(UInt32.self).map(Int.init),
+                          let hash = reader.read(UInt32.self),
+                          reader.remaining >= length {
+                let payload = UnsafeRawBufferPointer(rebasing: bytes[reader.offset..<reader.offset + length])
+                guard fnv1a(payload) == hash else { break }
+
+                var frame = LogReader(bytes: payload)
+                var frameChanges: [KeyValueVirtualTable.Change] = []
+                if let cancellation = frame.readCancellation() {
+                    cancelled.insert(cancellation)
+                } else {
+                    while frame.remaining > 0 {
+                        guard let change = frame.readChange() else { break frames }
+                        frameChanges.append(change)
+                    }
+                }
+                frames.append(frameChanges)
+                reader.offset += length
+                valid = reader.offset
+            }
+            return valid
+        }
+        let changes = frames.enumerated().flatMap { offset, frameChanges in
+            cancelled.contains(offset + 1) ? [] : frameChanges
+        }
+
+        let descriptor = open(path, O_RDWR | O_CREAT | O_APPEND, 0o644)
+        guard descriptor >= 0 else {
+            throw LogError.io(operation: "open", path: path, errno: errno)
+        }
+        if valid < contents.count, ftruncate(descriptor, off_t(valid)) != 0 {
+            let code = errno
+            close(descriptor)
+            throw LogError.io(operation: "truncate", path: path, errno: code)
+        }
+        return (KeyValueLog(path: path, descriptor: descriptor, size: valid, frames: frames.count), changes)
+    }
+
+    /// Writes one frame holding `changes`.
+    ///
+    /// - Returns: The frame's number, to pass to ``appendCancellation(of:)``, and its
+    ///   sequence number, to pass to ``sync(through:)``.
+    /// - Throws: ``LogError`` if the write fails; the file is cut back to the end of the
+    ///   previous frame.
+    func append(_ changes: [KeyValueVirtualTable.Change]) throws -> (frame: Int, sequence: Int) {
+        var bytes: [UInt8] = []
+        Self.encodeFrame(changes, into: &bytes)
+        return try write(bytes)
+    }
+
+    /// Writes a frame that cancels the frame numbered `frame`, so replay skips it.
+    ///
+    /// - Returns: The cancellation's sequence number, to pass to ``sync(through:)``.
+    /// - Throws: ``LogError`` if the write fails.
+    func appendCancellation(of frame: Int) throws -> Int {
+        var bytes: [UInt8] = []
+        Self.encodeFrame(into: &bytes) { payload in
+            payload.append(3)
+            withUnsafeBytes(of: Int64(frame).littleEndian) { payload.append(contentsOf: $0) }
+        }
+        return try write(bytes).sequence
+    }
+
+    private func write(_ bytes: [UInt8]) throws -> (frame: Int, sequence: Int) {
+        try state.withLock { state in
+            guard writeAll(bytes, to: state.descriptor) else {
+                let code = errno
+                _ = ftruncate(state.descriptor, off_t(state.size))
+                throw LogError.io(operation: "write", path: path, errno: code)
+            }
+            state.size += bytes.count
+            state.frames += 1
+            state.appended += 1
+            return (state.frames, state.appended)
+        }
+    }
+
+    /// Returns once the frame numbered `sequence`, and every frame before it, is on disk.
+    ///
+    /// One `fsync` covers every frame appended before it starts, so a caller that waited
+    /// for another's sync often finds its frame already covered.
+    func sync(through sequence: Int) throws {
+        try synced.withLock { synced in
+            guard synced < sequence else { return }
+            let (descriptor, appended, directoryUnsynced) = state.withLock {
+                ($0.descriptor, $0.appended, $0.directoryUnsynced)
+            }
+            guard fsync(descriptor) == 0 else {
+                throw LogError.io(operation: "fsync", path: path, errno: errno)
+            }
+            if directoryUnsynced {
+                try syncDirectory()
+                state.withLock { $0.directoryUnsynced = false }
+            }
+            synced = appended
+        }
+    }
+
+    /// Rewrites the log as one frame if it has grown enough since the last compaction.
+    ///
+    /// `rows` is only called when the log is compacted, and must return changes that
+    /// recreate every live row. Frame numbers restart with the compacted file, so no frame
+    /// appended before may still need cancelling. A compaction that cannot create, write or rename its new
+    /// file leaves the log as it was and is retried after the next commit; the error is
+    /// not reported, since the log is still complete without it.
+    ///
+    /// After the rename the directory is synced, since until then a crash may bring back
+    /// the old file, or none. If that fails, every later ``sync(through:)`` retries it and
+    /// throws until it succeeds, so no frame is reported durable in the meantime.
+    func compactIfNeeded(_ rows: () -> [KeyValueVirtualTable.Change]) {
+        // Check before waiting out any sync in progress, which most commits need not do.
+        guard state.withLock({ Self.isCompactionDue($0) }) else { return }
+        synced.withLock { synced in
+            state.withLock { state in
+                guard Self.isCompactionDue(state) else { return }
+
+                var bytes: [UInt8] = []
+                Self.encodeFrame(rows(), into: &bytes)
+                let temporary = path + ".compacting"
+                let descriptor = open(temporary, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0o644)
+                guard descriptor >= 0 else { return }
+                guard writeAll(bytes, to: descriptor), fsync(descriptor) == 0, rename(temporary, path) == 0 else {
+                    close(descriptor)
+                    unlink(temporary)
+                    return
+                }
+
+                let directorySynced = (try? syncDirectory()) != nil
+
+                close(state.descriptor)
+                state.descriptor = descriptor
+                state.size = bytes.count
+                state.compactedSize = bytes.count
+                state.frames = 1
+                state.directoryUnsynced = !directorySynced
+                synced = directorySynced ? state.appended : 0
+            }
+        }
+    }
+
+    /// Syncs the directory holding the log, making a rename of the log durable.
+    private func syncDirectory() throws {
+        let directory = (path as NSString).deletingLastPathComponent
+        let descriptor = open(directory.isEmpty ? "." : directory, O_RDONLY)
+        guard descriptor >= 0 else {
+            throw LogError.io(operation: "open", path: directory, errno: errno)
+        }
+        defer { close(descriptor) }
+        guard fsync(descriptor) == 0 else {
+            throw LogError.io(operation: "fsync", path: directory, errno: errno)
+        }
+    }
+
+    private static func isCompactionDue(_ state: State) -> Bool {
+        state.size >= max(2 * state.compactedSize, state.compactedSize + compactionThreshold)
+    }
+
+    /// Appends a frame holding `changes` to `bytes`.
+    private static func encodeFrame(_ changes: [KeyValueVirtualTable.Change], into bytes: inout [UInt8]) {
+        encodeFrame(into: &bytes) { bytes in
+            func appendInteger<T: FixedWidthInteger>(_ value: T) {
+                withUnsafeBytes(of: value.littleEndian) { bytes.append(contentsOf: $0) }
+            }
+            func appendString(_ string: String) {
+                appendInteger(UInt32(string.utf8.count))
+                bytes.append(contentsOf: string.utf8)
+            }
+
+            for change in changes {
+                switch change {
+                case let .set(key, value, rowid):
+                    bytes.append(1)
+                    appendInteger(rowid)
+                    appendString(key)
+                    appendString(value)
+                case let .remove(key):
+                    bytes.append(2)
+                    appendString(key)
+                }
+            }
+        }
+    }
+
+    /// Appends a frame to `bytes` whose payload is written by `writePayload`.
+    private static func encodeFrame(into bytes: inout [UInt8], _ writePayload: (inout [UInt8]) -> Void) {
+        let header = bytes.count
+        bytes.append(contentsOf: repeatElement(0, count: 8))
+        writePayload(&bytes)
+
+        let payload = header + 8
+        let hash = bytes.withUnsafeBytes { fnv1a(UnsafeRawBufferPointer(rebasing: $0[payload...])) }
+        withUnsafeBytes(of: UInt32(bytes.count - payload).littleEndian) {
+            bytes.replaceSubrange(header..<header + 4, with: $0)
+        }
+        withUnsafeBytes(of: hash.littleEndian) {
+            bytes.replaceSubrange(header + 4..<header + 8, with: $0)
+        }
+    }
+}
+
+/// Reads the little-endian fields of a log, returning `nil` at a short read.
+private struct LogReader {
+    let bytes: UnsafeRawBufferPointer
+    var offset = 0
+
+    init(bytes: UnsafeRawBufferPointer) {
+        self.bytes = bytes
+    }
+
+    var remaining: Int {
+        bytes.count - offset
+    }
+
+    mutating func read<T: FixedWidthInteger>(_ type: T.Type) -> T? {
+        guard remaining >= MemoryLayout<T>.size else { return nil }
+        defer { offset += MemoryLayout<T>.size }
+        return T(littleEndian: bytes.loadUnaligned(fromByteOffset: offset, as: T.self))
+    }
+
+    mutating func readString() -> String? {
+        guard let count = read(UInt32.self).map(Int.init), remaining >= count else { return nil }
+        defer { offset += count }
+        return String(decoding: UnsafeRawBufferPointer(rebasing: bytes[offset..<offset + count]), as: UTF8.self)
+    }
+
+    /// Reads a cancellation, which fills its whole frame, leaving the reader unmoved at
+    /// anything else.
+    mutating func readCancellation() -> Int? {
+        guard remaining == 1 + MemoryLayout<Int64>.size, bytes[offset] == 3 else { return nil }
+        offset += 1
+        return read(Int64.self).map(Int.init)
+    }
+
+    mutating func readChange() -> KeyValueVirtualTable.Change? {
+        switch read(UInt8.self) {
+        case 1:
+            guard let rowid = read(Int64.self), let key = readString(), let value = readString() else {
+                return nil
+            }
+            return .set(key: key, value: value, rowid: rowid)
+        case 2:
+            return readString().map { .remove(key: $0) }
+        default:
+            return nil
+        }
+    }
+}
+
+private func fnv1a(_ bytes: UnsafeRawBufferPointer) -> UInt32 {
+    var hash: UInt32 = 2_166_136_261
+    for byte in bytes {
+        hash = (hash ^ UInt32(byte)) &* 16_777_619
+    }
+    return hash
+}
+
+/// Writes all of `bytes`, retrying short writes and interrupted calls.
+private func writeAll(_ bytes: [UInt8], to descriptor: Int32) -> Bool {
+    bytes.withUnsafeBytes { buffer in
+        var offset = 0
+        while offset < buffer.count {
+            let written = write(descriptor, buffer.baseAddress! + offset, buffer.count - offset)
+            if written < 0 {
+                if errno == EINTR { continue }
+                return false
+            }
+            offset += written
+        }
+        return true
+    }
+}
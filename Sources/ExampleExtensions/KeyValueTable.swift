@@ -5,7 +5,7 @@ import Synchronization
 /// Example virtual table implementation: In-memory key-value store.
 ///
 /// This demonstrates how to create a virtual table in SQLite using Swift.
-/// The table stores key-value pairs in memory.
+/// The table stores key-value pairs in memory, ordered by key.
 ///
 /// ## Usage in SQL
 /// ```sql
@@ -19,104 +19,769 @@ import Synchronization
 /// -- Query values
 /// SELECT * FROM kv WHERE key = 'name';
 /// SELECT value FROM kv WHERE key = 'age';
+///
+/// -- Range and prefix scans, returned in key order without sorting
+/// SELECT * FROM kv WHERE key BETWEEN 'session:0' AND 'session:9' ORDER BY key;
+/// SELECT * FROM kv WHERE key LIKE 'config.%';
+/// SELECT * FROM kv WHERE starts_with(key, 'Config.');
+///
+/// -- Share one store between every table, on any connection, that names it
+/// CREATE VIRTUAL TABLE cache USING keyvalue('sessions');
+///
+/// -- Persist a shared store to a log file, restored when it is next opened
+/// CREATE VIRTUAL TABLE settings USING keyvalue('settings', '/var/db/settings.kvlog');
 /// ```
 ///
 /// ## Implementation Note
-/// This is a simplified example. Full virtual table support requires:
-/// - Implementing the complete sqlite3_module interface
-/// - Proper memory management with C callbacks
-/// - Transaction support
-/// - Update/delete operations
+/// Rows are kept in a ``SortedKeyValueIndex``. `bestIndex` pushes down `=`, `<`, `<=`,
+/// `>`, `>=` and `BETWEEN` on `key`, as well as the literal prefix of `LIKE` and `GLOB`
+/// patterns, and consumes `ORDER BY key` in either direction. The table overloads
+/// `starts_with(key, prefix)` so that it becomes an exact prefix range on the index, and
+/// receives `key IN (...)` as one list that it answers with a single multi-key lookup.
+/// Scans walk the index in place instead of copying the table, and the row count used for
+/// cost estimates is O(1).
+///
+/// Each cursor reads a snapshot: it pins the version of the table that was current when
+/// `filter` ran, without locking, so concurrent writers neither block it nor change the
+/// rows it returns.
 ///
-/// For production use, consider using the full C API for virtual tables
-/// as they require complex callback management beyond this Swift wrapper.
+/// Writes are transactional: they are staged until SQLite commits, published as a single
+/// version, and discarded on rollback, including rollback to a savepoint. Other
+/// connections sharing the store see none of a transaction's writes until it commits.
+///
+/// A named store lives as long as any table is attached to it. With a log file, each
+/// transaction is appended to the log and synced in `xSync`, before SQLite commits, so a
+/// write that cannot be logged fails the `COMMIT` and rolls back. The changes become
+/// visible in `xCommit`, once they are durable. Commits that arrive during a sync share
+/// the next one, and the log is compacted as it grows.
+///
+/// Inserting an existing key replaces its value.
 public struct KeyValueVirtualTable: VirtualTableModule {
-    /// Storage for key-value pairs
-    private let storage: Storage
+    /// The table's view of its store, with any transaction it is staging.
+    private let session: Session
+
+    /// The registry name of a shared store, or `nil` for a private one.
+    private let storeName: String?
 
-    /// Shared storage class
+    /// A change to a store, as staged by a transaction and recorded in a ``KeyValueLog``.
+    enum Change: Sendable {
+        case set(key: String, value: String, rowid: Int64)
+        case remove(key: String)
+
+        var key: String {
+            switch self {
+            case let .set(key, _, _), let .remove(key):
+                return key
+            }
+        }
+    }
+
+    /// The rows of a store.
+    struct Rows: Sendable {
+        var index = SortedKeyValueIndex()
+        /// Key lookup for the rowid-based operations of `xUpdate`.
+        var keysByRowID: [Int64: String] = [:]
+
+        mutating func apply(_ change: Change) {
+            switch change {
+            case let .set(key, value, rowid):
+                if let previous = index.entry(forKey: key)?.rowid, previous != rowid {
+                    keysByRowID[previous] = nil
+                }
+                // A rowid names one row, so a key that held it before gives it up.
+                if let other = keysByRowID[rowid], other != key {
+                    index.removeEntry(forKey: other)
+                }
+                index.insert(.init(key: key, value: value, rowid: rowid))
+                keysByRowID[rowid] = key
+            case let .remove(key):
+                guard let rowid = index.entry(forKey: key)?.rowid else { return }
+                keysByRowID[rowid] = nil
+                index.removeEntry(forKey: key)
+            }
+        }
+    }
+
+    /// The committed rows of a table, shared by every table attached to them.
+    ///
+    /// Writers serialise on a mutex and publish the committed index as an immutable
+    /// version. Readers never take the mutex: a scan or row count pins the latest
+    /// published version in O(1) and walks it for as long as it likes, unaffected by
+    /// writes that happen meanwhile.
+    ///
+    /// A store is private to its table unless the table names it. Named stores are kept
+    /// in a process-wide registry and shared by every table, on any connection, that
+    /// names them, until the last of those tables disconnects. A named store may also be
+    /// given a ``KeyValueLog``, which it replays when it is opened and appends to on
+    /// every commit.
+    ///
+    /// With a log, a commit has two phases. ``prepare(_:)`` logs and syncs the changes from
+    /// `xSync`, where a failure still rolls the transaction back, and
+    /// ``commit(_:prepared:)`` applies them from `xCommit`, which cannot fail. Transactions
+    /// on other connections may apply in a different order than they were logged, so the
+    /// store remembers which keys a later frame has written while earlier frames are still
+    /// prepared, and skips those keys when the earlier ones apply. The rows therefore always
+    /// match a replay of the log.
     final class Storage: Sendable {
-        private let data = Mutex<[String: String]>([:])
+        private struct State {
+            var rows: Rows
+            /// Logged frames not yet applied or cancelled.
+            var prepared: Set<Int> = []
+            /// For each key written while an earlier frame was prepared, the frame that
+            /// wrote it last; cleared once nothing is prepared.
+            var newerWrites: [String: Int] = [:]
+        }
+
+        private let state: Mutex<State>
+        private let published: PublishedSnapshot<SortedKeyValueIndex>
+        /// The next rowid to hand out, shared by all the tables of the store.
+        private let nextRowID: Atomic<Int64>
+        private let log: KeyValueLog?
+
+        init() {
+            state = Mutex(State(rows: Rows()))
+            published = PublishedSnapshot(SortedKeyValueIndex())
+            nextRowID = Atomic(1)
+            log = nil
+        }
+
+        /// Opens a store persisted to the log at `path`, restoring the rows it records.
+        init(logPath path: String) throws {
+            let (log, changes) = try KeyValueLog.load(path: path)
+            var restored = Rows()
+            var lastRowID: Int64 = 0
+            for change in changes {
+                restored.apply(change)
+                if case let .set(_, _, rowid) = change {
+                    lastRowID = max(lastRowID, rowid)
+                }
+            }
+            published = PublishedSnapshot(restored.index)
+            state = Mutex(State(rows: restored))
+            nextRowID = Atomic(lastRowID + 1)
+            self.log = log
+        }
+
+        /// The latest committed index. Lock-free; O(1).
+        var index: SortedKeyValueIndex {
+            published.load()
+        }
+
+        /// A copy of the committed rows, taken in O(1).
+        var committedRows: Rows {
+            state.withLock { $0.rows }
+        }
+
+        func key(forRowID rowid: Int64) -> String? {
+            state.withLock { $0.rows.keysByRowID[rowid] }
+        }
+
+        /// Returns `requested` if given, otherwise a rowid no table of the store has used.
+        func assignRowID(requested: Int64?) -> Int64 {
+            guard let requested else {
+                return nextRowID.wrappingAdd(1, ordering: .relaxed).oldValue
+            }
+            var current = nextRowID.load(ordering: .relaxed)
+            while current <= requested {
+                let (exchanged, original) = nextRowID.compareExchange(
+                    expected: current,
+                    desired: requested + 1,
+                    ordering: .relaxed
+                )
+                if exchanged { break }
+                current = original
+            }
+            return requested
+        }
+
+        /// Logs `changes` and waits until they are on disk, the first phase of a commit.
+        ///
+        /// The `fsync` happens after the store is unlocked, so other commits can append
+        /// meanwhile and share the next one.
+        ///
+        /// - Returns: The logged frame, to pass to ``commit(_:prepared:)`` or
+        ///   ``cancel(_:)``, or `nil` for a store without a log or with nothing to commit.
+        /// - Throws: ``KeyValueLog/LogError`` if the changes cannot be logged or synced, in
+        ///   which case nothing is prepared.
+        func prepare(_ changes: [Change]) throws -> Int? {
+            guard let log, !changes.isEmpty else { return nil }
+            let (frame, sequence) = try state.withLock { state in
+                let appended = try log.append(changes)
+                state.prepared.insert(appended.frame)
+                return appended
+            }
+            do {
+                try log.sync(through: sequence)
+            } catch {
+                cancel(frame)
+                throw error
+            }
+            return frame
+        }
+
+        /// Applies `changes`, logged as `frame` by ``prepare(_:)`` if the store has a log,
+        /// and publishes them as a single new version.
+        func commit(_ changes: [Change], prepared frame: Int?) {
+            guard !changes.isEmpty else { return }
+            state.withLock { state in
+                if let frame {
+                    state.prepared.remove(frame)
+                    let isLater = state.prepared.contains { $0 < frame }
+                    for change in changes {
+                        let key = change.key
+                        if let newer = state.newerWrites[key], newer > frame { continue }
+                        state.rows.apply(change)
+                        if isLater { state.newerWrites[key] = frame }
+                    }
+                    if state.prepared.isEmpty { state.newerWrites = [:] }
+                } else {
+                    for change in changes {
+                        state.rows.apply(change)
+                    }
+                }
+                published.publish(state.rows.index)
+                // Compaction renumbers frames, so it waits until none is prepared.
+                if state.prepared.isEmpty {
+                    log?.compactIfNeeded { Self.changes(recreating: state.rows) }
+                }
+            }
+        }
+
+        /// Applies `changes` as one commit, logging and syncing them first if the store has
+        /// a log.
+        ///
+        /// - Throws: ``KeyValueLog/LogError`` if the log cannot be written or synced, in
+        ///   which case nothing is applied.
+        func commit(_ changes: [Change]) throws {
+            commit(changes, prepared: try prepare(changes))
+        }
+
+        /// Abandons a frame logged by ``prepare(_:)`` whose transaction rolled back.
+        ///
+        /// The frame is already on disk, so a cancellation naming it is logged for replay to
+        /// skip. Nothing can report a failure here, so if the cancellation cannot be written
+        /// the rolled-back changes come back when the store is next opened.
+        func cancel(_ frame: Int) {
+            guard let log else { return }
+            let sequence = state.withLock { state -> Int? in
+                state.prepared.remove(frame)
+                if state.prepared.isEmpty { state.newerWrites = [:] }
+                return try? log.appendCancellation(of: frame)
+            }
+            if let sequence {
+                try? log.sync(through: sequence)
+            }
+        }
+
+        /// Changes that recreate every row of `rows`.
+        private static func changes(recreating rows: Rows) -> [Change] {
+            var changes: [Change] = []
+            changes.reserveCapacity(rows.index.count)
+            var scan = rows.index.scan(from: nil, to: nil, descending: false)
+            while let entry = scan.current {
+                changes.append(.set(key: entry.key, value: entry.value, rowid: entry.rowid))
+                scan.advance()
+            }
+            return changes
+        }
+
+        // MARK: Shared Stores
+
+        enum RegistryError: Error {
+            case logMismatch(name: String, path: String?)
+        }
+
+        /// Named stores, with the number of tables attached to each.
+        private static let registry = Mutex<[String: (storage: Storage, tables: Int)]>([:])
+
+        /// Attaches a table to the store named `name`, opening it if no table has it open.
+        ///
+        /// - Parameter logPath: The log to persist the store to. A table attaching to a
+        ///   store that is already open may omit it, but may not name a different one.
+        static func attach(named name: String, logPath: String?) throws -> Storage {
+            try registry.withLock { stores in
+                if let entry = stores[name] {
+                    guard logPath == nil || logPath == entry.storage.log?.path else {
+                        throw RegistryError.logMismatch(name: name, path: entry.storage.log?.path)
+                    }
+                    stores[name]?.tables += 1
+                    return entry.storage
+                }
+                let storage = try logPath.map { try Storage(logPath: $0) } ?? Storage()
+                stores[name] = (storage, 1)
+                return storage
+            }
+        }
 
-        func set(_ key: String, _ value: String) {
-            data.withLock {
-                $0[key] = value
+        /// Detaches a table from the store named `name`, closing the store after the last.
+        static func detach(named name: String) {
+            registry.withLock { stores in
+                guard let entry = stores[name] else { return }
+                if entry.tables > 1 {
+                    stores[name]?.tables -= 1
+                } else {
+                    stores[name] = nil
+                }
             }
         }
+    }
+
+    /// One table's view of its store, with the transaction it is staging.
+    ///
+    /// Writes outside a transaction commit at once. Inside one, they are staged in a
+    /// private copy of the rows taken at `begin`, which only this table's cursors read,
+    /// and recorded as a list of changes. Commit replays the list onto the store's
+    /// latest rows, so transactions on different connections merge key by key, the last
+    /// commit winning. Savepoints and rollback restore an earlier copy and cut the list
+    /// back; because the index is copy-on-write, taking a copy is O(1).
+    final class Session: Sendable {
+        private struct Transaction {
+            var rows: Rows
+            var changes: [Change] = []
+            /// The state when each open savepoint was taken, lowest level first.
+            var savepoints: [(level: Int, rows: Rows, changeCount: Int)] = []
+            /// Set once ``sync()`` has logged the changes, as `frame` if the store has a log.
+            var isPrepared = false
+            var frame: Int?
+        }
+
+        let storage: Storage
+        private let transaction = Mutex<Transaction?>(nil)
+        /// Set while a transaction is open, whose staged rows readers must see.
+        private let staging = Atomic(false)
+
+        init(storage: Storage) {
+            self.storage = storage
+        }
+
+        /// The index readers should see: staged rows during a transaction, otherwise the
+        /// latest committed version.
+        private var readableIndex: SortedKeyValueIndex {
+            if staging.load(ordering: .sequentiallyConsistent),
+               let index = transaction.withLock({ $0?.rows.index }) {
+                return index
+            }
+            return storage.index
+        }
+
+        /// The number of rows, in O(1).
+        var count: Int {
+            readableIndex.count
+        }
+
+        /// Stores `value` under `key`, keeping the key's rowid if it already exists.
+        ///
+        /// - Returns: The rowid of the row.
+        @discardableResult
+        func set(_ key: String, _ value: String, rowid requested: Int64? = nil) throws -> Int64 {
+            let rowid = readableIndex.entry(forKey: key)?.rowid ?? storage.assignRowID(requested: requested)
+            try stage(.set(key: key, value: value, rowid: rowid))
+            return rowid
+        }
 
         func get(_ key: String) -> String? {
-            data.withLock {
-                $0[key]
+            readableIndex.entry(forKey: key)?.value
+        }
+
+        func key(forRowID rowid: Int64) -> String? {
+            let staged = transaction.withLock { transaction in
+                transaction.map { $0.rows.keysByRowID[rowid] }
+            }
+            if let staged {
+                return staged
+            }
+            return storage.key(forRowID: rowid)
+        }
+
+        func remove(_ key: String) throws {
+            guard get(key) != nil else { return }
+            try stage(.remove(key: key))
+        }
+
+        /// Starts a scan over the rows between the bounds, as they are now.
+        func scan(
+            from lower: SortedKeyValueIndex.Bound?,
+            to upper: SortedKeyValueIndex.Bound?,
+            descending: Bool
+        ) -> SortedKeyValueIndex.Scan {
+            readableIndex.scan(from: lower, to: upper, descending: descending)
+        }
+
+        /// Looks up each key, returning the rows found once each, in key order or reversed.
+        func entries(forKeys keys: [String], descending: Bool) -> [SortedKeyValueIndex.Entry] {
+            let index = readableIndex
+            var found = keys.compactMap { index.entry(forKey: $0) }
+            found.sort {
+                let order = SortedKeyValueIndex.compare($0.key.utf8, $1.key.utf8)
+                return descending ? order > 0 : order < 0
+            }
+            // Different values can name the same key, such as 1 and '1'.
+            var previous: String?
+            return found.filter { entry in
+                defer { previous = entry.key }
+                return entry.key != previous
             }
         }
 
-        func all() -> [(String, String)] {
-            data.withLock {
-                Array($0)
+        /// Records `change` in the open transaction, or commits it if there is none.
+        private func stage(_ change: Change) throws {
+            let staged = transaction.withLock { transaction in
+                guard transaction != nil else { return false }
+                transaction?.rows.apply(change)
+                transaction?.changes.append(change)
+                return true
+            }
+            if !staged {
+                try storage.commit([change])
             }
         }
 
-        func remove(_ key: String) {
-            data.withLock {
-                _ = $0.removeValue(forKey: key)
+        // MARK: Transactions
+
+        /// Starts staging writes until ``commit()`` or ``rollback()``.
+        func begin() {
+            transaction.withLock { transaction in
+                guard transaction == nil else { return }
+                transaction = Transaction(rows: storage.committedRows)
+                staging.store(true, ordering: .sequentiallyConsistent)
+            }
+        }
+
+        /// Logs the staged writes and waits until they are on disk, the first phase of
+        /// ``commit()``.
+        ///
+        /// - Throws: ``KeyValueLog/LogError`` if they cannot be logged, after which SQLite
+        ///   rolls the transaction back.
+        func sync() throws {
+            try transaction.withLock { transaction in
+                guard let changes = transaction?.changes, transaction?.isPrepared == false else { return }
+                transaction?.frame = try storage.prepare(changes)
+                transaction?.isPrepared = true
+            }
+        }
+
+        /// Commits the staged writes to the store, logged by ``sync()``.
+        ///
+        /// - Throws: ``KeyValueLog/LogError`` only if ``sync()`` was never called and the
+        ///   writes cannot be logged now. The transaction is over either way.
+        func commit() throws {
+            try transaction.withLock { transaction in
+                guard let current = transaction else { return }
+                transaction = nil
+                staging.store(false, ordering: .sequentiallyConsistent)
+                if current.isPrepared {
+                    storage.commit(current.changes, prepared: current.frame)
+                } else {
+                    try storage.commit(current.changes)
+                }
+            }
+        }
+
+        /// Discards the staged writes, cancelling them in the log if ``sync()`` wrote them.
+        func rollback() {
+            transaction.withLock { transaction in
+                if let frame = transaction?.frame {
+                    storage.cancel(frame)
+                }
+                transaction = nil
+                staging.store(false, ordering: .sequentiallyConsistent)
+            }
+        }
+
+        func savepoint(_ level: Int) {
+            transaction.withLock { transaction in
+                guard let current = transaction else { return }
+                transaction?.savepoints.removeAll { $0.level >= level }
+                transaction?.savepoints.append((level, current.rows, current.changes.count))
+            }
+        }
+
+        func release(savepoint level: Int) {
+            transaction.withLock { transaction in
+                transaction?.savepoints.removeAll { $0.level >= level }
+            }
+        }
+
+        /// Restores the rows of the oldest savepoint at or above `level`, which covers a
+        /// savepoint opened before the table joined the transaction.
+        func rollback(toSavepoint level: Int) {
+            transaction.withLock { transaction in
+                guard let savepoints = transaction?.savepoints,
+                      let slot = savepoints.firstIndex(where: { $0.level >= level }) else {
+                    return
+                }
+                let savepoint = savepoints[slot]
+                transaction?.rows = savepoint.rows
+                transaction?.changes.removeSubrange(savepoint.changeCount...)
+                transaction?.savepoints.removeSubrange((slot + 1)...)
             }
         }
     }
 
+    /// Bits of `indexNumber` describing the plan chosen by ``bestIndex(_:)``.
+    ///
+    /// Constraint values are passed to `filter` in the order the flags are listed.
+    struct Plan: OptionSet, Hashable {
+        let rawValue: Int
+
+        static let equal = Plan(rawValue: 1 << 0)
+        static let greaterThan = Plan(rawValue: 1 << 1)
+        static let greaterThanOrEqual = Plan(rawValue: 1 << 2)
+        static let lessThan = Plan(rawValue: 1 << 3)
+        static let lessThanOrEqual = Plan(rawValue: 1 << 4)
+        static let like = Plan(rawValue: 1 << 5)
+        static let glob = Plan(rawValue: 1 << 6)
+        static let descending = Plan(rawValue: 1 << 7)
+        static let prefix = Plan(rawValue: 1 << 8)
+        static let keyList = Plan(rawValue: 1 << 9)
+
+        /// Constraint flags in argument order, with the operator each one handles.
+        static let constraints: [(Plan, IndexInfo.Constraint.Operator)] = [
+            (.equal, .eq),
+            (.greaterThan, .gt),
+            (.greaterThanOrEqual, .ge),
+            (.lessThan, .lt),
+            (.lessThanOrEqual, .le),
+            (.like, .like),
+            (.glob, .glob),
+            (.prefix, .function),
+            (.keyList, .eq),
+        ]
+    }
+
     public static var schema: String {
         "CREATE TABLE x(key TEXT PRIMARY KEY, value TEXT)"
     }
 
+    enum ArgumentError: Error {
+        case tooManyArguments
+    }
+
+    /// Opens a private store, or attaches to the shared store named by the first module
+    /// argument, persisted to the log file named by the second if given. Either may be
+    /// quoted.
     public static func create(arguments: [String]) throws -> KeyValueVirtualTable {
-        KeyValueVirtualTable(storage: Storage())
+        // argv holds the module, database and table names before the module arguments.
+        let options = arguments.dropFirst(3).map { argument in
+            let trimmed = argument.trimmingCharacters(in: .whitespaces)
+            guard trimmed.count >= 2, let quote = trimmed.first, quote == "'" || quote == "\"",
+                  trimmed.last == quote else {
+                return trimmed
+            }
+            return String(trimmed.dropFirst().dropLast())
+                .replacingOccurrences(of: "\(quote)\(quote)", with: "\(quote)")
+        }
+        guard options.count <= 2 else { throw ArgumentError.tooManyArguments }
+        guard let name = options.first else {
+            return KeyValueVirtualTable(storage: Storage(), storeName: nil)
+        }
+        let storage = try Storage.attach(named: name, logPath: options.count > 1 ? options[1] : nil)
+        return KeyValueVirtualTable(storage: storage, storeName: name)
     }
 
-    private init(storage: Storage) {
-        self.storage = storage
+    private init(storage: Storage, storeName: String?) {
+        self.session = Session(storage: storage)
+        self.storeName = storeName
+    }
+
+    /// Detaches from a shared store, which closes once no table is attached to it. The
+    /// log file of a persisted store is left in place, even by `DROP TABLE`.
+    public func disconnect() {
+        if let storeName {
+            Storage.detach(named: storeName)
+        }
     }
 
     public func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
-        // Check if we have a constraint on the key column
         var newInfo = indexInfo
-        var argvIndex = 1
+        if newInfo.constraintUsage.count < indexInfo.constraints.count {
+            newInfo.constraintUsage += Array(
+                repeating: IndexInfo.ConstraintUsage(),
+                count: indexInfo.constraints.count - newInfo.constraintUsage.count
+            )
+        }
+
+        // Pick at most one usable constraint on the key column for each operator,
+        // skipping a second lower or upper bound.
+        var plan: Plan = []
+        var chosen: [Plan: Int] = [:]
+        for (index, constraint) in indexInfo.constraints.enumerated()
+        where constraint.usable && constraint.column == 0 {
+            // The only function this table offers as a constraint is `starts_with`.
+            if constraint.op == .function && constraint.functionIndex != 0 {
+                continue
+            }
+            // The index is in byte order; comparisons under NOCASE, RTRIM or any other
+            // collation are left for SQLite to evaluate.
+            if constraint.collation.uppercased() != "BINARY" {
+                continue
+            }
+            guard let flag = Plan.constraints.first(where: { $0.1 == constraint.op })?.0,
+                  !plan.contains(flag) else {
+                continue
+            }
+            if (flag == .greaterThan || flag == .greaterThanOrEqual)
+                && !plan.isDisjoint(with: [.greaterThan, .greaterThanOrEqual]) {
+                continue
+            }
+            if (flag == .lessThan || flag == .lessThanOrEqual)
+                && !plan.isDisjoint(with: [.lessThan, .lessThanOrEqual]) {
+                continue
+            }
+            plan.insert(flag)
+            chosen[flag] = index
+        }
 
-        for constraint in indexInfo.constraints {
-            if constraint.usable && constraint.column == 0 && constraint.op == .eq {
-                // We can use the equality constraint on the key column
-                var usage = IndexInfo.ConstraintUsage()
-                usage.argvIndex = argvIndex
-                usage.omit = true
-                newInfo.constraintUsage.append(usage)
-                argvIndex += 1
+        if let index = chosen[.equal] {
+            if indexInfo.constraints[index].isInList {
+                // Take the whole IN list and look every key up in a single filter call.
+                plan = [.keyList]
+                chosen[.keyList] = index
+                newInfo.constraintUsage[index].inListAtOnce = true
+            } else {
+                plan = [.equal]
+                newInfo.flags.insert(.scanUnique)
+            }
+        }
+
+        var argvIndex = 1
+        for (flag, _) in Plan.constraints {
+            guard plan.contains(flag), let index = chosen[flag] else { continue }
+            newInfo.constraintUsage[index].argvIndex = argvIndex
+            // Patterns only narrow the scan to their literal prefix, so SQLite rechecks them.
+            newInfo.constraintUsage[index].omit = flag != .like && flag != .glob
+            argvIndex += 1
+        }
 
-                // Much cheaper when we can look up by key
-                newInfo.estimatedCost = 1.0
-                newInfo.estimatedRows = 1
-                newInfo.indexNumber = 1
-                return newInfo
+        // Key order is unique, so it satisfies any ORDER BY that starts with the key.
+        if let order = indexInfo.orderBy.first, order.column == 0 {
+            newInfo.orderByConsumed = true
+            if order.desc {
+                plan.insert(.descending)
             }
         }
 
-        // Full table scan
-        newInfo.estimatedCost = Double(storage.all().count)
-        newInfo.estimatedRows = Int64(storage.all().count)
-        newInfo.indexNumber = 0
+        let rowCount = Double(max(session.count, 1))
+        let rows: Double
+        if plan.contains(.equal) {
+            rows = 1
+        } else if plan.contains(.keyList) {
+            rows = min(rowCount, 10)
+        } else {
+            var fraction = 1.0
+            if !plan.isDisjoint(with: [.greaterThan, .greaterThanOrEqual]) { fraction /= 2 }
+            if !plan.isDisjoint(with: [.lessThan, .lessThanOrEqual]) { fraction /= 2 }
+            if !plan.isDisjoint(with: [.like, .glob, .prefix]) { fraction /= 10 }
+            rows = max(1, rowCount * fraction)
+        }
+
+        newInfo.indexNumber = plan.rawValue
+        newInfo.estimatedRows = Int64(rows)
+        if plan.contains(.keyList) {
+            newInfo.estimatedCost = rows * log2(rowCount + 1)
+        } else {
+            newInfo.estimatedCost = plan.isEmpty ? rowCount : log2(rowCount + 1) + rows
+        }
         return newInfo
     }
 
     public func open() throws -> KeyValueCursor {
-        KeyValueCursor(storage: storage)
+        KeyValueCursor(session: session)
+    }
+
+    /// Claims `starts_with(key, prefix)` as an index constraint; see ``bestIndex(_:)``.
+    public func findFunction(name: String, argumentCount: Int) -> VirtualTableFunction? {
+        guard name == "starts_with", argumentCount == 2 else { return nil }
+        return VirtualTableFunction(constraint: 0, function: startsWith)
+    }
+
+    enum UpdateError: Error {
+        case invalidColumnCount
+        case nullKey
+        case missingRow(Int64)
+        case duplicateKey(String)
+    }
+
+    public mutating func update(_ operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
+        switch operation {
+        case let .insert(rowid, values):
+            guard values.count >= 2 else { throw UpdateError.invalidColumnCount }
+            guard !values[0].isNull else { throw UpdateError.nullKey }
+            let rowid = try session.set(values[0].textValue, values[1].textValue, rowid: rowid)
+            return .handled(rowid: rowid)
+
+        case let .update(originalRowid, newRowid, values):
+            guard values.count >= 2 else { throw UpdateError.invalidColumnCount }
+            guard !values[0].isNull else { throw UpdateError.nullKey }
+            guard let originalKey = session.key(forRowID: originalRowid) else {
+                throw UpdateError.missingRow(originalRowid)
+            }
+
+            let key = values[0].textValue
+            if key != originalKey {
+                guard session.get(key) == nil else { throw UpdateError.duplicateKey(key) }
+                try session.remove(originalKey)
+            }
+            let rowid = try session.set(key, values[1].textValue, rowid: newRowid ?? originalRowid)
+            return .handled(rowid: rowid)
+
+        case let .delete(rowid):
+            if let key = session.key(forRowID: rowid) {
+                try session.remove(key)
+            }
+            return .handled(rowid: nil)
+        }
+    }
+
+    public mutating func begin() throws {
+        session.begin()
+    }
+
+    public mutating func sync() throws {
+        try session.sync()
+    }
+
+    public mutating func commit() throws {
+        try session.commit()
+    }
+
+    public mutating func rollback() throws {
+        session.rollback()
+    }
+
+    public mutating func savepoint(_ level: Int) throws {
+        session.savepoint(level)
+    }
+
+    public mutating func release(savepoint level: Int) throws {
+        session.release(savepoint: level)
+    }
+
+    public mutating func rollback(toSavepoint level: Int) throws {
+        session.rollback(toSavepoint: level)
     }
 
     /// Cursor for iterating over key-value pairs
     public struct KeyValueCursor: VirtualTableCursor {
-        private let storage: Storage
-        private var currentIndex: Int = 0
-        private var rows: [(String, String)] = []
-        private var currentRowId: Int64 = 0
+        private enum Rows {
+            case scan(SortedKeyValueIndex.Scan)
+            case entries([SortedKeyValueIndex.Entry], position: Int)
+        }
 
-        init(storage: Storage) {
-            self.storage = storage
+        private let session: Session
+        private var rows = Rows.scan(.empty)
+
+        private var current: SortedKeyValueIndex.Entry? {
+            switch rows {
+            case .scan(let scan):
+                return scan.current
+            case let .entries(entries, position):
+                return position < entries.count ? entries[position] : nil
+            }
+        }
+
+        init(session: Session) {
+            self.session = session
         }
 
         public mutating func filter(
@@ -124,58 +789,202 @@ public struct KeyValueVirtualTable: VirtualTableModule {
             indexString: String?,
             values: [SQLiteValue]
         ) throws {
-            if indexNumber == 1 && !values.isEmpty {
-                // Lookup by key
-                let key = values[0].textValue
-                if let value = storage.get(key) {
-                    rows = [(key, value)]
-                } else {
-                    rows = []
+            let plan = Plan(rawValue: indexNumber)
+            var lower: SortedKeyValueIndex.Bound?
+            var upper: SortedKeyValueIndex.Bound?
+            var isEmpty = false
+
+            func narrowLower(_ bound: SortedKeyValueIndex.Bound) {
+                if let current = lower {
+                    let order = SortedKeyValueIndex.compare(bound.bytes, current.bytes)
+                    if order < 0 || (order == 0 && bound.inclusive) { return }
                 }
-            } else {
-                // Full scan
-                rows = storage.all()
+                lower = bound
+            }
+
+            func narrowUpper(_ bound: SortedKeyValueIndex.Bound) {
+                if let current = upper {
+                    let order = SortedKeyValueIndex.compare(bound.bytes, current.bytes)
+                    if order > 0 || (order == 0 && bound.inclusive) { return }
+                }
+                upper = bound
+            }
+
+            if plan.contains(.keyList), let list = values.first {
+                var keys: [String] = []
+                try list.forEachInListValue { key in
+                    // As with `=`, NULL and blobs never equal a TEXT key.
+                    if !key.isNull && key.type != .blob {
+                        keys.append(key.textValue)
+                    }
+                }
+                rows = .entries(
+                    session.entries(forKeys: keys, descending: plan.contains(.descending)),
+                    position: 0
+                )
+                return
             }
-            currentIndex = 0
-            currentRowId = 0
+
+            var arguments = values.makeIterator()
+            for (flag, _) in Plan.constraints where plan.contains(flag) {
+                guard let value = arguments.next() else { break }
+
+                // NULL never compares true. Numbers take the key's TEXT affinity, and
+                // blobs sort after all text.
+                if value.isNull {
+                    isEmpty = true
+                    continue
+                }
+                let isBlob = value.type == .blob
+                let bytes = Array(value.textValue.utf8)
+
+                switch flag {
+                case .equal:
+                    if isBlob { isEmpty = true }
+                    narrowLower(.init(bytes: bytes, inclusive: true))
+                    narrowUpper(.init(bytes: bytes, inclusive: true))
+                case .greaterThan, .greaterThanOrEqual:
+                    if isBlob { isEmpty = true }
+                    narrowLower(.init(bytes: bytes, inclusive: flag == .greaterThanOrEqual))
+                case .lessThan, .lessThanOrEqual:
+                    if !isBlob {
+                        narrowUpper(.init(bytes: bytes, inclusive: flag == .lessThanOrEqual))
+                    }
+                case .like:
+                    // LIKE folds ASCII case, so scan every key between the upper- and
+                    // lowercase spellings of the literal prefix.
+                    let prefix = literalPrefix(of: bytes, wildcards: [UInt8(ascii: "%"), UInt8(ascii: "_")])
+                    if !prefix.isEmpty {
+                        narrowLower(.init(bytes: prefix.map(asciiUppercased), inclusive: true))
+                        if let end = prefixUpperBound(prefix.map(asciiLowercased)) {
+                            narrowUpper(end)
+                        }
+                    }
+                case .prefix:
+                    if !bytes.isEmpty {
+                        narrowLower(.init(bytes: bytes, inclusive: true))
+                        if let end = prefixUpperBound(bytes) {
+                            narrowUpper(end)
+                        }
+                    }
+                case .glob:
+                    let prefix = literalPrefix(
+                        of: bytes,
+                        wildcards: [UInt8(ascii: "*"), UInt8(ascii: "?"), UInt8(ascii: "[")]
+                    )
+                    if !prefix.isEmpty {
+                        narrowLower(.init(bytes: prefix, inclusive: true))
+                        if let end = prefixUpperBound(prefix) {
+                            narrowUpper(end)
+                        }
+                    }
+                default:
+                    break
+                }
+            }
+
+            rows = .scan(isEmpty
+                ? .empty
+                : session.scan(from: lower, to: upper, descending: plan.contains(.descending)))
         }
 
         public mutating func next() throws {
-            currentIndex += 1
-            currentRowId += 1
+            switch rows {
+            case .scan(var scan):
+                scan.advance()
+                rows = .scan(scan)
+            case let .entries(entries, position):
+                rows = .entries(entries, position: position + 1)
+            }
         }
 
         public var eof: Bool {
-            currentIndex >= rows.count
+            current == nil
         }
 
         public func column(at index: Int) throws -> ColumnValue {
-            guard currentIndex < rows.count else {
+            guard let row = current else {
                 return .null
             }
 
-            let row = rows[currentIndex]
             switch index {
             case 0:
-                return .text(row.0) // key
+                return .text(row.key)
             case 1:
-                return .text(row.1) // value
+                return .text(row.value)
             default:
                 return .null
             }
         }
 
         public var rowid: Int64 {
-            currentRowId
+            current?.rowid ?? 0
+        }
+
+        /// Drops the rows of the last scan so a pooled cursor does not keep a snapshot
+        /// of the table alive.
+        public mutating func reset() -> Bool {
+            rows = .scan(.empty)
+            return true
+        }
+    }
+}
+
+/// Returns the bytes of a pattern before its first wildcard.
+private func literalPrefix(of pattern: [UInt8], wildcards: Set<UInt8>) -> [UInt8] {
+    Array(pattern.prefix { !wildcards.contains($0) })
+}
+
+/// The exclusive upper bound of all byte strings starting with `prefix`, or `nil` if none.
+private func prefixUpperBound(_ prefix: [UInt8]) -> SortedKeyValueIndex.Bound? {
+    var bytes = prefix
+    while let last = bytes.last {
+        if last < 0xFF {
+            bytes[bytes.count - 1] = last + 1
+            return .init(bytes: bytes, inclusive: false)
         }
+        bytes.removeLast()
     }
+    return nil
+}
+
+private func asciiUppercased(_ byte: UInt8) -> UInt8 {
+    (UInt8(ascii: "a")...UInt8(ascii: "z")).contains(byte) ? byte - 32 : byte
+}
+
+private func asciiLowercased(_ byte: UInt8) -> UInt8 {
+    (UInt8(ascii: "A")...UInt8(ascii: "Z")).contains(byte) ? byte + 32 : byte
+}
+
+/// `starts_with(text, prefix)`: whether the UTF-8 bytes of `text` begin with those of
+/// `prefix`, or NULL if either is NULL.
+private let startsWith: BorrowingScalarFunction = { context, args in
+    guard args.count == 2, !args[0].isNull, !args[1].isNull else {
+        context.resultNull()
+        return
+    }
+    let matches = args[0].withUTF8Bytes { text in
+        args[1].withUTF8Bytes { prefix in
+            text.starts(with: prefix)
+        }
+    }
+    context.result(Int64(matches ? 1 : 0))
 }
 
 /// Extension that exposes the KeyValue virtual table.
+///
+/// It also registers `starts_with(text, prefix)`, which `keyvalue` tables answer from
+/// their index when applied to `key`.
 public struct KeyValueTableExtension: SQLiteExtensionModule {
     public static let name = "keyvalue_table"
 
     public static func register(with db: SQLiteDatabase) throws {
+        try db.createScalarFunction(
+            name: "starts_with",
+            argumentCount: 2,
+            deterministic: true,
+            function: startsWith
+        )
         try db.registerVirtualTableModule(name: "keyvalue", module: KeyValueVirtualTable.self)
     }
 }
@@ -0,0 +1,366 @@
+import SQLiteExtensionKit
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#elseif canImport(Glibc)
+import Glibc
+#endif
+
+/// A read-only columnar file mapped into memory, as served by ``MappedColumnTable``.
+///
+/// ## File Format
+/// All integers are little-endian. The file starts with a header and one descriptor per
+/// column:
+///
+/// | Offset | Size | Field |
+/// | --- | --- | --- |
+/// | 0 | 8 | Magic, `SEKCOL01` |
+/// | 8 | 4 | Column count |
+/// | 12 | 4 | Reserved, 0 |
+/// | 16 | 8 | Row count |
+/// | 24 | 40 per column | Column descriptors |
+///
+/// A descriptor holds the ``ColumnType`` and the name's byte length as `UInt32`s,
+/// followed by four `UInt64` file offsets: the UTF-8 name, the values, the heap, and a
+/// NULL bitmap (0 when the column has no NULLs). Integer and real columns store one
+/// 8-byte value per row. Text and blob columns store `rowCount + 1` offsets into the
+/// heap, so the bytes of row `i` are `heap[offsets[i]..<offsets[i + 1]]`. Bit `i % 8` of
+/// bitmap byte `i / 8` is set when row `i` is NULL.
+///
+/// Opening a file only maps it and validates the header and descriptors, so it takes the
+/// same time for any file size. Values are read in place on demand: the operating system
+/// pages in just the parts of the columns a query reads, and text and blobs are handed to
+/// SQLite without copying.
+public final class MappedColumnFile: @unchecked Sendable {
+    /// The storage class of a column.
+    public enum ColumnType: UInt32, Sendable {
+        case integer = 1
+        case real = 2
+        case text = 3
+        case blob = 4
+
+        /// The type name declared in the virtual table schema.
+        var declaration: String {
+            switch self {
+            case .integer: return "INTEGER"
+            case .real: return "REAL"
+            case .text: return "TEXT"
+            case .blob: return "BLOB"
+            }
+        }
+    }
+
+    /// A column's name, type and location in the file.
+    public struct Column: Sendable {
+        public let name: String
+        public let type: ColumnType
+        let values: Int
+        let heap: Int
+        /// The validated heap size, which bounds every text and blob offset.
+        let heapLength: UInt64
+        let nulls: Int?
+    }
+
+    /// Errors opening or writing a column file.
+    public enum FileError: Error {
+        case cannotOpen(path: String, errno: Int32)
+        case invalidFormat(String)
+        case unsupportedValue(column: String, row: Int)
+    }
+
+    static let magic = Array("SEKCOL01".utf8)
+    static let headerSize = 24
+    static let descriptorSize = 40
+
+    /// The number of rows in every column.
+    public let rowCount: Int
+
+    /// The columns in file order.
+    public let columns: [Column]
+
+    private let base: UnsafeRawPointer
+    private let size: Int
+
+    /// Maps the file at `path` and validates its header.
+    ///
+    /// - Throws: ``FileError`` if the file cannot be read or is not a valid column file.
+    public init(path: String) throws {
+        let descriptor = open(path, O_RDONLY)
+        guard descriptor >= 0 else {
+            throw FileError.cannotOpen(path: path, errno: errno)
+        }
+        defer { close(descriptor) }
+
+        var info = stat()
+        guard fstat(descriptor, &info) == 0 else {
+            throw FileError.cannotOpen(path: path, errno: errno)
+        }
+        let size = Int(info.st_size)
+        guard size >= Self.headerSize else {
+            throw FileError.invalidFormat("\(path) is too short for a column file header")
+        }
+
+        // The mapping stays valid after the descriptor is closed.
+        let mapped = mmap(nil, size, PROT_READ, MAP_PRIVATE, descriptor, 0)
+        guard let mapped, mapped != UnsafeMutableRawPointer(bitPattern: -1) else {
+            throw FileError.cannotOpen(path: path, errno: errno)
+        }
+
+        let header: (rowCount: Int, columns: [Column])
+        do {
+            header = try Self.readHeader(UnsafeRawPointer(mapped), size: size)
+        } catch {
+            munmap(mapped, size)
+            throw error
+        }
+        self.rowCount = header.rowCount
+        self.columns = header.columns
+        self.base = UnsafeRawPointer(mapped)
+        self.size = size
+    }
+
+    deinit {
+        munmap(UnsafeMutableRawPointer(mutating: base), size)
+    }
+
+    /// The `CREATE TABLE` statement declaring the file's columns.
+    var schema: String {
+        let declarations = columns.map { column in
+            "\"\(column.name.replacingOccurrences(of: "\"", with: "\"\""))\" \(column.type.declaration)"
+        }
+        return "CREATE TABLE x(\(declarations.joined(separator: ", ")))"
+    }
+
+    // MARK: Reading
+
+    /// Whether a cell is NULL.
+    public func isNull(column: Int, row: Int) -> Bool {
+        guard let nulls = columns[column].nulls else { return false }
+        return base.load(fromByteOffset: nulls + (row >> 3), as: UInt8.self) & (1 << (row & 7)) != 0
+    }
+
+    /// Reads a cell of an integer column in place.
+    public func integer(column: Int, row: Int) -> Int64 {
+        Int64(littleEndian: base.loadUnaligned(fromByteOffset: columns[column].values + row * 8, as: Int64.self))
+    }
+
+    /// Reads a cell of a real column in place.
+    public func real(column: Int, row: Int) -> Double {
+        let bits = UInt64(littleEndian: base.loadUnaligned(
+            fromByteOffset: columns[column].values + row * 8,
+            as: UInt64.self
+        ))
+        return Double(bitPattern: bits)
+    }
+
+    /// The bytes of a cell of a text or blob column, referencing the mapping.
+    ///
+    /// Offsets that run backwards or past the heap read as empty rather than out of bounds.
+    public func bytes(column: Int, row: Int) -> UnsafeRawBufferPointer {
+        let info = columns[column]
+        let offsets = info.values + row * 8
+        let start = UInt64(littleEndian: base.loadUnaligned(fromByteOffset: offsets, as: UInt64.self))
+        let end = UInt64(littleEndian: base.loadUnaligned(fromByteOffset: offsets + 8, as: UInt64.self))
+        guard start <= end, end <= info.heapLength else {
+            return UnsafeRawBufferPointer(start: nil, count: 0)
+        }
+        return UnsafeRawBufferPointer(start: base + info.heap + Int(start), count: Int(end - start))
+    }
+
+    /// A cell as a column value; text and blobs reference the mapping without copying.
+    public func value(column: Int, row: Int) -> ColumnValue {
+        if isNull(column: column, row: row) {
+            return .null
+        }
+        switch columns[column].type {
+        case .integer:
+            return .integer(integer(column: column, row: row))
+        case .real:
+            return .real(real(column: column, row: row))
+        case .text:
+            return .staticText(SQLiteStaticBytes(bytes(column: column, row: row)))
+        case .blob:
+            return .staticBlob(SQLiteStaticBytes(bytes(column: column, row: row)))
+        }
+    }
+
+    private static func readHeader(_ base: UnsafeRawPointer, size: Int) throws -> (Int, [Column]) {
+        func integer<T: FixedWidthInteger>(at offset: Int, as type: T.Type) -> T {
+            T(littleEndian: base.loadUnaligned(fromByteOffset: offset, as: T.self))
+        }
+        func fits(_ offset: UInt64, _ length: UInt64) -> Bool {
+            offset <= UInt64(size) && length <= UInt64(size) - offset
+        }
+
+        guard magic.indices.allSatisfy({ base.load(fromByteOffset: $0, as: UInt8.self) == magic[$0] }) else {
+            throw FileError.invalidFormat("missing column file magic")
+        }
+        let columnCount = Int(integer(at: 8, as: UInt32.self))
+        let rows = integer(at: 16, as: UInt64.self)
+        guard columnCount > 0,
+              fits(UInt64(headerSize), UInt64(columnCount) * UInt64(descriptorSize)) else {
+            throw FileError.invalidFormat("column descriptors exceed the file")
+        }
+        // Also keeps every offset computed below within Int.
+        guard rows < 1 << 59 else {
+            throw FileError.invalidFormat("row count \(rows) is too large")
+        }
+        let valueBytes = rows * 8
+
+        var columns: [Column] = []
+        for index in 0..<columnCount {
+            let descriptor = headerSize + index * descriptorSize
+            let rawType = integer(at: descriptor, as: UInt32.self)
+            let nameLength = UInt64(integer(at: descriptor + 4, as: UInt32.self))
+            let nameOffset = integer(at: descriptor + 8, as: UInt64.self)
+            let values = integer(at: descriptor + 16, as: UInt64.self)
+            let heap = integer(at: descriptor + 24, as: UInt64.self)
+            let nulls = integer(at: descriptor + 32, as: UInt64.self)
+
+            guard let type = ColumnType(rawValue: rawType) else {
+                throw FileError.invalidFormat("column \(index) has unknown type \(rawType)")
+            }
+            guard fits(nameOffset, nameLength) else {
+                throw FileError.invalidFormat("column \(index) name exceeds the file")
+            }
+            let name = String(decoding: UnsafeRawBufferPointer(
+                start: base + Int(nameOffset),
+                count: Int(nameLength)
+            ), as: UTF8.self)
+            guard nulls == 0 || fits(nulls, (rows + 7) / 8) else {
+                throw FileError.invalidFormat("column \(name) NULL bitmap exceeds the file")
+            }
+
+            var heapLength: UInt64 = 0
+            switch type {
+            case .integer, .real:
+                guard fits(values, valueBytes) else {
+                    throw FileError.invalidFormat("column \(name) values exceed the file")
+                }
+            case .text, .blob:
+                guard fits(values, valueBytes + 8) else {
+                    throw FileError.invalidFormat("column \(name) offsets exceed the file")
+                }
+                // The final offset is the heap size; reading it touches one page.
+                heapLength = integer(at: Int(values + valueBytes), as: UInt64.self)
+                guard fits(heap, heapLength) else {
+                    throw FileError.invalidFormat("column \(name) heap exceeds the file")
+                }
+            }
+
+            columns.append(Column(
+                name: name,
+                type: type,
+                values: Int(values),
+                heap: Int(heap),
+                heapLength: heapLength,
+                nulls: nulls == 0 ? nil : Int(nulls)
+            ))
+        }
+        return (Int(rows), columns)
+    }
+
+    // MARK: Writing
+
+    /// Writes a column file, for example when converting data or in tests.
+    ///
+    /// The file is built in memory; every column must have the same number of values.
+    /// Integer columns accept integers, real columns accept reals and integers, text
+    /// columns accept text and blob columns accept blobs and text; any column accepts NULL.
+    ///
+    /// - Parameters:
+    ///   - columns: The columns in order, with one value per row.
+    ///   - path: The destination, which is replaced.
+    /// - Throws: ``FileError`` for mismatched columns or values, or any error writing the file.
+    public static func write(
+        columns: [(name: String, type: ColumnType, values: [ColumnValue])],
+        to path: String
+    ) throws {
+        guard let rowCount = columns.first?.values.count, columns.allSatisfy({ $0.values.count == rowCount }) else {
+            throw FileError.invalidFormat("columns must be non-empty and have the same number of rows")
+        }
+
+        var bytes: [UInt8] = []
+        func append<T: FixedWidthInteger>(_ value: T) {
+            withUnsafeBytes(of: value.littleEndian) { bytes.append(contentsOf: $0) }
+        }
+        func align() {
+            bytes.append(contentsOf: repeatElement(0, count: (8 - bytes.count % 8) % 8))
+        }
+        func patch(_ value: UInt64, at offset: Int) {
+            withUnsafeBytes(of: value.littleEndian) { bytes.replaceSubrange(offset..<offset + 8, with: $0) }
+        }
+
+        bytes.append(contentsOf: magic)
+        append(UInt32(columns.count))
+        append(UInt32(0))
+        append(UInt64(rowCount))
+        let descriptors = bytes.count
+        bytes.append(contentsOf: repeatElement(0, count: columns.count * descriptorSize))
+
+        for (index, column) in columns.enumerated() {
+            let descriptor = descriptors + index * descriptorSize
+            let name = Array(column.name.utf8)
+            withUnsafeBytes(of: column.type.rawValue.littleEndian) {
+                bytes.replaceSubrange(descriptor..<descriptor + 4, with: $0)
+            }
+            withUnsafeBytes(of: UInt32(name.count).littleEndian) {
+                bytes.replaceSubrange(descriptor + 4..<descriptor + 8, with: $0)
+            }
+            patch(UInt64(bytes.count), at: descriptor + 8)
+            bytes.append(contentsOf: name)
+
+            if column.values.contains(where: { if case .null = $0 { return true } else { return false } }) {
+                align()
+                patch(UInt64(bytes.count), at: descriptor + 32)
+                var bitmap = [UInt8](repeating: 0, count: (rowCount + 7) / 8)
+                for (row, value) in column.values.enumerated() {
+                    if case .null = value {
+                        bitmap[row >> 3] |= 1 << (row & 7)
+                    }
+                }
+                bytes.append(contentsOf: bitmap)
+            }
+
+            align()
+            patch(UInt64(bytes.count), at: descriptor + 16)
+            switch column.type {
+            case .integer, .real:
+                for (row, value) in column.values.enumerated() {
+                    switch (column.type, value) {
+                    case (.integer, .integer(let integer)):
+                        append(integer)
+                    case (.real, .real(let real)):
+                        append(real.bitPattern)
+                    case (.real, .integer(let integer)):
+                        append(Double(integer).bitPattern)
+                    case (_, .null):
+                        append(UInt64(0))
+                    default:
+                        throw FileError.unsupportedValue(column: column.name, row: row)
+                    }
+                }
+            case .text, .blob:
+                var heap: [UInt8] = []
+                append(UInt64(0))
+                for (row, value) in column.values.enumerated() {
+                    switch (column.type, value) {
+                    case (_, .text(let text)):
+                        heap.append(contentsOf: text.utf8)
+                    case (.blob, .blob(let data)):
+                        heap.append(contentsOf: data)
+                    case (_, .null):
+                        break
+                    default:
+                        throw FileError.unsupportedValue(column: column.name, row: row)
+                    }
+                    append(UInt64(heap.count))
+                }
+                patch(UInt64(bytes.count), at: descriptor + 24)
+                bytes.append(contentsOf: heap)
+            }
+        }
+
+        try Data(bytes).write(to: URL(fileURLWithPath: path))
+    }
+}
@@ -0,0 +1,278 @@
+import SQLiteExtensionKit
+import Foundation
+
+/// Example virtual table implementation: A read-only table over a memory-mapped column file.
+///
+/// The table's columns are those of the ``MappedColumnFile`` named in its arguments, so
+/// large files can be queried where they are instead of being imported first.
+///
+/// ## Usage in SQL
+/// ```sql
+/// -- Opens instantly: only the header is read
+/// CREATE VIRTUAL TABLE events USING mmap_table('/data/events.col');
+///
+/// -- Touches only the pages of the `kind` column for rows 1000 through 1999
+/// SELECT kind, count(*) FROM events WHERE rowid BETWEEN 1000 AND 1999 GROUP BY kind;
+/// ```
+///
+/// ## Implementation Note
+/// Row `i` of the file has rowid `i + 1`. `bestIndex` pushes down `=`, `<`, `<=`, `>`,
+/// `>=` and `BETWEEN` on the rowid, so a range reads only its own rows, and consumes
+/// `ORDER BY rowid` in either direction. Cells are decoded from the mapping when SQLite
+/// asks for them, so a query pages in only the columns and rows it reads, and text and
+/// blob values point SQLite at the mapped bytes instead of copying them.
+public struct MappedColumnTable: VirtualTableModule {
+    private let file: MappedColumnFile
+
+    /// Bits of `indexNumber` describing the plan chosen by ``bestIndex(_:)``.
+    ///
+    /// Constraint values are passed to `filter` in the order the flags are listed.
+    struct Plan: OptionSet, Hashable {
+        let rawValue: Int
+
+        static let equal = Plan(rawValue: 1 << 0)
+        static let greaterThan = Plan(rawValue: 1 << 1)
+        static let greaterThanOrEqual = Plan(rawValue: 1 << 2)
+        static let lessThan = Plan(rawValue: 1 << 3)
+        static let lessThanOrEqual = Plan(rawValue: 1 << 4)
+        static let descending = Plan(rawValue: 1 << 5)
+
+        /// Constraint flags in argument order, with the operator each one handles.
+        static let constraints: [(Plan, IndexInfo.Constraint.Operator)] = [
+            (.equal, .eq),
+            (.greaterThan, .gt),
+            (.greaterThanOrEqual, .ge),
+            (.lessThan, .lt),
+            (.lessThanOrEqual, .le),
+        ]
+    }
+
+    enum TableError: Error {
+        case missingPath
+    }
+
+    /// Unused: each table declares the columns of its file in ``declaredSchema``.
+    public static var schema: String {
+        "CREATE TABLE x(data BLOB)"
+    }
+
+    public var declaredSchema: String {
+        file.schema
+    }
+
+    /// Maps the file named by the first module argument, which may be quoted.
+    public static func create(arguments: [String]) throws -> MappedColumnTable {
+        // argv holds the module, database and table names before the module arguments.
+        guard arguments.count > 3 else { throw TableError.missingPath }
+        var path = arguments[3].trimmingCharacters(in: .whitespaces)
+        if path.count >= 2, let quote = path.first, quote == "'" || quote == "\"", path.last == quote {
+            path = String(path.dropFirst().dropLast())
+                .replacingOccurrences(of: "\(quote)\(quote)", with: "\(quote)")
+        }
+        return MappedColumnTable(file: try MappedColumnFile(path: path))
+    }
+
+    private init(file: MappedColumnFile) {
+        self.file = file
+    }
+
+    public func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        var newInfo = indexInfo
+
+        // Pick at most one usable rowid constraint for each operator, skipping a second
+        // lower or upper bound.
+        var plan: Plan = []
+        var chosen: [Plan: Int] = [:]
+        for (index, constraint) in indexInfo.constraints.enumerated()
+        where constraint.usable && constraint.column == -1 {
+            guard let flag = Plan.constraints.first(where: { $0.1 == constraint.op })?.0,
+                  !plan.contains(flag) else {
+                continue
+            }
+            if (flag == .greaterThan || flag == .greaterThanOrEqual)
+                && !plan.isDisjoint(with: [.greaterThan, .greaterThanOrEqual]) {
+                continue
+            }
+            if (flag == .lessThan || flag == .lessThanOrEqual)
+                && !plan.isDisjoint(with: [.lessThan, .lessThanOrEqual]) {
+                continue
+            }
+            plan.insert(flag)
+            chosen[flag] = index
+        }
+
+        if chosen[.equal] != nil {
+            plan = [.equal]
+            newInfo.flags.insert(.scanUnique)
+        }
+
+        // Estimate from the constant bounds SQLite already knows, halving for the rest.
+        var range = RowRange(rowCount: file.rowCount)
+        var fraction = 1.0
+        var argvIndex = 1
+        for (flag, op) in Plan.constraints {
+            guard plan.contains(flag), let index = chosen[flag] else { continue }
+            newInfo.constraintUsage[index].argvIndex = argvIndex
+            argvIndex += 1
+            if case .integer(let value) = indexInfo.constraints[index].rightHandValue {
+                // Integer bounds are exact, so SQLite need not recheck them.
+                range.narrow(op, value)
+                newInfo.constraintUsage[index].omit = true
+            } else if flag != .equal {
+                fraction /= 2
+            }
+        }
+
+        if let order = indexInfo.orderBy.first, order.column == -1 {
+            newInfo.orderByConsumed = true
+            if order.desc {
+                plan.insert(.descending)
+            }
+        }
+
+        let rows = plan.contains(.equal) ? min(range.count, 1) : Int64(Double(range.count) * fraction)
+        newInfo.indexNumber = plan.rawValue
+        newInfo.estimatedRows = max(rows, 1)
+        newInfo.estimatedCost = Double(max(rows, 1))
+        return newInfo
+    }
+
+    public func open() throws -> MappedColumnCursor {
+        MappedColumnCursor(file: file)
+    }
+
+    /// Cursor walking a rowid range of the mapped file.
+    public struct MappedColumnCursor: VirtualTableCursor {
+        private let file: MappedColumnFile
+        private var range = RowRange(rowCount: 0)
+        private var position: Int64 = 1
+        private var descending = false
+
+        init(file: MappedColumnFile) {
+            self.file = file
+        }
+
+        public mutating func filter(
+            indexNumber: Int,
+            indexString: String?,
+            values: [SQLiteValue]
+        ) throws {
+            let plan = Plan(rawValue: indexNumber)
+            range = RowRange(rowCount: file.rowCount)
+            var arguments = values.makeIterator()
+            for (flag, op) in Plan.constraints where plan.contains(flag) {
+                guard let value = arguments.next() else { break }
+                range.narrow(op, value)
+            }
+            descending = plan.contains(.descending)
+            position = descending ? range.upper : range.lower
+        }
+
+        public mutating func next() throws {
+            position += descending ? -1 : 1
+        }
+
+        public var eof: Bool {
+            position < range.lower || position > range.upper
+        }
+
+        public func column(at index: Int) throws -> ColumnValue {
+            guard index >= 0 && index < file.columns.count else { return .null }
+            return file.value(column: index, row: Int(position - 1))
+        }
+
+        public var rowid: Int64 {
+            position
+        }
+    }
+}
+
+/// An inclusive range of rowids, narrowed by constraints the way SQLite compares them.
+struct RowRange {
+    private(set) var lower: Int64 = 1
+    private(set) var upper: Int64
+
+    init(rowCount: Int) {
+        upper = Int64(rowCount)
+    }
+
+    var count: Int64 {
+        max(0, upper - lower + 1)
+    }
+
+    mutating func narrow(_ op: IndexInfo.Constraint.Operator, _ value: Int64) {
+        switch op {
+        case .eq:
+            lower = max(lower, value)
+            upper = min(upper, value)
+        case .gt:
+            if value == .max { clear() } else { lower = max(lower, value + 1) }
+        case .ge:
+            lower = max(lower, value)
+        case .lt:
+            if value == .min { clear() } else { upper = min(upper, value - 1) }
+        case .le:
+            upper = min(upper, value)
+        default:
+            break
+        }
+    }
+
+    /// Applies a constraint on a value of any type: reals are rounded towards the range,
+    /// every number is less than any text or blob, and NULL matches nothing.
+    mutating func narrow(_ op: IndexInfo.Constraint.Operator, _ value: SQLiteValue) {
+        switch value.type {
+        case .integer:
+            narrow(op, value.intValue)
+        case .real:
+            let real = value.doubleValue
+            switch op {
+            case .eq:
+                if let exact = Int64(exactly: real) { narrow(.eq, exact) } else { clear() }
+            case .gt, .le:
+                narrow(op, Self.clamped(real.rounded(.down)))
+            case .ge, .lt:
+                narrow(op, Self.clamped(real.rounded(.up)))
+            default:
+                break
+            }
+        case .text, .blob:
+            if op == .eq || op == .gt || op == .ge {
+                clear()
+            }
+        case .null:
+            clear()
+        }
+    }
+
+    private mutating func clear() {
+        lower = 1
+        upper = 0
+    }
+
+    private static func clamped(_ value: Double) -> Int64 {
+        if value.isNaN { return 0 }
+        if value >= 9223372036854775807.0 { return .max }
+        if value <= -9223372036854775808.0 { return .min }
+        return Int64(value)
+    }
+}
+
+/// Registers the `mmap_table` module.
+public struct MappedColumnTableExtension: SQLiteExtensionModule {
+    public static let name = "mmap_table"
+
+    public static func register(with db: SQLiteDatabase) throws {
+        try db.registerVirtualTableModule(name: "mmap_table", module: MappedColumnTable.self)
+    }
+}
+
+/// Entry point for the memory-mapped table extension.
+@_cdecl("sqlite3_mmaptable_init")
+public func sqlite3_mmaptable_init(
+    db: OpaquePointer?,
+    pzErrMsg: UnsafeMutablePointer<UnsafeMutablePointer<CChar>?>?,
+    pApi: UnsafePointer<sqlite3_api_routines>?
+) -> Int32 {
+    return MappedColumnTableExtension.entryPoint(db: db, pzErrMsg: pzErrMsg, pApi: pApi)
+}
@@ -6,6 +6,8 @@ import Foundation
 /// This extension provides mathematical functions including:
 /// - Scalar functions: `power(x, y)`, `factorial(n)`, `fibonacci(n)`
 /// - Aggregate functions: `product(x)`, `std_dev(x)`
+/// - Table-valued function: `parallel_aggregate(aggregate, table, column, threads)`, which
+///   computes `product` or `std_dev` over a column by scanning rowid ranges on several threads
 ///
 /// ## Usage in SQL
 /// ```sql
@@ -17,23 +19,15 @@ import Foundation
 /// -- Aggregate functions
 /// SELECT product(value) FROM numbers;
 /// SELECT std_dev(price) FROM products;
+/// SELECT value FROM parallel_aggregate('std_dev', 'products', 'price', 8);
 /// ```
 public struct MathFunctionsExtension: SQLiteExtensionModule {
     public static let name = "math_functions"
 
     public static func register(with db: SQLiteDatabase) throws {
         // Power function: power(x, y) = x^y
-        try db.createScalarFunction(name: "power", argumentCount: 2, deterministic: true) { context, args in
-            guard args.count == 2 else {
-                context.resultError("power() requires exactly 2 arguments")
-                return
-            }
-
-            let base = args[0].doubleValue
-            let exponent = args[1].doubleValue
-            let result = pow(base, exponent)
-
-            context.result(result)
+        try db.createScalarFunction(name: "power", deterministic: true) { (base: Double, exponent: Double) in
+            pow(base, exponent)
         }
 
         // Factorial function
@@ -98,70 +92,80 @@ public struct MathFunctionsExtension: SQLiteExtensionModule {
         }
 
         // Product aggregate: multiplies all values together
-        try db.createAggregateFunction(
-            name: "product",
-            argumentCount: 1,
-            step: { context, args in
-                guard let first = args.first else { return }
-
-                let value = first.doubleValue
-                context.withAggregateValue(initialValue: (product: 1.0, count: Int64(0))) { state in
-                    if state.count == 0 {
-                        state.product = value
-                    } else {
-                        state.product *= value
-                    }
-                    state.count += 1
-                }
-            },
-            final: { context in
-                guard context.withExistingAggregateValue((product: Double, count: Int64).self, clearOnExit: true, { state in
-                    if state.count == 0 {
-                        context.resultNull()
-                    } else {
-                        context.result(state.product)
-                    }
-                }) else {
-                    context.resultNull()
-                    return
-                }
-            }
-        )
+        try db.createAggregateFunction(name: "product", argumentCount: 1, aggregate: Product.self)
 
         // Standard deviation aggregate
-        try db.createAggregateFunction(
-            name: "std_dev",
-            argumentCount: 1,
-            step: { context, args in
-                guard let first = args.first else { return }
-
-                let value = first.doubleValue
-
-                context.withAggregateValue(initialValue: (count: Int64(0), sum: 0.0, sumSquares: 0.0)) { state in
-                    state.count += 1
-                    state.sum += value
-                    state.sumSquares += value * value
-                }
-            },
-            final: { context in
-                guard context.withExistingAggregateValue((count: Int64, sum: Double, sumSquares: Double).self, clearOnExit: true, { state in
-                    let count = state.count
-                    if count == 0 {
-                        context.resultNull()
-                        return
-                    }
-
-                    let mean = state.sum / Double(count)
-                    let variance = (state.sumSquares / Double(count)) - (mean * mean)
-                    let stdDev = sqrt(max(0, variance))  // max to handle floating point errors
-
-                    context.result(stdDev)
-                }) else {
-                    context.resultNull()
-                    return
-                }
-            }
-        )
+        try db.createAggregateFunction(name: "std_dev", argumentCount: 1, aggregate: StandardDeviation.self)
+
+        // Both aggregates again, computed over a table by several threads
+        try db.createParallelAggregateFunction(aggregates: [
+            "product": Product.self,
+            "std_dev": StandardDeviation.self,
+        ])
+    }
+}
+
+/// Running product of the values, NULL when there are none.
+public struct Product: MergeableAggregate {
+    private var product = 1.0
+    private var count: Int64 = 0
+
+    public init() {}
+
+    public mutating func step(_ arguments: SQLiteArguments) {
+        guard let first = arguments.first else { return }
+        product *= first.doubleValue
+        count += 1
+    }
+
+    public mutating func merge(_ other: Product) {
+        product *= other.product
+        count += other.count
+    }
+
+    public func finalize() -> ColumnValue {
+        count == 0 ? .null : .real(product)
+    }
+}
+
+/// Population standard deviation, NULL when there are no values.
+///
+/// The state is the count, mean and sum of squared deviations, updated with Welford's
+/// method and merged with Chan's formula, which stays accurate when the mean is large
+/// compared to the spread.
+public struct StandardDeviation: MergeableAggregate {
+    private var count: Int64 = 0
+    private var mean = 0.0
+    private var squaredDeviations = 0.0
+
+    public init() {}
+
+    public mutating func step(_ arguments: SQLiteArguments) {
+        guard let first = arguments.first else { return }
+        let value = first.doubleValue
+        count += 1
+        let delta = value - mean
+        mean += delta / Double(count)
+        squaredDeviations += delta * (value - mean)
+    }
+
+    public mutating func merge(_ other: StandardDeviation) {
+        guard other.count > 0 else { return }
+        guard count > 0 else {
+            self = other
+            return
+        }
+        let total = count + other.count
+        let delta = other.mean - mean
+        mean += delta * Double(other.count) / Double(total)
+        squaredDeviations += other.squaredDeviations
+            + delta * delta * Double(count) * Double(other.count) / Double(total)
+        count = total
+    }
+
+    public func finalize() -> ColumnValue {
+        guard count > 0 else { return .null }
+        return .real(sqrt(max(0, squaredDeviations / Double(count))))
     }
 }
 
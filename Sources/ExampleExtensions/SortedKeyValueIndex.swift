@@ -0,0 +1,266 @@
+import Foundation
+
+/// An ordered key/value map tuned for range scans and cheap snapshots.
+///
+/// Keys are ordered by their UTF-8 bytes, which is SQLite's `BINARY` collation, so a scan
+/// can satisfy `ORDER BY key` directly. Entries live in two sorted arrays: a large `base`
+/// and a small `delta` of recent changes (including deletions) that overrides it. Writes
+/// only insert into `delta`; once it grows past roughly √n entries it is merged into a new
+/// `base`. This keeps writes cheap without a tree, and because both arrays are
+/// copy-on-write, copying the index to pin a consistent view for a scan is O(1).
+struct SortedKeyValueIndex: Sendable {
+    struct Entry: Sendable {
+        var key: String
+        var value: String
+        var rowid: Int64
+    }
+
+    /// A pending change: the new entry for `key`, or `nil` if it was deleted.
+    private struct Change: Sendable {
+        var key: String
+        var entry: Entry?
+    }
+
+    private var base: [Entry] = []
+    private var delta: [Change] = []
+
+    /// The number of live entries.
+    private(set) var count = 0
+
+    /// Returns the entry stored for `key`.
+    func entry(forKey key: String) -> Entry? {
+        let slot = Self.lowerBound(key.utf8, in: delta, key: \.key, inclusive: true)
+        if slot < delta.count, Self.compare(delta[slot].key.utf8, key.utf8) == 0 {
+            return delta[slot].entry
+        }
+
+        let baseSlot = Self.lowerBound(key.utf8, in: base, key: \.key, inclusive: true)
+        if baseSlot < base.count, Self.compare(base[baseSlot].key.utf8, key.utf8) == 0 {
+            return base[baseSlot]
+        }
+        return nil
+    }
+
+    /// Inserts or replaces the entry for its key.
+    mutating func insert(_ entry: Entry) {
+        record(Change(key: entry.key, entry: entry))
+    }
+
+    /// Removes the entry for `key`, if any.
+    mutating func removeEntry(forKey key: String) {
+        record(Change(key: key, entry: nil))
+    }
+
+    private mutating func record(_ change: Change) {
+        let existed = entry(forKey: change.key) != nil
+        let slot = Self.lowerBound(change.key.utf8, in: delta, key: \.key, inclusive: true)
+        let replacing = slot < delta.count && Self.compare(delta[slot].key.utf8, change.key.utf8) == 0
+
+        let baseSlot = Self.lowerBound(change.key.utf8, in: base, key: \.key, inclusive: true)
+        let inBase = baseSlot < base.count && Self.compare(base[baseSlot].key.utf8, change.key.utf8) == 0
+
+        if change.entry == nil && !inBase {
+            // Nothing in base to shadow, so no tombstone is needed.
+            if replacing {
+                delta.remove(at: slot)
+            }
+        } else if replacing {
+            delta[slot] = change
+        } else {
+            delta.insert(change, at: slot)
+        }
+
+        count += (change.entry == nil ? 0 : 1) - (existed ? 1 : 0)
+
+        if delta.count > max(64, Int(Double(base.count).squareRoot())) {
+            mergeDelta()
+        }
+    }
+
+    /// Folds `delta` into a new `base`, dropping deleted entries.
+    private mutating func mergeDelta() {
+        var merged: [Entry] = []
+        merged.reserveCapacity(count)
+
+        var b = 0
+        var d = 0
+        while b < base.count || d < delta.count {
+            let order: Int
+            if b == base.count {
+                order = 1
+            } else if d == delta.count {
+                order = -1
+            } else {
+                order = Self.compare(base[b].key.utf8, delta[d].key.utf8)
+            }
+
+            if order < 0 {
+                merged.append(base[b])
+                b += 1
+            } else {
+                if let entry = delta[d].entry {
+                    merged.append(entry)
+                }
+                if order == 0 {
+                    b += 1
+                }
+                d += 1
+            }
+        }
+
+        base = merged
+        delta = []
+    }
+
+    // MARK: - Scanning
+
+    /// A bound on the keys visited by a scan, as UTF-8 bytes.
+    struct Bound: Sendable {
+        var bytes: [UInt8]
+        var inclusive: Bool
+    }
+
+    /// Returns a scan over the keys between `lower` and `upper`, in key order or reversed.
+    ///
+    /// The scan holds its own copy of the index, so later writes do not affect it.
+    func scan(from lower: Bound?, to upper: Bound?, descending: Bool = false) -> Scan {
+        func range<Element>(in array: [Element], key: KeyPath<Element, String>) -> Range<Int> {
+            let start = lower.map {
+                Self.lowerBound($0.bytes, in: array, key: key, inclusive: $0.inclusive)
+            } ?? 0
+            let end = upper.map {
+                Self.lowerBound($0.bytes, in: array, key: key, inclusive: !$0.inclusive)
+            } ?? array.count
+            return start..<max(start, end)
+        }
+
+        return Scan(
+            index: self,
+            baseRange: range(in: base, key: \.key),
+            deltaRange: range(in: delta, key: \.key),
+            descending: descending
+        )
+    }
+
+    /// A merged walk over `base` and `delta` that yields live entries one at a time.
+    struct Scan: Sendable {
+        private let index: SortedKeyValueIndex
+        private let baseRange: Range<Int>
+        private let deltaRange: Range<Int>
+        private let descending: Bool
+        private var nextBase: Int
+        private var nextDelta: Int
+
+        /// The entry the scan is positioned on, or `nil` once it is exhausted.
+        private(set) var current: Entry?
+
+        fileprivate init(
+            index: SortedKeyValueIndex,
+            baseRange: Range<Int>,
+            deltaRange: Range<Int>,
+            descending: Bool
+        ) {
+            self.index = index
+            self.baseRange = baseRange
+            self.deltaRange = deltaRange
+            self.descending = descending
+            nextBase = descending ? baseRange.upperBound - 1 : baseRange.lowerBound
+            nextDelta = descending ? deltaRange.upperBound - 1 : deltaRange.lowerBound
+            advance()
+        }
+
+        /// An empty scan.
+        static var empty: Scan {
+            SortedKeyValueIndex().scan(from: nil, to: nil)
+        }
+
+        /// Moves to the next live entry in scan order.
+        mutating func advance() {
+            let step = descending ? -1 : 1
+
+            while true {
+                let baseEntry = baseRange.contains(nextBase) ? index.base[nextBase] : nil
+                let change = deltaRange.contains(nextDelta) ? index.delta[nextDelta] : nil
+
+                switch (baseEntry, change) {
+                case (nil, nil):
+                    current = nil
+                    return
+
+                case (let entry?, nil):
+                    current = entry
+                    nextBase += step
+                    return
+
+                case (nil, let change?):
+                    nextDelta += step
+                    if let entry = change.entry {
+                        current = entry
+                        return
+                    }
+
+                case (let entry?, let change?):
+                    let order = SortedKeyValueIndex.compare(entry.key.utf8, change.key.utf8) * step
+                    if order < 0 {
+                        current = entry
+                        nextBase += step
+                        return
+                    }
+                    if order == 0 {
+                        // The change shadows the base entry for the same key.
+                        nextBase += step
+                    }
+                    nextDelta += step
+                    if let entry = change.entry {
+                        current = entry
+                        return
+                    }
+                }
+            }
+        }
+    }
+
+    // MARK: - Byte Ordering
+
+    /// Compares two byte sequences like `memcmp`, with a shorter prefix ordering first.
+    static func compare<A: Sequence, B: Sequence>(_ a: A, _ b: B) -> Int
+    where A.Element == UInt8, B.Element == UInt8 {
+        var left = a.makeIterator()
+        var right = b.makeIterator()
+        while true {
+            switch (left.next(), right.next()) {
+            case (nil, nil):
+                return 0
+            case (nil, _):
+                return -1
+            case (_, nil):
+                return 1
+            case let (l?, r?):
+                if l != r {
+                    return l < r ? -1 : 1
+                }
+            }
+        }
+    }
+
+    /// Returns the first index whose key is `>= bound` (or `> bound` when not inclusive).
+    private static func lowerBound<Element, Bytes: Sequence>(
+        _ bound: Bytes,
+        in array: [Element],
+        key: KeyPath<Element, String>,
+        inclusive: Bool
+    ) -> Int where Bytes.Element == UInt8 {
+        var low = 0
+        var high = array.count
+        while low < high {
+            let mid = low + (high - low) / 2
+            let order = compare(array[mid][keyPath: key].utf8, bound)
+            if order < 0 || (order == 0 && !inclusive) {
+                low = mid + 1
+            } else {
+                high = mid
+            }
+        }
+        return low
+    }
+}
@@ -7,12 +7,17 @@ import Foundation
 /// - `reverse(text)`: Reverses a string
 /// - `rot13(text)`: Applies ROT13 encoding
 /// - `trim_all(text)`: Removes all whitespace from a string
+/// - `word_count(text)`: Counts the whitespace-separated words in a string
+///
+/// The functions read SQLite's UTF-8 bytes in place and write their results without
+/// building intermediate strings.
 ///
 /// ## Usage in SQL
 /// ```sql
 /// SELECT reverse('hello');        -- Returns 'olleh'
 /// SELECT rot13('hello');          -- Returns 'uryyb'
 /// SELECT trim_all('  hello  ');   -- Returns 'hello'
+/// SELECT word_count('a b  c');    -- Returns 3
 /// ```
 public struct StringFunctionsExtension: SQLiteExtensionModule {
     public static let name = "string_functions"
@@ -25,8 +30,17 @@ public struct StringFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let text = first.textValue
-            context.result(String(text.reversed()))
+            first.withUTF8Bytes { utf8 in
+                let bytes = UnsafeRawBufferPointer(utf8)
+                context.result(capacity: bytes.count) { output in
+                    guard TextKernels.reverseCharacters(bytes, into: output.baseAddress!) else {
+                        // Invalid UTF-8 is repaired while decoding, which changes its length.
+                        context.result(String(String(decoding: utf8, as: UTF8.self).reversed()))
+                        return nil
+                    }
+                    return .text(count: bytes.count)
+                }
+            }
         }
 
         // ROT13 encoding
@@ -36,18 +50,13 @@ public struct StringFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let text = first.textValue
-            let result = text.map { char -> Character in
-                switch char {
-                case "a"..."m", "A"..."M":
-                    return Character(UnicodeScalar(char.unicodeScalars.first!.value + 13)!)
-                case "n"..."z", "N"..."Z":
-                    return Character(UnicodeScalar(char.unicodeScalars.first!.value - 13)!)
-                default:
-                    return char
+            first.withUTF8Bytes { utf8 in
+                let bytes = UnsafeRawBufferPointer(utf8)
+                context.result(capacity: bytes.count) { output in
+                    TextKernels.rot13(bytes, into: output.baseAddress!)
+                    return .text(count: bytes.count)
                 }
             }
-            context.result(String(result))
         }
 
         // Remove all whitespace
@@ -57,9 +66,12 @@ public struct StringFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let text = first.textValue
-            let result = text.filter { !$0.isWhitespace }
-            context.result(result)
+            first.withUTF8Bytes { utf8 in
+                let bytes = UnsafeRawBufferPointer(utf8)
+                context.result(capacity: bytes.count) { output in
+                    .text(count: TextKernels.removeWhitespace(bytes, into: output.baseAddress!))
+                }
+            }
         }
 
         // Word count function
@@ -69,10 +81,10 @@ public struct StringFunctionsExtension: SQLiteExtensionModule {
                 return
             }
 
-            let text = first.textValue
-            let words = text.components(separatedBy: .whitespacesAndNewlines)
-                .filter { !$0.isEmpty }
-            context.result(Int64(words.count))
+            let words = first.withUTF8Bytes { utf8 in
+                TextKernels.wordCount(UnsafeRawBufferPointer(utf8))
+            }
+            context.result(Int64(words))
         }
     }
 }
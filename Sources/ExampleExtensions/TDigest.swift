@@ -0,0 +1,188 @@
+import Foundation
+
+/// A merging t-digest laid out in a single fixed-size block of memory.
+///
+/// The digest keeps at most about `compression` centroids plus an unsorted buffer of new
+/// samples, so its size depends only on the requested accuracy and never on the number of
+/// inputs. Because it holds no references, the block can be the memory returned by
+/// `SQLiteContext.aggregateMemory(byteCount:)`: SQLite zero-fills it for each group and
+/// frees it after `xFinal`, with no Swift object to retain or release.
+///
+/// Quantile error is smallest at the tails, which suits p95/p99 latency queries; with the
+/// default compression of 100 a digest takes under 9 KB.
+struct TDigest {
+    struct Header {
+        var compression: Double
+        var percentile: Double
+        var totalWeight: Double
+        var minimum: Double
+        var maximum: Double
+        var capacity: Int
+        var centroidCount: Int
+        var bufferCount: Int
+    }
+
+    struct Centroid {
+        var mean: Double
+        var weight: Double
+    }
+
+    static let defaultCompression = 100.0
+    static let compressionRange = 20.0...1000.0
+
+    private let header: UnsafeMutablePointer<Header>
+    private let centroids: UnsafeMutablePointer<Centroid>
+
+    /// The number of bytes needed for a digest with the given compression.
+    static func byteCount(compression: Double) -> Int {
+        MemoryLayout<Header>.stride + capacity(compression: compression) * MemoryLayout<Centroid>.stride
+    }
+
+    /// The number of centroid slots. Merged centroids never exceed `compression + 2` under
+    /// the k1 scale function; the rest of the block buffers raw samples between merges.
+    private static func capacity(compression: Double) -> Int {
+        (Int(compression.rounded(.up)) + 8) * 5
+    }
+
+    /// Views `memory`, which must hold ``byteCount(compression:)`` bytes.
+    ///
+    /// Zero-filled memory is initialised as an empty digest with `compression`; memory that
+    /// already holds a digest is used as is.
+    init(memory: UnsafeMutableRawPointer, compression: Double) {
+        let header = memory.bindMemory(to: Header.self, capacity: 1)
+        if header.pointee.compression == 0 {
+            header.pointee = Header(
+                compression: compression,
+                percentile: 0,
+                totalWeight: 0,
+                minimum: .infinity,
+                maximum: -.infinity,
+                capacity: Self.capacity(compression: compression),
+                centroidCount: 0,
+                bufferCount: 0
+            )
+        }
+
+        self.header = header
+        centroids = (memory + MemoryLayout<Header>.stride).bindMemory(
+            to: Centroid.self,
+            capacity: header.pointee.capacity
+        )
+    }
+
+    /// The requested percentile, stored alongside the digest for `xFinal`.
+    var percentile: Double {
+        get { header.pointee.percentile }
+        nonmutating set { header.pointee.percentile = newValue }
+    }
+
+    /// The number of samples added.
+    var count: Double {
+        header.pointee.totalWeight
+    }
+
+    /// Adds a sample. NaN is ignored.
+    func add(_ value: Double) {
+        guard !value.isNaN else { return }
+
+        if header.pointee.centroidCount + header.pointee.bufferCount >= header.pointee.capacity {
+            compress()
+        }
+
+        centroids[header.pointee.centroidCount + header.pointee.bufferCount] = Centroid(mean: value, weight: 1)
+        header.pointee.bufferCount += 1
+        header.pointee.totalWeight += 1
+        header.pointee.minimum = Swift.min(header.pointee.minimum, value)
+        header.pointee.maximum = Swift.max(header.pointee.maximum, value)
+    }
+
+    /// Estimates the value at quantile `q` in `0...1`.
+    ///
+    /// - Returns: The estimate, or `nil` if no samples were added.
+    func quantile(_ q: Double) -> Double? {
+        if header.pointee.bufferCount > 0 {
+            compress()
+        }
+
+        let n = header.pointee.centroidCount
+        guard n > 0 else { return nil }
+        if n == 1 { return centroids[0].mean }
+
+        let total = header.pointee.totalWeight
+        let minimum = header.pointee.minimum
+        let maximum = header.pointee.maximum
+        let index = Swift.min(Swift.max(q, 0), 1) * total
+
+        if index < 1 { return minimum }
+        if index > total - 1 { return maximum }
+
+        // Below the first centroid's centre, interpolate from the exact minimum.
+        let first = centroids[0]
+        if first.weight > 2 && index < first.weight / 2 {
+            return minimum + (index - 1) / (first.weight / 2 - 1) * (first.mean - minimum)
+        }
+
+        // Between centroid centres, interpolate linearly by cumulative weight.
+        var weightSoFar = first.weight / 2
+        for i in 0..<(n - 1) {
+            let left = centroids[i]
+            let right = centroids[i + 1]
+            let span = (left.weight + right.weight) / 2
+            if weightSoFar + span > index {
+                let t = (index - weightSoFar) / span
+                return left.mean + t * (right.mean - left.mean)
+            }
+            weightSoFar += span
+        }
+
+        // Above the last centroid's centre, interpolate towards the exact maximum.
+        let last = centroids[n - 1]
+        let tail = last.weight / 2 - 1
+        guard tail > 0 else { return maximum }
+        let t = Swift.min((index - weightSoFar) / tail, 1)
+        return last.mean + t * (maximum - last.mean)
+    }
+
+    /// Sorts buffered samples into the centroids and merges neighbours within the k1 bound.
+    private func compress() {
+        let n = header.pointee.centroidCount + header.pointee.bufferCount
+        guard n > 0 else { return }
+
+        let items = UnsafeMutableBufferPointer(start: centroids, count: n)
+        items.sort { $0.mean < $1.mean }
+
+        let total = header.pointee.totalWeight
+        let compression = header.pointee.compression
+        var output = 0
+        var current = items[0]
+        var weightSoFar = 0.0
+        var limit = total * Self.quantileLimit(after: 0, compression: compression)
+
+        for i in 1..<n {
+            let next = items[i]
+            let proposed = current.weight + next.weight
+            if weightSoFar + proposed <= limit {
+                current.mean += (next.mean - current.mean) * next.weight / proposed
+                current.weight = proposed
+            } else {
+                weightSoFar += current.weight
+                items[output] = current
+                output += 1
+                limit = total * Self.quantileLimit(after: weightSoFar / total, compression: compression)
+                current = next
+            }
+        }
+        items[output] = current
+        output += 1
+
+        header.pointee.centroidCount = output
+        header.pointee.bufferCount = 0
+    }
+
+    /// The largest quantile a centroid starting at `q` may reach: one unit further along
+    /// the scale `k(q) = δ / 2π · asin(2q - 1)`.
+    private static func quantileLimit(after q: Double, compression: Double) -> Double {
+        let k = compression / (2 * Double.pi) * asin(2 * q - 1) + 1
+        return (sin(Swift.min(k * 2 * Double.pi / compression, Double.pi / 2)) + 1) / 2
+    }
+}
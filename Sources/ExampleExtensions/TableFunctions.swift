@@ -0,0 +1,105 @@
+import SQLiteExtensionKit
+import Foundation
+
+/// Example extension demonstrating table-valued functions.
+///
+/// Both functions stream their rows, so they work over inputs far larger than memory
+/// and stop as soon as the query has read enough:
+/// - `split_lines(input)`: One row per line of a text or blob, with `line_number` and
+///   `line` columns. Lines end at `\n`, and a trailing `\r` is removed.
+/// - `series(start, stop, step)`: The integers from `start` to `stop` inclusive, with
+///   `step` defaulting to 1. Without `stop` the series is unbounded.
+///
+/// ## Usage in SQL
+/// ```sql
+/// SELECT line FROM split_lines('a' || char(10) || 'b');   -- Returns 'a', 'b'
+/// SELECT value FROM series(1, 10, 3);                      -- Returns 1, 4, 7, 10
+/// SELECT value FROM series(1) LIMIT 5;                     -- Returns 1 through 5
+/// ```
+public struct TableFunctionsExtension: SQLiteExtensionModule {
+    public static let name = "table_functions"
+
+    public static func register(with db: SQLiteDatabase) throws {
+        try db.createTableValuedFunction(
+            name: "split_lines",
+            columns: ["line_number INTEGER", "line TEXT"],
+            parameters: ["input"]
+        ) { arguments in
+            LineSequence(input: arguments[0])
+        }
+
+        try db.createTableValuedFunction(
+            name: "series",
+            column: "value INTEGER",
+            parameters: ["start", "stop", "step"]
+        ) { arguments in
+            IntegerSeries(
+                start: arguments[0]?.intValue ?? 0,
+                stop: arguments[1].flatMap { $0.isNull ? nil : $0.intValue },
+                step: arguments[2].flatMap { $0.isNull ? nil : $0.intValue } ?? 1
+            )
+        }
+    }
+}
+
+/// The lines of a value, found one at a time by scanning its bytes in place.
+struct LineSequence: Sequence, IteratorProtocol {
+    let input: SQLiteValue?
+    private var offset = 0
+    private var lineNumber: Int64 = 0
+
+    init(input: SQLiteValue?) {
+        self.input = input
+    }
+
+    mutating func next() -> [ColumnValue]? {
+        guard let input, !input.isNull else { return nil }
+        return input.withBlobBytes { bytes -> [ColumnValue]? in
+            guard offset < bytes.count else { return nil }
+            let rest = bytes[offset...]
+            let end = rest.firstIndex(of: UInt8(ascii: "\n")) ?? bytes.endIndex
+            var lineEnd = end
+            if lineEnd > offset, bytes[lineEnd - 1] == UInt8(ascii: "\r") {
+                lineEnd -= 1
+            }
+            let line = String(decoding: UnsafeRawBufferPointer(rebasing: bytes[offset..<lineEnd]), as: UTF8.self)
+            offset = end + 1
+            lineNumber += 1
+            return [.integer(lineNumber), .text(line)]
+        }
+    }
+}
+
+/// An arithmetic series of integers that stops before overflowing.
+struct IntegerSeries: Sequence, IteratorProtocol {
+    private var nextValue: Int64?
+    let stop: Int64?
+    let step: Int64
+
+    init(start: Int64, stop: Int64?, step: Int64) {
+        self.nextValue = step == 0 ? nil : start
+        self.stop = stop
+        self.step = step
+    }
+
+    mutating func next() -> ColumnValue? {
+        guard let value = nextValue else { return nil }
+        if let stop, step > 0 ? value > stop : value < stop {
+            nextValue = nil
+            return nil
+        }
+        let (advanced, overflow) = value.addingReportingOverflow(step)
+        nextValue = overflow ? nil : advanced
+        return .integer(value)
+    }
+}
+
+/// Entry point for the table functions extension.
+@_cdecl("sqlite3_tablefunctions_init")
+public func sqlite3_tablefunctions_init(
+    db: OpaquePointer?,
+    pzErrMsg: UnsafeMutablePointer<UnsafeMutablePointer<CChar>?>?,
+    pApi: UnsafePointer<sqlite3_api_routines>?
+) -> Int32 {
+    return TableFunctionsExtension.entryPoint(db: db, pzErrMsg: pzErrMsg, pApi: pApi)
+}
@@ -0,0 +1,527 @@
+import Synchronization
+
+/// Single-pass UTF-8 kernels behind the string functions.
+///
+/// Like ``ByteKernels``, every kernel reads a borrowed input buffer and writes into
+/// caller-provided output, so a function can work straight from SQLite's text and into its
+/// result allocation without building a `String`. ASCII is classified 16 bytes at a time
+/// with portable `SIMD` vectors; blocks containing other bytes fall back to stepping one
+/// scalar at a time.
+///
+/// Whitespace is the Unicode `White_Space` set, which is also what `Character.isWhitespace`
+/// and `CharacterSet.whitespacesAndNewlines` use.
+enum TextKernels {
+    // MARK: Classification
+
+    /// Whether every byte is ASCII.
+    static func isASCII(_ bytes: UnsafeRawBufferPointer) -> Bool {
+        guard let source = bytes.baseAddress else { return true }
+        var index = 0
+        while index + 16 <= bytes.count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            guard all(block .< 0x80) else { return false }
+            index += 16
+        }
+        while index < bytes.count {
+            guard source.load(fromByteOffset: index, as: UInt8.self) < 0x80 else { return false }
+            index += 1
+        }
+        return true
+    }
+
+    /// The lanes holding ASCII whitespace: tab, line feed, vertical tab, form feed,
+    /// carriage return and space.
+    private static func isASCIIWhitespace(_ block: SIMD16<UInt8>) -> SIMDMask<SIMD16<Int8>> {
+        (block .== 0x20) .| ((block &- 0x09) .< 5)
+    }
+
+    private static func isASCIIWhitespace(_ byte: UInt8) -> Bool {
+        byte == 0x20 || byte &- 0x09 < 5
+    }
+
+    /// The length of the whitespace scalar that starts at `index` with a byte of at least
+    /// `0x80`, or zero if the scalar there is not whitespace.
+    private static func whitespaceLength(_ source: UnsafeRawPointer, at index: Int, count: Int) -> Int {
+        func byte(_ offset: Int) -> UInt8 {
+            index + offset < count ? source.load(fromByteOffset: index + offset, as: UInt8.self) : 0
+        }
+
+        switch byte(0) {
+        case 0xC2:
+            // U+0085 NEXT LINE, U+00A0 NO-BREAK SPACE
+            let second = byte(1)
+            return second == 0x85 || second == 0xA0 ? 2 : 0
+        case 0xE1:
+            // U+1680 OGHAM SPACE MARK
+            return byte(1) == 0x9A && byte(2) == 0x80 ? 3 : 0
+        case 0xE2:
+            // U+2000...U+200A, U+2028, U+2029, U+202F, U+205F
+            switch (byte(1), byte(2)) {
+            case (0x80, 0x80...0x8A), (0x80, 0xA8), (0x80, 0xA9), (0x80, 0xAF), (0x81, 0x9F):
+                return 3
+            default:
+                return 0
+            }
+        case 0xE3:
+            // U+3000 IDEOGRAPHIC SPACE
+            return byte(1) == 0x80 && byte(2) == 0x80 ? 3 : 0
+        default:
+            return 0
+        }
+    }
+
+    // MARK: Reverse
+
+    /// Writes the characters of `input` in reverse order, `input.count` bytes.
+    ///
+    /// ASCII without carriage returns, whose characters are single bytes, is reversed as
+    /// bytes. Other text is split into grapheme clusters, so combining marks, emoji
+    /// sequences and `"\r\n"` stay intact.
+    ///
+    /// - Returns: `false`, writing nothing, if `input` is not valid UTF-8.
+    static func reverseCharacters(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) -> Bool {
+        guard let source = input.baseAddress else { return true }
+        let count = input.count
+        var index = 0
+        var isSingleByte = true
+
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            guard all(block .< 0x80), !any(block .== 0x0D) else {
+                isSingleByte = false
+                break
+            }
+            index += 16
+        }
+        while isSingleByte, index < count {
+            let byte = source.load(fromByteOffset: index, as: UInt8.self)
+            isSingleByte = byte < 0x80 && byte != 0x0D
+            index += 1
+        }
+
+        if isSingleByte {
+            ByteKernels.reverse(input, into: output)
+            return true
+        }
+        guard ByteKernels.isValidUTF8(input) else { return false }
+
+        // Valid input decodes to exactly its own bytes, so each character is copied from
+        // its offset in the input to the mirrored offset in the output.
+        var offset = 0
+        for character in String(decoding: input, as: UTF8.self) {
+            let length = character.utf8.count
+            (output + count - offset - length).copyMemory(from: source + offset, byteCount: length)
+            offset += length
+        }
+        return true
+    }
+
+    // MARK: ROT13
+
+    /// Rotates ASCII letters by 13 places, writing `input.count` bytes. Every other byte,
+    /// including all bytes of non-ASCII scalars, is copied unchanged.
+    static func rot13(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) {
+        guard let source = input.baseAddress else { return }
+        let count = input.count
+        var index = 0
+
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            let position = (block | 0x20) &- 97  // "a", folding case
+            var shift = SIMD16<UInt8>(repeating: 0)
+            shift.replace(with: 13, where: position .< 13)
+            shift.replace(with: 243, where: (position .>= 13) .& (position .< 26))  // -13, wrapping
+            output.storeBytes(of: block &+ shift, toByteOffset: index, as: SIMD16<UInt8>.self)
+            index += 16
+        }
+
+        while index < count {
+            let byte = source.load(fromByteOffset: index, as: UInt8.self)
+            let position = (byte | 0x20) &- 97
+            let rotated = position < 13 ? byte &+ 13 : position < 26 ? byte &- 13 : byte
+            output.storeBytes(of: rotated, toByteOffset: index, as: UInt8.self)
+            index += 1
+        }
+    }
+
+    // MARK: Whitespace
+
+    /// Copies `input` without its whitespace scalars into at most `input.count` bytes.
+    ///
+    /// - Returns: The number of bytes written.
+    static func removeWhitespace(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) -> Int {
+        guard let source = input.baseAddress else { return 0 }
+        let count = input.count
+        var index = 0
+        var written = 0
+
+        func step() {
+            let byte = source.load(fromByteOffset: index, as: UInt8.self)
+            let skipped = byte < 0x80
+                ? (isASCIIWhitespace(byte) ? 1 : 0)
+                : whitespaceLength(source, at: index, count: count)
+            if skipped > 0 {
+                index += skipped
+            } else {
+                output.storeBytes(of: byte, toByteOffset: written, as: UInt8.self)
+                written += 1
+                index += 1
+            }
+        }
+
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            let whitespace = isASCIIWhitespace(block)
+            let isASCII = all(block .< 0x80)
+            if isASCII, !any(whitespace) {
+                output.storeBytes(of: block, toByteOffset: written, as: SIMD16<UInt8>.self)
+                written += 16
+                index += 16
+                continue
+            }
+
+            if isASCII {
+                // Store every byte and advance past the ones that are kept, without branches.
+                for lane in 0..<16 {
+                    output.storeBytes(of: block[lane], toByteOffset: written, as: UInt8.self)
+                    written += whitespace[lane] ? 0 : 1
+                }
+                index += 16
+                continue
+            }
+
+            let blockEnd = index + 16
+            while index < blockEnd {
+                step()
+            }
+        }
+
+        while index < count {
+            step()
+        }
+        return written
+    }
+
+    /// Counts the maximal runs of non-whitespace scalars.
+    static func wordCount(_ input: UnsafeRawBufferPointer) -> Int {
+        guard let source = input.baseAddress, input.count > 0 else { return 0 }
+        let count = input.count
+        var index = 0
+        var words = 0
+        var inWord = false
+
+        func step() {
+            let byte = source.load(fromByteOffset: index, as: UInt8.self)
+            let whitespace = byte < 0x80
+                ? (isASCIIWhitespace(byte) ? 1 : 0)
+                : whitespaceLength(source, at: index, count: count)
+            if whitespace == 0, !inWord {
+                words += 1
+            }
+            inWord = whitespace == 0
+            index += max(whitespace, 1)
+        }
+
+        // The vector loop compares each byte with the one before it, loaded unaligned one
+        // byte back, so the first scalar is always handled on its own.
+        step()
+
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            guard all(block .< 0x80) else {
+                let blockEnd = index + 16
+                while index < blockEnd {
+                    step()
+                }
+                continue
+            }
+            // Lane 0 of `previous` is the byte before the block, which may end a non-ASCII
+            // scalar, so it is replaced by the state carried from before.
+            var previous = source.loadUnaligned(fromByteOffset: index - 1, as: SIMD16<UInt8>.self)
+            previous[0] = inWord ? 0x41 : 0x20
+            let starts = .!isASCIIWhitespace(block) .& isASCIIWhitespace(previous)
+            words += Int(SIMD16<UInt8>(repeating: 0).replacing(with: 1, where: starts).wrappedSum())
+            inWord = !isASCIIWhitespace(block[15])
+            index += 16
+        }
+
+        while index < count {
+            step()
+        }
+        return words
+    }
+
+    // MARK: URL Encoding
+
+    /// The lanes holding characters that the URL query component allows unencoded:
+    /// ASCII letters, digits and `!$&'()*+,-./:;=?@_~`.
+    private static func isURLQueryAllowed(_ block: SIMD16<UInt8>) -> SIMDMask<SIMD16<Int8>> {
+        (block .== 0x21) .| (block .== 0x24) .| (block .== 0x3D) .| (block .== 0x5F) .| (block .== 0x7E)
+            .| ((block &- 0x26) .< 22)  // & through ;
+            .| ((block &- 0x3F) .< 28)  // ? @ A-Z
+            .| ((block &- 0x61) .< 26)  // a-z
+    }
+
+    private static func isURLQueryAllowed(_ byte: UInt8) -> Bool {
+        switch byte {
+        case 0x21, 0x24, 0x26...0x3B, 0x3D, 0x3F...0x5A, 0x5F, 0x61...0x7A, 0x7E: return true
+        default: return false
+        }
+    }
+
+    /// The length of the percent encoding of `input`.
+    static func urlEncodedCount(_ input: UnsafeRawBufferPointer) -> Int {
+        guard let source = input.baseAddress else { return 0 }
+        let count = input.count
+        var index = 0
+        var encoded = 0
+
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            encoded += Int(SIMD16<UInt8>(repeating: 1).replacing(with: 0, where: isURLQueryAllowed(block)).wrappedSum())
+            index += 16
+        }
+        while index < count {
+            encoded += isURLQueryAllowed(source.load(fromByteOffset: index, as: UInt8.self)) ? 0 : 1
+            index += 1
+        }
+        return count + 2 * encoded
+    }
+
+    /// Percent-encodes every byte outside the URL query set as `%XX` with uppercase hex
+    /// digits, writing ``urlEncodedCount(_:)`` bytes.
+    static func urlEncode(_ input: UnsafeRawBufferPointer, into output: UnsafeMutableRawPointer) {
+        guard let source = input.baseAddress else { return }
+        let count = input.count
+        var index = 0
+        var written = 0
+
+        func put(_ byte: UInt8) {
+            if isURLQueryAllowed(byte) {
+                output.storeBytes(of: byte, toByteOffset: written, as: UInt8.self)
+                written += 1
+            } else {
+                output.storeBytes(of: UInt8(ascii: "%"), toByteOffset: written, as: UInt8.self)
+                output.storeBytes(of: hexDigits[Int(byte >> 4)], toByteOffset: written + 1, as: UInt8.self)
+                output.storeBytes(of: hexDigits[Int(byte & 0x0F)], toByteOffset: written + 2, as: UInt8.self)
+                written += 3
+            }
+        }
+
+        while index + 16 <= count {
+            let block = source.loadUnaligned(fromByteOffset: index, as: SIMD16<UInt8>.self)
+            if all(isURLQueryAllowed(block)) {
+                output.storeBytes(of: block, toByteOffset: written, as: SIMD16<UInt8>.self)
+                written += 16
+            } else {
+                for lane in 0..<16 {
+                    put(block[lane])
+                }
+            }
+            index += 16
+        }
+        while index < count {
+            put(source.load(fromByteOffset: index, as: UInt8.self))
+            index += 1
+        }
+    }
+
+    private static let hexDigits: [UInt8] = Array("0123456789ABCDEF".utf8)
+}
+
+// MARK: - Edit Distance
+
+/// Computes Levenshtein distances over Unicode scalars, reusing its buffers between calls.
+///
+/// ASCII inputs are compared as bytes in place; other inputs are first decoded into
+/// scalar buffers, with invalid UTF-8 replaced by U+FFFD. When the shorter input has at
+/// most 64 scalars the distance is computed with Myers' bit-parallel algorithm, one word
+/// operation per scalar of the longer input; otherwise with a single row of the dynamic
+/// programming matrix.
+///
+/// The buffers sit behind a lock, so one instance can back a function registered on
+/// several connections; SQLite never runs two calls on one connection at once, so the lock
+/// is uncontended there.
+final class EditDistanceCalculator: Sendable {
+    private let buffers = Mutex(Buffers())
+
+    /// Returns the edit distance between two UTF-8 strings.
+    ///
+    /// - Parameters:
+    ///   - maximum: If set, any distance above it is reported as `maximum + 1`, which
+    ///     lets the computation stop as soon as the result is known to exceed it.
+    func distance(_ left: UnsafeRawBufferPointer, _ right: UnsafeRawBufferPointer, maximum: Int? = nil) -> Int {
+        buffers.withLock { $0.distance(left, right, maximum: maximum) }
+    }
+
+    /// The scratch state of one computation, only reached through ``buffers``.
+    private final class Buffers {
+        private var row: [Int] = []
+        private var leftScalars: [UInt32] = []
+        private var rightScalars: [UInt32] = []
+
+        /// Pattern masks of ASCII scalars, all zero between calls.
+        private var asciiMasks = [UInt64](repeating: 0, count: 128)
+        /// Pattern masks of other scalars, searched linearly; patterns rarely have many.
+        private var otherScalars: [UInt32] = []
+        private var otherMasks: [UInt64] = []
+
+        func distance(_ left: UnsafeRawBufferPointer, _ right: UnsafeRawBufferPointer, maximum: Int? = nil) -> Int {
+            if TextKernels.isASCII(left), TextKernels.isASCII(right) {
+                return scalarDistance(left.assumingMemoryBound(to: UInt8.self), right.assumingMemoryBound(to: UInt8.self), maximum: maximum)
+            }
+
+            Self.decode(left, into: &leftScalars)
+            Self.decode(right, into: &rightScalars)
+            return leftScalars.withUnsafeBufferPointer { left in
+                rightScalars.withUnsafeBufferPointer { right in
+                    scalarDistance(left, right, maximum: maximum)
+                }
+            }
+        }
+
+        private static func decode(_ bytes: UnsafeRawBufferPointer, into scalars: inout [UInt32]) {
+            scalars.removeAll(keepingCapacity: true)
+            var iterator = bytes.makeIterator()
+            var decoder = UTF8()
+            while true {
+                switch decoder.decode(&iterator) {
+                case .scalarValue(let scalar):
+                    scalars.append(scalar.value)
+                case .error:
+                    scalars.append(0xFFFD)
+                case .emptyInput:
+                    return
+                }
+            }
+        }
+
+        private func scalarDistance<Element: FixedWidthInteger>(
+            _ left: UnsafeBufferPointer<Element>,
+            _ right: UnsafeBufferPointer<Element>,
+            maximum: Int?
+        ) -> Int {
+            var short = left.count <= right.count ? left : right
+            var long = left.count <= right.count ? right : left
+            let limit = maximum ?? Int.max - 1
+
+            // The distance is at least the difference in length.
+            guard long.count - short.count <= limit else { return limit + 1 }
+
+            // A common prefix or suffix never changes the distance.
+            var prefix = 0
+            while prefix < short.count, short[prefix] == long[prefix] {
+                prefix += 1
+            }
+            var suffix = 0
+            while suffix < short.count - prefix, short[short.count - 1 - suffix] == long[long.count - 1 - suffix] {
+                suffix += 1
+            }
+            short = UnsafeBufferPointer(rebasing: short[prefix..<(short.count - suffix)])
+            long = UnsafeBufferPointer(rebasing: long[prefix..<(long.count - suffix)])
+
+            guard !short.isEmpty else { return min(long.count, limit + 1) }
+            let result = short.count <= 64
+                ? bitParallelDistance(pattern: short, text: long, limit: limit)
+                : rowDistance(short: short, long: long, limit: limit)
+            return min(result, limit + 1)
+        }
+
+        /// Myers' algorithm as formulated by Hyyrö for global edit distance. Bit `i` of the
+        /// vertical delta vectors describes row `i + 1` of the column for the current text
+        /// scalar; the score tracks the last row.
+        private func bitParallelDistance<Element: FixedWidthInteger>(
+            pattern: UnsafeBufferPointer<Element>,
+            text: UnsafeBufferPointer<Element>,
+            limit: Int
+        ) -> Int {
+            for (position, element) in pattern.enumerated() {
+                let bit: UInt64 = 1 << UInt64(position)
+                let scalar = UInt32(truncatingIfNeeded: element)
+                if scalar < 128 {
+                    asciiMasks[Int(scalar)] |= bit
+                } else if let index = otherScalars.firstIndex(of: scalar) {
+                    otherMasks[index] |= bit
+                } else {
+                    otherScalars.append(scalar)
+                    otherMasks.append(bit)
+                }
+            }
+            defer {
+                for element in pattern where UInt32(truncatingIfNeeded: element) < 128 {
+                    asciiMasks[Int(element)] = 0
+                }
+                otherScalars.removeAll(keepingCapacity: true)
+                otherMasks.removeAll(keepingCapacity: true)
+            }
+
+            let last: UInt64 = 1 << UInt64(pattern.count - 1)
+            var positive = UInt64.max
+            var negative: UInt64 = 0
+            var score = pattern.count
+
+            for (position, element) in text.enumerated() {
+                let scalar = UInt32(truncatingIfNeeded: element)
+                let equal: UInt64
+                if scalar < 128 {
+                    equal = asciiMasks[Int(scalar)]
+                } else if let index = otherScalars.firstIndex(of: scalar) {
+                    equal = otherMasks[index]
+                } else {
+                    equal = 0
+                }
+
+                let vertical = equal | negative
+                let horizontal = (((equal & positive) &+ positive) ^ positive) | equal
+                var horizontalPositive = negative | ~(horizontal | positive)
+                var horizontalNegative = positive & horizontal
+                if horizontalPositive & last != 0 {
+                    score += 1
+                } else if horizontalNegative & last != 0 {
+                    score -= 1
+                }
+                // Row 0 grows by one per column, which shifts a positive delta in.
+                horizontalPositive = (horizontalPositive << 1) | 1
+                horizontalNegative <<= 1
+                positive = horizontalNegative | ~(vertical | horizontalPositive)
+                negative = horizontalPositive & vertical
+
+                // The score falls by at most one per remaining text scalar.
+                if score - (text.count - position - 1) > limit {
+                    return limit + 1
+                }
+            }
+            return score
+        }
+
+        /// The textbook recurrence over one reused row, indexed by the shorter input.
+        private func rowDistance<Element: FixedWidthInteger>(
+            short: UnsafeBufferPointer<Element>,
+            long: UnsafeBufferPointer<Element>,
+            limit: Int
+        ) -> Int {
+            row.removeAll(keepingCapacity: true)
+            row.append(contentsOf: 0...short.count)
+
+            return row.withUnsafeMutableBufferPointer { row in
+                for (i, longElement) in long.enumerated() {
+                    var diagonal = row[0]
+                    row[0] = i + 1
+                    var rowMinimum = row[0]
+                    for j in 1...short.count {
+                        let above = row[j]
+                        let cost = short[j - 1] == longElement ? 0 : 1
+                        row[j] = min(above + 1, row[j - 1] + 1, diagonal + cost)
+                        diagonal = above
+                        rowMinimum = min(rowMinimum, row[j])
+                    }
+                    // Row minima never decrease, so the distance already exceeds the limit.
+                    if rowMinimum > limit {
+                        return limit + 1
+                    }
+                }
+                return row[short.count]
+            }
+        }
+    }
+}
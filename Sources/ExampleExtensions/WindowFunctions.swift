@@ -12,9 +12,17 @@ import Foundation
 /// -- Running total
 /// SELECT value, running_total(value) OVER (ORDER BY id) FROM data;
 ///
-/// -- Moving average (3-row window)
+/// -- Moving average over the window frame
+/// SELECT value,
+///        moving_avg(value) OVER (ORDER BY id ROWS BETWEEN 99 PRECEDING AND CURRENT ROW)
+/// FROM data;
+///
+/// -- Moving average of the trailing 3 rows of the frame
 /// SELECT value, moving_avg(value, 3) OVER (ORDER BY id) FROM data;
 ///
+/// -- p99 latency per endpoint in a few KB per group
+/// SELECT endpoint, approx_percentile(latency_ms, 99) FROM requests GROUP BY endpoint;
+///
 /// -- Rank within partition
 /// SELECT category, value,
 ///        dense_rank_custom(value) OVER (PARTITION BY category ORDER BY value DESC)
@@ -22,43 +30,71 @@ import Foundation
 /// ```
 ///
 /// ## Implementation Note
-/// Window functions require the xStep, xInverse, xValue, and xFinal callbacks
-/// of the aggregate function interface. This is a simplified demonstration.
+/// `moving_avg` and `running_total` are registered with
+/// ``SQLiteDatabase/createWindowFunction(name:argumentCount:step:inverse:value:final:)``, so
+/// SQLite slides their frames with xInverse/xValue in O(1) per row instead of recomputing
+/// each frame. Both still work as plain aggregates, and keep their plain-data state inline in
+/// SQLite's aggregate context with no per-group allocation of their own.
 ///
-/// For full window function support, you need to register with SQLITE_UTF8 | SQLITE_DETERMINISTIC
-/// and implement the window-specific aggregate interface.
+/// `percentile` and `median` keep every input and pick the result with quickselect.
+/// `approx_percentile(value, p [, compression])` instead keeps a t-digest of fixed size
+/// directly in SQLite's aggregate context memory; a higher `compression` (20–1000, default
+/// 100) trades memory for accuracy.
 public struct WindowFunctionsExtension: SQLiteExtensionModule {
     public static let name = "window_functions"
 
     public static func register(with db: SQLiteDatabase) throws {
-        // Moving average window function
-        // This demonstrates a simplified approach - full window functions
-        // require special registration with xInverse support
+        // Moving average over the window frame
+        try db.createWindowFunction(
+            name: "moving_avg",
+            argumentCount: 1,
+            step: { context, args in
+                let value = args[0].doubleValue
+                context.withInlineAggregateValue(initialValue: SumCount()) { state in
+                    state.sum += value
+                    state.count += 1
+                }
+            },
+            inverse: { context, args in
+                let value = args[0].doubleValue
+                context.withInlineAggregateValue(initialValue: SumCount()) { state in
+                    state.sum -= value
+                    state.count -= 1
+                }
+            },
+            value: { context in
+                resultAverage(in: context)
+            },
+            final: { context in
+                resultAverage(in: context)
+            }
+        )
 
-        try db.createAggregateFunction(
+        // Moving average of the trailing `window_size` rows of the frame
+        try db.createWindowFunction(
             name: "moving_avg",
             argumentCount: 2,
             step: { context, args in
-                guard args.count == 2 else { return }
-
                 let value = args[0].doubleValue
                 let windowSize = max(1, Int(args[1].intValue))
 
-                // Store values and running sum in a reference type to ensure proper initialisation.
                 let state: MovingAvgState = context.aggregateState { MovingAvgState() }
 
                 if state.windowSize == 0 {
                     state.windowSize = windowSize
                 }
 
-                state.values.append(value)
-                state.sum += value
-
-                // Keep only the last 'windowSize' values
-                if state.values.count > state.windowSize {
-                    let removed = state.values.removeFirst()
-                    state.sum -= removed
+                state.append(value)
+            },
+            inverse: { context, _ in
+                context.existingAggregateState(MovingAvgState.self)?.removeFrameRow()
+            },
+            value: { context in
+                guard let average = context.existingAggregateState(MovingAvgState.self)?.average else {
+                    context.resultNull()
+                    return
                 }
+                context.result(average)
             },
             final: { context in
                 guard let state: MovingAvgState = context.existingAggregateState(MovingAvgState.self) else {
@@ -68,34 +104,35 @@ public struct WindowFunctionsExtension: SQLiteExtensionModule {
 
                 defer { context.clearAggregateState(MovingAvgState.self) }
 
-                if state.values.isEmpty {
+                guard let average = state.average else {
                     context.resultNull()
                     return
                 }
-
-                let avg = state.sum / Double(state.values.count)
-                context.result(avg)
+                context.result(average)
             }
         )
 
         // Running total
-        try db.createAggregateFunction(
+        try db.createWindowFunction(
             name: "running_total",
             argumentCount: 1,
             step: { context, args in
-                guard let first = args.first else { return }
-
-                let value = first.doubleValue
-                context.withAggregateValue(initialValue: 0.0) { sum in
+                let value = args[0].doubleValue
+                context.withInlineAggregateValue(initialValue: 0.0) { sum in
                     sum += value
                 }
             },
-            final: { context in
-                if !context.withExistingAggregateValue(Double.self, clearOnExit: true, { sum in
-                    context.result(sum)
-                }) {
-                    context.result(0.0)
+            inverse: { context, args in
+                let value = args[0].doubleValue
+                context.withInlineAggregateValue(initialValue: 0.0) { sum in
+                    sum -= value
                 }
+            },
+            value: { context in
+                context.result(context.inlineAggregateValue(Double.self) ?? 0.0)
+            },
+            final: { context in
+                context.result(context.inlineAggregateValue(Double.self) ?? 0.0)
             }
         )
 
@@ -125,10 +162,9 @@ public struct WindowFunctionsExtension: SQLiteExtensionModule {
                     return
                 }
 
-                let sorted = state.values.sorted()
-                let percentileValue = state.percentile
-                let index = Int(Double(sorted.count - 1) * percentileValue / 100.0)
-                context.result(sorted[index])
+                let index = Int(Double(state.values.count - 1) * state.percentile / 100.0)
+                let clamped = min(max(index, 0), state.values.count - 1)
+                context.result(selectInPlace(&state.values, clamped))
             }
         )
 
@@ -156,20 +192,62 @@ public struct WindowFunctionsExtension: SQLiteExtensionModule {
                     return
                 }
 
-                let sorted = state.values.sorted()
-                let count = sorted.count
+                let count = state.values.count
+                let upper = selectInPlace(&state.values, count / 2)
 
                 if count % 2 == 0 {
-                    // Even number of elements: average the two middle values
-                    let median = (sorted[count / 2 - 1] + sorted[count / 2]) / 2.0
-                    context.result(median)
+                    // Even number of elements: average the two middle values. Selection
+                    // leaves the lower half in front, so its maximum is the lower middle.
+                    let lower = state.values[..<(count / 2)].max() ?? upper
+                    context.result((lower + upper) / 2.0)
                 } else {
                     // Odd number of elements: take the middle value
-                    context.result(sorted[count / 2])
+                    context.result(upper)
                 }
             }
         )
 
+        // Approximate percentile in bounded memory
+        for argumentCount: Int32 in [2, 3] {
+            try db.createAggregateFunction(
+                name: "approx_percentile",
+                argumentCount: argumentCount,
+                step: { context, args in
+                    guard !args[0].isNull else { return }
+
+                    let compression = args.count > 2
+                        ? min(max(args[2].doubleValue, TDigest.compressionRange.lowerBound),
+                              TDigest.compressionRange.upperBound)
+                        : TDigest.defaultCompression
+                    guard let memory = context.aggregateMemory(
+                        byteCount: TDigest.byteCount(compression: compression)
+                    ) else {
+                        context.resultErrorCode(SQLITE_NOMEM)
+                        return
+                    }
+
+                    let digest = TDigest(memory: memory, compression: compression)
+                    if digest.count == 0 {
+                        digest.percentile = min(max(args[1].doubleValue, 0), 100)
+                    }
+                    digest.add(args[0].doubleValue)
+                },
+                final: { context in
+                    guard let memory = context.aggregateMemory(byteCount: 0) else {
+                        context.resultNull()
+                        return
+                    }
+
+                    let digest = TDigest(memory: memory, compression: TDigest.defaultCompression)
+                    guard let value = digest.quantile(digest.percentile / 100) else {
+                        context.resultNull()
+                        return
+                    }
+                    context.result(value)
+                }
+            )
+        }
+
         // String aggregation (like GROUP_CONCAT but customizable)
         try db.createAggregateFunction(
             name: "string_agg",
@@ -210,10 +288,100 @@ public struct WindowFunctionsExtension: SQLiteExtensionModule {
 
 // MARK: - State Structures
 
+/// Moves the `k`-th smallest element of `values` into position `k` and returns it.
+///
+/// Hoare-partition quickselect: expected O(n) with no allocation, leaving every element
+/// before `k` less than or equal to it and every element after greater than or equal.
+private func selectInPlace(_ values: inout [Double], _ k: Int) -> Double {
+    var low = 0
+    var high = values.count - 1
+
+    while low < high {
+        let mid = low + (high - low) / 2
+        let a = values[low], b = values[mid], c = values[high]
+        let pivot = max(min(a, b), min(max(a, b), c))
+
+        var i = low
+        var j = high
+        while i <= j {
+            while values[i] < pivot { i += 1 }
+            while values[j] > pivot { j -= 1 }
+            if i <= j {
+                values.swapAt(i, j)
+                i += 1
+                j -= 1
+            }
+        }
+
+        if k <= j {
+            high = j
+        } else if k >= i {
+            low = i
+        } else {
+            break
+        }
+    }
+    return values[k]
+}
+
+/// Running sum and row count for `moving_avg(value)`, stored inline in the aggregate context.
+private struct SumCount: BitwiseCopyable {
+    var sum = 0.0
+    var count: Int64 = 0
+}
+
+/// Writes `sum / count` for the inline ``SumCount`` state, or NULL when the frame is empty.
+private func resultAverage(in context: SQLiteContext) {
+    guard let state = context.inlineAggregateValue(SumCount.self), state.count > 0 else {
+        context.resultNull()
+        return
+    }
+    context.result(state.sum / Double(state.count))
+}
+
+/// Trailing-window state for `moving_avg(value, window_size)`.
+///
+/// Holds the newest `min(frameCount, windowSize)` values of the frame, oldest first,
+/// starting at `head`, so both appends and frame removals are amortised O(1).
 final class MovingAvgState: @unchecked Sendable {
     var values: [Double] = []
+    var head: Int = 0
     var sum: Double = 0.0
     var windowSize: Int = 0
+    var frameCount: Int = 0
+
+    var count: Int {
+        values.count - head
+    }
+
+    var average: Double? {
+        count == 0 ? nil : sum / Double(count)
+    }
+
+    func append(_ value: Double) {
+        frameCount += 1
+        values.append(value)
+        sum += value
+        if count > windowSize {
+            removeOldest()
+        }
+    }
+
+    func removeFrameRow() {
+        frameCount = max(0, frameCount - 1)
+        if count > frameCount {
+            removeOldest()
+        }
+    }
+
+    private func removeOldest() {
+        sum -= values[head]
+        head += 1
+        if head >= 64 && head * 2 >= values.count {
+            values.removeFirst(head)
+            head = 0
+        }
+    }
 }
 
 final class PercentileState: @unchecked Sendable {
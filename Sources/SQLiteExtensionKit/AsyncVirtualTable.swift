@@ -0,0 +1,229 @@
+import Dispatch
+import Synchronization
+
+/// A virtual table cursor whose rows are produced by an `AsyncSequence` of batches,
+/// fetched ahead of SQLite on a separate task.
+///
+/// A cursor that reads from the network or disk in ``VirtualTableCursor/next()`` makes
+/// SQLite wait out every fetch in turn. An async cursor instead returns a sequence from
+/// ``batches(indexNumber:indexString:values:)``, and the bridge iterates it on a detached
+/// task that runs up to ``prefetchLimit`` batches ahead. While SQLite processes one batch,
+/// the next is already being fetched; `xNext` only waits when the queue is empty.
+///
+/// The producer task is cancelled when SQLite closes the cursor or filters it again, so a
+/// `LIMIT` stops the fetches a few batches after the last row it needs. Sequences that
+/// check `Task.isCancelled` or call `Task.checkCancellation()` stop at once; otherwise the
+/// producer stops at the next batch it tries to queue.
+///
+/// An error thrown by the sequence is reported to SQLite after the rows of the batches
+/// before it.
+///
+/// The row-at-a-time requirements of ``VirtualTableCursor`` have default implementations
+/// and are never called by the bridge.
+///
+/// - Important: `xNext` blocks the thread running the statement until a batch arrives,
+///   while the sequence runs on the cooperative thread pool. Step statements over an
+///   async cursor from your own threads or queues rather than from Swift concurrency
+///   tasks, which could otherwise leave no thread free to produce the batch awaited.
+///
+/// ## Example
+/// ```swift
+/// struct ManifestCursor: AsyncVirtualTableCursor {
+///     let bucket: Bucket
+///
+///     func batches(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws
+///         -> AsyncMapSequence<Bucket.ListPages, [VirtualTableRow]> {
+///         bucket.listPages(prefix: values.first?.textValue ?? "").map { page in
+///             page.objects.map { VirtualTableRow(rowid: $0.id, columns: [.text($0.key), .integer($0.size)]) }
+///         }
+///     }
+/// }
+/// ```
+public protocol AsyncVirtualTableCursor: VirtualTableCursor {
+    /// The sequence of row batches a scan produces.
+    associatedtype Batches: AsyncSequence & Sendable where Batches.Element == [VirtualTableRow]
+
+    /// The most batches fetched ahead of the one SQLite is reading.
+    static var prefetchLimit: Int { get }
+
+    /// Returns the batches of a new scan, in the place of
+    /// ``VirtualTableCursor/filter(indexNumber:indexString:values:)``.
+    ///
+    /// Read anything needed from `values` here; they are only valid during the call.
+    ///
+    /// - Parameters:
+    ///   - indexNumber: The index number from `bestIndex`.
+    ///   - indexString: The index string from `bestIndex`.
+    ///   - values: Values for the query constraints.
+    /// - Returns: The batches, which are iterated once on a detached task. Empty batches
+    ///   are skipped.
+    /// - Throws: Any error starting the scan.
+    mutating func batches(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws -> Batches
+}
+
+extension AsyncVirtualTableCursor {
+    /// Default prefetch limit of two batches, so one is ready while the next is fetched.
+    public static var prefetchLimit: Int { 2 }
+
+    /// Unused for async cursors; scans start from
+    /// ``batches(indexNumber:indexString:values:)``.
+    public mutating func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+        _ = (indexNumber, indexString, values)
+    }
+
+    /// Unused for async cursors; rows are advanced from the prefetched batches.
+    public mutating func next() throws {}
+
+    /// Unused for async cursors; end of data is the end of the sequence.
+    public var eof: Bool { true }
+
+    /// Unused for async cursors; columns are read from the prefetched batches.
+    public func column(at index: Int) throws -> ColumnValue {
+        _ = index
+        return .null
+    }
+
+    /// Unused for async cursors; row identifiers are read from the prefetched batches.
+    public var rowid: Int64 { 0 }
+}
+
+/// One row produced by an ``AsyncVirtualTableCursor``.
+public struct VirtualTableRow: Sendable {
+    /// The row identifier reported to SQLite.
+    public var rowid: Int64
+
+    /// The values of the declared columns, in order. Missing columns read as NULL.
+    public var columns: [ColumnValue]
+
+    public init(rowid: Int64, columns: [ColumnValue]) {
+        self.rowid = rowid
+        self.columns = columns
+    }
+}
+
+/// A bounded queue of row batches between a producer task and the thread running the
+/// statement.
+///
+/// The producer suspends while the queue is full and is resumed by the consumer taking a
+/// batch. The consumer blocks on a semaphore while the queue is empty; every batch queued
+/// and the end of the sequence signal it once, so it may wake to find nothing new and
+/// wait again, but never misses a batch.
+final class AsyncRowBatchQueue: Sendable {
+    private struct State {
+        var batches: [[VirtualTableRow]] = []
+        var isFinished = false
+        var failure: (any Error)?
+        /// Set once the consumer has gone, after which batches are dropped.
+        var isClosed = false
+        var waitingProducer: CheckedContinuation<Void, Never>?
+    }
+
+    private enum Next {
+        case batch([VirtualTableRow])
+        case failed(any Error)
+        case finished
+        case empty
+    }
+
+    let limit: Int
+    private let state = Mutex(State())
+    private let available = DispatchSemaphore(value: 0)
+
+    init(limit: Int) {
+        self.limit = max(1, limit)
+    }
+
+    /// Iterates `batches` into the queue until it ends, fails or the queue is closed.
+    func produce<Batches: AsyncSequence & Sendable>(_ batches: Batches) async
+    where Batches.Element == [VirtualTableRow] {
+        do {
+            for try await batch in batches where !batch.isEmpty {
+                guard await push(batch) else { return }
+            }
+            finish(failure: nil)
+        } catch {
+            finish(failure: error)
+        }
+    }
+
+    /// Queues `batch`, suspending while the queue is full.
+    ///
+    /// - Returns: `false` if the consumer has closed the queue.
+    private func push(_ batch: [VirtualTableRow]) async -> Bool {
+        while true {
+            let queued = state.withLock { state -> Bool? in
+                if state.isClosed { return false }
+                guard state.batches.count < limit else { return nil }
+                state.batches.append(batch)
+                return true
+            }
+            if let queued {
+                if queued { available.signal() }
+                return queued
+            }
+
+            await withCheckedContinuation { continuation in
+                let hasRoom = state.withLock { state in
+                    if state.isClosed || state.batches.count < limit { return true }
+                    state.waitingProducer = continuation
+                    return false
+                }
+                if hasRoom {
+                    continuation.resume()
+                }
+            }
+        }
+    }
+
+    private func finish(failure: (any Error)?) {
+        state.withLock { state in
+            state.isFinished = true
+            state.failure = failure
+        }
+        available.signal()
+    }
+
+    /// Takes the next batch, blocking until one is queued.
+    ///
+    /// - Returns: The batch, or `nil` at the end of the sequence.
+    /// - Throws: The error the sequence ended with.
+    func pop() throws -> [VirtualTableRow]? {
+        while true {
+            let (next, producer) = state.withLock { state -> (Next, CheckedContinuation<Void, Never>?) in
+                if !state.batches.isEmpty {
+                    let producer = state.waitingProducer
+                    state.waitingProducer = nil
+                    return (.batch(state.batches.removeFirst()), producer)
+                }
+                if let failure = state.failure {
+                    return (.failed(failure), nil)
+                }
+                return (state.isFinished ? .finished : .empty, nil)
+            }
+            producer?.resume()
+
+            switch next {
+            case .batch(let batch):
+                return batch
+            case .failed(let error):
+                throw error
+            case .finished:
+                return nil
+            case .empty:
+                available.wait()
+            }
+        }
+    }
+
+    /// Drops the queued batches and stops the producer at its next push.
+    func close() {
+        let producer = state.withLock { state in
+            state.isClosed = true
+            state.batches = []
+            let producer = state.waitingProducer
+            state.waitingProducer = nil
+            return producer
+        }
+        producer?.resume()
+    }
+}
@@ -0,0 +1,222 @@
+import CSQLite
+import Foundation
+
+/// A virtual table cursor that produces rows in fixed-capacity columnar batches.
+///
+/// Row-at-a-time cursors cross from SQLite into Swift for every `xNext`, `xEof` and
+/// `xRowid` call and once per cell for `xColumn`. A batch cursor instead fills a
+/// ``VirtualTableBatch`` with up to ``batchCapacity`` rows at once. SQLite's cursor
+/// callbacks are then served directly from that buffer by the C shim, and Swift is only
+/// called again once the batch has been consumed.
+///
+/// Conforming types implement `filter(indexNumber:indexString:values:)` to reset their
+/// position and ``fillBatch(_:)`` to produce rows. The row-at-a-time requirements of
+/// ``VirtualTableCursor`` have default implementations and are never called by the bridge.
+///
+/// ## Example
+/// ```swift
+/// struct RangeCursor: BatchVirtualTableCursor {
+///     static let columnCount = 1
+///     private var next: Int64 = 0
+///
+///     mutating func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+///         next = 0
+///     }
+///
+///     mutating func fillBatch(_ batch: VirtualTableBatch) throws {
+///         while !batch.isFull && next < 1_000_000 {
+///             let row = batch.appendRow(rowid: next)
+///             batch.setInteger(next, column: 0, row: row)
+///             next += 1
+///         }
+///     }
+/// }
+/// ```
+public protocol BatchVirtualTableCursor: VirtualTableCursor {
+    /// The number of declared columns served from the batch.
+    ///
+    /// Columns at or beyond this index read as NULL.
+    static var columnCount: Int { get }
+
+    /// The maximum number of rows in each batch.
+    static var batchCapacity: Int { get }
+
+    /// Appends the next rows to `batch`.
+    ///
+    /// The batch is empty when this method is called. Append up to
+    /// ``VirtualTableBatch/capacity`` rows; appending no rows signals the end of the result set.
+    ///
+    /// - Parameter batch: The batch to fill.
+    /// - Throws: Any error producing rows.
+    mutating func fillBatch(_ batch: VirtualTableBatch) throws
+}
+
+extension BatchVirtualTableCursor {
+    /// Default batch capacity of 256 rows.
+    public static var batchCapacity: Int { 256 }
+
+    /// Unused for batch cursors; rows are advanced from the batch buffer.
+    public mutating func next() throws {}
+
+    /// Unused for batch cursors; end of data is signalled by an empty batch.
+    public var eof: Bool { true }
+
+    /// Unused for batch cursors; columns are read from the batch buffer.
+    public func column(at index: Int) throws -> ColumnValue {
+        _ = index
+        return .null
+    }
+
+    /// Unused for batch cursors; row identifiers are read from the batch buffer.
+    public var rowid: Int64 { 0 }
+}
+
+/// A columnar row buffer filled by a ``BatchVirtualTableCursor``.
+///
+/// Each appended row starts with every column set to NULL. Integer and real cells are
+/// stored in contiguous per-column arrays, and text and blob cells are copied into a
+/// shared byte arena that is reset before every refill.
+///
+/// A batch is only valid inside ``BatchVirtualTableCursor/fillBatch(_:)``.
+public struct VirtualTableBatch {
+    let pointer: UnsafeMutablePointer<SQLiteVirtualBatch>
+
+    init(_ pointer: UnsafeMutablePointer<SQLiteVirtualBatch>) {
+        self.pointer = pointer
+    }
+
+    /// The maximum number of rows in the batch.
+    public var capacity: Int {
+        Int(pointer.pointee.capacity)
+    }
+
+    /// The number of columns stored per row.
+    public var columnCount: Int {
+        Int(pointer.pointee.columnCount)
+    }
+
+    /// The number of rows appended so far.
+    public var count: Int {
+        Int(pointer.pointee.rowCount)
+    }
+
+    /// Whether the batch has reached its capacity.
+    public var isFull: Bool {
+        pointer.pointee.rowCount >= pointer.pointee.capacity
+    }
+
+    /// Appends a row whose columns are all NULL.
+    ///
+    /// - Parameter rowid: The row identifier reported to SQLite for this row.
+    /// - Returns: The index of the new row, used with the `set` methods.
+    @discardableResult
+    public func appendRow(rowid: Int64) -> Int {
+        let row = SQLiteExtensionKit_BatchAppendRow(pointer, rowid)
+        precondition(row >= 0, "VirtualTableBatch is full")
+        return Int(row)
+    }
+
+    /// Stores an integer cell.
+    public func setInteger(_ value: Int64, column: Int, row: Int) {
+        let cell = cellIndex(column: column, row: row)
+        pointer.pointee.integers[cell] = value
+        pointer.pointee.types[cell] = UInt8(SQLITE_INTEGER)
+    }
+
+    /// Stores a real cell.
+    public func setReal(_ value: Double, column: Int, row: Int) {
+        let cell = cellIndex(column: column, row: row)
+        pointer.pointee.reals[cell] = value
+        pointer.pointee.types[cell] = UInt8(SQLITE_FLOAT)
+    }
+
+    /// Stores a NULL cell.
+    public func setNull(column: Int, row: Int) {
+        let cell = cellIndex(column: column, row: row)
+        pointer.pointee.types[cell] = UInt8(SQLITE_NULL)
+    }
+
+    /// Copies a text cell into the batch arena.
+    ///
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the arena cannot grow.
+    public func setText(_ value: String, column: Int, row: Int) throws {
+        var value = value
+        try value.withUTF8 { buffer in
+            try setBytes(UnsafeRawBufferPointer(buffer), type: SQLITE_TEXT, column: column, row: row)
+        }
+    }
+
+    /// Copies UTF-8 encoded text bytes into the batch arena.
+    ///
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the arena cannot grow.
+    public func setText(utf8 bytes: UnsafeRawBufferPointer, column: Int, row: Int) throws {
+        try setBytes(bytes, type: SQLITE_TEXT, column: column, row: row)
+    }
+
+    /// Copies a blob cell into the batch arena.
+    ///
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the arena cannot grow.
+    public func setBlob(_ value: Data, column: Int, row: Int) throws {
+        try value.withUnsafeBytes { bytes in
+            try setBytes(bytes, type: SQLITE_BLOB, column: column, row: row)
+        }
+    }
+
+    /// Copies raw blob bytes into the batch arena.
+    ///
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the arena cannot grow.
+    public func setBlob(bytes: UnsafeRawBufferPointer, column: Int, row: Int) throws {
+        try setBytes(bytes, type: SQLITE_BLOB, column: column, row: row)
+    }
+
+    /// Stores any ``ColumnValue`` in the cell.
+    ///
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the arena cannot grow.
+    public func set(_ value: ColumnValue, column: Int, row: Int) throws {
+        switch value {
+        case .integer(let value):
+            setInteger(value, column: column, row: row)
+        case .real(let value):
+            setReal(value, column: column, row: row)
+        case .text(let value):
+            try setText(value, column: column, row: row)
+        case .blob(let value):
+            try setBlob(value, column: column, row: row)
+        case .null:
+            setNull(column: column, row: row)
+        case .textBuffer(let buffer):
+            try setText(utf8: buffer.bytes, column: column, row: row)
+        case .blobBuffer(let buffer):
+            try setBlob(bytes: buffer.bytes, column: column, row: row)
+        case .staticText(let bytes):
+            try setText(utf8: bytes.bytes, column: column, row: row)
+        case .staticBlob(let bytes):
+            try setBlob(bytes: bytes.bytes, column: column, row: row)
+        }
+    }
+
+    private func cellIndex(column: Int, row: Int) -> Int {
+        precondition(column >= 0 && column < columnCount, "VirtualTableBatch column out of range")
+        precondition(row >= 0 && row < count, "VirtualTableBatch row out of range")
+        return column * capacity + row
+    }
+
+    private func setBytes(
+        _ bytes: UnsafeRawBufferPointer,
+        type: Int32,
+        column: Int,
+        row: Int
+    ) throws {
+        let result = SQLiteExtensionKit_BatchSetBytes(
+            pointer,
+            Int32(row),
+            Int32(column),
+            bytes.baseAddress,
+            sqlite3_int64(bytes.count),
+            type
+        )
+        if result != SQLITE_OK {
+            throw SQLiteExtensionError.sqliteError(code: result)
+        }
+    }
+}
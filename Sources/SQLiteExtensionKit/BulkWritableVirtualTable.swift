@@ -0,0 +1,185 @@
+import CSQLite
+import Foundation
+
+/// A writable virtual table that receives inserted rows in columnar batches.
+///
+/// For ordinary modules every inserted row is decoded into a
+/// ``VirtualTableUpdateOperation/insert(rowid:values:)`` with its own array of values.
+/// A bulk writable table instead has incoming rows copied straight from SQLite's values
+/// into a reusable ``RowBatch`` of up to ``insertBatchCapacity`` rows, and receives the
+/// whole batch in one ``insertBatch(_:)`` call.
+///
+/// Each row's rowid is still chosen when SQLite inserts it, by ``assignRowID(requested:)``,
+/// so `last_insert_rowid()` and any requested rowid behave exactly as in the row-at-a-time
+/// path. The rows themselves are delivered later: when the batch is full, before any
+/// update, delete or new cursor on the table, before a savepoint is taken, and before the
+/// transaction commits. Staged rows are dropped on rollback, including rollback to a
+/// savepoint, and when the table is disconnected with its transaction still open, such as
+/// by closing the connection mid-transaction. Because delivery is deferred, an error thrown
+/// by ``insertBatch(_:)`` is reported by the statement that triggered it, or by `COMMIT`,
+/// which then rolls back.
+///
+/// ``VirtualTableModule/update(_:)`` still handles updates and deletes, but is never
+/// called for inserts.
+///
+/// ## Example
+/// ```swift
+/// struct ColumnStoreTable: BulkWritableVirtualTable {
+///     static let insertBatchCapacity = 4096
+///     let store: ColumnStore
+///
+///     mutating func assignRowID(requested: Int64?) throws -> Int64 {
+///         store.reserveRowID(requested)
+///     }
+///
+///     mutating func insertBatch(_ rows: RowBatch) throws {
+///         for row in 0..<rows.count {
+///             store.append(rowid: rows.rowid(at: row), value: rows.integer(column: 1, row: row))
+///         }
+///     }
+///     // schema, bestIndex(_:) and open() as for any virtual table
+/// }
+/// ```
+public protocol BulkWritableVirtualTable: VirtualTableModule {
+    /// The maximum number of rows staged before ``insertBatch(_:)`` is called.
+    static var insertBatchCapacity: Int { get }
+
+    /// Chooses the rowid of a row as SQLite inserts it.
+    ///
+    /// Called once the row's values have been staged, so a row that fails to stage never
+    /// takes a rowid.
+    ///
+    /// - Parameter requested: The rowid given in the `INSERT`, if any.
+    /// - Returns: The rowid to report to SQLite and to store in the staged row.
+    /// - Throws: Any error, which fails the insert, for example a duplicate rowid.
+    mutating func assignRowID(requested: Int64?) throws -> Int64
+
+    /// Stores a batch of inserted rows.
+    ///
+    /// - Parameter rows: The staged rows in insertion order; only valid during the call.
+    /// - Throws: Any error storing the rows.
+    mutating func insertBatch(_ rows: RowBatch) throws
+}
+
+extension BulkWritableVirtualTable {
+    /// Default staging capacity of 1024 rows.
+    public static var insertBatchCapacity: Int { 1024 }
+}
+
+/// A read-only view of rows staged for ``BulkWritableVirtualTable/insertBatch(_:)``.
+///
+/// Cells are stored column-major with their original storage class, so reading a
+/// column in a loop touches one contiguous array. Text and blob cells are borrowed from
+/// a shared arena and stay valid until `insertBatch(_:)` returns.
+public struct RowBatch {
+    let pointer: UnsafeMutablePointer<SQLiteVirtualBatch>
+
+    init(_ pointer: UnsafeMutablePointer<SQLiteVirtualBatch>) {
+        self.pointer = pointer
+    }
+
+    /// The number of rows in the batch.
+    public var count: Int {
+        Int(pointer.pointee.rowCount)
+    }
+
+    /// The number of column values stored per row, in schema order.
+    public var columnCount: Int {
+        Int(pointer.pointee.columnCount)
+    }
+
+    /// The rowid assigned to `row`.
+    public func rowid(at row: Int) -> Int64 {
+        precondition(row >= 0 && row < count, "RowBatch row out of range")
+        return pointer.pointee.rowids[row]
+    }
+
+    /// The storage class of a cell.
+    public func type(column: Int, row: Int) -> SQLiteValue.ValueType {
+        let cell = cellIndex(column: column, row: row)
+        return SQLiteValue.ValueType(rawValue: Int32(pointer.pointee.types[cell])) ?? .null
+    }
+
+    /// Returns a cell as an integer, converting reals and treating anything else as 0.
+    public func integer(column: Int, row: Int) -> Int64 {
+        let cell = cellIndex(column: column, row: row)
+        switch Int32(pointer.pointee.types[cell]) {
+        case SQLITE_INTEGER:
+            return pointer.pointee.integers[cell]
+        case SQLITE_FLOAT:
+            return Int64(exactly: pointer.pointee.reals[cell].rounded(.towardZero)) ?? 0
+        default:
+            return 0
+        }
+    }
+
+    /// Returns a cell as a real, converting integers and treating anything else as 0.
+    public func real(column: Int, row: Int) -> Double {
+        let cell = cellIndex(column: column, row: row)
+        switch Int32(pointer.pointee.types[cell]) {
+        case SQLITE_INTEGER:
+            return Double(pointer.pointee.integers[cell])
+        case SQLITE_FLOAT:
+            return pointer.pointee.reals[cell]
+        default:
+            return 0
+        }
+    }
+
+    /// Calls `body` with the bytes of a text or blob cell, or an empty buffer otherwise.
+    ///
+    /// - Returns: The value returned by `body`.
+    public func withBytes<Result>(
+        column: Int,
+        row: Int,
+        _ body: (UnsafeRawBufferPointer) throws -> Result
+    ) rethrows -> Result {
+        let cell = cellIndex(column: column, row: row)
+        let type = Int32(pointer.pointee.types[cell])
+        guard type == SQLITE_TEXT || type == SQLITE_BLOB,
+              pointer.pointee.lengths[cell] > 0,
+              let arena = pointer.pointee.arena else {
+            return try body(UnsafeRawBufferPointer(start: nil, count: 0))
+        }
+        return try body(UnsafeRawBufferPointer(
+            start: arena + Int(pointer.pointee.offsets[cell]),
+            count: Int(pointer.pointee.lengths[cell])
+        ))
+    }
+
+    /// Returns a cell as text, decoding blobs as UTF-8 and formatting numbers.
+    public func text(column: Int, row: Int) -> String {
+        switch type(column: column, row: row) {
+        case .integer:
+            return String(integer(column: column, row: row))
+        case .real:
+            return String(real(column: column, row: row))
+        case .text, .blob:
+            return withBytes(column: column, row: row) { String(decoding: $0, as: UTF8.self) }
+        case .null:
+            return ""
+        }
+    }
+
+    /// Returns a cell as a ``ColumnValue``, copying text and blobs.
+    public func value(column: Int, row: Int) -> ColumnValue {
+        switch type(column: column, row: row) {
+        case .integer:
+            return .integer(integer(column: column, row: row))
+        case .real:
+            return .real(real(column: column, row: row))
+        case .text:
+            return .text(text(column: column, row: row))
+        case .blob:
+            return .blob(withBytes(column: column, row: row) { Data($0) })
+        case .null:
+            return .null
+        }
+    }
+
+    private func cellIndex(column: Int, row: Int) -> Int {
+        precondition(column >= 0 && column < columnCount, "RowBatch column out of range")
+        precondition(row >= 0 && row < count, "RowBatch row out of range")
+        return column * Int(pointer.pointee.capacity) + row
+    }
+}
@@ -36,6 +36,9 @@ public protocol SQLiteExtensionModule: Sendable {
 
     /// Register the extension's functions and features with the database.
     ///
+    /// Extensions loaded on many connections can build a ``SQLiteFunctionRegistry`` once
+    /// and register it here, instead of creating every function again per connection.
+    ///
     /// - Parameter db: The database to register with.
     /// - Throws: Any error that occurs during registration.
     static func register(with db: SQLiteDatabase) throws
@@ -0,0 +1,192 @@
+import CSQLite
+import Synchronization
+
+// MARK: - Memoization
+
+/// A cache policy for the results of a deterministic scalar function.
+///
+/// `SQLITE_DETERMINISTIC` only lets SQLite factor a call with constant arguments out of a
+/// statement; a function applied to a column still runs once per row. A memoized function
+/// keeps the results of recent argument lists, so a query over a column with few distinct
+/// values does the work once per value instead of once per row.
+///
+/// Arguments are keyed by their storage class and bytes, read in place, so `1` and `'1'`
+/// are different keys and a lookup allocates nothing. Results that are errors, and calls
+/// whose arguments total more than ``maximumKeyBytes``, are never cached. Text and blob
+/// results are kept in a ``SQLiteResultBuffer`` and returned from the cache without a copy.
+///
+/// A memoized function must set its result only through the methods of the
+/// ``SQLiteContext`` it is passed. A result set by calling `sqlite3_result_*` on
+/// ``SQLiteContext/pointer`` directly, including a subtype, is not seen by the cache: the
+/// call caches whatever wrapper result it set before, or nothing.
+///
+/// Each registration has its own cache: a function registered on a connection caches for
+/// that connection, and one added to a ``SQLiteFunctionRegistry`` shares its cache with every
+/// connection the registry is installed on.
+///
+/// Memoize only functions whose cost is well above a hash lookup and a lock: cheap
+/// arithmetic is faster recomputed. When ``SQLiteInstrumentation`` is enabled at
+/// registration, hits and misses are counted as the `memo_hit` and `memo_miss` callbacks of
+/// the function.
+///
+/// ## Example
+/// ```swift
+/// try db.createScalarFunction(
+///     name: "geo_region",
+///     argumentCount: 1,
+///     deterministic: true,
+///     memoize: .lru(capacity: 1024)
+/// ) { context, args in
+///     context.result(regionIndex.lookup(args[0].textValue))
+/// }
+/// ```
+public struct SQLiteMemoization: Sendable {
+    /// The largest encoded argument list that is cached, 4 KiB.
+    public static let maximumKeyBytes = 4096
+
+    /// The maximum number of results kept.
+    public let capacity: Int
+
+    private init(capacity: Int) {
+        self.capacity = capacity
+    }
+
+    /// Keeps the results of the `capacity` most recently used argument lists.
+    ///
+    /// - Parameter capacity: The maximum number of results; must be at least 1.
+    public static func lru(capacity: Int) -> SQLiteMemoization {
+        precondition(capacity > 0, "SQLiteMemoization capacity must be positive")
+        return SQLiteMemoization(capacity: capacity)
+    }
+}
+
+/// A function result as kept by a memoized function.
+enum MemoizedResult: Sendable {
+    case integer(Int64)
+    case real(Double)
+    case text(SQLiteResultBuffer)
+    case blob(SQLiteResultBuffer)
+    case zeroBlob(Int)
+    case null
+
+    func apply(to context: SQLiteContext) {
+        switch self {
+        case .integer(let value):
+            context.result(value)
+        case .real(let value):
+            context.result(value)
+        case .text(let buffer):
+            context.result(text: buffer)
+        case .blob(let buffer):
+            context.result(blob: buffer)
+        case .zeroBlob(let count):
+            context.resultZeroBlob(count: count)
+        case .null:
+            context.resultNull()
+        }
+    }
+}
+
+/// Captures the result a function sets on a memoization miss.
+///
+/// Attached to the ``SQLiteContext`` passed to the function; each result method records
+/// the value it sets, the last one winning, and errors mark the call as not cacheable.
+final class SQLiteResultRecorder {
+    private(set) var result: MemoizedResult?
+    private(set) var isCacheable = true
+
+    func record(_ result: MemoizedResult) {
+        self.result = result
+    }
+
+    func recordError() {
+        isCacheable = false
+    }
+}
+
+/// The result cache of one memoized function registration.
+final class FunctionMemo: Sendable {
+    struct Key: Hashable, Sendable {
+        let bytes: [UInt8]
+    }
+
+    private let cache: SQLiteLRUCache<Key, MemoizedResult>
+    /// Reused to encode each call's arguments, so a hit allocates nothing. A miss stores
+    /// the bytes as a key and the next call copies them before writing.
+    private let scratch = Mutex<[UInt8]>([])
+    private let hits: InstrumentationProbe?
+    private let misses: InstrumentationProbe?
+
+    init(name: String, memoization: SQLiteMemoization) {
+        cache = SQLiteLRUCache(capacity: memoization.capacity)
+        hits = SQLiteInstrumentation.probe(name: name, callback: "memo_hit")
+        misses = SQLiteInstrumentation.probe(name: name, callback: "memo_miss")
+    }
+
+    /// Sets the cached result for `arguments`, or calls `function` and caches its result.
+    func call(
+        _ function: BorrowingScalarFunction,
+        context: SQLiteContext,
+        arguments: SQLiteArguments
+    ) throws {
+        guard let key = key(for: arguments) else {
+            try function(context, arguments)
+            return
+        }
+        if let cached = cache.value(forKey: key) {
+            count(hits)
+            cached.apply(to: context)
+            return
+        }
+
+        count(misses)
+        let recorder = SQLiteResultRecorder()
+        try function(SQLiteContext(context.pointer, recorder: recorder), arguments)
+        if recorder.isCacheable, let result = recorder.result {
+            cache.insert(result, forKey: key)
+        }
+    }
+
+    private func count(_ probe: InstrumentationProbe?) {
+        if let probe, SQLiteInstrumentation.isEnabled {
+            probe.recordEvent()
+        }
+    }
+
+    /// Encodes each argument as its type tag followed by its value, or by its length and
+    /// bytes, or returns `nil` past ``SQLiteMemoization/maximumKeyBytes``.
+    private func key(for arguments: SQLiteArguments) -> Key? {
+        scratch.withLock { bytes -> Key? in
+            bytes.removeAll(keepingCapacity: true)
+            func appendInteger<T: FixedWidthInteger>(_ value: T) {
+                withUnsafeBytes(of: value.littleEndian) { bytes.append(contentsOf: $0) }
+            }
+            func appendBytes(_ payload: UnsafeRawBufferPointer) -> Bool {
+                guard bytes.count + 4 + payload.count <= SQLiteMemoization.maximumKeyBytes else {
+                    return false
+                }
+                appendInteger(UInt32(payload.count))
+                bytes.append(contentsOf: payload)
+                return true
+            }
+
+            for argument in arguments {
+                let type = argument.type
+                bytes.append(UInt8(type.rawValue))
+                switch type {
+                case .integer:
+                    appendInteger(argument.intValue)
+                case .real:
+                    appendInteger(argument.doubleValue.bitPattern)
+                case .text:
+                    guard argument.withUTF8Bytes({ appendBytes(UnsafeRawBufferPointer($0)) }) else { return nil }
+                case .blob:
+                    guard argument.withBlobBytes({ appendBytes($0) }) else { return nil }
+                case .null:
+                    break
+                }
+            }
+            return bytes.count <= SQLiteMemoization.maximumKeyBytes ? Key(bytes: bytes) : nil
+        }
+    }
+}
@@ -0,0 +1,321 @@
+import CSQLite
+import Foundation
+import Synchronization
+#if canImport(os)
+import os
+#endif
+
+// MARK: - Instrumentation
+
+/// Opt-in call counts, error counts and latency histograms for extension callbacks.
+///
+/// While instrumentation is enabled, functions and virtual table modules registered from
+/// then on are wrapped with probes: every scalar call, aggregate step and final, window
+/// callback, and virtual table `filter`, `next`, `column` and `update` is counted and
+/// timed. Probes are shared by every registration of the same name, so the statistics of
+/// a function cover all connections. Functions registered while instrumentation is
+/// disabled carry no probe and run exactly as before.
+///
+/// Each probe keeps its counters in per-thread stripes updated with relaxed atomic adds,
+/// so concurrent callers do not contend; ``statistics()`` sums the stripes when read.
+/// Latencies go into power-of-two histogram buckets, from which percentiles are
+/// estimated to within a factor of two.
+///
+/// ## Example
+/// ```swift
+/// SQLiteInstrumentation.isEnabled = true
+/// try MyExtension.register(with: db)
+/// try db.registerInstrumentationTable()
+/// ```
+///
+/// ```sql
+/// SELECT name, callback, calls, p99_ns FROM sqlite_extension_kit_stats ORDER BY total_ns DESC;
+/// ```
+///
+/// ## Topics
+///
+/// ### Enabling Instrumentation
+/// - ``isEnabled``
+/// - ``isTracingEnabled``
+///
+/// ### Reading Statistics
+/// - ``statistics()``
+/// - ``Statistics``
+/// - ``reset()``
+public enum SQLiteInstrumentation {
+    /// The number of histogram buckets. Bucket `i` counts calls that took less than
+    /// 2^`i` nanoseconds and, for `i > 0`, at least 2^(`i` - 1).
+    public static let bucketCount = 40
+
+    /// Whether newly registered functions and modules are instrumented, and whether
+    /// instrumented callbacks record. Disabling it stops recording without removing probes.
+    public static var isEnabled: Bool {
+        get { enabled.load(ordering: .relaxed) }
+        set { enabled.store(newValue, ordering: .relaxed) }
+    }
+
+    /// Whether instrumented callbacks also emit signpost intervals, where `os` is available.
+    public static var isTracingEnabled: Bool {
+        get { tracing.load(ordering: .relaxed) }
+        set { tracing.store(newValue, ordering: .relaxed) }
+    }
+
+    /// The totals of one probe.
+    public struct Statistics: Sendable {
+        /// The function or module name.
+        public let name: String
+
+        /// The callback measured, such as `function`, `step` or `filter`, or the event
+        /// counted, such as `memo_hit` or `memo_miss` for a memoized function.
+        public let callback: String
+
+        /// The number of calls.
+        public let calls: UInt64
+
+        /// The number of calls that threw.
+        public let errors: UInt64
+
+        /// The total time spent in the callback.
+        public let totalNanoseconds: UInt64
+
+        /// Call counts per latency bucket; see ``SQLiteInstrumentation/bucketCount``.
+        public let histogram: [UInt64]
+
+        /// The mean latency, or zero without calls.
+        public var meanNanoseconds: UInt64 {
+            calls == 0 ? 0 : totalNanoseconds / calls
+        }
+
+        /// Estimates a latency percentile as the upper bound of the bucket containing it.
+        ///
+        /// - Parameter fraction: The percentile as a fraction, such as `0.99`.
+        /// - Returns: The estimate in nanoseconds, or zero without calls.
+        public func percentile(_ fraction: Double) -> UInt64 {
+            let total = histogram.reduce(0, +)
+            guard total > 0 else { return 0 }
+            let rank = UInt64((Double(total) * min(max(fraction, 0), 1)).rounded(.up))
+            var seen: UInt64 = 0
+            for (bucket, count) in histogram.enumerated() {
+                seen += count
+                if seen >= max(rank, 1) {
+                    return 1 << UInt64(bucket)
+                }
+            }
+            return 1 << UInt64(histogram.count - 1)
+        }
+    }
+
+    /// Returns the statistics of every probe, ordered by name and callback.
+    public static func statistics() -> [Statistics] {
+        probes.withLock { Array($0.values) }
+            .map { $0.statistics() }
+            .sorted { ($0.name, $0.callback) < ($1.name, $1.callback) }
+    }
+
+    /// Sets every counter to zero. Calls running concurrently may be partly counted.
+    public static func reset() {
+        for probe in probes.withLock({ Array($0.values) }) {
+            probe.reset()
+        }
+    }
+
+    /// Returns the shared probe for a callback, or `nil` while instrumentation is disabled.
+    static func probe(name: String, callback: String) -> InstrumentationProbe? {
+        guard isEnabled else { return nil }
+        let key = ProbeKey(name: name, callback: callback)
+        return probes.withLock { probes in
+            if let probe = probes[key] {
+                return probe
+            }
+            let probe = InstrumentationProbe(name: name, callback: callback)
+            probes[key] = probe
+            return probe
+        }
+    }
+
+    private struct ProbeKey: Hashable {
+        let name: String
+        let callback: String
+    }
+
+    private static let enabled = Atomic<Bool>(false)
+    private static let tracing = Atomic<Bool>(false)
+    private static let probes = Mutex<[ProbeKey: InstrumentationProbe]>([:])
+
+    #if canImport(os)
+    static let signposter = OSSignposter(subsystem: "SQLiteExtensionKit", category: .pointsOfInterest)
+    #endif
+}
+
+/// Counters for one callback of one function or module.
+///
+/// Probes are created once per name and callback and never freed, so callbacks can use
+/// them without retaining anything.
+final class InstrumentationProbe: @unchecked Sendable {
+    let name: String
+    let callback: String
+
+    private static let stripeCount = 16
+    // calls, errors, total nanoseconds, then the histogram, padded to a multiple of 64 bytes.
+    private static let stride = (3 + SQLiteInstrumentation.bucketCount + 7) / 8 * 8
+    private let counters: UnsafeMutablePointer<UInt64>
+
+    init(name: String, callback: String) {
+        self.name = name
+        self.callback = callback
+        counters = .allocate(capacity: Self.stripeCount * Self.stride)
+        counters.initialize(repeating: 0, count: Self.stripeCount * Self.stride)
+    }
+
+    deinit {
+        counters.deallocate()
+    }
+
+    /// Runs `body`, recording its latency and whether it threw.
+    func measure<Result>(_ body: () throws -> Result) rethrows -> Result {
+        #if canImport(os)
+        let signpost = SQLiteInstrumentation.isTracingEnabled ? beginSignpost() : nil
+        defer {
+            if let signpost {
+                endSignpost(signpost)
+            }
+        }
+        #endif
+
+        let start = SQLiteExtensionKit_MonotonicNanoseconds()
+        do {
+            let result = try body()
+            record(since: start, failed: false)
+            return result
+        } catch {
+            record(since: start, failed: true)
+            throw error
+        }
+    }
+
+    /// Counts an untimed event, such as a memoization hit.
+    func recordEvent() {
+        let stripe = counters + Int(SQLiteExtensionKit_ThreadStripe()) % Self.stripeCount * Self.stride
+        SQLiteExtensionKit_CounterAdd(stripe, 1)
+    }
+
+    private func record(since start: UInt64, failed: Bool) {
+        let elapsed = SQLiteExtensionKit_MonotonicNanoseconds() &- start
+        let stripe = counters + Int(SQLiteExtensionKit_ThreadStripe()) % Self.stripeCount * Self.stride
+        SQLiteExtensionKit_CounterAdd(stripe, 1)
+        if failed {
+            SQLiteExtensionKit_CounterAdd(stripe + 1, 1)
+        }
+        SQLiteExtensionKit_CounterAdd(stripe + 2, elapsed)
+        let bucket = min(UInt64.bitWidth - elapsed.leadingZeroBitCount, SQLiteInstrumentation.bucketCount - 1)
+        SQLiteExtensionKit_CounterAdd(stripe + 3 + bucket, 1)
+    }
+
+    func statistics() -> SQLiteInstrumentation.Statistics {
+        var totals = [UInt64](repeating: 0, count: 3 + SQLiteInstrumentation.bucketCount)
+        for stripe in 0..<Self.stripeCount {
+            let base = counters + stripe * Self.stride
+            for index in totals.indices {
+                totals[index] &+= SQLiteExtensionKit_CounterLoad(base + index)
+            }
+        }
+        return SQLiteInstrumentation.Statistics(
+            name: name,
+            callback: callback,
+            calls: totals[0],
+            errors: totals[1],
+            totalNanoseconds: totals[2],
+            histogram: Array(totals[3...])
+        )
+    }
+
+    func reset() {
+        for index in 0..<(Self.stripeCount * Self.stride) {
+            SQLiteExtensionKit_CounterStore(counters + index, 0)
+        }
+    }
+
+    #if canImport(os)
+    private func beginSignpost() -> OSSignpostIntervalState {
+        let signposter = SQLiteInstrumentation.signposter
+        return signposter.beginInterval(
+            "SQLiteExtensionKit",
+            id: signposter.makeSignpostID(),
+            "\(self.name, privacy: .public) \(self.callback, privacy: .public)"
+        )
+    }
+
+    private func endSignpost(_ state: OSSignpostIntervalState) {
+        SQLiteInstrumentation.signposter.endInterval("SQLiteExtensionKit", state)
+    }
+    #endif
+}
+
+/// Runs `body` under `probe` while instrumentation is enabled, and directly otherwise.
+@inline(__always)
+func instrumented<Result>(_ probe: InstrumentationProbe?, _ body: () throws -> Result) rethrows -> Result {
+    guard let probe, SQLiteInstrumentation.isEnabled else {
+        return try body()
+    }
+    return try probe.measure(body)
+}
+
+/// The probes of a virtual table module's row callbacks.
+final class VirtualTableProbes: Sendable {
+    let filter: InstrumentationProbe
+    let next: InstrumentationProbe
+    let column: InstrumentationProbe
+    let update: InstrumentationProbe
+
+    /// Creates the module's probes, or returns `nil` while instrumentation is disabled.
+    init?(module name: String) {
+        guard
+            let filter = SQLiteInstrumentation.probe(name: name, callback: "filter"),
+            let next = SQLiteInstrumentation.probe(name: name, callback: "next"),
+            let column = SQLiteInstrumentation.probe(name: name, callback: "column"),
+            let update = SQLiteInstrumentation.probe(name: name, callback: "update")
+        else {
+            return nil
+        }
+        self.filter = filter
+        self.next = next
+        self.column = column
+        self.update = update
+    }
+}
+
+extension SQLiteDatabase {
+    /// Registers an eponymous table listing ``SQLiteInstrumentation/statistics()``.
+    ///
+    /// The table has one row per probe, with columns `name`, `callback`, `calls`,
+    /// `errors`, `total_ns`, `mean_ns`, `p50_ns`, `p90_ns`, `p99_ns` and `histogram`, a
+    /// JSON array of the bucket counts.
+    ///
+    /// - Parameter name: The table name as used in SQL.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func registerInstrumentationTable(name: String = "sqlite_extension_kit_stats") throws {
+        try createTableValuedFunction(
+            name: name,
+            columns: [
+                "name TEXT", "callback TEXT", "calls INTEGER", "errors INTEGER", "total_ns INTEGER",
+                "mean_ns INTEGER", "p50_ns INTEGER", "p90_ns INTEGER", "p99_ns INTEGER", "histogram TEXT",
+            ],
+            parameters: []
+        ) { _ in
+            SQLiteInstrumentation.statistics().lazy.map { statistics in
+                [
+                    .text(statistics.name),
+                    .text(statistics.callback),
+                    .integer(Int64(clamping: statistics.calls)),
+                    .integer(Int64(clamping: statistics.errors)),
+                    .integer(Int64(clamping: statistics.totalNanoseconds)),
+                    .integer(Int64(clamping: statistics.meanNanoseconds)),
+                    .integer(Int64(clamping: statistics.percentile(0.5))),
+                    .integer(Int64(clamping: statistics.percentile(0.9))),
+                    .integer(Int64(clamping: statistics.percentile(0.99))),
+                    .text("[\(statistics.histogram.map(String.init).joined(separator: ","))]"),
+                ] as [ColumnValue]
+            }
+        }
+    }
+}
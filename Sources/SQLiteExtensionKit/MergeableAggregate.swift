@@ -0,0 +1,367 @@
+import CSQLite
+import Foundation
+import Synchronization
+
+// MARK: - Mergeable Aggregates
+
+/// An aggregate whose partial states can be combined.
+///
+/// A mergeable aggregate can be registered as an ordinary SQL aggregate with
+/// ``SQLiteDatabase/createAggregateFunction(name:argumentCount:aggregate:)``, and it can
+/// also be computed over disjoint parts of a table in parallel with
+/// ``SQLiteDatabase/parallelAggregate(_:table:columns:threads:)``: each worker steps its
+/// own state, and the partial states are merged before ``finalize()``.
+///
+/// `merge(_:)` must give the same result as stepping `other`'s rows into `self`, up to
+/// floating-point rounding, and must accept ``init()`` states on either side.
+///
+/// ## Example
+/// ```swift
+/// struct Sum: MergeableAggregate {
+///     var total = 0.0
+///
+///     mutating func step(_ arguments: SQLiteArguments) {
+///         total += arguments[0].doubleValue
+///     }
+///
+///     mutating func merge(_ other: Sum) {
+///         total += other.total
+///     }
+///
+///     func finalize() -> ColumnValue {
+///         .real(total)
+///     }
+/// }
+/// ```
+public protocol MergeableAggregate: Sendable {
+    /// Creates the state of an aggregate over no rows.
+    init()
+
+    /// Adds one row. The arguments view must not escape the call.
+    mutating func step(_ arguments: SQLiteArguments) throws
+
+    /// Adds the rows summarized by another state.
+    mutating func merge(_ other: Self)
+
+    /// Returns the result for the rows added so far.
+    func finalize() -> ColumnValue
+}
+
+/// Errors raised while computing an aggregate in parallel.
+public enum ParallelAggregationError: Error, Sendable {
+    /// No mergeable aggregate is registered under the name.
+    case unknownAggregate(String)
+
+    /// A required argument of the table-valued function was NULL or missing.
+    case missingArgument(String)
+
+    /// A worker connection failed, with SQLite's error message.
+    case sqlite(code: Int32, message: String)
+}
+
+extension SQLiteDatabase {
+    /// Registers a ``MergeableAggregate`` as an SQL aggregate function.
+    ///
+    /// The state is boxed by ``SQLiteContext/withAggregateValue(initialValue:clearOnExit:_:)``,
+    /// so each group allocates one box that the aggregate context points to, and it is
+    /// finalized once per group; a group without rows finalizes a fresh
+    /// ``MergeableAggregate/init()`` state.
+    ///
+    /// - Parameters:
+    ///   - name: The name of the aggregate function.
+    ///   - argumentCount: The number of arguments the function accepts.
+    ///   - aggregate: The aggregate type.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func createAggregateFunction<Aggregate: MergeableAggregate>(
+        name: String,
+        argumentCount: Int32 = -1,
+        aggregate: Aggregate.Type
+    ) throws {
+        let result = createFunction(
+            name: name,
+            argumentCount: argumentCount,
+            flags: SQLITE_UTF8,
+            kind: .aggregate,
+            box: AggregateFunctionBox(name: name, aggregate: aggregate)
+        )
+        if result != SQLITE_OK {
+            throw SQLiteExtensionError.functionRegistrationFailed(name: name, code: result)
+        }
+    }
+
+    /// Computes an aggregate over columns of a table, scanning rowid ranges in parallel.
+    ///
+    /// The rowid range of `table` is split into several shards per thread, and worker
+    /// threads claim shards until none are left, so a thread that finishes early helps
+    /// with the rest instead of idling. Each worker reads through its own read-only
+    /// connection to the database file and steps its own state; the partial states are
+    /// merged at the end.
+    ///
+    /// The workers are separate connections, so they do not see uncommitted changes made
+    /// on this connection, and each shard reads the latest committed data when it starts:
+    /// run the aggregation while the table is not being written if the result must match
+    /// a single snapshot. In-memory and temporary databases cannot be opened by other
+    /// connections, so they are scanned on this connection by the calling thread.
+    ///
+    /// ## Example
+    /// ```swift
+    /// let deviation = try db.parallelAggregate(StandardDeviation.self, table: "events", columns: ["latency"], threads: 8)
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - type: The aggregate to compute.
+    ///   - table: The table to scan, which must have rowids.
+    ///   - columns: The columns passed to ``MergeableAggregate/step(_:)``, in order.
+    ///   - threads: The number of worker threads.
+    /// - Returns: The merged state.
+    /// - Throws: ``ParallelAggregationError`` if a worker cannot read the table, or the
+    ///   first error thrown by ``MergeableAggregate/step(_:)``.
+    public func parallelAggregate<Aggregate: MergeableAggregate>(
+        _ type: Aggregate.Type = Aggregate.self,
+        table: String,
+        columns: [String],
+        threads: Int
+    ) throws -> Aggregate {
+        let query = "SELECT \(columns.map(quotedIdentifier).joined(separator: ", ")) FROM \(quotedIdentifier(table))"
+
+        guard let filename = sqlite3_db_filename(pointer, "main"), filename.pointee != 0 else {
+            var state = Aggregate()
+            try AggregationScan(connection: pointer, sql: query).step(into: &state)
+            return state
+        }
+        let path = String(cString: filename)
+
+        let bounds = try AggregationScan(
+            connection: pointer,
+            sql: "SELECT min(rowid), max(rowid) FROM \(quotedIdentifier(table))"
+        ).bounds()
+        guard let bounds else {
+            return Aggregate()
+        }
+
+        let shards = RowidShards(lowest: bounds.lowest, highest: bounds.highest, count: max(threads, 1) * 4)
+        let workerCount = min(max(threads, 1), shards.count)
+        let nextShard = Atomic<Int>(0)
+        let outcome = Mutex<(partials: [Aggregate?], error: (any Error)?)>(
+            (Array(repeating: nil, count: workerCount), nil)
+        )
+        let shardQuery = "\(query) WHERE rowid BETWEEN ?1 AND ?2"
+
+        DispatchQueue.concurrentPerform(iterations: workerCount) { worker in
+            var state = Aggregate()
+            do {
+                let scan = try AggregationScan(path: path, sql: shardQuery)
+                while outcome.withLock({ $0.error == nil }) {
+                    let shard = nextShard.wrappingAdd(1, ordering: .relaxed).oldValue
+                    guard shard < shards.count else { break }
+                    let (lower, upper) = shards[shard]
+                    try scan.step(into: &state, lower: lower, upper: upper)
+                }
+                outcome.withLock { $0.partials[worker] = state }
+            } catch {
+                outcome.withLock { if $0.error == nil { $0.error = error } }
+            }
+        }
+
+        let (partials, error) = outcome.withLock { ($0.partials, $0.error) }
+        if let error {
+            throw error
+        }
+        var result = Aggregate()
+        for partial in partials {
+            if let partial {
+                result.merge(partial)
+            }
+        }
+        return result
+    }
+
+    /// Registers a table-valued function that computes mergeable aggregates in parallel.
+    ///
+    /// The function takes the aggregate name, a table, a column and an optional thread
+    /// count defaulting to the number of active processors, and returns one row whose
+    /// `value` is the result of ``parallelAggregate(_:table:columns:threads:)``.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createParallelAggregateFunction(aggregates: ["std_dev": StandardDeviation.self])
+    /// // SELECT value FROM parallel_aggregate('std_dev', 'events', 'latency', 8);
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The function name as used in SQL.
+    ///   - aggregates: The aggregates the function can compute, by case-insensitive name.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func createParallelAggregateFunction(
+        name: String = "parallel_aggregate",
+        aggregates: [String: any MergeableAggregate.Type]
+    ) throws {
+        let database = self
+        let registry = Dictionary(aggregates.map { ($0.key.lowercased(), $0.value) }) { first, _ in first }
+
+        try createTableValuedFunction(
+            name: name,
+            column: "value",
+            parameters: ["aggregate", "source", "column", "threads"]
+        ) { arguments in
+            func text(_ index: Int, _ parameter: String) throws -> String {
+                guard let value = arguments[index], !value.isNull else {
+                    throw ParallelAggregationError.missingArgument(parameter)
+                }
+                return value.textValue
+            }
+
+            let aggregateName = try text(0, "aggregate")
+            guard let aggregate = registry[aggregateName.lowercased()] else {
+                throw ParallelAggregationError.unknownAggregate(aggregateName)
+            }
+            let threads = arguments[3].flatMap { $0.isNull ? nil : Int($0.intValue) }
+                ?? ProcessInfo.processInfo.activeProcessorCount
+
+            func run<Aggregate: MergeableAggregate>(_ type: Aggregate.Type) throws -> ColumnValue {
+                try database.parallelAggregate(
+                    type,
+                    table: try text(1, "source"),
+                    columns: [try text(2, "column")],
+                    threads: min(max(threads, 1), 64)
+                ).finalize()
+            }
+            return CollectionOfOne(try run(aggregate))
+        }
+    }
+}
+
+extension AggregateFunctionBox {
+    /// Creates the callbacks of a mergeable aggregate, whose state is boxed in the aggregate context.
+    convenience init<Aggregate: MergeableAggregate>(name: String, aggregate: Aggregate.Type) {
+        self.init(
+            name: name,
+            step: { context, args in
+                try context.withAggregateValue(initialValue: Aggregate()) { state in
+                    try state.step(args)
+                }
+            },
+            final: { context in
+                let state = context.takeAggregateValue(Aggregate.self) ?? Aggregate()
+                state.finalize().setResult(in: context)
+            }
+        )
+    }
+}
+
+/// Quotes an SQL identifier, doubling any embedded quotes.
+private func quotedIdentifier(_ name: String) -> String {
+    "\"\(name.replacingOccurrences(of: "\"", with: "\"\""))\""
+}
+
+/// Even, inclusive splits of a rowid range.
+private struct RowidShards {
+    let lowest: Int64
+    let highest: Int64
+    let count: Int
+    private let width: UInt64
+
+    init(lowest: Int64, highest: Int64, count: Int) {
+        self.lowest = lowest
+        self.highest = highest
+        // The span overflows only for the full Int64 range, where any width is fine.
+        let span = UInt64(bitPattern: highest &- lowest) &+ 1
+        let shardCount = span == 0 ? count : Int(min(UInt64(count), span))
+        self.count = shardCount
+        self.width = (span == 0 ? .max : span) / UInt64(shardCount)
+    }
+
+    subscript(index: Int) -> (lower: Int64, upper: Int64) {
+        let lower = lowest &+ Int64(bitPattern: UInt64(index) &* width)
+        let upper = index == count - 1 ? highest : lower &+ Int64(bitPattern: width) &- 1
+        return (lower, upper)
+    }
+}
+
+/// A prepared statement whose result rows are stepped into an aggregate.
+private final class AggregationScan {
+    private let connection: OpaquePointer
+    private let ownsConnection: Bool
+    private var statement: OpaquePointer?
+
+    /// Prepares a statement on an existing connection.
+    init(connection: OpaquePointer, sql: String) throws {
+        self.connection = connection
+        self.ownsConnection = false
+        try prepare(sql)
+    }
+
+    /// Opens a read-only connection for the calling thread and prepares a statement on it.
+    init(path: String, sql: String) throws {
+        var handle: OpaquePointer?
+        let result = sqlite3_open_v2(path, &handle, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nil)
+        guard result == SQLITE_OK, let handle else {
+            let message = handle.map { String(cString: sqlite3_errmsg($0)) } ?? "out of memory"
+            sqlite3_close(handle)
+            throw ParallelAggregationError.sqlite(code: result, message: message)
+        }
+        self.connection = handle
+        self.ownsConnection = true
+        do {
+            try prepare(sql)
+        } catch {
+            sqlite3_close(handle)
+            throw error
+        }
+    }
+
+    deinit {
+        sqlite3_finalize(statement)
+        if ownsConnection {
+            sqlite3_close(connection)
+        }
+    }
+
+    private func prepare(_ sql: String) throws {
+        let result = sqlite3_prepare_v2(connection, sql, -1, &statement, nil)
+        if result != SQLITE_OK {
+            throw failure(result)
+        }
+    }
+
+    private func failure(_ code: Int32) -> ParallelAggregationError {
+        .sqlite(code: code, message: String(cString: sqlite3_errmsg(connection)))
+    }
+
+    /// Returns the two integers of the statement's single row, or `nil` if they are NULL.
+    func bounds() throws -> (lowest: Int64, highest: Int64)? {
+        defer { sqlite3_reset(statement) }
+        let result = sqlite3_step(statement)
+        guard result == SQLITE_ROW else { throw failure(result) }
+        guard sqlite3_column_type(statement, 0) != SQLITE_NULL else { return nil }
+        return (sqlite3_column_int64(statement, 0), sqlite3_column_int64(statement, 1))
+    }
+
+    /// Steps every result row into `state`, binding the rowid bounds if given.
+    func step<Aggregate: MergeableAggregate>(
+        into state: inout Aggregate,
+        lower: Int64? = nil,
+        upper: Int64? = nil
+    ) throws {
+        defer { sqlite3_reset(statement) }
+        if let lower, let upper {
+            sqlite3_bind_int64(statement, 1, lower)
+            sqlite3_bind_int64(statement, 2, upper)
+        }
+
+        // The row's values are passed as a borrowed argument view, as SQLite does for xStep.
+        let columnCount = Int(sqlite3_column_count(statement))
+        let values = UnsafeMutablePointer<OpaquePointer?>.allocate(capacity: max(columnCount, 1))
+        defer { values.deallocate() }
+
+        while true {
+            let result = sqlite3_step(statement)
+            if result == SQLITE_DONE { return }
+            guard result == SQLITE_ROW else { throw failure(result) }
+            for column in 0..<columnCount {
+                values[column] = sqlite3_column_value(statement, Int32(column))
+            }
+            try state.step(SQLiteArguments(values, count: Int32(columnCount)))
+        }
+    }
+}
@@ -0,0 +1,48 @@
+import CSQLite
+
+/// A borrowed, non-owning view over the arguments SQLite passes to a function callback.
+///
+/// `SQLiteArguments` wraps the `argv`/`argc` pair handed to `xFunc` and `xStep` without
+/// copying it into an array, so iterating or subscripting the arguments performs no heap
+/// allocation. Elements are produced on demand as ``SQLiteValue`` wrappers.
+///
+/// The view is only valid for the duration of the callback that received it. Copy the
+/// values you need (for example with `Array(arguments)` or by reading ``SQLiteValue/intValue``)
+/// before returning if they must outlive the call.
+///
+/// ## Example
+/// ```swift
+/// try db.createScalarFunction(name: "sum_all") { context, args in
+///     var total: Int64 = 0
+///     for value in args {
+///         total += value.intValue
+///     }
+///     context.result(total)
+/// }
+/// ```
+public struct SQLiteArguments: RandomAccessCollection {
+    /// The underlying `sqlite3_value` pointer array.
+    let base: UnsafeMutablePointer<OpaquePointer?>?
+
+    /// The number of arguments.
+    public let count: Int
+
+    /// Creates a borrowed argument view.
+    ///
+    /// - Parameters:
+    ///   - base: The `argv` array provided by SQLite.
+    ///   - count: The `argc` value provided by SQLite.
+    init(_ base: UnsafeMutablePointer<OpaquePointer?>?, count: Int32) {
+        self.base = base
+        self.count = base == nil ? 0 : Int(max(count, 0))
+    }
+
+    public var startIndex: Int { 0 }
+
+    public var endIndex: Int { count }
+
+    public subscript(position: Int) -> SQLiteValue {
+        precondition(position >= 0 && position < count, "SQLiteArguments index out of range")
+        return SQLiteValue(base.unsafelyUnwrapped[position].unsafelyUnwrapped)
+    }
+}
@@ -0,0 +1,186 @@
+import CSQLite
+
+// MARK: - Incremental Blob I/O
+
+/// An open handle for reading and writing one stored blob a range at a time.
+///
+/// A value passed to a function or returned from a virtual table is always held in memory
+/// whole. A blob handle instead reads the value straight from the database file with
+/// `sqlite3_blob_read`, so a function can process a value of any size in fixed-size
+/// chunks, with memory bounded by the chunk rather than the blob.
+///
+/// To store a large value without building it in memory, insert a placeholder of the right
+/// size, such as `zeroblob(n)` in SQL or ``SQLiteContext/resultZeroBlob(count:)`` from a
+/// function, then open it writable and fill it with ``write(_:at:)``. A blob handle cannot
+/// change the size of a value.
+///
+/// The handle is tied to its connection and row. It becomes invalid if the row is updated
+/// or deleted by anything other than the handle itself; later reads and writes then throw
+/// `SQLITE_ABORT`. It is closed when the object is released, and the connection must stay
+/// open until then.
+///
+/// ## Example
+/// ```swift
+/// let blob = try db.openBlob(table: "firmware", column: "image", rowid: id)
+/// var checksum: UInt32 = 0
+/// try blob.forEachChunk { chunk in
+///     checksum = chunk.reduce(checksum) { $0 &+ UInt32($1) }
+/// }
+/// ```
+///
+/// ## Topics
+///
+/// ### Opening a Blob
+/// - ``SQLiteDatabase/openBlob(table:column:rowid:schema:writable:)``
+/// - ``reopen(rowid:)``
+///
+/// ### Reading and Writing
+/// - ``count``
+/// - ``read(into:at:)``
+/// - ``forEachChunk(size:_:)``
+/// - ``write(_:at:)``
+public final class SQLiteBlob {
+    /// The chunk size ``forEachChunk(size:_:)`` uses by default, 64 KiB.
+    public static let defaultChunkSize = 64 * 1024
+
+    /// The underlying `sqlite3_blob` handle.
+    public let pointer: OpaquePointer
+
+    /// Whether the handle was opened for writing.
+    public let isWritable: Bool
+
+    init(pointer: OpaquePointer, isWritable: Bool) {
+        self.pointer = pointer
+        self.isWritable = isWritable
+    }
+
+    deinit {
+        sqlite3_blob_close(pointer)
+    }
+
+    /// The size of the value in bytes.
+    public var count: Int {
+        Int(sqlite3_blob_bytes(pointer))
+    }
+
+    /// Moves the handle to the same column of another row, which is faster than opening a
+    /// new handle.
+    ///
+    /// - Parameter rowid: The rowid of the row to open.
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the row does not exist or
+    ///   its value is not a blob or text. The handle is unusable afterwards.
+    public func reopen(rowid: Int64) throws {
+        let result = sqlite3_blob_reopen(pointer, rowid)
+        if result != SQLITE_OK {
+            throw SQLiteExtensionError.sqliteError(code: result)
+        }
+    }
+
+    /// Reads `buffer.count` bytes starting at `offset`.
+    ///
+    /// - Parameters:
+    ///   - buffer: The destination; it is filled completely.
+    ///   - offset: The offset of the first byte to read.
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the range extends past the
+    ///   end of the value, or `SQLITE_ABORT` if the row has changed since it was opened.
+    public func read(into buffer: UnsafeMutableRawBufferPointer, at offset: Int) throws {
+        guard let length = Int32(exactly: buffer.count), let start = Int32(exactly: offset) else {
+            throw SQLiteExtensionError.sqliteError(code: SQLITE_RANGE)
+        }
+        guard length > 0 else { return }
+        let result = sqlite3_blob_read(pointer, buffer.baseAddress, length, start)
+        if result != SQLITE_OK {
+            throw SQLiteExtensionError.sqliteError(code: result)
+        }
+    }
+
+    /// Writes `bytes` starting at `offset`, overwriting what is there.
+    ///
+    /// - Parameters:
+    ///   - bytes: The bytes to write.
+    ///   - offset: The offset of the first byte to overwrite.
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the handle is read-only,
+    ///   the range extends past the end of the value, or the row has changed.
+    public func write(_ bytes: UnsafeRawBufferPointer, at offset: Int) throws {
+        guard let length = Int32(exactly: bytes.count), let start = Int32(exactly: offset) else {
+            throw SQLiteExtensionError.sqliteError(code: SQLITE_RANGE)
+        }
+        guard length > 0 else { return }
+        let result = sqlite3_blob_write(pointer, bytes.baseAddress, length, start)
+        if result != SQLITE_OK {
+            throw SQLiteExtensionError.sqliteError(code: result)
+        }
+    }
+
+    /// Calls `body` with consecutive chunks of the value, from the start.
+    ///
+    /// One buffer of `size` bytes is allocated and reused for every chunk; each chunk is
+    /// only valid inside its call to `body`. Every chunk but the last is `size` bytes long.
+    ///
+    /// - Parameters:
+    ///   - size: The chunk size in bytes.
+    ///   - body: Processes one chunk.
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if a read fails, or any error
+    ///   thrown by `body`.
+    public func forEachChunk(
+        size: Int = SQLiteBlob.defaultChunkSize,
+        _ body: (UnsafeRawBufferPointer) throws -> Void
+    ) throws {
+        precondition(size > 0, "SQLiteBlob chunk size must be positive")
+        let total = count
+        guard total > 0 else { return }
+
+        let buffer = UnsafeMutableRawBufferPointer.allocate(byteCount: min(size, total), alignment: 16)
+        defer { buffer.deallocate() }
+
+        var offset = 0
+        while offset < total {
+            let chunk = UnsafeMutableRawBufferPointer(rebasing: buffer[..<min(buffer.count, total - offset)])
+            try read(into: chunk, at: offset)
+            try body(UnsafeRawBufferPointer(chunk))
+            offset += chunk.count
+        }
+    }
+}
+
+extension SQLiteDatabase {
+    /// Opens a stored blob or text value for incremental I/O.
+    ///
+    /// ## Example
+    /// ```swift
+    /// // Reserve 16 MiB, then fill it one chunk at a time.
+    /// sqlite3_exec(db.pointer, "INSERT INTO firmware(image) VALUES (zeroblob(16777216))", nil, nil, nil)
+    /// let rowid = sqlite3_last_insert_rowid(db.pointer)
+    /// let blob = try db.openBlob(table: "firmware", column: "image", rowid: rowid, writable: true)
+    /// var offset = 0
+    /// while let chunk = try reader.nextChunk() {
+    ///     try chunk.withUnsafeBytes { try blob.write($0, at: offset) }
+    ///     offset += chunk.count
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - table: The table name.
+    ///   - column: The column name.
+    ///   - rowid: The rowid of the row.
+    ///   - schema: The database name, such as `main`, `temp` or an attached database.
+    ///   - writable: Whether the handle may write.
+    /// - Returns: The open handle, closed when it is released.
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if the table, column or row does
+    ///   not exist, the value is not a blob or text, or a writable handle is requested for
+    ///   an indexed or read-only column. `sqlite3_errmsg` describes the failure.
+    public func openBlob(
+        table: String,
+        column: String,
+        rowid: Int64,
+        schema: String = "main",
+        writable: Bool = false
+    ) throws -> SQLiteBlob {
+        var handle: OpaquePointer?
+        let result = sqlite3_blob_open(pointer, schema, table, column, rowid, writable ? 1 : 0, &handle)
+        guard result == SQLITE_OK, let handle else {
+            throw SQLiteExtensionError.sqliteError(code: result == SQLITE_OK ? SQLITE_ERROR : result)
+        }
+        return SQLiteBlob(pointer: handle, isWritable: writable)
+    }
+}
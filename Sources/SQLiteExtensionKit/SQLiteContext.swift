@@ -12,20 +12,40 @@ import Foundation
 /// - ``result(_:)-8x7td``
 /// - ``result(_:)-3bt8o``
 /// - ``result(_:)-5yh2z``
+/// - ``result(capacity:initializingWith:)``
+/// - ``resultZeroBlob(count:)``
+/// - ``WrittenResult``
 /// - ``resultNull()``
 /// - ``resultError(_:)``
 ///
 /// ### Accessing Metadata
 /// - ``database``
+///
+/// ### Aggregate State
+/// - ``aggregateState(create:)``
+/// - ``withInlineAggregateValue(initialValue:_:)``
+/// - ``inlineAggregateValue(_:)``
+/// - ``aggregateMemory(byteCount:)``
+///
+/// ### Auxiliary Data
+/// - ``auxiliaryData(_:forArgument:)``
+/// - ``setAuxiliaryData(_:forArgument:)``
+/// - ``auxiliaryData(forArgument:create:)``
 public struct SQLiteContext: @unchecked Sendable {
     /// The underlying SQLite context pointer.
     public let pointer: OpaquePointer
 
+    /// Captures the result for a memoized function, or `nil` for any other call.
+    let recorder: SQLiteResultRecorder?
+
     /// Creates a SQLite context wrapper.
     ///
-    /// - Parameter pointer: The underlying `sqlite3_context` pointer.
-    init(_ pointer: OpaquePointer) {
+    /// - Parameters:
+    ///   - pointer: The underlying `sqlite3_context` pointer.
+    ///   - recorder: Captures every result set through the wrapper.
+    init(_ pointer: OpaquePointer, recorder: SQLiteResultRecorder? = nil) {
         self.pointer = pointer
+        self.recorder = recorder
     }
 
     /// The database connection associated with this context.
@@ -146,6 +166,101 @@ public struct SQLiteContext: @unchecked Sendable {
         return box.value
     }
 
+    /// Returns the per-group memory SQLite allocates for an aggregate.
+    ///
+    /// This is `sqlite3_aggregate_context`: the first call for a group allocates `byteCount`
+    /// zero-initialised bytes, and every later call returns the same memory whatever size is
+    /// passed. SQLite frees it automatically after `xFinal`, so it suits plain-data state of a
+    /// size that is known at the first step, such as a fixed-capacity sketch. Pass `0` to look
+    /// up the memory without allocating it, as `xFinal` should for empty groups.
+    ///
+    /// - Parameter byteCount: The size to allocate on the first call for the group.
+    /// - Returns: The group's memory, or `nil` if it does not exist yet and `byteCount` is `0`,
+    ///   or if the allocation failed.
+    public func aggregateMemory(byteCount: Int) -> UnsafeMutableRawPointer? {
+        sqlite3_aggregate_context(pointer, Int32(clamping: byteCount))
+    }
+
+    /// Accesses a plain-data aggregate value stored inline in SQLite's aggregate context.
+    ///
+    /// Unlike ``withAggregateValue(initialValue:clearOnExit:_:)``, the value is not boxed in a
+    /// class: it lives directly in the memory from `sqlite3_aggregate_context`, which SQLite
+    /// frees along with the group. There is nothing to retain or release, so the state cannot
+    /// leak when `xFinal` is skipped and no clearing is needed.
+    ///
+    /// ## Example
+    /// ```swift
+    /// step: { context, args in
+    ///     let value = args[0].doubleValue
+    ///     context.withInlineAggregateValue(initialValue: 0.0) { sum in
+    ///         sum += value
+    ///     }
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - initialValue: The value to store when the group's state is first created.
+    ///   - body: Closure that mutates the state in place.
+    /// - Returns: `false` if SQLite could not allocate the state, in which case `body` is not
+    ///   called; otherwise `true`.
+    @discardableResult
+    public func withInlineAggregateValue<State: BitwiseCopyable>(
+        initialValue: @autoclosure () -> State,
+        _ body: (inout State) throws -> Void
+    ) rethrows -> Bool {
+        guard let raw = aggregateMemory(byteCount: InlineAggregateLayout<State>.byteCount) else {
+            return false
+        }
+
+        let value = InlineAggregateLayout<State>.value(in: raw)
+        if !InlineAggregateLayout<State>.isInitialized(raw) {
+            value.initialize(to: initialValue())
+            InlineAggregateLayout<State>.markInitialized(raw)
+        }
+
+        try body(&value.pointee)
+        return true
+    }
+
+    /// Returns the inline aggregate value if the group has one, without allocating it.
+    ///
+    /// Use this from `xFinal` or `xValue` to read state written by
+    /// ``withInlineAggregateValue(initialValue:_:)``.
+    ///
+    /// - Parameter type: The value type stored in the aggregate state.
+    /// - Returns: The stored value, or `nil` if no step has run for the group.
+    public func inlineAggregateValue<State: BitwiseCopyable>(_ type: State.Type = State.self) -> State? {
+        guard let raw = aggregateMemory(byteCount: 0),
+              InlineAggregateLayout<State>.isInitialized(raw) else {
+            return nil
+        }
+        return InlineAggregateLayout<State>.value(in: raw).pointee
+    }
+
+    /// Layout of an inline aggregate value: the value itself, followed by a flag byte that
+    /// distinguishes an initialised value from SQLite's zero fill.
+    private enum InlineAggregateLayout<State: BitwiseCopyable> {
+        static var byteCount: Int {
+            precondition(
+                MemoryLayout<State>.alignment <= 8,
+                "Inline aggregate state must not need more than 8-byte alignment"
+            )
+            return MemoryLayout<State>.stride + 1
+        }
+
+        static func value(in raw: UnsafeMutableRawPointer) -> UnsafeMutablePointer<State> {
+            raw.bindMemory(to: State.self, capacity: 1)
+        }
+
+        static func isInitialized(_ raw: UnsafeMutableRawPointer) -> Bool {
+            raw.load(fromByteOffset: MemoryLayout<State>.stride, as: UInt8.self) != 0
+        }
+
+        static func markInitialized(_ raw: UnsafeMutableRawPointer) {
+            raw.storeBytes(of: 1, toByteOffset: MemoryLayout<State>.stride, as: UInt8.self)
+        }
+    }
+
     private func aggregateStateStorage(
         allocate: Bool
     ) -> UnsafeMutablePointer<AggregateStateHolder>? {
@@ -178,6 +293,78 @@ public struct SQLiteContext: @unchecked Sendable {
         }
     }
 
+    // MARK: - Auxiliary Data
+
+    /// Returns the object previously attached to an argument with ``setAuxiliaryData(_:forArgument:)``.
+    ///
+    /// SQLite keeps auxiliary data only while the argument holds the same value, which in
+    /// practice means constant arguments of a prepared statement. A non-`nil` result is
+    /// therefore always derived from the current argument value.
+    ///
+    /// - Parameters:
+    ///   - type: The expected type of the attached object.
+    ///   - index: The zero-based argument index.
+    /// - Returns: The attached object, or `nil` if none is attached or it has another type.
+    public func auxiliaryData<T: AnyObject>(_ type: T.Type = T.self, forArgument index: Int32) -> T? {
+        guard let raw = sqlite3_get_auxdata(pointer, index) else {
+            return nil
+        }
+        return Unmanaged<AnyObject>.fromOpaque(raw).takeUnretainedValue() as? T
+    }
+
+    /// Attaches an object to an argument so later calls in the same statement can reuse it.
+    ///
+    /// The object is retained by SQLite and released when the argument value changes or the
+    /// statement is finalized. Use this for state that is expensive to derive from a constant
+    /// argument, such as a compiled pattern.
+    ///
+    /// - Parameters:
+    ///   - object: The object to attach.
+    ///   - index: The zero-based argument index.
+    public func setAuxiliaryData<T: AnyObject>(_ object: T, forArgument index: Int32) {
+        sqlite3_set_auxdata(
+            pointer,
+            index,
+            Unmanaged<AnyObject>.passRetained(object).toOpaque(),
+            Self.auxiliaryDataDestructor
+        )
+    }
+
+    /// Returns the object attached to an argument, creating and attaching it if needed.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createScalarFunction(name: "matches", argumentCount: 2) { context, args in
+    ///     let pattern = try context.auxiliaryData(forArgument: 1) {
+    ///         try CompiledPattern(args[1].textValue)
+    ///     }
+    ///     context.result(Int64(pattern.matches(args[0].textValue) ? 1 : 0))
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - index: The zero-based argument index.
+    ///   - create: Builds the object from the current argument value.
+    /// - Returns: The attached or newly created object.
+    public func auxiliaryData<T: AnyObject>(
+        forArgument index: Int32,
+        create: () throws -> T
+    ) rethrows -> T {
+        if let existing = auxiliaryData(T.self, forArgument: index) {
+            return existing
+        }
+        let object = try create()
+        setAuxiliaryData(object, forArgument: index)
+        return object
+    }
+
+    private static var auxiliaryDataDestructor: @convention(c) (UnsafeMutableRawPointer?) -> Void {
+        { raw in
+            guard let raw else { return }
+            Unmanaged<AnyObject>.fromOpaque(raw).release()
+        }
+    }
+
     // MARK: - Result Methods
 
     /// Sets the result to an integer value.
@@ -193,6 +380,7 @@ public struct SQLiteContext: @unchecked Sendable {
     /// - Parameter value: The integer result to return.
     public func result(_ value: Int64) {
         sqlite3_result_int64(pointer, value)
+        recorder?.record(.integer(value))
     }
 
     /// Sets the result to a double value.
@@ -208,6 +396,7 @@ public struct SQLiteContext: @unchecked Sendable {
     /// - Parameter value: The double result to return.
     public func result(_ value: Double) {
         sqlite3_result_double(pointer, value)
+        recorder?.record(.real(value))
     }
 
     /// Sets the result to a text value.
@@ -226,6 +415,7 @@ public struct SQLiteContext: @unchecked Sendable {
             let length = Int32(value.utf8.count)
             sqlite3_result_text(pointer, cString, length, unsafeBitCast(-1, to: sqlite3_destructor_type.self))
         }
+        recorder?.record(.text(SQLiteResultBuffer(value)))
     }
 
     /// Sets the result to a blob (binary data) value.
@@ -248,6 +438,167 @@ public struct SQLiteContext: @unchecked Sendable {
                 unsafeBitCast(-1, to: sqlite3_destructor_type.self)
             )
         }
+        recorder?.record(.blob(SQLiteResultBuffer(value)))
+    }
+
+    /// Sets the result to a blob of `count` zero bytes, without allocating them.
+    ///
+    /// SQLite represents the value by its length until it has to be materialized, so a
+    /// function can reserve space for a large value that is then inserted and filled in place
+    /// with ``SQLiteBlob/write(_:at:)``. A length above the connection's `SQLITE_LIMIT_LENGTH`
+    /// makes the result a "string or blob too big" error.
+    ///
+    /// - Parameter count: The length of the blob.
+    public func resultZeroBlob(count: Int) {
+        _ = sqlite3_result_zeroblob64(pointer, sqlite3_uint64(max(count, 0)))
+        recorder?.record(.zeroBlob(max(count, 0)))
+    }
+
+    /// Sets the result to text held in a ``SQLiteResultBuffer`` without copying it.
+    ///
+    /// The buffer is retained until SQLite no longer needs the value, so the same buffer can
+    /// back many results.
+    ///
+    /// - Parameter buffer: UTF-8 encoded text.
+    public func result(text buffer: SQLiteResultBuffer) {
+        sqlite3_result_text64(
+            pointer,
+            buffer.retainedPayload().assumingMemoryBound(to: CChar.self),
+            sqlite3_uint64(buffer.count),
+            SQLiteResultBuffer.sqliteDestructor,
+            UInt8(SQLITE_UTF8)
+        )
+        recorder?.record(.text(buffer))
+    }
+
+    /// Sets the result to a blob held in a ``SQLiteResultBuffer`` without copying it.
+    ///
+    /// The buffer is retained until SQLite no longer needs the value, so the same buffer can
+    /// back many results.
+    ///
+    /// - Parameter buffer: The blob bytes.
+    public func result(blob buffer: SQLiteResultBuffer) {
+        sqlite3_result_blob64(
+            pointer,
+            buffer.retainedPayload(),
+            sqlite3_uint64(buffer.count),
+            SQLiteResultBuffer.sqliteDestructor
+        )
+        recorder?.record(.blob(buffer))
+    }
+
+    /// Whether a result written by ``result(capacity:initializingWith:)`` is text or a blob.
+    public enum WrittenResult: Sendable {
+        /// `count` bytes of UTF-8 text.
+        case text(count: Int)
+
+        /// A blob of `count` bytes.
+        case blob(count: Int)
+    }
+
+    /// Sets the result to bytes written directly into memory that SQLite takes over.
+    ///
+    /// `body` receives `capacity` bytes from `sqlite3_malloc64` and reports how many it
+    /// initialised and whether they are text or a blob. SQLite adopts the allocation with
+    /// `sqlite3_free` as its destructor, so a value computed per row, such as an encoding,
+    /// costs one allocation and no copy. Prefer ``SQLiteResultBuffer`` for a value
+    /// returned many times.
+    ///
+    /// Return `nil` to discard the memory without setting a result, for example after
+    /// calling ``resultError(_:)``. If allocation fails the result is `SQLITE_NOMEM` and
+    /// `body` is not called.
+    ///
+    /// ## Example
+    /// ```swift
+    /// args[0].withBlobBytes { bytes in
+    ///     context.result(capacity: bytes.count) { output in
+    ///         for (index, byte) in bytes.enumerated() {
+    ///             output[index] = byte ^ 0x5A
+    ///         }
+    ///         return .blob(count: bytes.count)
+    ///     }
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - capacity: The number of bytes `body` may write.
+    ///   - body: Writes the result and returns its storage class and length.
+    public func result(
+        capacity: Int,
+        initializingWith body: (UnsafeMutableRawBufferPointer) throws -> WrittenResult?
+    ) rethrows {
+        let capacity = max(capacity, 0)
+        guard let memory = sqlite3_malloc64(sqlite3_uint64(max(capacity, 1))) else {
+            sqlite3_result_error_nomem(pointer)
+            recorder?.recordError()
+            return
+        }
+
+        let written: WrittenResult?
+        do {
+            written = try body(UnsafeMutableRawBufferPointer(start: memory, count: capacity))
+        } catch {
+            sqlite3_free(memory)
+            throw error
+        }
+
+        switch written {
+        case .text(let count)?:
+            precondition(count >= 0 && count <= capacity, "SQLiteContext result overflow")
+            recorder?.record(.text(SQLiteResultBuffer(copying: UnsafeRawBufferPointer(start: memory, count: count))))
+            sqlite3_result_text64(
+                pointer,
+                memory.assumingMemoryBound(to: CChar.self),
+                sqlite3_uint64(count),
+                sqlite3_free,
+                UInt8(SQLITE_UTF8)
+            )
+        case .blob(let count)?:
+            precondition(count >= 0 && count <= capacity, "SQLiteContext result overflow")
+            recorder?.record(.blob(SQLiteResultBuffer(copying: UnsafeRawBufferPointer(start: memory, count: count))))
+            sqlite3_result_blob64(pointer, memory, sqlite3_uint64(count), sqlite3_free)
+        case nil:
+            sqlite3_free(memory)
+        }
+    }
+
+    /// Sets the result to UTF-8 text that SQLite references in place (`SQLITE_STATIC`).
+    ///
+    /// See ``SQLiteStaticBytes`` for the lifetime the caller must guarantee.
+    ///
+    /// - Parameter text: UTF-8 encoded text bytes.
+    public func result(staticText text: SQLiteStaticBytes) {
+        guard let base = text.bytes.baseAddress, !text.bytes.isEmpty else {
+            result("")
+            return
+        }
+        sqlite3_result_text64(
+            pointer,
+            base.assumingMemoryBound(to: CChar.self),
+            sqlite3_uint64(text.bytes.count),
+            nil,
+            UInt8(SQLITE_UTF8)
+        )
+        recorder?.record(.text(SQLiteResultBuffer(copying: text.bytes)))
+    }
+
+    /// Sets the result to a blob that SQLite references in place (`SQLITE_STATIC`).
+    ///
+    /// See ``SQLiteStaticBytes`` for the lifetime the caller must guarantee.
+    ///
+    /// - Parameter blob: The blob bytes.
+    public func result(staticBlob blob: SQLiteStaticBytes) {
+        guard let base = blob.bytes.baseAddress, !blob.bytes.isEmpty else {
+            resultZeroBlob(count: 0)
+            return
+        }
+        sqlite3_result_blob64(
+            pointer,
+            base,
+            sqlite3_uint64(blob.bytes.count),
+            nil
+        )
+        recorder?.record(.blob(SQLiteResultBuffer(copying: blob.bytes)))
     }
 
     /// Sets the result to NULL.
@@ -264,6 +615,7 @@ public struct SQLiteContext: @unchecked Sendable {
     /// ```
     public func resultNull() {
         sqlite3_result_null(pointer)
+        recorder?.record(.null)
     }
 
     /// Sets the result to an error with the given message.
@@ -285,6 +637,7 @@ public struct SQLiteContext: @unchecked Sendable {
         message.withCString { cString in
             sqlite3_result_error(pointer, cString, -1)
         }
+        recorder?.recordError()
     }
 
     /// Sets the result to an error code.
@@ -292,5 +645,6 @@ public struct SQLiteContext: @unchecked Sendable {
     /// - Parameter code: The SQLite error code to return.
     public func resultErrorCode(_ code: Int32) {
         sqlite3_result_error_code(pointer, code)
+        recorder?.recordError()
     }
 }
@@ -17,6 +17,9 @@ public enum SQLiteExtensionError: Error, Sendable {
 ///
 /// Scalar functions take zero or more arguments and return a single value.
 ///
+/// This array-based form is kept for compatibility. Each invocation copies the
+/// arguments into a new `[SQLiteValue]`; prefer ``BorrowingScalarFunction`` on hot paths.
+///
 /// ## Example
 /// ```swift
 /// let upperFunc: ScalarFunction = { context, args in
@@ -29,11 +32,36 @@ public enum SQLiteExtensionError: Error, Sendable {
 /// ```
 public typealias ScalarFunction = @Sendable (SQLiteContext, [SQLiteValue]) throws -> Void
 
+/// A type that represents a SQLite scalar function receiving borrowed arguments.
+///
+/// The arguments are a non-owning ``SQLiteArguments`` view over SQLite's `argv`, so no
+/// array is allocated per call. The view must not escape the function.
+///
+/// ## Example
+/// ```swift
+/// let upperFunc: BorrowingScalarFunction = { context, args in
+///     guard let first = args.first else {
+///         context.resultNull()
+///         return
+///     }
+///     context.result(first.textValue.uppercased())
+/// }
+/// ```
+public typealias BorrowingScalarFunction = @Sendable (SQLiteContext, SQLiteArguments) throws -> Void
+
 /// A type that represents the step function for a SQLite aggregate.
 ///
 /// The step function is called once for each row in the aggregation.
+///
+/// This array-based form is kept for compatibility; prefer ``BorrowingAggregateStepFunction``.
 public typealias AggregateStepFunction = @Sendable (SQLiteContext, [SQLiteValue]) throws -> Void
 
+/// A type that represents the step function for a SQLite aggregate receiving borrowed arguments.
+///
+/// The step function is called once for each row in the aggregation. The arguments view
+/// must not escape the call.
+public typealias BorrowingAggregateStepFunction = @Sendable (SQLiteContext, SQLiteArguments) throws -> Void
+
 /// A type that represents the finalize function for a SQLite aggregate.
 ///
 /// The finalize function is called once at the end of the aggregation to compute the final result.
@@ -70,63 +98,75 @@ public struct SQLiteDatabase: @unchecked Sendable {
     ///   - name: The name of the function as it will be used in SQL.
     ///   - argumentCount: The number of arguments the function accepts. Use -1 for variable arguments.
     ///   - deterministic: Whether the function always returns the same result for the same inputs.
-    ///   - function: The function implementation.
-    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    ///   - memoize: A cache for the function's results on this connection, or `nil` to call
+    ///     it every time. Requires `deterministic`; see ``SQLiteMemoization``.
+    ///   - function: The function implementation. It receives a borrowed view over the
+    ///     arguments that is only valid for the duration of the call.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails, or with `SQLITE_MISUSE` if
+    ///   `memoize` is given for a function that is not deterministic.
     public func createScalarFunction(
         name: String,
         argumentCount: Int32 = -1,
         deterministic: Bool = false,
-        function: @escaping ScalarFunction
+        memoize: SQLiteMemoization? = nil,
+        function: @escaping BorrowingScalarFunction
     ) throws {
-        let box = FunctionBox(function: function)
-        let userData = Unmanaged.passRetained(box).toOpaque()
+        if memoize != nil && !deterministic {
+            throw SQLiteExtensionError.functionRegistrationFailed(name: name, code: SQLITE_MISUSE)
+        }
 
         var flags = SQLITE_UTF8
         if deterministic {
             flags |= SQLITE_DETERMINISTIC
         }
 
-        let result = sqlite3_create_function_v2(
-            pointer,
-            name,
-            argumentCount,
-            flags,
-            userData,
-            { contextPtr, argc, argv in
-                guard let contextPtr = contextPtr,
-                      let argv = argv else {
-                    return
-                }
-
-                let context = SQLiteContext(contextPtr)
-                let userData = sqlite3_user_data(contextPtr)
-                let box = Unmanaged<FunctionBox>.fromOpaque(userData!).takeUnretainedValue()
-
-                var args: [SQLiteValue] = []
-                for i in 0..<Int(argc) {
-                    args.append(SQLiteValue(argv[i]!))
-                }
-
-                do {
-                    try box.function(context, args)
-                } catch {
-                    context.resultError("Function error: \(error)")
-                }
-            },
-            nil,
-            nil,
-            { userData in
-                guard let userData = userData else { return }
-                Unmanaged<FunctionBox>.fromOpaque(userData).release()
-            }
+        let result = createFunction(
+            name: name,
+            argumentCount: argumentCount,
+            flags: flags,
+            kind: .scalar,
+            box: FunctionBox(name: name, function: function, memoization: memoize)
         )
-
         if result != SQLITE_OK {
-            Unmanaged<FunctionBox>.fromOpaque(userData).release()
             throw SQLiteExtensionError.functionRegistrationFailed(name: name, code: result)
         }
     }
 
+    /// Registers a scalar function that receives its arguments as an array.
+    ///
+    /// This overload exists for compatibility with ``ScalarFunction`` values. The arguments
+    /// are copied into a new array on every call; closures written inline resolve to the
+    /// borrowing overload instead.
+    ///
+    /// - Parameters:
+    ///   - name: The name of the function as it will be used in SQL.
+    ///   - argumentCount: The number of arguments the function accepts. Use -1 for variable arguments.
+    ///   - deterministic: Whether the function always returns the same result for the same inputs.
+    ///   - memoize: A cache for the function's results on this connection, or `nil` to call
+    ///     it every time. Requires `deterministic`; see ``SQLiteMemoization``.
+    ///   - function: The function implementation.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails, or with `SQLITE_MISUSE` if
+    ///   `memoize` is given for a function that is not deterministic.
+    @_disfavoredOverload
+    public func createScalarFunction(
+        name: String,
+        argumentCount: Int32 = -1,
+        deterministic: Bool = false,
+        memoize: SQLiteMemoization? = nil,
+        function: @escaping ScalarFunction
+    ) throws {
+        let borrowing: BorrowingScalarFunction = { context, args in
+            try function(context, Array(args))
+        }
+        try createScalarFunction(
+            name: name,
+            argumentCount: argumentCount,
+            deterministic: deterministic,
+            memoize: memoize,
+            function: borrowing
+        )
+    }
+
     /// Registers an aggregate function with the database.
     ///
     /// Aggregate functions process multiple rows and return a single result.
@@ -159,67 +199,123 @@ public struct SQLiteDatabase: @unchecked Sendable {
     /// - Parameters:
     ///   - name: The name of the aggregate function.
     ///   - argumentCount: The number of arguments the function accepts.
+    ///   - step: The step function called for each row. It receives a borrowed view over
+    ///     the arguments that is only valid for the duration of the call.
+    ///   - final: The finalize function called to compute the result.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func createAggregateFunction(
+        name: String,
+        argumentCount: Int32 = -1,
+        step: @escaping BorrowingAggregateStepFunction,
+        final: @escaping AggregateFinalFunction
+    ) throws {
+        let result = createFunction(
+            name: name,
+            argumentCount: argumentCount,
+            flags: SQLITE_UTF8,
+            kind: .aggregate,
+            box: AggregateFunctionBox(name: name, step: step, final: final)
+        )
+        if result != SQLITE_OK {
+            throw SQLiteExtensionError.functionRegistrationFailed(name: name, code: result)
+        }
+    }
+
+    /// Registers an aggregate function whose step receives its arguments as an array.
+    ///
+    /// This overload exists for compatibility with ``AggregateStepFunction`` values. The
+    /// arguments are copied into a new array on every step.
+    ///
+    /// - Parameters:
+    ///   - name: The name of the aggregate function.
+    ///   - argumentCount: The number of arguments the function accepts.
     ///   - step: The step function called for each row.
     ///   - final: The finalize function called to compute the result.
     /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    @_disfavoredOverload
     public func createAggregateFunction(
         name: String,
         argumentCount: Int32 = -1,
         step: @escaping AggregateStepFunction,
         final: @escaping AggregateFinalFunction
     ) throws {
-        let box = AggregateFunctionBox(step: step, final: final)
-        let userData = Unmanaged.passRetained(box).toOpaque()
-
-        let result = sqlite3_create_function_v2(
-            pointer,
-            name,
-            argumentCount,
-            SQLITE_UTF8,
-            userData,
-            nil,
-            { contextPtr, argc, argv in
-                guard let contextPtr = contextPtr,
-                      let argv = argv else {
-                    return
-                }
-
-                let context = SQLiteContext(contextPtr)
-                let userData = sqlite3_user_data(contextPtr)
-                let box = Unmanaged<AggregateFunctionBox>.fromOpaque(userData!).takeUnretainedValue()
-
-                var args: [SQLiteValue] = []
-                for i in 0..<Int(argc) {
-                    args.append(SQLiteValue(argv[i]!))
-                }
-
-                do {
-                    try box.step(context, args)
-                } catch {
-                    context.resultError("Aggregate step error: \(error)")
-                }
-            },
-            { contextPtr in
-                guard let contextPtr = contextPtr else { return }
-
-                let context = SQLiteContext(contextPtr)
-                let userData = sqlite3_user_data(contextPtr)
-                let box = Unmanaged<AggregateFunctionBox>.fromOpaque(userData!).takeUnretainedValue()
-
-                do {
-                    try box.final(context)
-                } catch {
-                    context.resultError("Aggregate final error: \(error)")
-                }
-            },
-            { userData in
-                guard let userData = userData else { return }
-                Unmanaged<AggregateFunctionBox>.fromOpaque(userData).release()
-            }
+        let borrowing: BorrowingAggregateStepFunction = { context, args in
+            try step(context, Array(args))
+        }
+        try createAggregateFunction(
+            name: name,
+            argumentCount: argumentCount,
+            step: borrowing,
+            final: final
         )
+    }
 
+    /// Registers an aggregate window function with the database.
+    ///
+    /// Window functions extend aggregates with `value` and `inverse` callbacks so SQLite can
+    /// slide a frame incrementally: `step` adds the row entering the frame, `inverse` removes
+    /// the row leaving it, and `value` reports the current result without finalising. The
+    /// function can still be used as a plain aggregate, in which case only `step` and `final`
+    /// are called.
+    ///
+    /// State is shared between the callbacks through ``SQLiteContext/aggregateState(create:)``
+    /// or ``SQLiteContext/withAggregateValue(initialValue:clearOnExit:_:)``. Only `final`
+    /// should clear it.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createWindowFunction(
+    ///     name: "sum_window",
+    ///     argumentCount: 1,
+    ///     step: { context, args in
+    ///         let value = args[0].doubleValue
+    ///         context.withAggregateValue(initialValue: 0.0) { $0 += value }
+    ///     },
+    ///     inverse: { context, args in
+    ///         let value = args[0].doubleValue
+    ///         context.withAggregateValue(initialValue: 0.0) { $0 -= value }
+    ///     },
+    ///     value: { context in
+    ///         if !context.withExistingAggregateValue(Double.self, { context.result($0) }) {
+    ///             context.resultNull()
+    ///         }
+    ///     },
+    ///     final: { context in
+    ///         if !context.withExistingAggregateValue(Double.self, clearOnExit: true, { context.result($0) }) {
+    ///             context.resultNull()
+    ///         }
+    ///     }
+    /// )
+    /// ```
+    ///
+    /// ```sql
+    /// SELECT sum_window(x) OVER (ORDER BY id ROWS BETWEEN 99 PRECEDING AND CURRENT ROW) FROM t;
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The name of the window function.
+    ///   - argumentCount: The number of arguments the function accepts.
+    ///   - step: Called for each row added to the current frame.
+    ///   - inverse: Called for each row removed from the current frame.
+    ///   - value: Called to return the result for the current frame.
+    ///   - final: Called once after the last frame to return the result and release state.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func createWindowFunction(
+        name: String,
+        argumentCount: Int32 = -1,
+        step: @escaping BorrowingAggregateStepFunction,
+        inverse: @escaping BorrowingAggregateStepFunction,
+        value: @escaping AggregateFinalFunction,
+        final: @escaping AggregateFinalFunction
+    ) throws {
+        let result = createFunction(
+            name: name,
+            argumentCount: argumentCount,
+            flags: SQLITE_UTF8,
+            kind: .window,
+            box: WindowFunctionBox(name: name, step: step, inverse: inverse, value: value, final: final)
+        )
         if result != SQLITE_OK {
-            Unmanaged<AggregateFunctionBox>.fromOpaque(userData).release()
             throw SQLiteExtensionError.functionRegistrationFailed(name: name, code: result)
         }
     }
@@ -234,51 +330,256 @@ public struct SQLiteDatabase: @unchecked Sendable {
         name: String,
         module: Module.Type = Module.self
     ) throws {
-        let descriptor = VirtualTableModuleDescriptor(
-            name: name,
-            adapter: VirtualTableModuleAdapter<Module>()
+        try registerModule(
+            VirtualTableModuleDescriptor(name: name, adapter: VirtualTableModuleAdapter<Module>()),
+            eponymous: false
         )
+    }
 
+    /// Registers a type-erased module, as an eponymous-only module when `eponymous` is set.
+    func registerModule(_ descriptor: VirtualTableModuleDescriptor, eponymous: Bool) throws {
         let context = Unmanaged.passRetained(descriptor).toOpaque()
-        let destroy: @convention(c) (UnsafeMutableRawPointer?) -> Void = { pointer in
-            guard let pointer else { return }
-            Unmanaged<VirtualTableModuleDescriptor>.fromOpaque(pointer).release()
-        }
 
-        let result = name.withCString { cName in
-            SQLiteExtensionKit_CreateVirtualTableModule(
-                pointer,
-                cName,
-                context,
-                destroy
-            )
+        // SQLite invokes the destructor itself when registration fails, so the descriptor
+        // is not released again on the error path.
+        let result = descriptor.name.withCString { cName in
+            eponymous
+                ? SQLiteExtensionKit_CreateEponymousVirtualTableModule(pointer, cName, context, releaseBoxedObject)
+                : SQLiteExtensionKit_CreateVirtualTableModule(pointer, cName, context, releaseBoxedObject)
         }
 
         if result != SQLITE_OK {
-            Unmanaged<VirtualTableModuleDescriptor>.fromOpaque(context).release()
             throw SQLiteExtensionError.sqliteError(code: result)
         }
     }
+
+    /// Registers the callbacks of one kind of boxed function, handing SQLite a new
+    /// reference to `box` that it releases when the function is replaced or the
+    /// connection closes.
+    ///
+    /// SQLite also invokes the destructor when registration fails, so callers must not
+    /// release the reference themselves.
+    ///
+    /// - Returns: The SQLite result code.
+    func createFunction(
+        name: UnsafePointer<CChar>,
+        argumentCount: Int32,
+        flags: Int32,
+        kind: FunctionKind,
+        box: AnyObject
+    ) -> Int32 {
+        let userData = Unmanaged.passRetained(box).toOpaque()
+        switch kind {
+        case .scalar:
+            return sqlite3_create_function_v2(
+                pointer, name, argumentCount, flags, userData,
+                scalarFunctionCallback, nil, nil, releaseBoxedObject
+            )
+        case .aggregate:
+            return sqlite3_create_function_v2(
+                pointer, name, argumentCount, flags, userData,
+                nil, aggregateStepCallback, aggregateFinalCallback, releaseBoxedObject
+            )
+        case .window:
+            return sqlite3_create_window_function(
+                pointer, name, argumentCount, flags, userData,
+                windowStepCallback, windowFinalCallback, windowValueCallback, windowInverseCallback,
+                releaseBoxedObject
+            )
+        }
+    }
 }
 
 // MARK: - Internal Support Types
 
+/// The set of callbacks a boxed function is registered with.
+enum FunctionKind {
+    /// `xFunc`, with a ``FunctionBox``.
+    case scalar
+
+    /// `xStep` and `xFinal`, with an ``AggregateFunctionBox``.
+    case aggregate
+
+    /// `xStep`, `xFinal`, `xValue` and `xInverse`, with a ``WindowFunctionBox``.
+    case window
+}
+
+// Each callback finds its closures in the box passed as the function's user data, so
+// the same C function pointers serve every registration.
+
+func scalarFunctionCallback(
+    _ contextPtr: OpaquePointer?,
+    _ argc: Int32,
+    _ argv: UnsafeMutablePointer<OpaquePointer?>?
+) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<FunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.probe) {
+            let arguments = SQLiteArguments(argv, count: argc)
+            if let memo = box.memo {
+                try memo.call(box.function, context: context, arguments: arguments)
+            } else {
+                try box.function(context, arguments)
+            }
+        }
+    } catch {
+        context.resultError("Function error: \(error)")
+    }
+}
+
+func aggregateStepCallback(
+    _ contextPtr: OpaquePointer?,
+    _ argc: Int32,
+    _ argv: UnsafeMutablePointer<OpaquePointer?>?
+) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<AggregateFunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.stepProbe) { try box.step(context, SQLiteArguments(argv, count: argc)) }
+    } catch {
+        context.resultError("Aggregate step error: \(error)")
+    }
+}
+
+func aggregateFinalCallback(_ contextPtr: OpaquePointer?) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<AggregateFunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.finalProbe) { try box.final(context) }
+    } catch {
+        context.resultError("Aggregate final error: \(error)")
+    }
+}
+
+func windowStepCallback(
+    _ contextPtr: OpaquePointer?,
+    _ argc: Int32,
+    _ argv: UnsafeMutablePointer<OpaquePointer?>?
+) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<WindowFunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.stepProbe) { try box.step(context, SQLiteArguments(argv, count: argc)) }
+    } catch {
+        context.resultError("Window step error: \(error)")
+    }
+}
+
+func windowInverseCallback(
+    _ contextPtr: OpaquePointer?,
+    _ argc: Int32,
+    _ argv: UnsafeMutablePointer<OpaquePointer?>?
+) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<WindowFunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.inverseProbe) { try box.inverse(context, SQLiteArguments(argv, count: argc)) }
+    } catch {
+        context.resultError("Window inverse error: \(error)")
+    }
+}
+
+func windowValueCallback(_ contextPtr: OpaquePointer?) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<WindowFunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.valueProbe) { try box.value(context) }
+    } catch {
+        context.resultError("Window value error: \(error)")
+    }
+}
+
+func windowFinalCallback(_ contextPtr: OpaquePointer?) {
+    guard let contextPtr else { return }
+
+    let context = SQLiteContext(contextPtr)
+    let box = Unmanaged<WindowFunctionBox>.fromOpaque(sqlite3_user_data(contextPtr)!).takeUnretainedValue()
+
+    do {
+        try instrumented(box.finalProbe) { try box.final(context) }
+    } catch {
+        context.resultError("Window final error: \(error)")
+    }
+}
+
+/// Releases the reference passed to SQLite as a function's or module's user data.
+func releaseBoxedObject(_ pointer: UnsafeMutableRawPointer?) {
+    guard let pointer else { return }
+    Unmanaged<AnyObject>.fromOpaque(pointer).release()
+}
+
 /// Box to hold scalar function closures
 final class FunctionBox: @unchecked Sendable {
-    let function: ScalarFunction
+    let function: BorrowingScalarFunction
+    let probe: InstrumentationProbe?
+    let memo: FunctionMemo?
 
-    init(function: @escaping ScalarFunction) {
+    init(name: String, function: @escaping BorrowingScalarFunction, memoization: SQLiteMemoization? = nil) {
         self.function = function
+        self.probe = SQLiteInstrumentation.probe(name: name, callback: "function")
+        self.memo = memoization.map { FunctionMemo(name: name, memoization: $0) }
     }
 }
 
 /// Box to hold aggregate function closures
 final class AggregateFunctionBox: @unchecked Sendable {
-    let step: AggregateStepFunction
+    let step: BorrowingAggregateStepFunction
+    let final: AggregateFinalFunction
+    let stepProbe: InstrumentationProbe?
+    let finalProbe: InstrumentationProbe?
+
+    init(name: String, step: @escaping BorrowingAggregateStepFunction, final: @escaping AggregateFinalFunction) {
+        self.step = step
+        self.final = final
+        self.stepProbe = SQLiteInstrumentation.probe(name: name, callback: "step")
+        self.finalProbe = SQLiteInstrumentation.probe(name: name, callback: "final")
+    }
+}
+
+/// Box to hold window function closures
+final class WindowFunctionBox: @unchecked Sendable {
+    let step: BorrowingAggregateStepFunction
+    let inverse: BorrowingAggregateStepFunction
+    let value: AggregateFinalFunction
     let final: AggregateFinalFunction
+    let stepProbe: InstrumentationProbe?
+    let inverseProbe: InstrumentationProbe?
+    let valueProbe: InstrumentationProbe?
+    let finalProbe: InstrumentationProbe?
 
-    init(step: @escaping AggregateStepFunction, final: @escaping AggregateFinalFunction) {
+    init(
+        name: String,
+        step: @escaping BorrowingAggregateStepFunction,
+        inverse: @escaping BorrowingAggregateStepFunction,
+        value: @escaping AggregateFinalFunction,
+        final: @escaping AggregateFinalFunction
+    ) {
         self.step = step
+        self.inverse = inverse
+        self.value = value
         self.final = final
+        self.stepProbe = SQLiteInstrumentation.probe(name: name, callback: "step")
+        self.inverseProbe = SQLiteInstrumentation.probe(name: name, callback: "inverse")
+        self.valueProbe = SQLiteInstrumentation.probe(name: name, callback: "value")
+        self.finalProbe = SQLiteInstrumentation.probe(name: name, callback: "final")
     }
 }
@@ -55,13 +55,19 @@
 /// - ``SQLiteDatabase``
 ///
 /// ### Function Types
+/// - ``BorrowingScalarFunction``
+/// - ``BorrowingAggregateStepFunction``
 /// - ``ScalarFunction``
 /// - ``AggregateStepFunction``
 /// - ``AggregateFinalFunction``
 ///
 /// ### Working with Values
 /// - ``SQLiteValue``
+/// - ``SQLiteArguments``
 /// - ``SQLiteContext``
+/// - ``SQLiteResultBuffer``
+/// - ``SQLiteStaticBytes``
+/// - ``SQLiteLRUCache``
 ///
 /// ### Error Handling
 /// - ``SQLiteExtensionError``
@@ -0,0 +1,339 @@
+import CSQLite
+
+// MARK: - Function Registry
+
+/// An immutable set of functions, collations and virtual table modules, built once and
+/// registered on any number of connections.
+///
+/// Registering through ``SQLiteDatabase`` creates new boxes for the closures of every
+/// function on every connection. A registry creates them once, when it is built, and
+/// shares them read-only between connections: ``register(with:lazily:)`` is a loop of
+/// `sqlite3_create_function_v2` calls that hand SQLite another reference to an existing
+/// box and a precomputed C name, so it performs no Swift allocation per function.
+///
+/// A registry is immutable after initialization, so it can be registered from any thread.
+/// Store it in a `static let` so it is built on first use and lives for the process.
+///
+/// ## Example
+/// ```swift
+/// public struct MyExtension: SQLiteExtensionModule {
+///     public static let name = "my_extension"
+///
+///     static let registry = SQLiteFunctionRegistry { functions in
+///         functions.createScalarFunction(name: "double_it", argumentCount: 1, deterministic: true) { context, args in
+///             context.result(args[0].intValue * 2)
+///         }
+///         functions.createCollation(name: "length") { lhs, rhs in
+///             Int32(clamping: lhs.count - rhs.count)
+///         }
+///     }
+///
+///     public static func register(with db: SQLiteDatabase) throws {
+///         try registry.register(with: db, lazily: true)
+///     }
+/// }
+/// ```
+///
+/// ## Topics
+///
+/// ### Building a Registry
+/// - ``init(_:)``
+/// - ``Builder``
+///
+/// ### Registering
+/// - ``register(with:lazily:)``
+public final class SQLiteFunctionRegistry: @unchecked Sendable {
+    /// Collects the contents of a registry.
+    ///
+    /// The methods mirror the registration methods of ``SQLiteDatabase``, so an extension's
+    /// `register(with:)` body can move into a registry unchanged apart from the receiver.
+    public struct Builder {
+        fileprivate var functions: [FunctionEntry] = []
+        fileprivate var collations: [CollationEntry] = []
+        fileprivate var modules: [(descriptor: VirtualTableModuleDescriptor, eponymous: Bool)] = []
+
+        fileprivate init() {}
+
+        /// Adds a scalar function.
+        ///
+        /// See ``SQLiteDatabase/createScalarFunction(name:argumentCount:deterministic:memoize:function:)``.
+        ///
+        /// A registry installs the same function on every connection, so a `memoize` cache
+        /// is shared by all of them and its capacity should be sized for that.
+        ///
+        /// - Precondition: `memoize` is only given for a deterministic function.
+        public mutating func createScalarFunction(
+            name: String,
+            argumentCount: Int32 = -1,
+            deterministic: Bool = false,
+            memoize: SQLiteMemoization? = nil,
+            function: @escaping BorrowingScalarFunction
+        ) {
+            precondition(memoize == nil || deterministic, "Memoized function \(name) must be deterministic")
+            var flags = SQLITE_UTF8
+            if deterministic {
+                flags |= SQLITE_DETERMINISTIC
+            }
+            functions.append(
+                FunctionEntry(
+                    name: name,
+                    argumentCount: argumentCount,
+                    flags: flags,
+                    kind: .scalar,
+                    box: FunctionBox(name: name, function: function, memoization: memoize)
+                )
+            )
+        }
+
+        /// Adds an aggregate function.
+        ///
+        /// See ``SQLiteDatabase/createAggregateFunction(name:argumentCount:step:final:)``.
+        public mutating func createAggregateFunction(
+            name: String,
+            argumentCount: Int32 = -1,
+            step: @escaping BorrowingAggregateStepFunction,
+            final: @escaping AggregateFinalFunction
+        ) {
+            functions.append(
+                FunctionEntry(
+                    name: name,
+                    argumentCount: argumentCount,
+                    flags: SQLITE_UTF8,
+                    kind: .aggregate,
+                    box: AggregateFunctionBox(name: name, step: step, final: final)
+                )
+            )
+        }
+
+        /// Adds a ``MergeableAggregate`` as an aggregate function.
+        ///
+        /// See ``SQLiteDatabase/createAggregateFunction(name:argumentCount:aggregate:)``.
+        public mutating func createAggregateFunction<Aggregate: MergeableAggregate>(
+            name: String,
+            argumentCount: Int32 = -1,
+            aggregate: Aggregate.Type
+        ) {
+            functions.append(
+                FunctionEntry(
+                    name: name,
+                    argumentCount: argumentCount,
+                    flags: SQLITE_UTF8,
+                    kind: .aggregate,
+                    box: AggregateFunctionBox(name: name, aggregate: aggregate)
+                )
+            )
+        }
+
+        /// Adds an aggregate window function.
+        ///
+        /// See ``SQLiteDatabase/createWindowFunction(name:argumentCount:step:inverse:value:final:)``.
+        public mutating func createWindowFunction(
+            name: String,
+            argumentCount: Int32 = -1,
+            step: @escaping BorrowingAggregateStepFunction,
+            inverse: @escaping BorrowingAggregateStepFunction,
+            value: @escaping AggregateFinalFunction,
+            final: @escaping AggregateFinalFunction
+        ) {
+            functions.append(
+                FunctionEntry(
+                    name: name,
+                    argumentCount: argumentCount,
+                    flags: SQLITE_UTF8,
+                    kind: .window,
+                    box: WindowFunctionBox(name: name, step: step, inverse: inverse, value: value, final: final)
+                )
+            )
+        }
+
+        /// Adds a collating sequence over UTF-8 text.
+        ///
+        /// - Parameters:
+        ///   - name: The collation name as used in `COLLATE name`.
+        ///   - compare: Compares the bytes of two values, returning a negative number, zero
+        ///     or a positive number when the first sorts before, with or after the second.
+        public mutating func createCollation(
+            name: String,
+            compare: @escaping @Sendable (UnsafeRawBufferPointer, UnsafeRawBufferPointer) -> Int32
+        ) {
+            collations.append(CollationEntry(name: name, box: CollationBox(compare: compare)))
+        }
+
+        /// Adds a virtual table module.
+        ///
+        /// See ``SQLiteDatabase/registerVirtualTableModule(name:module:)``.
+        public mutating func registerVirtualTableModule<Module: VirtualTableModule>(
+            name: String,
+            module: Module.Type = Module.self
+        ) {
+            modules.append(
+                (VirtualTableModuleDescriptor(name: name, adapter: VirtualTableModuleAdapter<Module>()), false)
+            )
+        }
+    }
+
+    private let functions: [FunctionEntry]
+    private let collations: [CollationEntry]
+    private let collationsByName: [String: Int]
+    private let modules: [(descriptor: VirtualTableModuleDescriptor, eponymous: Bool)]
+
+    /// Builds a registry.
+    ///
+    /// - Parameter build: Adds the registry's contents to the builder.
+    public init(_ build: (inout Builder) throws -> Void) rethrows {
+        var builder = Builder()
+        try build(&builder)
+        functions = builder.functions
+        collations = builder.collations
+        modules = builder.modules
+
+        // A later collation with the same name replaces an earlier one, as it would if
+        // both were registered with SQLite.
+        var collationsByName: [String: Int] = [:]
+        for (index, collation) in collations.enumerated() {
+            collationsByName[collation.key] = index
+        }
+        self.collationsByName = collationsByName
+    }
+
+    /// Registers the registry's contents on a connection.
+    ///
+    /// Functions and modules are always registered immediately: SQLite resolves function
+    /// names while preparing a statement and has no hook for a missing one, so they must
+    /// exist before the first statement that uses them.
+    ///
+    /// Collations can be registered on first use instead. With `lazily` set, the registry
+    /// installs itself as the connection's `sqlite3_collation_needed` callback, replacing
+    /// any earlier one, and registers a collation when a statement first names it. The
+    /// callback does not retain the registry, which must outlive the connection.
+    ///
+    /// - Parameters:
+    ///   - db: The connection to register with.
+    ///   - lazily: Whether to defer registering collations until they are first used.
+    /// - Throws: ``SQLiteExtensionError`` if a registration fails; anything registered
+    ///   before the failure stays registered.
+    public func register(with db: SQLiteDatabase, lazily: Bool = false) throws {
+        for function in functions {
+            let result = function.cName.withUnsafeBufferPointer { name in
+                db.createFunction(
+                    name: name.baseAddress!,
+                    argumentCount: function.argumentCount,
+                    flags: function.flags,
+                    kind: function.kind,
+                    box: function.box
+                )
+            }
+            if result != SQLITE_OK {
+                throw SQLiteExtensionError.functionRegistrationFailed(name: function.name, code: result)
+            }
+        }
+
+        for module in modules {
+            try db.registerModule(module.descriptor, eponymous: module.eponymous)
+        }
+
+        if lazily {
+            let result = sqlite3_collation_needed(
+                db.pointer,
+                Unmanaged.passUnretained(self).toOpaque(),
+                collationNeededCallback
+            )
+            if result != SQLITE_OK {
+                throw SQLiteExtensionError.sqliteError(code: result)
+            }
+        } else {
+            for collation in collations {
+                let result = collation.register(with: db.pointer)
+                if result != SQLITE_OK {
+                    throw SQLiteExtensionError.functionRegistrationFailed(name: collation.name, code: result)
+                }
+            }
+        }
+    }
+
+    /// Registers the collation named `name`, if the registry has one.
+    fileprivate func registerCollation(named name: String, with db: OpaquePointer) {
+        guard let index = collationsByName[name.lowercased()] else { return }
+        _ = collations[index].register(with: db)
+    }
+}
+
+/// A function of a registry, with its name already converted for SQLite.
+private struct FunctionEntry {
+    let name: String
+    let cName: ContiguousArray<CChar>
+    let argumentCount: Int32
+    let flags: Int32
+    let kind: FunctionKind
+    let box: AnyObject
+
+    init(name: String, argumentCount: Int32, flags: Int32, kind: FunctionKind, box: AnyObject) {
+        self.name = name
+        self.cName = name.utf8CString
+        self.argumentCount = argumentCount
+        self.flags = flags
+        self.kind = kind
+        self.box = box
+    }
+}
+
+/// A collation of a registry.
+private struct CollationEntry {
+    let name: String
+    let cName: ContiguousArray<CChar>
+    let key: String
+    let box: CollationBox
+
+    init(name: String, box: CollationBox) {
+        self.name = name
+        self.cName = name.utf8CString
+        self.key = name.lowercased()
+        self.box = box
+    }
+
+    /// Registers the collation, handing SQLite a new reference to its box.
+    func register(with db: OpaquePointer) -> Int32 {
+        let userData = Unmanaged.passRetained(box).toOpaque()
+        return cName.withUnsafeBufferPointer { name in
+            sqlite3_create_collation_v2(
+                db, name.baseAddress, SQLITE_UTF8, userData,
+                collationCompareCallback, releaseBoxedObject
+            )
+        }
+    }
+}
+
+/// Box to hold collation closures
+final class CollationBox: @unchecked Sendable {
+    let compare: @Sendable (UnsafeRawBufferPointer, UnsafeRawBufferPointer) -> Int32
+
+    init(compare: @escaping @Sendable (UnsafeRawBufferPointer, UnsafeRawBufferPointer) -> Int32) {
+        self.compare = compare
+    }
+}
+
+private func collationCompareCallback(
+    _ userData: UnsafeMutableRawPointer?,
+    _ lhsCount: Int32,
+    _ lhs: UnsafeRawPointer?,
+    _ rhsCount: Int32,
+    _ rhs: UnsafeRawPointer?
+) -> Int32 {
+    guard let userData else { return 0 }
+    let box = Unmanaged<CollationBox>.fromOpaque(userData).takeUnretainedValue()
+    return box.compare(
+        UnsafeRawBufferPointer(start: lhs, count: Int(max(lhsCount, 0))),
+        UnsafeRawBufferPointer(start: rhs, count: Int(max(rhsCount, 0)))
+    )
+}
+
+private func collationNeededCallback(
+    _ userData: UnsafeMutableRawPointer?,
+    _ db: OpaquePointer?,
+    _ textEncoding: Int32,
+    _ name: UnsafePointer<CChar>?
+) {
+    guard let userData, let db, let name else { return }
+    let registry = Unmanaged<SQLiteFunctionRegistry>.fromOpaque(userData).takeUnretainedValue()
+    registry.registerCollation(named: String(cString: name), with: db)
+}
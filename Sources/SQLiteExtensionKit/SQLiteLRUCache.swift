@@ -0,0 +1,152 @@
+import Synchronization
+
+/// A thread-safe, bounded cache that evicts the least recently used entry.
+///
+/// Extension functions are called from whichever thread steps the statement, so lookups
+/// are guarded by a mutex. Lookups, insertions and evictions are O(1).
+///
+/// Use it for state derived from argument values that is expensive to rebuild, such as
+/// compiled patterns, when the value is not constant and so cannot be kept as auxiliary
+/// data with ``SQLiteContext/setAuxiliaryData(_:forArgument:)``.
+///
+/// ## Example
+/// ```swift
+/// let patterns = SQLiteLRUCache<String, CompiledPattern>(capacity: 64)
+///
+/// let pattern = try patterns.value(forKey: text) {
+///     try CompiledPattern(text)
+/// }
+/// ```
+public final class SQLiteLRUCache<Key: Hashable & Sendable, Value: Sendable>: Sendable {
+    private struct Node {
+        var key: Key
+        var value: Value
+        var previous: Int
+        var next: Int
+    }
+
+    private struct Storage {
+        var slots: [Key: Int] = [:]
+        var nodes: [Node] = []
+        /// Most recently used node, or -1 when empty.
+        var head = -1
+        /// Least recently used node, or -1 when empty.
+        var tail = -1
+
+        mutating func unlink(_ slot: Int) {
+            let node = nodes[slot]
+            if node.previous >= 0 {
+                nodes[node.previous].next = node.next
+            } else {
+                head = node.next
+            }
+            if node.next >= 0 {
+                nodes[node.next].previous = node.previous
+            } else {
+                tail = node.previous
+            }
+        }
+
+        mutating func pushFront(_ slot: Int) {
+            nodes[slot].previous = -1
+            nodes[slot].next = head
+            if head >= 0 {
+                nodes[head].previous = slot
+            }
+            head = slot
+            if tail < 0 {
+                tail = slot
+            }
+        }
+
+        mutating func touch(_ slot: Int) {
+            guard slot != head else { return }
+            unlink(slot)
+            pushFront(slot)
+        }
+    }
+
+    private let storage = Mutex(Storage())
+
+    /// The maximum number of entries kept.
+    public let capacity: Int
+
+    /// Creates an empty cache.
+    ///
+    /// - Parameter capacity: The maximum number of entries; must be at least 1.
+    public init(capacity: Int) {
+        precondition(capacity > 0, "SQLiteLRUCache capacity must be positive")
+        self.capacity = capacity
+    }
+
+    /// The number of cached entries.
+    public var count: Int {
+        storage.withLock { $0.nodes.count }
+    }
+
+    /// Returns the cached value for `key` and marks it as most recently used.
+    ///
+    /// - Parameter key: The key to look up.
+    /// - Returns: The cached value, or `nil` on a miss.
+    public func value(forKey key: Key) -> Value? {
+        storage.withLock { storage in
+            guard let slot = storage.slots[key] else {
+                return nil
+            }
+            storage.touch(slot)
+            return storage.nodes[slot].value
+        }
+    }
+
+    /// Returns the cached value for `key`, creating and inserting it on a miss.
+    ///
+    /// `create` runs outside the lock, so two threads missing on the same key at once may
+    /// both build a value; the last one inserted wins.
+    ///
+    /// - Parameters:
+    ///   - key: The key to look up.
+    ///   - create: Builds the value on a miss.
+    /// - Returns: The cached or newly created value.
+    public func value(forKey key: Key, orInsert create: () throws -> Value) rethrows -> Value {
+        if let cached = value(forKey: key) {
+            return cached
+        }
+        let value = try create()
+        insert(value, forKey: key)
+        return value
+    }
+
+    /// Inserts or replaces the value for `key`, evicting the least recently used entry if full.
+    ///
+    /// - Parameters:
+    ///   - value: The value to cache.
+    ///   - key: The key to store it under.
+    public func insert(_ value: Value, forKey key: Key) {
+        storage.withLock { storage in
+            if let slot = storage.slots[key] {
+                storage.nodes[slot].value = value
+                storage.touch(slot)
+                return
+            }
+
+            let slot: Int
+            if storage.nodes.count < capacity {
+                slot = storage.nodes.count
+                storage.nodes.append(Node(key: key, value: value, previous: -1, next: -1))
+            } else {
+                slot = storage.tail
+                storage.unlink(slot)
+                storage.slots[storage.nodes[slot].key] = nil
+                storage.nodes[slot].key = key
+                storage.nodes[slot].value = value
+            }
+            storage.slots[key] = slot
+            storage.pushFront(slot)
+        }
+    }
+
+    /// Removes every entry.
+    public func removeAll() {
+        storage.withLock { $0 = Storage() }
+    }
+}
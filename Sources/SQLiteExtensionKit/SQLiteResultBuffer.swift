@@ -0,0 +1,140 @@
+import CSQLite
+import Foundation
+
+/// An immutable, reference-counted byte buffer that can be handed to SQLite without copying.
+///
+/// Passing a `String` or `Data` to `SQLiteContext.result(_:)` makes SQLite copy the
+/// bytes (`SQLITE_TRANSIENT`). A result buffer is instead retained for each result it backs
+/// and released by SQLite's destructor callback once SQLite is done with the value, so large
+/// payloads that are returned repeatedly — for example a JSON column held by a virtual table
+/// — are never copied again after the buffer is built.
+///
+/// ## Example
+/// ```swift
+/// let payload = SQLiteResultBuffer(jsonString)
+/// // Later, once per row:
+/// context.result(text: payload)
+/// ```
+public final class SQLiteResultBuffer: @unchecked Sendable {
+    /// Space reserved in front of the payload for the owning object pointer.
+    static let headerSize = MemoryLayout<UnsafeRawPointer>.stride
+
+    private let allocation: UnsafeMutableRawPointer
+
+    /// The number of payload bytes.
+    public let count: Int
+
+    /// Creates a buffer by letting `body` write up to `capacity` bytes.
+    ///
+    /// - Parameters:
+    ///   - capacity: The maximum number of bytes `body` may write.
+    ///   - body: Writes into the buffer and returns the number of bytes initialised.
+    public init(
+        capacity: Int,
+        initializingWith body: (UnsafeMutableRawBufferPointer) throws -> Int
+    ) rethrows {
+        let capacity = max(capacity, 0)
+        allocation = UnsafeMutableRawPointer.allocate(
+            byteCount: Self.headerSize + max(capacity, 1),
+            alignment: MemoryLayout<UnsafeRawPointer>.alignment
+        )
+
+        let payload = UnsafeMutableRawBufferPointer(
+            start: allocation + Self.headerSize,
+            count: capacity
+        )
+
+        let written: Int
+        do {
+            written = try body(payload)
+        } catch {
+            allocation.deallocate()
+            throw error
+        }
+        precondition(written >= 0 && written <= capacity, "SQLiteResultBuffer overflow")
+        count = written
+
+        allocation.storeBytes(
+            of: UnsafeRawPointer(Unmanaged.passUnretained(self).toOpaque()),
+            as: UnsafeRawPointer.self
+        )
+    }
+
+    /// Creates a buffer holding a copy of `bytes`.
+    public convenience init(copying bytes: UnsafeRawBufferPointer) {
+        self.init(capacity: bytes.count) { destination in
+            if let source = bytes.baseAddress, !bytes.isEmpty {
+                destination.baseAddress!.copyMemory(from: source, byteCount: bytes.count)
+            }
+            return bytes.count
+        }
+    }
+
+    /// Creates a buffer holding the UTF-8 bytes of `string`.
+    public convenience init(_ string: String) {
+        var string = string
+        self.init(capacity: string.utf8.count) { destination in
+            string.withUTF8 { source in
+                destination.copyMemory(from: UnsafeRawBufferPointer(source))
+                return source.count
+            }
+        }
+    }
+
+    /// Creates a buffer holding the bytes of `data`.
+    public convenience init(_ data: Data) {
+        self.init(capacity: data.count) { destination in
+            data.withUnsafeBytes { source in
+                destination.copyMemory(from: source)
+                return source.count
+            }
+        }
+    }
+
+    deinit {
+        allocation.deallocate()
+    }
+
+    /// The payload bytes.
+    public var bytes: UnsafeRawBufferPointer {
+        UnsafeRawBufferPointer(start: allocation + Self.headerSize, count: count)
+    }
+
+    /// Retains the buffer on behalf of SQLite and returns the payload pointer to hand over.
+    ///
+    /// The matching release happens in ``sqliteDestructor``.
+    func retainedPayload() -> UnsafeMutableRawPointer {
+        _ = Unmanaged.passRetained(self)
+        return allocation + Self.headerSize
+    }
+
+    /// Destructor passed to `sqlite3_result_text64`/`sqlite3_result_blob64`.
+    ///
+    /// Recovers the owning buffer from the header in front of the payload and releases the
+    /// reference taken by ``retainedPayload()``.
+    static var sqliteDestructor: @convention(c) (UnsafeMutableRawPointer?) -> Void {
+        { payload in
+            guard let payload else { return }
+            let owner = (payload - SQLiteResultBuffer.headerSize).load(as: UnsafeRawPointer.self)
+            Unmanaged<SQLiteResultBuffer>.fromOpaque(owner).release()
+        }
+    }
+}
+
+/// A borrowed byte range that SQLite may reference without copying (`SQLITE_STATIC`).
+///
+/// The memory must stay valid and unchanged until the statement that reads it is reset or
+/// finalised, not just until the next `xNext`: SQLite may keep static values in registers
+/// across rows, for example as the previous key of a `GROUP BY`. Suitable sources include
+/// memory-mapped files and immutable storage owned by the virtual table.
+public struct SQLiteStaticBytes: @unchecked Sendable {
+    /// The referenced bytes.
+    public let bytes: UnsafeRawBufferPointer
+
+    /// Wraps a byte range whose lifetime is guaranteed by the caller.
+    ///
+    /// - Parameter bytes: The bytes to reference.
+    public init(_ bytes: UnsafeRawBufferPointer) {
+        self.bytes = bytes
+    }
+}
@@ -15,6 +15,13 @@ import Foundation
 /// - ``textValue``
 /// - ``blobValue``
 /// - ``isNull``
+///
+/// ### Borrowing Bytes
+/// - ``withUTF8Bytes(_:)``
+/// - ``withBlobBytes(_:)``
+///
+/// ### Virtual Table Arguments
+/// - ``forEachInListValue(_:)``
 public struct SQLiteValue: @unchecked Sendable {
     /// The underlying SQLite value pointer.
     let pointer: OpaquePointer
@@ -71,10 +78,7 @@ public struct SQLiteValue: @unchecked Sendable {
     ///
     /// Returns an empty string if the value is NULL or cannot be converted to text.
     public var textValue: String {
-        guard let cString = sqlite3_value_text(pointer) else {
-            return ""
-        }
-        return String(cString: cString)
+        withUTF8Bytes { String(decoding: $0, as: UTF8.self) }
     }
 
     /// Returns the value as a blob (binary data).
@@ -95,6 +99,86 @@ public struct SQLiteValue: @unchecked Sendable {
     public var bytes: Int {
         Int(sqlite3_value_bytes(pointer))
     }
+
+    /// Calls `body` with the value's UTF-8 text, borrowed from SQLite's own buffer.
+    ///
+    /// Unlike ``textValue``, no `String` is created: the bytes are exactly those returned by
+    /// `sqlite3_value_text`, and the length comes from `sqlite3_value_bytes` rather than a
+    /// scan for the terminator. Non-text values are converted by SQLite first.
+    ///
+    /// The buffer is empty for NULL and is only valid inside `body`.
+    ///
+    /// ## Example
+    /// ```swift
+    /// let spaces = args[0].withUTF8Bytes { utf8 in
+    ///     utf8.reduce(0) { $1 == UInt8(ascii: " ") ? $0 + 1 : $0 }
+    /// }
+    /// ```
+    ///
+    /// - Parameter body: A closure that reads the UTF-8 bytes.
+    /// - Returns: The value returned by `body`.
+    public func withUTF8Bytes<Result>(
+        _ body: (UnsafeBufferPointer<UInt8>) throws -> Result
+    ) rethrows -> Result {
+        // sqlite3_value_bytes must follow the conversion done by sqlite3_value_text.
+        let text = sqlite3_value_text(pointer)
+        let count = text == nil ? 0 : Int(sqlite3_value_bytes(pointer))
+        return try body(UnsafeBufferPointer(start: text, count: count))
+    }
+
+    /// Calls `body` with the value's bytes, borrowed from SQLite's own buffer.
+    ///
+    /// Unlike ``blobValue``, no `Data` is allocated, which avoids a full copy when reading
+    /// large blobs. Text values expose their UTF-8 encoding.
+    ///
+    /// The buffer is empty for NULL and is only valid inside `body`.
+    ///
+    /// ## Example
+    /// ```swift
+    /// let checksum = args[0].withBlobBytes { bytes in
+    ///     bytes.reduce(UInt8(0)) { $0 ^ $1 }
+    /// }
+    /// ```
+    ///
+    /// - Parameter body: A closure that reads the bytes.
+    /// - Returns: The value returned by `body`.
+    public func withBlobBytes<Result>(
+        _ body: (UnsafeRawBufferPointer) throws -> Result
+    ) rethrows -> Result {
+        // sqlite3_value_bytes must follow the conversion done by sqlite3_value_blob.
+        let blob = sqlite3_value_blob(pointer)
+        let count = blob == nil ? 0 : Int(sqlite3_value_bytes(pointer))
+        return try body(UnsafeRawBufferPointer(start: blob, count: count))
+    }
+
+    /// Calls `body` with each value of an `IN (...)` list passed whole to a virtual table's
+    /// `filter`, using `sqlite3_vtab_in_first` and `sqlite3_vtab_in_next`.
+    ///
+    /// Only valid for an argument whose constraint set
+    /// ``IndexInfo/ConstraintUsage/inListAtOnce`` in `bestIndex`. Each value is only valid
+    /// inside its call to `body`. Duplicates are removed; the order is not specified.
+    ///
+    /// ## Example
+    /// ```swift
+    /// var keys: [String] = []
+    /// try values[0].forEachInListValue { keys.append($0.textValue) }
+    /// rows = store.rows(forKeys: keys)
+    /// ```
+    ///
+    /// - Parameter body: A closure called once per list value.
+    /// - Throws: ``SQLiteExtensionError/sqliteError(code:)`` if SQLite cannot produce the
+    ///   list, or any error thrown by `body`.
+    public func forEachInListValue(_ body: (SQLiteValue) throws -> Void) throws {
+        var element: OpaquePointer?
+        var result = sqlite3_vtab_in_first(pointer, &element)
+        while result == SQLITE_OK, let current = element {
+            try body(SQLiteValue(current))
+            result = sqlite3_vtab_in_next(pointer, &element)
+        }
+        if result != SQLITE_OK && result != SQLITE_DONE {
+            throw SQLiteExtensionError.sqliteError(code: result)
+        }
+    }
 }
 
 extension SQLiteValue {
@@ -0,0 +1,100 @@
+import CSQLite
+import Foundation
+
+// MARK: - Table-Valued Functions
+
+extension SQLiteDatabase {
+    /// Registers a table-valued function whose rows come from a lazily evaluated sequence.
+    ///
+    /// The function is an eponymous virtual table: it can be queried by name without
+    /// `CREATE VIRTUAL TABLE`, and its parameters are HIDDEN columns after the output
+    /// columns, so `FROM name(a, b)` is shorthand for `WHERE param1 = a AND param2 = b`.
+    ///
+    /// `rows` is called once per scan with one value per parameter, in declaration order,
+    /// and `nil` for parameters the query does not supply. The returned sequence is not
+    /// buffered: each `xNext` pulls one element from its iterator, so memory use does not
+    /// grow with the number of rows and `LIMIT 10` stops after ten elements. The arguments
+    /// are protected copies owned by the cursor, so the sequence may capture them and read
+    /// their bytes in place until the scan ends.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createTableValuedFunction(
+    ///     name: "squares",
+    ///     columns: ["n INTEGER", "square INTEGER"],
+    ///     parameters: ["count"]
+    /// ) { arguments in
+    ///     let count = arguments[0]?.intValue ?? 0
+    ///     return (0..<count).lazy.map { n in [ColumnValue.integer(n), .integer(n * n)] }
+    /// }
+    /// // SELECT n, square FROM squares(1000000000) LIMIT 3;
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The function name as used in SQL.
+    ///   - columns: Output column declarations, such as `"line TEXT"`.
+    ///   - parameters: Parameter column declarations, such as `"input"`; each is declared HIDDEN.
+    ///   - rows: Returns the rows for one set of arguments. Each element holds the output
+    ///     columns in order; missing trailing values read as NULL. An iterator that can
+    ///     fail partway conforms to ``FailableRowIterator``.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func createTableValuedFunction<Rows: Sequence>(
+        name: String,
+        columns: [String],
+        parameters: [String],
+        rows: @escaping @Sendable (_ arguments: [SQLiteValue?]) throws -> Rows
+    ) throws where Rows.Element == [ColumnValue] {
+        let adapter = TableValuedFunctionModuleAdapter(
+            columns: columns,
+            parameters: parameters,
+            makeRows: rows,
+            value: { row, column in column < row.count ? row[column] : .null }
+        )
+        try registerModule(VirtualTableModuleDescriptor(name: name, adapter: adapter), eponymous: true)
+    }
+
+    /// Registers a table-valued function with a single output column.
+    ///
+    /// This is ``createTableValuedFunction(name:columns:parameters:rows:)`` for sequences
+    /// whose elements are the column value itself, which avoids an array per row.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createTableValuedFunction(name: "countdown", column: "value", parameters: ["start"]) { arguments in
+    ///     let start = arguments[0]?.intValue ?? 10
+    ///     return stride(from: start, through: 0, by: -1).lazy.map { ColumnValue.integer($0) }
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The function name as used in SQL.
+    ///   - column: The output column declaration.
+    ///   - parameters: Parameter column declarations; each is declared HIDDEN.
+    ///   - rows: Returns the values for one set of arguments.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    public func createTableValuedFunction<Rows: Sequence>(
+        name: String,
+        column: String,
+        parameters: [String],
+        rows: @escaping @Sendable (_ arguments: [SQLiteValue?]) throws -> Rows
+    ) throws where Rows.Element == ColumnValue {
+        let adapter = TableValuedFunctionModuleAdapter(
+            columns: [column],
+            parameters: parameters,
+            makeRows: rows,
+            value: { value, column in column == 0 ? value : .null }
+        )
+        try registerModule(VirtualTableModuleDescriptor(name: name, adapter: adapter), eponymous: true)
+    }
+}
+
+/// An iterator of table-valued function rows that can end with an error.
+///
+/// `IteratorProtocol.next()` cannot throw, so an iterator whose source fails partway, such
+/// as a blob changed during the scan, returns `nil` and sets ``failure``. The cursor checks
+/// it when the rows end and fails the statement with it, rather than returning the rows
+/// before it as if they were complete.
+public protocol FailableRowIterator: IteratorProtocol {
+    /// The error that ended the rows, or `nil` if they ran to completion.
+    var failure: (any Error)? { get }
+}
@@ -0,0 +1,316 @@
+import CSQLite
+import Foundation
+
+/// A Swift type that can be decoded directly from a SQLite function argument.
+///
+/// Conforming types are used by the typed `createScalarFunction(name:deterministic:function:)`
+/// overloads on ``SQLiteDatabase``, which decode each argument straight into its native type.
+///
+/// Returning `nil` from ``init(argument:)`` signals that the argument is SQL NULL and the
+/// function should produce NULL without running its body. `Optional` wrappers opt out of that
+/// propagation and receive `nil` instead.
+public protocol SQLiteFunctionArgument {
+    /// Decodes the argument, or returns `nil` when the call should short-circuit to NULL.
+    ///
+    /// - Parameter value: The borrowed argument value.
+    init?(argument value: SQLiteValue)
+}
+
+/// A Swift type that can be written as the result of a SQLite function.
+public protocol SQLiteFunctionResult {
+    /// Writes the value using the matching `sqlite3_result_*` call.
+    ///
+    /// - Parameter context: The context of the current function invocation.
+    func setResult(in context: SQLiteContext)
+}
+
+// MARK: - Argument Conformances
+
+extension Int64: SQLiteFunctionArgument {
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        guard !value.isNull else { return nil }
+        self = value.intValue
+    }
+}
+
+extension Int: SQLiteFunctionArgument {
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        guard !value.isNull else { return nil }
+        self = Int(truncatingIfNeeded: value.intValue)
+    }
+}
+
+extension Double: SQLiteFunctionArgument {
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        guard !value.isNull else { return nil }
+        self = value.doubleValue
+    }
+}
+
+extension Bool: SQLiteFunctionArgument {
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        guard !value.isNull else { return nil }
+        self = value.intValue != 0
+    }
+}
+
+extension String: SQLiteFunctionArgument {
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        guard !value.isNull else { return nil }
+        self = value.textValue
+    }
+}
+
+extension Data: SQLiteFunctionArgument {
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        guard !value.isNull else { return nil }
+        self = value.blobValue
+    }
+}
+
+extension SQLiteValue: SQLiteFunctionArgument {
+    /// Passes the raw value through, including NULL.
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        self = value
+    }
+}
+
+extension Optional: SQLiteFunctionArgument where Wrapped: SQLiteFunctionArgument {
+    /// Decodes NULL as `nil` instead of propagating it.
+    @inlinable
+    public init?(argument value: SQLiteValue) {
+        if value.isNull {
+            self = .none
+            return
+        }
+        guard let wrapped = Wrapped(argument: value) else {
+            return nil
+        }
+        self = .some(wrapped)
+    }
+}
+
+// MARK: - Result Conformances
+
+extension Int64: SQLiteFunctionResult {
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        context.result(self)
+    }
+}
+
+extension Int: SQLiteFunctionResult {
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        context.result(Int64(self))
+    }
+}
+
+extension Double: SQLiteFunctionResult {
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        context.result(self)
+    }
+}
+
+extension Bool: SQLiteFunctionResult {
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        context.result(Int64(self ? 1 : 0))
+    }
+}
+
+extension String: SQLiteFunctionResult {
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        context.result(self)
+    }
+}
+
+extension Data: SQLiteFunctionResult {
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        context.result(self)
+    }
+}
+
+extension Optional: SQLiteFunctionResult where Wrapped: SQLiteFunctionResult {
+    /// Writes NULL for `nil`.
+    @inlinable
+    public func setResult(in context: SQLiteContext) {
+        switch self {
+        case .some(let wrapped):
+            wrapped.setResult(in: context)
+        case .none:
+            context.resultNull()
+        }
+    }
+}
+
+// MARK: - Typed Registration
+
+extension SQLiteDatabase {
+    /// Registers a typed scalar function that takes no arguments.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createScalarFunction(name: "answer") { () -> Int64 in 42 }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The name of the function as it will be used in SQL.
+    ///   - deterministic: Whether the function always returns the same result for the same inputs.
+    ///   - function: The function implementation.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    @inlinable
+    public func createScalarFunction<R: SQLiteFunctionResult>(
+        name: String,
+        deterministic: Bool = false,
+        function: @escaping @Sendable () throws -> R
+    ) throws {
+        let body: BorrowingScalarFunction = { context, _ in
+            try function().setResult(in: context)
+        }
+        try createScalarFunction(name: name, argumentCount: 0, deterministic: deterministic, function: body)
+    }
+
+    /// Registers a typed scalar function that takes one argument.
+    ///
+    /// The argument is decoded directly into `A`. If it is NULL and `A` is not optional,
+    /// the function returns NULL without calling `function`.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createScalarFunction(name: "double_it", deterministic: true) { (x: Int64) in x * 2 }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The name of the function as it will be used in SQL.
+    ///   - deterministic: Whether the function always returns the same result for the same inputs.
+    ///   - function: The function implementation.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    @inlinable
+    public func createScalarFunction<A: SQLiteFunctionArgument, R: SQLiteFunctionResult>(
+        name: String,
+        deterministic: Bool = false,
+        function: @escaping @Sendable (A) throws -> R
+    ) throws {
+        let body: BorrowingScalarFunction = { context, args in
+            guard let a = A(argument: args[0]) else {
+                context.resultNull()
+                return
+            }
+            try function(a).setResult(in: context)
+        }
+        try createScalarFunction(name: name, argumentCount: 1, deterministic: deterministic, function: body)
+    }
+
+    /// Registers a typed scalar function that takes two arguments.
+    ///
+    /// Arguments are decoded directly into their native types. If any non-optional argument
+    /// is NULL, the function returns NULL without calling `function`.
+    ///
+    /// ## Example
+    /// ```swift
+    /// try db.createScalarFunction(name: "power", deterministic: true) { (a: Double, b: Double) in
+    ///     pow(a, b)
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The name of the function as it will be used in SQL.
+    ///   - deterministic: Whether the function always returns the same result for the same inputs.
+    ///   - function: The function implementation.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    @inlinable
+    public func createScalarFunction<A: SQLiteFunctionArgument, B: SQLiteFunctionArgument, R: SQLiteFunctionResult>(
+        name: String,
+        deterministic: Bool = false,
+        function: @escaping @Sendable (A, B) throws -> R
+    ) throws {
+        let body: BorrowingScalarFunction = { context, args in
+            guard let a = A(argument: args[0]),
+                  let b = B(argument: args[1]) else {
+                context.resultNull()
+                return
+            }
+            try function(a, b).setResult(in: context)
+        }
+        try createScalarFunction(name: name, argumentCount: 2, deterministic: deterministic, function: body)
+    }
+
+    /// Registers a typed scalar function that takes three arguments.
+    ///
+    /// Arguments are decoded directly into their native types. If any non-optional argument
+    /// is NULL, the function returns NULL without calling `function`.
+    ///
+    /// - Parameters:
+    ///   - name: The name of the function as it will be used in SQL.
+    ///   - deterministic: Whether the function always returns the same result for the same inputs.
+    ///   - function: The function implementation.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    @inlinable
+    public func createScalarFunction<
+        A: SQLiteFunctionArgument,
+        B: SQLiteFunctionArgument,
+        C: SQLiteFunctionArgument,
+        R: SQLiteFunctionResult
+    >(
+        name: String,
+        deterministic: Bool = false,
+        function: @escaping @Sendable (A, B, C) throws -> R
+    ) throws {
+        let body: BorrowingScalarFunction = { context, args in
+            guard let a = A(argument: args[0]),
+                  let b = B(argument: args[1]),
+                  let c = C(argument: args[2]) else {
+                context.resultNull()
+                return
+            }
+            try function(a, b, c).setResult(in: context)
+        }
+        try createScalarFunction(name: name, argumentCount: 3, deterministic: deterministic, function: body)
+    }
+
+    /// Registers a typed scalar function that takes four arguments.
+    ///
+    /// Arguments are decoded directly into their native types. If any non-optional argument
+    /// is NULL, the function returns NULL without calling `function`.
+    ///
+    /// - Parameters:
+    ///   - name: The name of the function as it will be used in SQL.
+    ///   - deterministic: Whether the function always returns the same result for the same inputs.
+    ///   - function: The function implementation.
+    /// - Throws: ``SQLiteExtensionError`` if registration fails.
+    @inlinable
+    public func createScalarFunction<
+        A: SQLiteFunctionArgument,
+        B: SQLiteFunctionArgument,
+        C: SQLiteFunctionArgument,
+        D: SQLiteFunctionArgument,
+        R: SQLiteFunctionResult
+    >(
+        name: String,
+        deterministic: Bool = false,
+        function: @escaping @Sendable (A, B, C, D) throws -> R
+    ) throws {
+        let body: BorrowingScalarFunction = { context, args in
+            guard let a = A(argument: args[0]),
+                  let b = B(argument: args[1]),
+                  let c = C(argument: args[2]),
+                  let d = D(argument: args[3]) else {
+                context.resultNull()
+                return
+            }
+            try function(a, b, c, d).setResult(in: context)
+        }
+        try createScalarFunction(name: name, argumentCount: 4, deterministic: deterministic, function: body)
+    }
+}
@@ -8,12 +8,25 @@ import Foundation
 /// ## Topics
 /// ### Required Methods
 /// - ``schema``
+/// - ``declaredSchema``
 /// - ``bestIndex(_:)``
 /// - ``open()``
 ///
 /// ### Optional Methods
 /// - ``disconnect()``
 /// - ``update(_:)``
+///
+/// ### Function Overloading
+/// - ``findFunction(name:argumentCount:)``
+///
+/// ### Transactions
+/// - ``begin()``
+/// - ``sync()``
+/// - ``commit()``
+/// - ``rollback()``
+/// - ``savepoint(_:)``
+/// - ``release(savepoint:)``
+/// - ``rollback(toSavepoint:)``
 public protocol VirtualTableModule: Sendable {
     /// The associated cursor type for iterating over rows.
     associatedtype Cursor: VirtualTableCursor
@@ -28,6 +41,12 @@ public protocol VirtualTableModule: Sendable {
     /// ```
     static var schema: String { get }
 
+    /// The schema declared for this instance, which defaults to ``schema``.
+    ///
+    /// Implement it when the columns depend on the `CREATE VIRTUAL TABLE` arguments, such
+    /// as a table over a file that describes its own columns.
+    var declaredSchema: String { get }
+
     /// Called when a new instance of the virtual table is created.
     ///
     /// - Parameter arguments: Arguments passed to CREATE VIRTUAL TABLE.
@@ -67,9 +86,111 @@ public protocol VirtualTableModule: Sendable {
     /// - Returns: The outcome of the operation.
     /// - Throws: Any error encountered during processing.
     mutating func update(_ operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome
+
+    /// Supplies the table's own implementation of a SQL function applied to one of its
+    /// columns.
+    ///
+    /// SQLite asks when a statement is prepared, for any function whose first argument is a
+    /// column of this table, or whose second argument is for the infix operators `MATCH`,
+    /// `LIKE`, `GLOB` and `REGEXP` (so `body MATCH 'x'` is `match('x', body)`). The function
+    /// must also be registered with the database, where it serves every other table.
+    ///
+    /// Returning a function created with ``VirtualTableFunction/init(constraint:function:)``
+    /// also turns a two-argument call such as `WHERE contains_word(body, 'swift')` into an
+    /// ``IndexInfo/Constraint/Operator/function`` constraint on the column, which
+    /// ``bestIndex(_:)`` can claim and answer from the table's own index.
+    ///
+    /// ## Example
+    /// ```swift
+    /// func findFunction(name: String, argumentCount: Int) -> VirtualTableFunction? {
+    ///     guard name == "contains_word", argumentCount == 2 else { return nil }
+    ///     return VirtualTableFunction(constraint: 0) { context, args in
+    ///         context.result(words.contains(args[1].textValue, in: args[0].textValue))
+    ///     }
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The function name, lowercased.
+    ///   - argumentCount: The number of arguments in the call.
+    /// - Returns: The implementation to use for this table, or `nil` for the registered one.
+    func findFunction(name: String, argumentCount: Int) -> VirtualTableFunction?
+
+    /// Called before the first write to the table in a transaction.
+    ///
+    /// Together with ``commit()`` this lets a writable table stage every ``update(_:)`` of
+    /// a transaction in memory and apply them to its backing store once, instead of
+    /// writing each row as it arrives. In autocommit mode every statement is its own
+    /// transaction, so an `INSERT INTO t SELECT ...` of any size is flushed once.
+    ///
+    /// ## Example
+    /// ```swift
+    /// mutating func begin() throws {
+    ///     pending = []
+    /// }
+    ///
+    /// mutating func update(_ operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
+    ///     pending.append(operation)
+    ///     return .handled(rowid: nil)
+    /// }
+    ///
+    /// mutating func commit() throws {
+    ///     try store.apply(pending)
+    ///     pending = []
+    /// }
+    /// ```
+    ///
+    /// - Throws: Any error, which aborts the transaction.
+    mutating func begin() throws
+
+    /// Called at the start of a two-phase commit, before any table is committed.
+    ///
+    /// Make staged writes durable here; throwing rolls the transaction back.
+    ///
+    /// - Throws: Any error, which rolls the transaction back.
+    mutating func sync() throws
+
+    /// Called when the transaction commits.
+    ///
+    /// - Throws: Any error. SQLite ignores failures at this stage, so anything that can
+    ///   fail belongs in ``sync()``.
+    mutating func commit() throws
+
+    /// Called when the transaction rolls back; discard every staged write.
+    ///
+    /// - Throws: Any error during rollback.
+    mutating func rollback() throws
+
+    /// Called when savepoint `level` is opened, including the implicit savepoint SQLite
+    /// takes around each statement inside a transaction.
+    ///
+    /// Levels are small integers that grow as savepoints nest.
+    ///
+    /// - Parameter level: The savepoint level.
+    /// - Throws: Any error, which fails the statement.
+    mutating func savepoint(_ level: Int) throws
+
+    /// Called when savepoint `level` and every savepoint above it are released, keeping
+    /// their writes in the enclosing transaction.
+    ///
+    /// - Parameter level: The savepoint level.
+    /// - Throws: Any error, which fails the statement.
+    mutating func release(savepoint level: Int) throws
+
+    /// Called to undo the writes made since savepoint `level` was opened. The savepoint
+    /// itself stays open; the ones above it are discarded.
+    ///
+    /// - Parameter level: The savepoint level.
+    /// - Throws: Any error during rollback.
+    mutating func rollback(toSavepoint level: Int) throws
 }
 
 extension VirtualTableModule {
+    /// Default implementation that declares the static ``schema``.
+    public var declaredSchema: String {
+        Self.schema
+    }
+
     /// Default implementation that uses `create` for connect.
     public static func connect(arguments: [String]) throws -> Self {
         try create(arguments: arguments)
@@ -83,6 +204,73 @@ extension VirtualTableModule {
         _ = operation
         return .readOnly
     }
+
+    /// Default implementation that keeps the registered functions.
+    public func findFunction(name: String, argumentCount: Int) -> VirtualTableFunction? {
+        nil
+    }
+
+    /// Default implementation with no special action.
+    public mutating func begin() throws {}
+
+    /// Default implementation with no special action.
+    public mutating func sync() throws {}
+
+    /// Default implementation with no special action.
+    public mutating func commit() throws {}
+
+    /// Default implementation with no special action.
+    public mutating func rollback() throws {}
+
+    /// Default implementation with no special action.
+    public mutating func savepoint(_ level: Int) throws {}
+
+    /// Default implementation with no special action.
+    public mutating func release(savepoint level: Int) throws {}
+
+    /// Default implementation with no special action.
+    public mutating func rollback(toSavepoint level: Int) throws {}
+}
+
+/// A virtual table's implementation of a SQL function, returned from
+/// ``VirtualTableModule/findFunction(name:argumentCount:)``.
+public struct VirtualTableFunction: Sendable {
+    /// The highest constraint index; SQLite reserves operator codes 150 through 255.
+    public static let maximumConstraintIndex = 105
+
+    let function: BorrowingScalarFunction
+
+    /// The index reported in ``IndexInfo/Constraint/functionIndex``, or `nil` if the
+    /// function only replaces the implementation.
+    public let constraintIndex: Int?
+
+    /// Creates an implementation that replaces the registered function for this table.
+    ///
+    /// - Parameter function: The implementation.
+    public init(function: @escaping BorrowingScalarFunction) {
+        self.function = function
+        constraintIndex = nil
+    }
+
+    /// Creates an implementation that can also be claimed as a constraint in `bestIndex`.
+    ///
+    /// A two-argument call with the table's column first is then reported as a
+    /// ``IndexInfo/Constraint/Operator/function`` constraint with this index, and its
+    /// second argument is the constraint's value. The implementation still runs for rows
+    /// unless `bestIndex` sets ``IndexInfo/ConstraintUsage/omit``.
+    ///
+    /// - Parameters:
+    ///   - index: Distinguishes the table's constraint functions, from 0 through
+    ///     ``maximumConstraintIndex``.
+    ///   - function: The implementation.
+    public init(constraint index: Int, function: @escaping BorrowingScalarFunction) {
+        precondition(
+            (0...Self.maximumConstraintIndex).contains(index),
+            "VirtualTableFunction constraint index out of range"
+        )
+        self.function = function
+        constraintIndex = index
+    }
 }
 
 /// A cursor for iterating over virtual table rows.
@@ -102,6 +290,9 @@ public protocol VirtualTableCursor: Sendable {
     mutating func next() throws
 
     /// Returns whether the cursor has reached the end.
+    ///
+    /// Read once after each call to ``filter(indexNumber:indexString:values:)`` and
+    /// ``next()``; the result is cached for SQLite's `xEof` until the next of those calls.
     var eof: Bool { get }
 
     /// Returns the value for a specific column.
@@ -113,6 +304,25 @@ public protocol VirtualTableCursor: Sendable {
 
     /// Returns the current row ID.
     var rowid: Int64 { get }
+
+    /// Prepares the cursor to be reused by a later scan of the same table.
+    ///
+    /// Called when SQLite closes the cursor. Return `true` to keep it: the table's next
+    /// `xOpen` hands it out again instead of calling ``VirtualTableModule/open()``, and
+    /// the first call it then receives is ``filter(indexNumber:indexString:values:)``.
+    /// Release anything that refers to the rows scanned, but keep buffers that the next
+    /// filter can refill.
+    ///
+    /// - Returns: Whether the cursor can be reused. The default returns `false`, so every
+    ///   scan opens a new cursor.
+    mutating func reset() -> Bool
+}
+
+extension VirtualTableCursor {
+    /// Default implementation that discards the cursor.
+    public mutating func reset() -> Bool {
+        false
+    }
 }
 
 /// Operations that SQLite can request via `xUpdate` on a virtual table.
@@ -150,6 +360,10 @@ public enum VirtualTableUpdateOutcome: Sendable {
 }
 
 /// Represents a column value in a virtual table.
+///
+/// `.text` and `.blob` are copied by SQLite when they are returned. Use `.textBuffer` and
+/// `.blobBuffer` to hand over a retained ``SQLiteResultBuffer`` without a copy, or
+/// `.staticText` and `.staticBlob` to point SQLite at memory the table keeps alive.
 public enum ColumnValue: Sendable {
     case integer(Int64)
     case real(Double)
@@ -157,6 +371,34 @@ public enum ColumnValue: Sendable {
     case blob(Data)
     case null
 
+    /// Text owned by a retained buffer, returned without copying.
+    case textBuffer(SQLiteResultBuffer)
+
+    /// A blob owned by a retained buffer, returned without copying.
+    case blobBuffer(SQLiteResultBuffer)
+
+    /// Text referenced in place; see ``SQLiteStaticBytes`` for the lifetime requirements.
+    case staticText(SQLiteStaticBytes)
+
+    /// A blob referenced in place; see ``SQLiteStaticBytes`` for the lifetime requirements.
+    case staticBlob(SQLiteStaticBytes)
+
+    /// Copies a SQLite value, keeping its storage class.
+    public init(copying value: SQLiteValue) {
+        switch value.type {
+        case .integer:
+            self = .integer(value.intValue)
+        case .real:
+            self = .real(value.doubleValue)
+        case .text:
+            self = .text(value.textValue)
+        case .blob:
+            self = .blob(value.blobValue)
+        case .null:
+            self = .null
+        }
+    }
+
     /// Sets this value as the result in a SQLite context.
     func setResult(in context: SQLiteContext) {
         switch self {
@@ -170,6 +412,14 @@ public enum ColumnValue: Sendable {
             context.result(value)
         case .null:
             context.resultNull()
+        case .textBuffer(let buffer):
+            context.result(text: buffer)
+        case .blobBuffer(let buffer):
+            context.result(blob: buffer)
+        case .staticText(let bytes):
+            context.result(staticText: bytes)
+        case .staticBlob(let bytes):
+            context.result(staticBlob: bytes)
         }
     }
 }
@@ -200,6 +450,19 @@ public struct IndexInfo: Sendable {
     /// Constraint usage information.
     public var constraintUsage: [ConstraintUsage]
 
+    /// The columns the statement reads, as a bit mask (`colUsed`).
+    ///
+    /// Bit `n` is set if column `n` is used; bit 63 stands for every column from 63 on.
+    /// A wide table can pass this to `filter` through ``indexNumber`` or ``indexString``
+    /// and skip producing the columns that are never read. See ``usesColumn(_:)``.
+    public let columnsUsed: UInt64
+
+    /// How the rows must be ordered or grouped (`sqlite3_vtab_distinct`).
+    public let distinct: Distinct
+
+    /// Flags describing the chosen plan (`idxFlags`).
+    public var flags: Flags
+
     public init(
         constraints: [Constraint] = [],
         orderBy: [OrderBy] = [],
@@ -208,7 +471,10 @@ public struct IndexInfo: Sendable {
         indexNumber: Int = 0,
         indexString: String? = nil,
         orderByConsumed: Bool = false,
-        constraintUsage: [ConstraintUsage] = []
+        constraintUsage: [ConstraintUsage] = [],
+        columnsUsed: UInt64 = .max,
+        distinct: Distinct = .ordered,
+        flags: Flags = []
     ) {
         self.constraints = constraints
         self.orderBy = orderBy
@@ -218,6 +484,40 @@ public struct IndexInfo: Sendable {
         self.indexString = indexString
         self.orderByConsumed = orderByConsumed
         self.constraintUsage = constraintUsage
+        self.columnsUsed = columnsUsed
+        self.distinct = distinct
+        self.flags = flags
+    }
+
+    /// Whether the statement reads column `index`.
+    public func usesColumn(_ index: Int) -> Bool {
+        guard index >= 0 else { return false }
+        return columnsUsed & (1 << UInt64(min(index, 63))) != 0
+    }
+
+    /// Plan flags written back to SQLite.
+    public struct Flags: OptionSet, Sendable {
+        public let rawValue: Int32
+
+        public init(rawValue: Int32) {
+            self.rawValue = rawValue
+        }
+
+        /// The plan returns at most one row (`SQLITE_INDEX_SCAN_UNIQUE`), which lets SQLite
+        /// skip work such as a statement journal for the write it drives.
+        public static let scanUnique = Flags(rawValue: SQLITE_INDEX_SCAN_UNIQUE)
+    }
+
+    /// What `orderByConsumed` promises, from `sqlite3_vtab_distinct`.
+    public enum Distinct: Int32, Sendable {
+        /// Rows must come out in ``orderBy`` order.
+        case ordered = 0
+        /// Rows with equal ``orderBy`` columns must be adjacent (a `GROUP BY`), in any order.
+        case grouped = 1
+        /// Only one row per distinct combination of the used columns is needed, in any order.
+        case distinct = 2
+        /// Both ``grouped`` and ``distinct``.
+        case distinctGrouped = 3
     }
 
     /// A constraint on a column.
@@ -231,10 +531,42 @@ public struct IndexInfo: Sendable {
         /// Whether the constraint is usable.
         public let usable: Bool
 
-        public init(column: Int, op: Operator, usable: Bool) {
+        /// For ``Operator/function`` constraints, the
+        /// ``VirtualTableFunction/constraintIndex`` of the function that produced it.
+        public let functionIndex: Int
+
+        /// The collating sequence of the comparison (`sqlite3_vtab_collation`), such as
+        /// `"BINARY"` or `"NOCASE"`.
+        ///
+        /// A table that compares values bytewise must not use, and above all must not
+        /// omit, a constraint under any other collation, or the rows it returns will not
+        /// match the query.
+        public let collation: String
+
+        /// The value of the right-hand side when it is known while planning, such as a
+        /// literal (`sqlite3_vtab_rhs_value`). Parameters and expressions give `nil`.
+        public let rightHandValue: ColumnValue?
+
+        /// Whether this `.eq` constraint is an `IN (...)` list that `filter` can receive
+        /// whole; see ``ConstraintUsage/inListAtOnce``.
+        public let isInList: Bool
+
+        public init(
+            column: Int,
+            op: Operator,
+            usable: Bool,
+            functionIndex: Int = 0,
+            collation: String = "BINARY",
+            rightHandValue: ColumnValue? = nil,
+            isInList: Bool = false
+        ) {
             self.column = column
             self.op = op
             self.usable = usable
+            self.functionIndex = functionIndex
+            self.collation = collation
+            self.rightHandValue = rightHandValue
+            self.isInList = isInList
         }
 
         /// Constraint operators.
@@ -255,6 +587,9 @@ public struct IndexInfo: Sendable {
             case `is` = 72
             case limit = 73
             case offset = 74
+            /// A function returned by ``VirtualTableModule/findFunction(name:argumentCount:)``;
+            /// see ``Constraint/functionIndex``.
+            case function = 150
         }
     }
 
@@ -280,9 +615,17 @@ public struct IndexInfo: Sendable {
         /// Whether to omit the double-check of this constraint.
         public var omit: Bool
 
-        public init(argvIndex: Int = 0, omit: Bool = false) {
+        /// Whether `filter` receives an ``Constraint/isInList`` constraint's whole list,
+        /// instead of being called once per value.
+        ///
+        /// The argument is then read with ``SQLiteValue/forEachInListValue(_:)``. Set
+        /// ``argvIndex`` for the constraint, and ``omit`` so SQLite does not recheck it.
+        public var inListAtOnce: Bool
+
+        public init(argvIndex: Int = 0, omit: Bool = false, inListAtOnce: Bool = false) {
             self.argvIndex = argvIndex
             self.omit = omit
+            self.inListAtOnce = inListAtOnce
         }
     }
 }
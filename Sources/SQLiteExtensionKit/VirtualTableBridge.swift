@@ -4,71 +4,352 @@ import Foundation
 // MARK: - Type Erasure Helpers
 
 protocol AnyVirtualTableModuleAdapter: AnyObject {
-    var schema: String { get }
     func create(arguments: [String]) throws -> AnyVirtualTableInstanceAdapter
     func connect(arguments: [String]) throws -> AnyVirtualTableInstanceAdapter
 }
 
-protocol AnyVirtualTableInstanceAdapter: AnyObject {
-    func bestIndex(info: inout IndexInfo)
-    func disconnect()
-    func open() throws -> AnyVirtualTableCursorAdapter
-    func update(operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome
-}
+/// Base class of the table adapters.
+///
+/// The SQLite callbacks recover an adapter from its pointer with an unchecked cast to
+/// this class, so each callback is one class-vtable call into the generic subclass that
+/// knows the concrete module type: no dynamic cast and no existential dispatch.
+class AnyVirtualTableInstanceAdapter {
+    /// The most closed cursors a table keeps for reuse.
+    static let cursorPoolLimit = 4
+
+    /// Closed cursors kept for the next `xOpen`, so a table that is scanned repeatedly,
+    /// such as the inner side of a nested-loop join, does not allocate per scan.
+    ///
+    /// A pooled cursor keeps its batch buffer, and keeps its adapter when the adapter's
+    /// `reset()` returned `true`; otherwise its `swiftCursor` is nil and the next `xOpen`
+    /// creates a new adapter for it.
+    var cursorPool: [UnsafeMutablePointer<SQLiteVirtualCursor>] = []
+
+    var schema: String {
+        preconditionFailure("\(Self.self) must override schema")
+    }
+
+    func bestIndex(info: inout IndexInfo) {
+        preconditionFailure("\(Self.self) must override bestIndex(info:)")
+    }
+
+    func disconnect() {}
+
+    /// Called at the start of every `xOpen`, including those served from the pool.
+    func willOpen() throws {}
+
+    /// Creates a new cursor adapter, when the pool has none to reuse.
+    func open() throws -> AnyVirtualTableCursorAdapter {
+        preconditionFailure("\(Self.self) must override open()")
+    }
 
-extension AnyVirtualTableInstanceAdapter {
     func update(operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
-        _ = operation
-        return .readOnly
+        .readOnly
+    }
+
+    func transaction(_ event: VirtualTableTransactionEvent, savepoint: Int) throws {}
+
+    func findFunction(name: String, argumentCount: Int) -> (code: Int32, box: FunctionBox)? {
+        nil
+    }
+
+    /// The adapter as a bulk writer, if its module stages inserts.
+    var bulkWriter: AnyBulkWritableInstanceAdapter? {
+        nil
     }
 }
 
-protocol AnyVirtualTableCursorAdapter: AnyObject {
-    func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws
-    func next() throws
-    func eof() -> Bool
-    func column(at index: Int) throws -> ColumnValue
-    func rowid() throws -> Int64
+/// Transaction callbacks, with the raw values the C shim passes for each.
+enum VirtualTableTransactionEvent: Int32 {
+    case begin = 0
+    case sync = 1
+    case commit = 2
+    case rollback = 3
+    case savepoint = 4
+    case release = 5
+    case rollbackTo = 6
+
+    var name: String {
+        switch self {
+        case .begin: "Begin"
+        case .sync: "Sync"
+        case .commit: "Commit"
+        case .rollback: "Rollback"
+        case .savepoint: "Savepoint"
+        case .release: "Release"
+        case .rollbackTo: "Rollback to savepoint"
+        }
+    }
 }
 
-final class VirtualTableModuleAdapter<Module: VirtualTableModule>: AnyVirtualTableModuleAdapter {
-    var schema: String {
-        Module.schema
+/// Base class of the cursor adapters, recovered by the cursor callbacks the same way as
+/// ``AnyVirtualTableInstanceAdapter``.
+///
+/// `eof()` is read once after every `filter` and `next` and cached in the C cursor, so
+/// `xEof` is answered without entering Swift.
+class AnyVirtualTableCursorAdapter {
+    func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+        preconditionFailure("\(Self.self) must override filter(indexNumber:indexString:values:)")
+    }
+
+    func next() throws {
+        preconditionFailure("\(Self.self) must override next()")
+    }
+
+    func eof() -> Bool {
+        true
+    }
+
+    func column(at index: Int) throws -> ColumnValue {
+        .null
+    }
+
+    func rowid() throws -> Int64 {
+        0
+    }
+
+    /// Prepares the adapter for reuse after `xClose`, returning whether it can be reused.
+    func reset() -> Bool {
+        false
+    }
+}
+
+protocol AnyBulkWritableInstanceAdapter: AnyVirtualTableInstanceAdapter {
+    func stageInsert(
+        rowid requested: Int64?,
+        values: UnsafeMutablePointer<OpaquePointer?>,
+        count: Int
+    ) throws -> Int64
+}
+
+/// Base class of the batch cursor adapters. A cursor has a batch buffer exactly when its
+/// adapter is one of these, so `xFilter` and `xNext` downcast it without checking.
+class AnyBatchVirtualTableCursorAdapter: AnyVirtualTableCursorAdapter {
+    var columnCount: Int {
+        0
+    }
+
+    var batchCapacity: Int {
+        1
+    }
+
+    func fillBatch(_ batch: UnsafeMutablePointer<SQLiteVirtualBatch>) throws {
+        preconditionFailure("\(Self.self) must override fillBatch(_:)")
     }
+}
+
+final class VirtualTableModuleAdapter<Module: VirtualTableModule>: AnyVirtualTableModuleAdapter {
     func create(arguments: [String]) throws -> AnyVirtualTableInstanceAdapter {
         let module = try Module.create(arguments: arguments)
-        return VirtualTableInstanceAdapter(module: module)
+        return makeInstanceAdapter(for: module)
     }
 
     func connect(arguments: [String]) throws -> AnyVirtualTableInstanceAdapter {
         let module = try Module.connect(arguments: arguments)
+        return makeInstanceAdapter(for: module)
+    }
+
+    private func makeInstanceAdapter(for module: Module) -> AnyVirtualTableInstanceAdapter {
+        if let bulkModule = module as? any BulkWritableVirtualTable {
+            return makeBulkInstanceAdapter(for: bulkModule)
+        }
         return VirtualTableInstanceAdapter(module: module)
     }
+
+    private func makeBulkInstanceAdapter<BulkModule: BulkWritableVirtualTable>(
+        for module: BulkModule
+    ) -> AnyVirtualTableInstanceAdapter {
+        BulkWritableInstanceAdapter(module: module)
+    }
 }
 
-final class VirtualTableInstanceAdapter<Module: VirtualTableModule>: AnyVirtualTableInstanceAdapter {
-    private var module: Module
+class VirtualTableInstanceAdapter<Module: VirtualTableModule>: AnyVirtualTableInstanceAdapter {
+    fileprivate var module: Module
+    /// Overloaded functions handed to SQLite, kept alive for as long as the table.
+    private var functions: [String: (code: Int32, box: FunctionBox)] = [:]
 
     init(module: Module) {
         self.module = module
     }
 
-    func bestIndex(info: inout IndexInfo) {
+    override var schema: String {
+        module.declaredSchema
+    }
+
+    override func bestIndex(info: inout IndexInfo) {
         info = module.bestIndex(info)
     }
 
-    func disconnect() {
+    override func disconnect() {
         module.disconnect()
     }
 
-    func open() throws -> AnyVirtualTableCursorAdapter {
+    override func open() throws -> AnyVirtualTableCursorAdapter {
         let cursor = try module.open()
+        if let batchCursor = cursor as? any BatchVirtualTableCursor {
+            return makeBatchCursorAdapter(for: batchCursor)
+        }
+        if let asyncCursor = cursor as? any AsyncVirtualTableCursor {
+            return makeAsyncCursorAdapter(for: asyncCursor)
+        }
         return VirtualTableCursorAdapter(cursor: cursor)
     }
 
-    func update(operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
+    private func makeAsyncCursorAdapter<AsyncCursor: AsyncVirtualTableCursor>(
+        for cursor: AsyncCursor
+    ) -> AnyVirtualTableCursorAdapter {
+        AsyncVirtualTableCursorAdapter(cursor: cursor)
+    }
+
+    private func makeBatchCursorAdapter<BatchCursor: BatchVirtualTableCursor>(
+        for cursor: BatchCursor
+    ) -> AnyVirtualTableCursorAdapter {
+        BatchVirtualTableCursorAdapter(cursor: cursor)
+    }
+
+    override func update(operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
         try module.update(operation)
     }
+
+    override func findFunction(name: String, argumentCount: Int) -> (code: Int32, box: FunctionBox)? {
+        let key = "\(name)/\(argumentCount)"
+        if let cached = functions[key] {
+            return cached
+        }
+        guard let overload = module.findFunction(name: name, argumentCount: argumentCount) else {
+            return nil
+        }
+
+        let code = overload.constraintIndex.map {
+            SQLITE_INDEX_CONSTRAINT_FUNCTION + Int32($0)
+        } ?? 1
+        let entry = (code: code, box: FunctionBox(name: name, function: overload.function))
+        functions[key] = entry
+        return entry
+    }
+
+    override func transaction(_ event: VirtualTableTransactionEvent, savepoint: Int) throws {
+        switch event {
+        case .begin:
+            try module.begin()
+        case .sync:
+            try module.sync()
+        case .commit:
+            try module.commit()
+        case .rollback:
+            try module.rollback()
+        case .savepoint:
+            try module.savepoint(savepoint)
+        case .release:
+            try module.release(savepoint: savepoint)
+        case .rollbackTo:
+            try module.rollback(toSavepoint: savepoint)
+        }
+    }
+}
+
+/// Stages inserted rows in a columnar batch and hands them to the module in bulk.
+///
+/// Staged rows are flushed before anything that could observe them: reads, updates and
+/// deletes, savepoints, and the end of the transaction. Every savepoint flushes, so rows
+/// still staged at a rollback were all inserted after the savepoint and are dropped.
+///
+/// Rows are only ever staged inside a transaction, and every commit flushes them. Rows still
+/// staged at `xDisconnect` or `xDestroy` therefore belong to a transaction that never
+/// committed. They are dropped, as a rollback would drop them, rather than delivered.
+final class BulkWritableInstanceAdapter<Module: BulkWritableVirtualTable>:
+    VirtualTableInstanceAdapter<Module>, AnyBulkWritableInstanceAdapter {
+    private var staged: UnsafeMutablePointer<SQLiteVirtualBatch>?
+
+    deinit {
+        SQLiteExtensionKit_BatchFree(staged)
+    }
+
+    override var bulkWriter: AnyBulkWritableInstanceAdapter? {
+        self
+    }
+
+    func stageInsert(
+        rowid requested: Int64?,
+        values: UnsafeMutablePointer<OpaquePointer?>,
+        count: Int
+    ) throws -> Int64 {
+        if staged == nil {
+            staged = SQLiteExtensionKit_BatchCreate(
+                Int32(count),
+                Int32(max(1, Module.insertBatchCapacity))
+            )
+        }
+        guard let batch = staged else {
+            throw SQLiteExtensionError.sqliteError(code: SQLITE_NOMEM)
+        }
+
+        // Copy the values before choosing the rowid, so a row that fails to stage has not
+        // used one up. A failed row is taken back out, and its arena bytes with it.
+        let arenaUsed = batch.pointee.arenaUsed
+        func unstageRow() {
+            batch.pointee.rowCount -= 1
+            batch.pointee.arenaUsed = arenaUsed
+        }
+        let row = SQLiteExtensionKit_BatchAppendRow(batch, 0)
+        for column in 0..<min(count, Int(batch.pointee.columnCount)) {
+            let result = SQLiteExtensionKit_BatchSetValue(batch, row, Int32(column), values[column])
+            if result != SQLITE_OK {
+                unstageRow()
+                throw SQLiteExtensionError.sqliteError(code: result)
+            }
+        }
+        let rowid: Int64
+        do {
+            rowid = try module.assignRowID(requested: requested)
+        } catch {
+            unstageRow()
+            throw error
+        }
+        batch.pointee.rowids[Int(row)] = rowid
+
+        if batch.pointee.rowCount >= batch.pointee.capacity {
+            try flushStagedRows()
+        }
+        return rowid
+    }
+
+    private func flushStagedRows() throws {
+        guard let batch = staged, batch.pointee.rowCount > 0 else { return }
+        defer { SQLiteExtensionKit_BatchReset(batch) }
+        try module.insertBatch(RowBatch(batch))
+    }
+
+    private func discardStagedRows() {
+        SQLiteExtensionKit_BatchReset(staged)
+    }
+
+    override func disconnect() {
+        // Anything left belongs to an uncommitted transaction; see the type's documentation.
+        discardStagedRows()
+        super.disconnect()
+    }
+
+    override func willOpen() throws {
+        try flushStagedRows()
+    }
+
+    override func update(operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
+        try flushStagedRows()
+        return try super.update(operation: operation)
+    }
+
+    override func transaction(_ event: VirtualTableTransactionEvent, savepoint: Int) throws {
+        switch event {
+        case .sync, .commit, .savepoint:
+            try flushStagedRows()
+        case .rollback, .rollbackTo:
+            discardStagedRows()
+        case .begin, .release:
+            break
+        }
+        try super.transaction(event, savepoint: savepoint)
+    }
 }
 
 final class VirtualTableCursorAdapter<Cursor: VirtualTableCursor>: AnyVirtualTableCursorAdapter {
@@ -78,7 +359,7 @@ final class VirtualTableCursorAdapter<Cursor: VirtualTableCursor>: AnyVirtualTab
         self.cursor = cursor
     }
 
-    func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+    override func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
         try cursor.filter(
             indexNumber: indexNumber,
             indexString: indexString,
@@ -86,21 +367,331 @@ final class VirtualTableCursorAdapter<Cursor: VirtualTableCursor>: AnyVirtualTab
         )
     }
 
-    func next() throws {
+    override func next() throws {
         try cursor.next()
     }
 
-    func eof() -> Bool {
+    override func eof() -> Bool {
         cursor.eof
     }
 
-    func column(at index: Int) throws -> ColumnValue {
+    override func column(at index: Int) throws -> ColumnValue {
         try cursor.column(at: index)
     }
 
-    func rowid() throws -> Int64 {
+    override func rowid() throws -> Int64 {
         cursor.rowid
     }
+
+    override func reset() -> Bool {
+        cursor.reset()
+    }
+}
+
+final class BatchVirtualTableCursorAdapter<Cursor: BatchVirtualTableCursor>: AnyBatchVirtualTableCursorAdapter {
+    private var cursor: Cursor
+
+    init(cursor: Cursor) {
+        self.cursor = cursor
+    }
+
+    override var columnCount: Int {
+        Cursor.columnCount
+    }
+
+    override var batchCapacity: Int {
+        Cursor.batchCapacity
+    }
+
+    override func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+        try cursor.filter(
+            indexNumber: indexNumber,
+            indexString: indexString,
+            values: values
+        )
+    }
+
+    override func next() throws {
+        try cursor.next()
+    }
+
+    override func eof() -> Bool {
+        cursor.eof
+    }
+
+    override func column(at index: Int) throws -> ColumnValue {
+        try cursor.column(at: index)
+    }
+
+    override func rowid() throws -> Int64 {
+        cursor.rowid
+    }
+
+    override func reset() -> Bool {
+        cursor.reset()
+    }
+
+    override func fillBatch(_ batch: UnsafeMutablePointer<SQLiteVirtualBatch>) throws {
+        SQLiteExtensionKit_BatchReset(batch)
+        try cursor.fillBatch(VirtualTableBatch(batch))
+    }
+}
+
+/// Serves rows from batches that a detached task prefetches from the cursor's sequence.
+final class AsyncVirtualTableCursorAdapter<Cursor: AsyncVirtualTableCursor>: AnyVirtualTableCursorAdapter {
+    private var cursor: Cursor
+    private var queue: AsyncRowBatchQueue?
+    private var producer: Task<Void, Never>?
+    private var batch: [VirtualTableRow] = []
+    private var position = 0
+
+    init(cursor: Cursor) {
+        self.cursor = cursor
+    }
+
+    deinit {
+        stopProducer()
+    }
+
+    override func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+        stopProducer()
+        let batches = try cursor.batches(
+            indexNumber: indexNumber,
+            indexString: indexString,
+            values: values
+        )
+        let queue = AsyncRowBatchQueue(limit: Cursor.prefetchLimit)
+        self.queue = queue
+        producer = Task.detached {
+            await queue.produce(batches)
+        }
+        try takeBatch()
+    }
+
+    override func next() throws {
+        position += 1
+        if position >= batch.count {
+            try takeBatch()
+        }
+    }
+
+    override func eof() -> Bool {
+        position >= batch.count
+    }
+
+    override func column(at index: Int) throws -> ColumnValue {
+        let columns = batch[position].columns
+        return index < columns.count ? columns[index] : .null
+    }
+
+    override func rowid() throws -> Int64 {
+        batch[position].rowid
+    }
+
+    override func reset() -> Bool {
+        stopProducer()
+        return cursor.reset()
+    }
+
+    /// Replaces the consumed batch with the next one, leaving the cursor at eof after the last.
+    private func takeBatch() throws {
+        batch = []
+        position = 0
+        batch = try queue?.pop() ?? []
+    }
+
+    private func stopProducer() {
+        queue?.close()
+        producer?.cancel()
+        queue = nil
+        producer = nil
+        batch = []
+        position = 0
+    }
+}
+
+// MARK: - Table-Valued Functions
+
+/// An eponymous module whose schema is the output columns followed by one HIDDEN
+/// column per parameter.
+final class TableValuedFunctionModuleAdapter<Rows: Sequence>: AnyVirtualTableModuleAdapter {
+    let schema: String
+    let columnCount: Int
+    let parameterCount: Int
+    let makeRows: @Sendable ([SQLiteValue?]) throws -> Rows
+    let value: (Rows.Element, Int) -> ColumnValue
+
+    init(
+        columns: [String],
+        parameters: [String],
+        makeRows: @escaping @Sendable ([SQLiteValue?]) throws -> Rows,
+        value: @escaping (Rows.Element, Int) -> ColumnValue
+    ) {
+        let declarations = columns + parameters.map { "\($0) HIDDEN" }
+        schema = "CREATE TABLE x(\(declarations.joined(separator: ", ")))"
+        columnCount = columns.count
+        parameterCount = parameters.count
+        self.makeRows = makeRows
+        self.value = value
+    }
+
+    func create(arguments: [String]) throws -> AnyVirtualTableInstanceAdapter {
+        // Eponymous-only modules have no xCreate, so CREATE VIRTUAL TABLE never gets here.
+        throw SQLiteExtensionError.sqliteError(code: SQLITE_MISUSE)
+    }
+
+    func connect(arguments: [String]) throws -> AnyVirtualTableInstanceAdapter {
+        TableValuedFunctionInstanceAdapter(module: self)
+    }
+}
+
+final class TableValuedFunctionInstanceAdapter<Rows: Sequence>: AnyVirtualTableInstanceAdapter {
+    private let module: TableValuedFunctionModuleAdapter<Rows>
+
+    init(module: TableValuedFunctionModuleAdapter<Rows>) {
+        self.module = module
+    }
+
+    override var schema: String {
+        module.schema
+    }
+
+    /// Binds each parameter to its first usable equality constraint, in parameter order.
+    ///
+    /// `indexNumber` records the bound parameters as a bitmask. A plan in which a
+    /// parameter is constrained but not yet usable, such as the inner side of a join
+    /// evaluated in the wrong order, gets a prohibitive cost so SQLite picks the order
+    /// that supplies it; parameters that are not constrained at all are passed as NULL.
+    override func bestIndex(info: inout IndexInfo) {
+        var bound = 0
+        var argvIndex = 1
+        var missingUsable = false
+
+        for parameter in 0..<module.parameterCount {
+            let column = module.columnCount + parameter
+            let candidates = info.constraints.indices.filter {
+                info.constraints[$0].column == column && info.constraints[$0].op == .eq
+            }
+            guard !candidates.isEmpty else { continue }
+            guard let index = candidates.first(where: { info.constraints[$0].usable }) else {
+                missingUsable = true
+                continue
+            }
+            info.constraintUsage[index].argvIndex = argvIndex
+            info.constraintUsage[index].omit = true
+            argvIndex += 1
+            bound |= 1 << parameter
+        }
+
+        info.indexNumber = bound
+        if missingUsable {
+            info.estimatedCost = 1e300
+            info.estimatedRows = Int64.max
+        } else {
+            info.estimatedCost = 1000
+            info.estimatedRows = 1000
+        }
+    }
+
+    override func open() throws -> AnyVirtualTableCursorAdapter {
+        TableValuedFunctionCursorAdapter(module: module)
+    }
+}
+
+/// Pulls one element from the sequence per `xNext`, so memory stays constant and a
+/// `LIMIT` stops the sequence as soon as SQLite stops asking.
+final class TableValuedFunctionCursorAdapter<Rows: Sequence>: AnyVirtualTableCursorAdapter {
+    private let module: TableValuedFunctionModuleAdapter<Rows>
+    private var iterator: Rows.Iterator?
+    private var current: Rows.Element?
+    /// Protected copies of the bound arguments, owned by the cursor.
+    private var arguments: [SQLiteValue?] = []
+    private var rowNumber: Int64 = 0
+
+    init(module: TableValuedFunctionModuleAdapter<Rows>) {
+        self.module = module
+    }
+
+    deinit {
+        iterator = nil
+        freeArguments()
+    }
+
+    override func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+        // Reset first so a failed filter leaves the cursor at EOF. The sequence may read
+        // its arguments after xFilter returns, so they are duplicated rather than borrowed.
+        iterator = nil
+        current = nil
+        freeArguments()
+
+        var remaining = values.makeIterator()
+        for parameter in 0..<module.parameterCount {
+            guard indexNumber & (1 << parameter) != 0, let value = remaining.next() else {
+                arguments.append(nil)
+                continue
+            }
+            guard let copy = sqlite3_value_dup(value.pointer) else {
+                throw SQLiteExtensionError.sqliteError(code: SQLITE_NOMEM)
+            }
+            arguments.append(SQLiteValue(copy))
+        }
+
+        var rows = try module.makeRows(arguments).makeIterator()
+        current = rows.next()
+        iterator = rows
+        rowNumber = 1
+        try checkFailure()
+    }
+
+    override func next() throws {
+        current = iterator?.next()
+        rowNumber += 1
+        try checkFailure()
+    }
+
+    /// Throws the error a ``FailableRowIterator`` ended with, once the rows have ended.
+    private func checkFailure() throws {
+        if current == nil, let rows = iterator as? any FailableRowIterator, let failure = rows.failure {
+            throw failure
+        }
+    }
+
+    override func eof() -> Bool {
+        current == nil
+    }
+
+    override func column(at index: Int) throws -> ColumnValue {
+        if index >= module.columnCount {
+            let parameter = index - module.columnCount
+            guard parameter < arguments.count, let argument = arguments[parameter] else {
+                return .null
+            }
+            return ColumnValue(copying: argument)
+        }
+        guard let current else { return .null }
+        return module.value(current, index)
+    }
+
+    override func rowid() throws -> Int64 {
+        rowNumber
+    }
+
+    override func reset() -> Bool {
+        iterator = nil
+        current = nil
+        freeArguments()
+        rowNumber = 0
+        return true
+    }
+
+    private func freeArguments() {
+        for argument in arguments {
+            if let argument {
+                sqlite3_value_free(argument.pointer)
+            }
+        }
+        arguments.removeAll(keepingCapacity: true)
+    }
 }
 
 // MARK: - Descriptor & Registry
@@ -108,10 +699,12 @@ final class VirtualTableCursorAdapter<Cursor: VirtualTableCursor>: AnyVirtualTab
 final class VirtualTableModuleDescriptor: @unchecked Sendable {
     let name: String
     let adapter: AnyVirtualTableModuleAdapter
+    let probes: VirtualTableProbes?
 
     init(name: String, adapter: AnyVirtualTableModuleAdapter) {
         self.name = name
         self.adapter = adapter
+        self.probes = VirtualTableProbes(module: name)
     }
 }
 
@@ -145,6 +738,15 @@ private func values(from argc: Int32, argv: UnsafeMutablePointer<OpaquePointer?>
     return result
 }
 
+/// Returns the probes of the module a table belongs to, while instrumentation is enabled.
+@inline(__always)
+private func probes(of table: UnsafeMutablePointer<SQLiteVirtualTable>?) -> VirtualTableProbes? {
+    guard SQLiteInstrumentation.isEnabled, let context = table?.pointee.moduleContext else {
+        return nil
+    }
+    return Unmanaged<VirtualTableModuleDescriptor>.fromOpaque(context).takeUnretainedValue().probes
+}
+
 private func allocateVirtualTable() -> UnsafeMutablePointer<SQLiteVirtualTable>? {
     let size = sqlite3_uint64(MemoryLayout<SQLiteVirtualTable>.stride)
     guard let raw = sqlite3_malloc64(size) else {
@@ -166,6 +768,8 @@ private func allocateCursor() -> UnsafeMutablePointer<SQLiteVirtualCursor>? {
     let pointer = raw.bindMemory(to: SQLiteVirtualCursor.self, capacity: 1)
     pointer.pointee.swiftCursor = nil
     pointer.pointee.table = nil
+    pointer.pointee.batch = nil
+    pointer.pointee.eof = 1
     return pointer
 }
 
@@ -173,10 +777,7 @@ private func releaseVirtualTable(_ pointer: UnsafeMutablePointer<SQLiteVirtualTa
     guard let pointer = pointer else { return }
 
     if let swiftPointer = pointer.pointee.swiftTable {
-        let object = Unmanaged<AnyObject>
-            .fromOpaque(swiftPointer)
-            .takeRetainedValue()
-        _ = object as? AnyVirtualTableInstanceAdapter
+        Unmanaged<AnyVirtualTableInstanceAdapter>.fromOpaque(swiftPointer).release()
     }
 
     sqlite3_free(pointer)
@@ -186,57 +787,62 @@ private func releaseCursor(_ pointer: UnsafeMutablePointer<SQLiteVirtualCursor>?
     guard let pointer = pointer else { return }
 
     if let swiftPointer = pointer.pointee.swiftCursor {
-        let object = Unmanaged<AnyObject>
-            .fromOpaque(swiftPointer)
-            .takeRetainedValue()
-        _ = object as? AnyVirtualTableCursorAdapter
+        Unmanaged<AnyVirtualTableCursorAdapter>.fromOpaque(swiftPointer).release()
     }
 
+    SQLiteExtensionKit_BatchFree(pointer.pointee.batch)
+    pointer.pointee.batch = nil
     sqlite3_free(pointer)
 }
 
+// The pointers stored in the C structs are only ever created from these base classes, so
+// they are recovered with a plain reinterpretation rather than a checked cast.
+
 private func retainInstancePointer(
     for instance: AnyVirtualTableInstanceAdapter
 ) -> UnsafeMutableRawPointer {
-    Unmanaged.passRetained(instance as AnyObject).toOpaque()
+    Unmanaged.passRetained(instance).toOpaque()
 }
 
+@inline(__always)
 private func takeInstanceUnretained(
     _ pointer: UnsafeMutableRawPointer
-) -> AnyVirtualTableInstanceAdapter? {
-    Unmanaged<AnyObject>
-        .fromOpaque(pointer)
-        .takeUnretainedValue() as? AnyVirtualTableInstanceAdapter
+) -> AnyVirtualTableInstanceAdapter {
+    Unmanaged<AnyVirtualTableInstanceAdapter>.fromOpaque(pointer).takeUnretainedValue()
 }
 
 private func takeInstanceRetained(
     _ pointer: UnsafeMutableRawPointer
-) -> AnyVirtualTableInstanceAdapter? {
-    Unmanaged<AnyObject>
-        .fromOpaque(pointer)
-        .takeRetainedValue() as? AnyVirtualTableInstanceAdapter
+) -> AnyVirtualTableInstanceAdapter {
+    Unmanaged<AnyVirtualTableInstanceAdapter>.fromOpaque(pointer).takeRetainedValue()
 }
 
 private func retainCursorPointer(
     for cursor: AnyVirtualTableCursorAdapter
 ) -> UnsafeMutableRawPointer {
-    Unmanaged.passRetained(cursor as AnyObject).toOpaque()
+    Unmanaged.passRetained(cursor).toOpaque()
 }
 
+@inline(__always)
 private func takeCursorUnretained(
     _ pointer: UnsafeMutableRawPointer
-) -> AnyVirtualTableCursorAdapter? {
-    Unmanaged<AnyObject>
-        .fromOpaque(pointer)
-        .takeUnretainedValue() as? AnyVirtualTableCursorAdapter
+) -> AnyVirtualTableCursorAdapter {
+    Unmanaged<AnyVirtualTableCursorAdapter>.fromOpaque(pointer).takeUnretainedValue()
 }
 
 private func takeCursorRetained(
     _ pointer: UnsafeMutableRawPointer
-) -> AnyVirtualTableCursorAdapter? {
-    Unmanaged<AnyObject>
-        .fromOpaque(pointer)
-        .takeRetainedValue() as? AnyVirtualTableCursorAdapter
+) -> AnyVirtualTableCursorAdapter {
+    Unmanaged<AnyVirtualTableCursorAdapter>.fromOpaque(pointer).takeRetainedValue()
+}
+
+/// Copies the cursor's end-of-scan state into the C cursor, where `xEof` reads it.
+@inline(__always)
+private func cacheEof(
+    of cursor: AnyVirtualTableCursorAdapter,
+    in cursorPointer: UnsafeMutablePointer<SQLiteVirtualCursor>
+) {
+    cursorPointer.pointee.eof = cursor.eof() ? 1 : 0
 }
 
 private func assignVirtualTableError(
@@ -260,12 +866,26 @@ private func swiftIndexInfo(from pointer: UnsafeMutablePointer<sqlite3_index_inf
         for idx in 0..<Int(info.nConstraint) {
             let constraint = constraintPointer[idx]
             let opValue = Int32(constraint.op)
-            let op = IndexInfo.Constraint.Operator(rawValue: opValue) ?? .eq
+            let isFunction = opValue >= SQLITE_INDEX_CONSTRAINT_FUNCTION
+            let op: IndexInfo.Constraint.Operator? = isFunction
+                ? .function
+                : IndexInfo.Constraint.Operator(rawValue: opValue)
+
+            var rightHand: OpaquePointer?
+            let rightHandValue = sqlite3_vtab_rhs_value(pointer, Int32(idx), &rightHand) == SQLITE_OK
+                ? rightHand.map { ColumnValue(copying: SQLiteValue($0)) }
+                : nil
+
             constraints.append(
                 .init(
                     column: Int(constraint.iColumn),
-                    op: op,
-                    usable: constraint.usable != 0
+                    op: op ?? .eq,
+                    // An operator this version does not know cannot be handled correctly.
+                    usable: op != nil && constraint.usable != 0,
+                    functionIndex: isFunction ? Int(opValue - SQLITE_INDEX_CONSTRAINT_FUNCTION) : 0,
+                    collation: sqlite3_vtab_collation(pointer, Int32(idx)).map { String(cString: $0) } ?? "BINARY",
+                    rightHandValue: rightHandValue,
+                    isInList: sqlite3_vtab_in(pointer, Int32(idx), -1) != 0
                 )
             )
         }
@@ -307,7 +927,10 @@ private func swiftIndexInfo(from pointer: UnsafeMutablePointer<sqlite3_index_inf
         indexNumber: Int(info.idxNum),
         indexString: info.idxStr.flatMap { String(cString: $0) },
         orderByConsumed: info.orderByConsumed != 0,
-        constraintUsage: constraintUsage
+        constraintUsage: constraintUsage,
+        columnsUsed: info.colUsed,
+        distinct: IndexInfo.Distinct(rawValue: sqlite3_vtab_distinct(pointer)) ?? .ordered,
+        flags: IndexInfo.Flags(rawValue: info.idxFlags)
     )
 }
 
@@ -343,6 +966,7 @@ private func apply(
     pointer.pointee.orderByConsumed = indexInfo.orderByConsumed ? 1 : 0
     pointer.pointee.estimatedCost = indexInfo.estimatedCost
     pointer.pointee.estimatedRows = indexInfo.estimatedRows
+    pointer.pointee.idxFlags = indexInfo.flags.rawValue
 
     if let usagePointer = pointer.pointee.aConstraintUsage {
         let limit = min(Int(pointer.pointee.nConstraint), indexInfo.constraintUsage.count)
@@ -350,6 +974,9 @@ private func apply(
             let usage = indexInfo.constraintUsage[index]
             usagePointer[index].argvIndex = Int32(usage.argvIndex)
             usagePointer[index].omit = UInt8(usage.omit ? 1 : 0)
+            if usage.inListAtOnce {
+                sqlite3_vtab_in(pointer, Int32(index), 1)
+            }
         }
     }
 }
@@ -386,6 +1013,7 @@ func SQLiteExtensionKit_VirtualTableCreate(
         }
 
         guard let tablePointer = allocateVirtualTable() else {
+            instance.disconnect()
             return SQLITE_NOMEM
         }
 
@@ -393,11 +1021,12 @@ func SQLiteExtensionKit_VirtualTableCreate(
         tablePointer.pointee.moduleContext = context
 
         if let db {
-            let result = descriptor.adapter.schema.withCString { schema in
+            let result = instance.schema.withCString { schema in
                 sqlite3_declare_vtab(db, schema)
             }
 
             if result != SQLITE_OK {
+                instance.disconnect()
                 releaseVirtualTable(tablePointer)
                 if let pzErr, pzErr.pointee == nil {
                     let message = String(cString: sqlite3_errmsg(db))
@@ -431,9 +1060,7 @@ func SQLiteExtensionKit_VirtualTableBestIndex(
         return SQLITE_ERROR
     }
 
-    guard let instance = takeInstanceUnretained(swiftPointer) else {
-        return SQLITE_ERROR
-    }
+    let instance = takeInstanceUnretained(swiftPointer)
 
     var swiftInfo = swiftIndexInfo(from: indexInfoPointer)
     instance.bestIndex(info: &swiftInfo)
@@ -449,8 +1076,12 @@ func SQLiteExtensionKit_VirtualTableDisconnect(
         return SQLITE_ERROR
     }
 
-    if let swiftPointer = tablePointer.pointee.swiftTable,
-       let instance = takeInstanceRetained(swiftPointer) {
+    if let swiftPointer = tablePointer.pointee.swiftTable {
+        let instance = takeInstanceRetained(swiftPointer)
+        for cursorPointer in instance.cursorPool {
+            releaseCursor(cursorPointer)
+        }
+        instance.cursorPool.removeAll()
         instance.disconnect()
     }
 
@@ -479,25 +1110,48 @@ func SQLiteExtensionKit_VirtualTableOpen(
         return SQLITE_ERROR
     }
 
-    guard let instance = takeInstanceUnretained(swiftPointer) else {
+    let instance = takeInstanceUnretained(swiftPointer)
+
+    do {
+        try instance.willOpen()
+    } catch {
+        assignVirtualTableError(tablePointer, message: "Open failed: \(error)")
         return SQLITE_ERROR
     }
 
-    do {
-        let cursor = try instance.open()
-        guard let cursorPointer = allocateCursor() else {
-            return SQLITE_NOMEM
+    guard let cursorPointer = instance.cursorPool.popLast() ?? allocateCursor() else {
+        return SQLITE_NOMEM
+    }
+    cursorPointer.pointee.table = tablePointer
+    cursorPointer.pointee.eof = 1
+
+    if cursorPointer.pointee.swiftCursor == nil {
+        let cursor: AnyVirtualTableCursorAdapter
+        do {
+            cursor = try instance.open()
+        } catch {
+            releaseCursor(cursorPointer)
+            assignVirtualTableError(tablePointer, message: "Open failed: \(error)")
+            return SQLITE_ERROR
         }
-
-        cursorPointer.pointee.table = tablePointer
         cursorPointer.pointee.swiftCursor = retainCursorPointer(for: cursor)
 
-        outCursor?.pointee = cursorPointer
-        return SQLITE_OK
-    } catch {
-        assignVirtualTableError(tablePointer, message: "Open failed: \(error)")
-        return SQLITE_ERROR
+        // Every cursor of a table has the same type, so a pooled batch buffer fits.
+        if cursorPointer.pointee.batch == nil,
+           let batchCursor = cursor as? AnyBatchVirtualTableCursorAdapter {
+            guard let batch = SQLiteExtensionKit_BatchCreate(
+                Int32(batchCursor.columnCount),
+                Int32(max(1, batchCursor.batchCapacity))
+            ) else {
+                releaseCursor(cursorPointer)
+                return SQLITE_NOMEM
+            }
+            cursorPointer.pointee.batch = batch
+        }
     }
+
+    outCursor?.pointee = cursorPointer
+    return SQLITE_OK
 }
 
 @_cdecl("SQLiteExtensionKit_VirtualTableClose")
@@ -509,11 +1163,21 @@ func SQLiteExtensionKit_VirtualTableClose(
     }
 
     if let swiftPointer = cursorPointer.pointee.swiftCursor,
-       let cursor = takeCursorRetained(swiftPointer) {
-        _ = cursor
+       !takeCursorUnretained(swiftPointer).reset() {
+        _ = takeCursorRetained(swiftPointer)
+        cursorPointer.pointee.swiftCursor = nil
+    }
+
+    if let swiftTable = cursorPointer.pointee.table?.pointee.swiftTable {
+        let instance = takeInstanceUnretained(swiftTable)
+        if instance.cursorPool.count < AnyVirtualTableInstanceAdapter.cursorPoolLimit {
+            cursorPointer.pointee.table = nil
+            SQLiteExtensionKit_BatchReset(cursorPointer.pointee.batch)
+            instance.cursorPool.append(cursorPointer)
+            return SQLITE_OK
+        }
     }
 
-    cursorPointer.pointee.swiftCursor = nil
     cursorPointer.pointee.table = nil
     releaseCursor(cursorPointer)
     return SQLITE_OK
@@ -534,66 +1198,80 @@ func SQLiteExtensionKit_VirtualTableFilter(
         return SQLITE_ERROR
     }
 
-    guard let cursor = takeCursorUnretained(swiftPointer) else {
-        return SQLITE_ERROR
-    }
+    let cursor = takeCursorUnretained(swiftPointer)
 
     let arguments = values(from: argc, argv: argv)
     let indexString = idxStr.flatMap { String(cString: $0) }
 
     do {
-        try cursor.filter(
-            indexNumber: Int(idxNum),
-            indexString: indexString,
-            values: arguments
-        )
-        return SQLITE_OK
+        try instrumented(probes(of: cursorPointer.pointee.table)?.filter) {
+            try cursor.filter(
+                indexNumber: Int(idxNum),
+                indexString: indexString,
+                values: arguments
+            )
+        }
     } catch {
+        cursorPointer.pointee.eof = 1
         assignVirtualTableError(cursorPointer.pointee.table, message: "Filter failed: \(error)")
         return SQLITE_ERROR
     }
+
+    if cursorPointer.pointee.batch != nil {
+        return SQLiteExtensionKit_VirtualTableFillBatch(cursorPointer)
+    }
+    cacheEof(of: cursor, in: cursorPointer)
+    return SQLITE_OK
 }
 
-@_cdecl("SQLiteExtensionKit_VirtualTableNext")
-func SQLiteExtensionKit_VirtualTableNext(
+@_cdecl("SQLiteExtensionKit_VirtualTableFillBatch")
+func SQLiteExtensionKit_VirtualTableFillBatch(
     _ cursorPointer: UnsafeMutablePointer<SQLiteVirtualCursor>?
 ) -> Int32 {
     guard
         let cursorPointer,
-        let swiftPointer = cursorPointer.pointee.swiftCursor
+        let swiftPointer = cursorPointer.pointee.swiftCursor,
+        let batch = cursorPointer.pointee.batch
     else {
         return SQLITE_ERROR
     }
 
-    guard let cursor = takeCursorUnretained(swiftPointer) else {
-        return SQLITE_ERROR
-    }
+    let cursor = unsafeDowncast(takeCursorUnretained(swiftPointer), to: AnyBatchVirtualTableCursorAdapter.self)
 
     do {
-        try cursor.next()
+        try cursor.fillBatch(batch)
         return SQLITE_OK
     } catch {
-        assignVirtualTableError(cursorPointer.pointee.table, message: "Next failed: \(error)")
+        SQLiteExtensionKit_BatchReset(batch)
+        assignVirtualTableError(cursorPointer.pointee.table, message: "Fill batch failed: \(error)")
         return SQLITE_ERROR
     }
 }
 
-@_cdecl("SQLiteExtensionKit_VirtualTableEof")
-func SQLiteExtensionKit_VirtualTableEof(
+@_cdecl("SQLiteExtensionKit_VirtualTableNext")
+func SQLiteExtensionKit_VirtualTableNext(
     _ cursorPointer: UnsafeMutablePointer<SQLiteVirtualCursor>?
 ) -> Int32 {
     guard
         let cursorPointer,
         let swiftPointer = cursorPointer.pointee.swiftCursor
     else {
-        return 1
+        return SQLITE_ERROR
     }
 
-    guard let cursor = takeCursorUnretained(swiftPointer) else {
-        return 1
-    }
+    let cursor = takeCursorUnretained(swiftPointer)
 
-    return cursor.eof() ? 1 : 0
+    do {
+        try instrumented(probes(of: cursorPointer.pointee.table)?.next) {
+            try cursor.next()
+        }
+        cacheEof(of: cursor, in: cursorPointer)
+        return SQLITE_OK
+    } catch {
+        cursorPointer.pointee.eof = 1
+        assignVirtualTableError(cursorPointer.pointee.table, message: "Next failed: \(error)")
+        return SQLITE_ERROR
+    }
 }
 
 @_cdecl("SQLiteExtensionKit_VirtualTableColumn")
@@ -610,14 +1288,13 @@ func SQLiteExtensionKit_VirtualTableColumn(
         return SQLITE_ERROR
     }
 
-    guard let cursor = takeCursorUnretained(swiftPointer) else {
-        return SQLITE_ERROR
-    }
+    let cursor = takeCursorUnretained(swiftPointer)
 
     do {
-        let value = try cursor.column(at: Int(column))
         let context = SQLiteContext(contextPointer)
-        value.setResult(in: context)
+        try instrumented(probes(of: cursorPointer.pointee.table)?.column) {
+            try cursor.column(at: Int(column)).setResult(in: context)
+        }
         return SQLITE_OK
     } catch {
         assignVirtualTableError(cursorPointer.pointee.table, message: "Column failed: \(error)")
@@ -638,9 +1315,7 @@ func SQLiteExtensionKit_VirtualTableRowid(
         return SQLITE_ERROR
     }
 
-    guard let cursor = takeCursorUnretained(swiftPointer) else {
-        return SQLITE_ERROR
-    }
+    let cursor = takeCursorUnretained(swiftPointer)
 
     do {
         rowidPointer.pointee = try cursor.rowid()
@@ -666,14 +1341,36 @@ func SQLiteExtensionKit_VirtualTableUpdate(
         return SQLITE_ERROR
     }
 
-    guard let instance = takeInstanceUnretained(swiftPointer) else {
-        return SQLITE_ERROR
-    }
+    let instance = takeInstanceUnretained(swiftPointer)
 
     guard argc >= 1 else {
         return SQLITE_MISUSE
     }
 
+    // Bulk writable tables take inserts straight from the argument values.
+    if argc >= 2,
+       let bulkInstance = instance.bulkWriter,
+       argv[0].map({ sqlite3_value_type($0) == SQLITE_NULL }) ?? true {
+        let requestedRowid = argv[1].flatMap {
+            sqlite3_value_type($0) == SQLITE_NULL ? nil : sqlite3_value_int64($0)
+        }
+
+        do {
+            let rowid = try instrumented(probes(of: tablePointer)?.update) {
+                try bulkInstance.stageInsert(
+                    rowid: requestedRowid,
+                    values: argv + 2,
+                    count: Int(argc) - 2
+                )
+            }
+            rowidPointer?.pointee = rowid
+            return SQLITE_OK
+        } catch {
+            assignVirtualTableError(tablePointer, message: "Insert failed: \(error)")
+            return SQLITE_ERROR
+        }
+    }
+
     let argumentCount = Int(argc)
     let operation: VirtualTableUpdateOperation
 
@@ -741,7 +1438,9 @@ func SQLiteExtensionKit_VirtualTableUpdate(
     }
 
     do {
-        let result = try instance.update(operation: operation)
+        let result = try instrumented(probes(of: tablePointer)?.update) {
+            try instance.update(operation: operation)
+        }
         switch result {
         case .handled(let rowid):
             if let rowid, let rowidPointer {
@@ -757,6 +1456,75 @@ func SQLiteExtensionKit_VirtualTableUpdate(
     }
 }
 
+@_cdecl("SQLiteExtensionKit_VirtualTableTransaction")
+func SQLiteExtensionKit_VirtualTableTransaction(
+    _ tablePointer: UnsafeMutablePointer<SQLiteVirtualTable>?,
+    _ event: Int32,
+    _ savepoint: Int32
+) -> Int32 {
+    guard
+        let tablePointer,
+        let swiftPointer = tablePointer.pointee.swiftTable,
+        let event = VirtualTableTransactionEvent(rawValue: event)
+    else {
+        return SQLITE_ERROR
+    }
+
+    let instance = takeInstanceUnretained(swiftPointer)
+
+    do {
+        try instance.transaction(event, savepoint: Int(savepoint))
+        return SQLITE_OK
+    } catch {
+        assignVirtualTableError(tablePointer, message: "\(event.name) failed: \(error)")
+        return SQLITE_ERROR
+    }
+}
+
+@_cdecl("SQLiteExtensionKit_VirtualTableFindFunction")
+func SQLiteExtensionKit_VirtualTableFindFunction(
+    _ tablePointer: UnsafeMutablePointer<SQLiteVirtualTable>?,
+    _ argumentCount: Int32,
+    _ name: UnsafePointer<CChar>?,
+    _ outArgument: UnsafeMutablePointer<UnsafeMutableRawPointer?>?
+) -> Int32 {
+    guard
+        let tablePointer,
+        let swiftPointer = tablePointer.pointee.swiftTable,
+        let name,
+        let overload = takeInstanceUnretained(swiftPointer).findFunction(
+            name: String(cString: name).lowercased(),
+            argumentCount: Int(argumentCount)
+        )
+    else {
+        return 0
+    }
+
+    // The table keeps the box alive, so SQLite borrows it unretained.
+    outArgument?.pointee = Unmanaged.passUnretained(overload.box).toOpaque()
+    return overload.code
+}
+
+@_cdecl("SQLiteExtensionKit_VirtualTableCallFunction")
+func SQLiteExtensionKit_VirtualTableCallFunction(
+    _ contextPointer: OpaquePointer?,
+    _ argc: Int32,
+    _ argv: UnsafeMutablePointer<OpaquePointer?>?
+) {
+    guard let contextPointer, let userData = sqlite3_user_data(contextPointer) else {
+        return
+    }
+
+    let context = SQLiteContext(contextPointer)
+    let box = Unmanaged<FunctionBox>.fromOpaque(userData).takeUnretainedValue()
+
+    do {
+        try instrumented(box.probe) { try box.function(context, SQLiteArguments(argv, count: argc)) }
+    } catch {
+        context.resultError("Function error: \(error)")
+    }
+}
+
 // MARK: - Error Assignment Helper
 
 private func assignError(
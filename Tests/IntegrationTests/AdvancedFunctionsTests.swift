@@ -72,6 +72,75 @@ struct AdvancedFunctionsIntegrationTests {
         #expect(result3 == "NYC")
     }
 
+    /// Tests JSON extraction of every value type, and paths through arrays and
+    /// skipped subtrees
+    @Test("JSON extract values and paths")
+    func testJSONExtractPaths() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let json = #"""
+        {
+            "skipped": {"nested": [1, {"deep": "}]\"{["}], "text": "a \"quoted\" ] brace"},
+            "items": [{"name": "first"}, {"name": "se\u0063ond \ud83d\ude00"}, [10, 20]],
+            "pi": 3.25, "big": 1e3, "negative": -42, "yes": true, "no": false, "nothing": null,
+            "escaped\nkey": "found"
+        }
+        """#
+        func extract(_ path: String) -> String? {
+            executeScalarText(db, "SELECT quote(json_extract_simple('\(json)', '\(path)'))")
+        }
+
+        #expect(extract("$.items[0].name") == "'first'")
+        #expect(extract("$.items.1.name") == "'second 😀'")
+        #expect(extract("$.items[2][1]") == "20")
+        #expect(extract("$.items[3]") == "NULL")
+        #expect(extract("$.pi") == "3.25")
+        #expect(extract("$.big") == "1000.0")
+        #expect(extract("$.negative") == "-42")
+        #expect(extract("$.yes") == "1")
+        #expect(extract("$.no") == "0")
+        #expect(extract("$.nothing") == "NULL")
+        #expect(extract("$.missing") == "NULL")
+        #expect(extract("$.pi.deeper") == "NULL")
+        #expect(extract("$.escaped\nkey") == "'found'")
+        #expect(extract("$.skipped.text") == #"'a "quoted" ] brace'"#)
+        #expect(extract("$.items[2]") == "'[10, 20]'")
+
+        // Invalid JSON before the value is an error; a bad path is an error
+        var stmt: OpaquePointer?
+        sqlite3_prepare_v2(db, "SELECT json_extract_simple('{\"a\" 1, \"b\": 2}', '$.b')", -1, &stmt, nil)
+        #expect(sqlite3_step(stmt) == SQLITE_ERROR)
+        sqlite3_finalize(stmt)
+        sqlite3_prepare_v2(db, "SELECT json_extract_simple('{}', 'name')", -1, &stmt, nil)
+        #expect(sqlite3_step(stmt) == SQLITE_ERROR)
+        sqlite3_finalize(stmt)
+    }
+
+    /// Tests JSON extraction over many large rows with a path compiled once
+    @Test("JSON extract over large rows")
+    func testJSONExtractOverRows() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let setup = """
+        CREATE TABLE events (payload TEXT);
+        WITH RECURSIVE r(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM r WHERE n < 200)
+        INSERT INTO events
+        SELECT '{"padding": "' || hex(zeroblob(4000)) || '", "list": [' ||
+               substr(replace(hex(zeroblob(1000)), '00', ',[0]'), 2) ||
+               '], "user": {"id": ' || n || ', "name": "user' || n || '"}}'
+        FROM r;
+        """
+        #expect(sqlite3_exec(db, setup, nil, nil, nil) == SQLITE_OK)
+
+        #expect(executeScalarInt(db, "SELECT sum(json_extract_simple(payload, '$.user.id')) FROM events") == 20100)
+        #expect(
+            executeScalarInt(db, "SELECT count(*) FROM events WHERE json_extract_simple(payload, '$.user.name') = 'user7'")
+                == 1
+        )
+    }
+
     /// Tests JSON array contains
     @Test("JSON array contains function")
     func testJSONArrayContains() throws {
@@ -86,6 +155,16 @@ struct AdvancedFunctionsIntegrationTests {
 
         let result3 = executeScalarInt(db, "SELECT json_array_contains('[\"a\",\"b\",\"c\"]', 'b')")
         #expect(result3 == 1)
+
+        // Nested values are skipped, escapes are decoded, and numbers compare by value
+        let array = #"[{"b": "x"}, ["x"], "\u0078", 2.5, -0, 7]"#
+        #expect(executeScalarInt(db, "SELECT json_array_contains('\(array)', 'x')") == 1)
+        #expect(executeScalarInt(db, "SELECT json_array_contains('\(array)', '2.5')") == 1)
+        #expect(executeScalarInt(db, "SELECT json_array_contains('\(array)', '0')") == 1)
+        #expect(executeScalarInt(db, "SELECT json_array_contains('\(array)', '7')") == 1)
+        #expect(executeScalarInt(db, "SELECT json_array_contains('\(array)', 'b')") == 0)
+        #expect(executeScalarInt(db, "SELECT json_array_contains('{\"a\": 1}', '1')") == 0)
+        #expect(executeScalarInt(db, "SELECT json_array_contains('[1, 2', '3')") == 0)
     }
 
     /// Tests regular expression matching
@@ -117,6 +196,32 @@ struct AdvancedFunctionsIntegrationTests {
         #expect(result2 == "1234567890")
     }
 
+    /// Tests regex functions with constant and per-row patterns over table data
+    @Test("Regular expressions over table rows")
+    func testRegexOverRows() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let setup = """
+        CREATE TABLE logs (msg TEXT, pattern TEXT);
+        INSERT INTO logs VALUES
+            ('error: disk full', '^error'),
+            ('warning: low memory', '^warn'),
+            ('error: timeout', 'timeout$'),
+            ('info: started', '^error');
+        """
+        #expect(sqlite3_exec(db, setup, nil, nil, nil) == SQLITE_OK)
+
+        #expect(executeScalarInt(db, "SELECT count(*) FROM logs WHERE regexp_match(msg, '^error')") == 2)
+        #expect(executeScalarInt(db, "SELECT count(*) FROM logs WHERE regexp_match(msg, pattern)") == 3)
+        #expect(
+            executeScalarText(
+                db,
+                "SELECT group_concat(regexp_replace(msg, ':.*', ''), ',') FROM logs"
+            ) == "error,warning,error,info"
+        )
+    }
+
     /// Tests Levenshtein distance
     @Test("Levenshtein distance")
     func testLevenshtein() throws {
@@ -131,6 +236,75 @@ struct AdvancedFunctionsIntegrationTests {
 
         let result3 = executeScalarInt(db, "SELECT levenshtein('abc', 'xyz')")
         #expect(result3 == 3)
+
+        // Empty strings
+        #expect(executeScalarInt(db, "SELECT levenshtein('', '')") == 0)
+        #expect(executeScalarInt(db, "SELECT levenshtein('', 'abc')") == 3)
+        #expect(executeScalarInt(db, "SELECT levenshtein('abc', '')") == 3)
+
+        // Scalars, not bytes, are compared
+        #expect(executeScalarInt(db, "SELECT levenshtein('café', 'cafe')") == 1)
+        #expect(executeScalarInt(db, "SELECT levenshtein('日本語', '日本')") == 1)
+
+        // NULL gives NULL
+        #expect(executeScalarText(db, "SELECT typeof(levenshtein(NULL, 'abc'))") == "null")
+    }
+
+    /// Tests Levenshtein distance against the full matrix, on both sides of the
+    /// 64-scalar bit-parallel limit
+    @Test("Levenshtein distance matches the reference")
+    func testLevenshteinReference() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        func reference(_ lhs: [Character], _ rhs: [Character]) -> Int {
+            var previous = Array(0...rhs.count)
+            for (i, left) in lhs.enumerated() {
+                var current = [i + 1] + Array(repeating: 0, count: rhs.count)
+                for (j, right) in rhs.enumerated() {
+                    current[j + 1] = min(previous[j + 1] + 1, current[j] + 1, previous[j] + (left == right ? 0 : 1))
+                }
+                previous = current
+            }
+            return previous[rhs.count]
+        }
+
+        var generator = SystemRandomNumberGenerator()
+        let alphabets: [[Character]] = [["a", "b", "c"], ["a", "é", "ß"]]
+        for length in [1, 10, 63, 64, 65, 100] {
+            for alphabet in alphabets {
+                let lhs = (0..<length).map { _ in alphabet.randomElement(using: &generator)! }
+                let rhs = (0..<max(0, length + Int.random(in: -5...5, using: &generator)))
+                    .map { _ in alphabet.randomElement(using: &generator)! }
+                let expected = reference(lhs, rhs)
+                let sql = "SELECT levenshtein('\(String(lhs))', '\(String(rhs))')"
+                #expect(executeScalarInt(db, sql) == Int64(expected), "\(sql)")
+            }
+        }
+    }
+
+    /// Tests that max_distance caps the reported distance
+    @Test("Levenshtein distance with max_distance")
+    func testLevenshteinMaximum() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeScalarInt(db, "SELECT levenshtein('kitten', 'sitting', 5)") == 3)
+        #expect(executeScalarInt(db, "SELECT levenshtein('kitten', 'sitting', 3)") == 3)
+        #expect(executeScalarInt(db, "SELECT levenshtein('kitten', 'sitting', 2)") == 3)
+        #expect(executeScalarInt(db, "SELECT levenshtein('kitten', 'sitting', 0)") == 1)
+        #expect(executeScalarInt(db, "SELECT levenshtein('abc', 'abcdefgh', 2)") == 3)
+        #expect(executeScalarInt(db, "SELECT levenshtein('abc', 'abd', NULL)") == 1)
+
+        let long = String(repeating: "abcdefghij", count: 10)
+        let other = String(repeating: "abcdefghik", count: 10)
+        #expect(executeScalarInt(db, "SELECT levenshtein('\(long)', '\(other)')") == 10)
+        #expect(executeScalarInt(db, "SELECT levenshtein('\(long)', '\(other)', 4)") == 5)
+
+        var stmt: OpaquePointer?
+        sqlite3_prepare_v2(db, "SELECT levenshtein('a', 'b', -1)", -1, &stmt, nil)
+        defer { sqlite3_finalize(stmt) }
+        #expect(sqlite3_step(stmt) == SQLITE_ERROR)
     }
 
     /// Tests UUID generation
@@ -175,5 +349,11 @@ struct AdvancedFunctionsIntegrationTests {
         // Round-trip test
         let result3 = executeScalarText(db, "SELECT url_decode(url_encode('test with spaces & symbols!'))")
         #expect(result3 == "test with spaces & symbols!")
+
+        // Matches Foundation's query encoding, including across 16-byte blocks
+        for text in ["a-z_A-Z.0~9!$&'()*+,/:;=?@", "100% \"quoted\" <tags> #hash [x]{y}|\\^`", "naïve café 日本語", ""] {
+            let sql = "SELECT url_encode('\(text.replacingOccurrences(of: "'", with: "''"))')"
+            #expect(executeScalarText(db, sql) == text.addingPercentEncoding(withAllowedCharacters: .urlQueryAllowed))
+        }
     }
 }
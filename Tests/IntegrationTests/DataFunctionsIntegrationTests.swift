@@ -258,4 +258,121 @@ struct DataFunctionsIntegrationTests {
         sqlite3_finalize(stmt)
         #expect(errorCode3 == SQLITE_ERROR)
     }
+
+    /// Tests the vector kernels against reference encodings at every length around their
+    /// block sizes
+    @Test("Byte kernels match reference encodings")
+    func testByteKernels() throws {
+        var generator = SystemRandomNumberGenerator()
+        for length in 0...100 {
+            let input = (0..<length).map { _ in UInt8.random(in: 0...255, using: &generator) }
+            let hex = input.map { String(format: "%02X", $0) }.joined()
+            let base64 = Data(input).base64EncodedString()
+
+            input.withUnsafeBytes { bytes in
+                var output = [UInt8](repeating: 0, count: length * 2)
+                output.withUnsafeMutableBytes { ByteKernels.hexEncode(bytes, into: $0.baseAddress!) }
+                #expect(String(decoding: output, as: UTF8.self) == hex)
+
+                output = [UInt8](repeating: 0, count: ByteKernels.base64EncodedCount(length))
+                output.withUnsafeMutableBytes { ByteKernels.base64Encode(bytes, into: $0.baseAddress!) }
+                #expect(String(decoding: output, as: UTF8.self) == base64)
+
+                output = [UInt8](repeating: 0, count: length)
+                output.withUnsafeMutableBytes { ByteKernels.reverse(bytes, into: $0.baseAddress!) }
+                #expect(output == input.reversed())
+
+                #expect(ByteKernels.isValidUTF8(bytes) == (String(validating: input, as: UTF8.self) != nil))
+            }
+
+            var decoded = [UInt8](repeating: 0, count: max(hex.utf8.count / 2, 1))
+            let hexCount = Array(hex.lowercased().utf8).withUnsafeBytes { text in
+                decoded.withUnsafeMutableBytes { try? ByteKernels.hexDecode(text, into: $0.baseAddress!).get() }
+            }
+            #expect(hexCount.map { Array(decoded.prefix($0)) } == input)
+
+            decoded = [UInt8](repeating: 0, count: max(base64.utf8.count / 4 * 3, 1))
+            let base64Count = Array(base64.utf8).withUnsafeBytes { text in
+                decoded.withUnsafeMutableBytes { ByteKernels.base64Decode(text, into: $0.baseAddress!) }
+            }
+            #expect(base64Count.map { Array(decoded.prefix($0)) } == input)
+        }
+
+        // Invalid characters are caught inside a vector block as well as in the tail.
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+        let digits = String(repeating: "0123456789abcdef", count: 4)
+        for position in [0, 17, 40, 63] {
+            var invalid = Array(digits.utf8)
+            invalid[position] = UInt8(ascii: "g")
+            let sql = "SELECT hex_decode('\(String(decoding: invalid, as: UTF8.self))')"
+            #expect(executeScalarBlob(db, sql) == nil)
+
+            var base64 = Array(String(repeating: "QUJD", count: 16).utf8)
+            base64[position] = UInt8(ascii: "*")
+            #expect(executeScalarText(db, "SELECT base64_decode('\(String(decoding: base64, as: UTF8.self))')") == nil)
+        }
+        #expect(executeScalarBlob(db, "SELECT hex_decode('00 11 22 33 44 55 66 77 88 99 aa bb cc dd ee ff 00 11')")?.count == 18)
+        #expect(executeScalarText(db, "SELECT base64_decode('\(String(repeating: "QUJD", count: 16))')") == String(repeating: "ABC", count: 16))
+        #expect(executeScalarText(db, "SELECT base64_decode('QQ=A')") == nil)
+        #if canImport(CryptoKit)
+        #expect(executeScalarText(db, "SELECT sha256('abc')") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+        #endif
+    }
+
+    /// Tests reading a stored blob in chunks, by hash and as rows
+    @Test("Incremental blob reads")
+    func testIncrementalBlobReads() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        sqlite3_exec(db, """
+        CREATE TABLE files (name TEXT, content BLOB);
+        INSERT INTO files VALUES ('large', randomblob(1000000)), ('empty', x'');
+        """, nil, nil, nil)
+
+        #if canImport(CryptoKit)
+        // The chunked hash matches hashing the whole value at once.
+        #expect(
+            executeScalarText(db, "SELECT sha256_blob('files', 'content', 1)")
+                == executeScalarText(db, "SELECT sha256(content) FROM files WHERE rowid = 1")
+        )
+        #expect(
+            executeScalarText(db, "SELECT sha256_blob('files', 'content', 2, 'main')")
+                == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+        )
+        #expect(executeScalarText(db, "SELECT sha256_blob('files', 'content', 99)") == nil)
+        #endif
+
+        // 1,000,000 bytes in 64 KiB chunks is 15 full chunks and a partial one.
+        #expect(executeScalarInt(db, "SELECT count(*) FROM blob_chunks('files', 'content', 1)") == 16)
+        #expect(executeScalarInt(db, "SELECT count(*) FROM blob_chunks('files', 'content', 1, 300000)") == 4)
+        #expect(executeScalarInt(db, "SELECT max(start) FROM blob_chunks('files', 'content', 1, 300000)") == 900000)
+        #expect(executeScalarInt(db, "SELECT count(*) FROM blob_chunks('files', 'content', 2)") == 0)
+
+        // The chunks concatenate back to the stored value.
+        let rejoined = executeScalarInt(db, """
+        SELECT (SELECT group_concat(hex(chunk), '') FROM
+                   (SELECT chunk FROM blob_chunks('files', 'content', 1, 100000) ORDER BY start))
+               = (SELECT hex(content) FROM files WHERE rowid = 1)
+        """)
+        #expect(rejoined == 1)
+
+        // A missing row fails the query.
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "SELECT * FROM blob_chunks('files', 'content', 99)", -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ERROR)
+        sqlite3_finalize(stmt)
+
+        // Changing the row mid-scan fails the query instead of truncating it.
+        #expect(sqlite3_prepare_v2(db, "SELECT start FROM blob_chunks('files', 'content', 1, 100000)", -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(sqlite3_exec(db, "UPDATE files SET content = randomblob(1000000) WHERE rowid = 1", nil, nil, nil) == SQLITE_OK)
+        var result = sqlite3_step(stmt)
+        while result == SQLITE_ROW {
+            result = sqlite3_step(stmt)
+        }
+        #expect(result == SQLITE_ERROR)
+        sqlite3_finalize(stmt)
+    }
 }
@@ -0,0 +1,411 @@
+import Testing
+import Foundation
+import SQLiteExtensionKit
+@testable import ExampleExtensions
+import CSQLite
+
+/// Integration tests for the ordered key-value virtual table.
+@Suite("Key-Value Table Integration Tests")
+struct KeyValueTableIntegrationTests {
+    /// Helper to create a test database with a populated `kv` table
+    func createDatabase() throws -> OpaquePointer? {
+        var db: OpaquePointer?
+        guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db = db else {
+            return nil
+        }
+
+        let database = SQLiteDatabase(db)
+        try KeyValueTableExtension.register(with: database)
+
+        let setup = """
+        CREATE VIRTUAL TABLE kv USING keyvalue;
+        INSERT INTO kv VALUES ('banana', 'yellow');
+        INSERT INTO kv VALUES ('apple', 'red');
+        INSERT INTO kv VALUES ('cherry', 'dark red');
+        INSERT INTO kv VALUES ('Apricot', 'orange');
+        INSERT INTO kv VALUES ('date', 'brown');
+        """
+        guard sqlite3_exec(db, setup, nil, nil, nil) == SQLITE_OK else {
+            sqlite3_close(db)
+            return nil
+        }
+
+        return db
+    }
+
+    /// Helper to execute SQL and collect the first column of every row as text
+    func executeColumnText(_ db: OpaquePointer, _ sql: String) -> [String] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return []
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        var values: [String] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            values.append(sqlite3_column_text(stmt, 0).map { String(cString: $0) } ?? "")
+        }
+        return values
+    }
+
+    /// Tests point lookups and full scans in key order
+    @Test("Lookup and ordered scan")
+    func testLookupAndScan() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT value FROM kv WHERE key = 'cherry'") == ["dark red"])
+        #expect(executeColumnText(db, "SELECT value FROM kv WHERE key = 'missing'") == [])
+        #expect(executeColumnText(db, "SELECT key FROM kv") == ["Apricot", "apple", "banana", "cherry", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv ORDER BY key DESC") == ["date", "cherry", "banana", "apple", "Apricot"])
+    }
+
+    /// Tests range constraints pushed into the index
+    @Test("Range constraints")
+    func testRanges() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key > 'apple'") == ["banana", "cherry", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key >= 'apple' AND key < 'cherry'") == ["apple", "banana"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key BETWEEN 'b' AND 'cherry' ORDER BY key DESC") == ["cherry", "banana"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key > 'b' AND key > 'c'") == ["cherry", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key < NULL") == [])
+
+        // Other collations are not answered from the byte-ordered index.
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key = 'APPLE' COLLATE NOCASE") == ["apple"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key > 'b' COLLATE NOCASE") == ["banana", "cherry", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key = 'date  ' COLLATE RTRIM") == ["date"])
+    }
+
+    /// Tests LIKE and GLOB prefix narrowing
+    @Test("Prefix patterns")
+    func testPrefixPatterns() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key LIKE 'ap%'") == ["Apricot", "apple"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key LIKE 'a_p%'") == ["apple"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key LIKE '%e%'") == ["apple", "cherry", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key GLOB 'ap*'") == ["apple"])
+    }
+
+    /// Tests that ORDER BY key does not need a separate sort
+    @Test("ORDER BY key is consumed")
+    func testOrderByConsumed() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "EXPLAIN QUERY PLAN SELECT * FROM kv ORDER BY key DESC", -1, &stmt, nil) == SQLITE_OK)
+        defer { sqlite3_finalize(stmt) }
+
+        var details: [String] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            details.append(sqlite3_column_text(stmt, 3).map { String(cString: $0) } ?? "")
+        }
+        #expect(!details.contains { $0.contains("TEMP B-TREE") })
+    }
+
+    /// Tests writes, including enough rows to merge the index's change buffer
+    @Test("Inserts, updates, and deletes")
+    func testWrites() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let bulk = """
+        WITH RECURSIVE n(x) AS (SELECT 0 UNION ALL SELECT x + 1 FROM n WHERE x < 499)
+        INSERT INTO kv SELECT printf('k%03d', x), x FROM n
+        """
+        #expect(sqlite3_exec(db, bulk, nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT count(*) FROM kv") == ["505"])
+
+        #expect(sqlite3_exec(db, "DELETE FROM kv WHERE key GLOB 'k1*'", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT count(*) FROM kv WHERE key GLOB 'k*'") == ["400"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key > 'k098' LIMIT 3") == ["k099", "k200", "k201"])
+
+        #expect(sqlite3_exec(db, "UPDATE kv SET value = 'green' WHERE key = 'apple'", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT value FROM kv WHERE key = 'apple'") == ["green"])
+
+        #expect(sqlite3_exec(db, "UPDATE kv SET key = 'avocado' WHERE key = 'apple'", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT key || '=' || value FROM kv WHERE key LIKE 'a%'") == ["Apricot=orange", "avocado=green"])
+
+        #expect(sqlite3_exec(db, "INSERT INTO kv VALUES ('date', 'medjool')", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT value FROM kv WHERE key = 'date'") == ["medjool"])
+    }
+
+    /// Tests that an open cursor keeps reading the version it started on
+    @Test("Cursors read a snapshot")
+    func testCursorSnapshot() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "SELECT key FROM kv", -1, &stmt, nil) == SQLITE_OK)
+        defer { sqlite3_finalize(stmt) }
+
+        var keys: [String] = []
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        keys.append(String(cString: sqlite3_column_text(stmt, 0)))
+
+        #expect(sqlite3_exec(db, "INSERT INTO kv VALUES ('blueberry', 'blue')", nil, nil, nil) == SQLITE_OK)
+        #expect(sqlite3_exec(db, "DELETE FROM kv WHERE key = 'cherry'", nil, nil, nil) == SQLITE_OK)
+
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            keys.append(String(cString: sqlite3_column_text(stmt, 0)))
+        }
+        #expect(keys == ["Apricot", "apple", "banana", "cherry", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key GLOB 'b*'") == ["banana", "blueberry"])
+    }
+
+    /// Tests lock-free readers running alongside a writer
+    @Test("Concurrent readers and writer")
+    func testConcurrentSnapshots() async throws {
+        let session = KeyValueVirtualTable.Session(storage: .init())
+
+        await withTaskGroup(of: Bool.self) { group in
+            group.addTask {
+                for i in 0..<2_000 {
+                    _ = try? session.set(String(format: "k%05d", i), "\(i)")
+                }
+                return true
+            }
+            for _ in 0..<4 {
+                group.addTask {
+                    // Every version is a prefix of the inserts, so it must be contiguous.
+                    for _ in 0..<200 {
+                        var scan = session.scan(from: nil, to: nil, descending: false)
+                        var expected = 0
+                        while let entry = scan.current {
+                            guard entry.key == String(format: "k%05d", expected) else { return false }
+                            expected += 1
+                            scan.advance()
+                        }
+                    }
+                    return true
+                }
+            }
+            for await consistent in group {
+                #expect(consistent)
+            }
+        }
+
+        #expect(session.count == 2_000)
+    }
+
+    /// Tests that writes are staged per transaction and undone on rollback
+    @Test("Transactions and savepoints")
+    func testTransactions() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let script = """
+        BEGIN;
+        INSERT INTO kv VALUES ('fig', 'purple');
+        SAVEPOINT before_delete;
+        DELETE FROM kv WHERE key = 'apple';
+        ROLLBACK TO before_delete;
+        INSERT INTO kv VALUES ('grape', 'green');
+        """
+        #expect(sqlite3_exec(db, script, nil, nil, nil) == SQLITE_OK)
+        // Staged writes are visible inside the transaction.
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key >= 'date'") == ["date", "fig", "grape"])
+        #expect(executeColumnText(db, "SELECT value FROM kv WHERE key = 'apple'") == ["red"])
+
+        #expect(sqlite3_exec(db, "ROLLBACK", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT count(*) FROM kv") == ["5"])
+
+        #expect(sqlite3_exec(db, "BEGIN; DELETE FROM kv WHERE key < 'b'; COMMIT", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT key FROM kv") == ["banana", "cherry", "date"])
+    }
+
+    /// Helper to open a database with a `kv` table on the shared store named `name`
+    func openSharedDatabase(name: String, logPath: String? = nil) throws -> OpaquePointer? {
+        var db: OpaquePointer?
+        guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db = db else {
+            return nil
+        }
+        try KeyValueTableExtension.register(with: SQLiteDatabase(db))
+
+        let arguments = logPath.map { "'\(name)', '\($0)'" } ?? "'\(name)'"
+        guard sqlite3_exec(db, "CREATE VIRTUAL TABLE kv USING keyvalue(\(arguments))", nil, nil, nil) == SQLITE_OK else {
+            sqlite3_close(db)
+            return nil
+        }
+        return db
+    }
+
+    /// Tests that connections naming the same store share it, and see only committed writes
+    @Test("Shared stores across connections")
+    func testSharedStore() throws {
+        let name = "shared-\(UUID().uuidString)"
+        let first = try #require(try openSharedDatabase(name: name))
+        let second = try #require(try openSharedDatabase(name: name))
+
+        #expect(sqlite3_exec(first, "INSERT INTO kv VALUES ('apple', 'red')", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(second, "SELECT value FROM kv WHERE key = 'apple'") == ["red"])
+
+        #expect(sqlite3_exec(second, "BEGIN; INSERT INTO kv VALUES ('banana', 'yellow')", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(second, "SELECT key FROM kv") == ["apple", "banana"])
+        #expect(executeColumnText(first, "SELECT key FROM kv") == ["apple"])
+        #expect(sqlite3_exec(second, "COMMIT", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(first, "SELECT key FROM kv") == ["apple", "banana"])
+
+        // Rowids come from the store, so rows inserted on either connection stay distinct.
+        #expect(executeColumnText(first, "SELECT count(DISTINCT rowid) FROM kv") == ["2"])
+
+        // The store outlives one connection but not the last.
+        sqlite3_close(first)
+        #expect(executeColumnText(second, "SELECT count(*) FROM kv") == ["2"])
+        sqlite3_close(second)
+        let reopened = try #require(try openSharedDatabase(name: name))
+        defer { sqlite3_close(reopened) }
+        #expect(executeColumnText(reopened, "SELECT count(*) FROM kv") == ["0"])
+    }
+
+    /// Tests that a logged store is restored after every table closes, despite a torn tail
+    @Test("Persistent stores")
+    func testPersistentStore() throws {
+        let name = "persistent-\(UUID().uuidString)"
+        let path = FileManager.default.temporaryDirectory.appendingPathComponent("\(name).kvlog").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+
+        do {
+            let db = try #require(try openSharedDatabase(name: name, logPath: path))
+            defer { sqlite3_close(db) }
+            let script = """
+            INSERT INTO kv VALUES ('apple', 'red'), ('banana', 'yellow'), ('cherry', 'dark red');
+            BEGIN;
+            DELETE FROM kv WHERE key = 'banana';
+            UPDATE kv SET value = 'green' WHERE key = 'apple';
+            COMMIT;
+            BEGIN;
+            INSERT INTO kv VALUES ('date', 'brown');
+            ROLLBACK;
+            """
+            #expect(sqlite3_exec(db, script, nil, nil, nil) == SQLITE_OK)
+
+            // Another table may attach without naming the log, but not with another one.
+            let other = try #require(try openSharedDatabase(name: name))
+            sqlite3_close(other)
+            #expect(try openSharedDatabase(name: name, logPath: path + ".other") == nil)
+        }
+
+        // Simulate a crash part-way through appending a commit.
+        let handle = try #require(FileHandle(forWritingAtPath: path))
+        handle.seekToEndOfFile()
+        handle.write(Data([40, 0, 0, 0, 1, 2, 3]))
+        handle.closeFile()
+
+        let db = try #require(try openSharedDatabase(name: name, logPath: path))
+        defer { sqlite3_close(db) }
+        #expect(executeColumnText(db, "SELECT key || '=' || value FROM kv") == ["apple=green", "cherry=dark red"])
+        #expect(sqlite3_exec(db, "INSERT INTO kv VALUES ('elderberry', 'black')", nil, nil, nil) == SQLITE_OK)
+        #expect(executeColumnText(db, "SELECT count(DISTINCT rowid) FROM kv") == ["3"])
+    }
+
+    /// Tests that the log matches the store when transactions are logged in xSync and
+    /// then apply out of order or roll back
+    @Test("Two-phase log commits")
+    func testTwoPhaseCommits() throws {
+        let path = FileManager.default.temporaryDirectory.appendingPathComponent("two-phase-\(UUID().uuidString).kvlog").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+
+        do {
+            let storage = try KeyValueVirtualTable.Storage(logPath: path)
+            let first = KeyValueVirtualTable.Session(storage: storage)
+            let second = KeyValueVirtualTable.Session(storage: storage)
+
+            // Logged first, applied last: the later frame's write to "shared" wins.
+            first.begin()
+            try first.set("shared", "first")
+            try first.set("only-first", "1")
+            try first.sync()
+            second.begin()
+            try second.set("shared", "second")
+            try second.sync()
+            #expect(second.get("shared") == "second")
+            #expect(KeyValueVirtualTable.Session(storage: storage).get("shared") == nil)
+            try second.commit()
+            try first.commit()
+            #expect(first.get("shared") == "second")
+            #expect(first.get("only-first") == "1")
+
+            // A transaction rolled back after it was logged is cancelled.
+            first.begin()
+            try first.set("rolled-back", "x")
+            try first.sync()
+            first.rollback()
+            #expect(first.get("rolled-back") == nil)
+        }
+
+        let reopened = KeyValueVirtualTable.Session(storage: try KeyValueVirtualTable.Storage(logPath: path))
+        #expect(reopened.get("shared") == "second")
+        #expect(reopened.get("only-first") == "1")
+        #expect(reopened.get("rolled-back") == nil)
+    }
+
+    /// Tests that a log full of superseded writes is compacted to the live rows
+    @Test("Log compaction")
+    func testLogCompaction() throws {
+        let name = "compacted-\(UUID().uuidString)"
+        let path = FileManager.default.temporaryDirectory.appendingPathComponent("\(name).kvlog").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+
+        do {
+            let db = try #require(try openSharedDatabase(name: name, logPath: path))
+            defer { sqlite3_close(db) }
+            let script = """
+            INSERT INTO kv VALUES ('kept', 'yes');
+            WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 2000)
+            INSERT INTO kv SELECT 'hot', printf('%04d%01000d', i, 0) FROM n;
+            """
+            #expect(sqlite3_exec(db, script, nil, nil, nil) == SQLITE_OK)
+        }
+
+        let size = try #require(try FileManager.default.attributesOfItem(atPath: path)[.size] as? Int)
+        #expect(size < 4096)
+
+        let db = try #require(try openSharedDatabase(name: name, logPath: path))
+        defer { sqlite3_close(db) }
+        #expect(executeColumnText(db, "SELECT key || substr(value, 1, 4) FROM kv") == ["hot2000", "keptyes"])
+    }
+
+    /// Tests that starts_with() on the key is answered from the index
+    @Test("starts_with is pushed into the index")
+    func testStartsWith() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE starts_with(key, 'ap')") == ["apple"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE starts_with(key, '') ORDER BY key DESC LIMIT 2") == ["date", "cherry"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE starts_with(value, 'dark')") == ["cherry"])
+        #expect(executeColumnText(db, "SELECT starts_with('apple', 'app'), starts_with('apple', 'b')") == ["1"])
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "EXPLAIN QUERY PLAN SELECT * FROM kv WHERE starts_with(key, 'ch')", -1, &stmt, nil) == SQLITE_OK)
+        defer { sqlite3_finalize(stmt) }
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        let detail = sqlite3_column_text(stmt, 3).map { String(cString: $0) } ?? ""
+        #expect(detail.contains("INDEX \(KeyValueVirtualTable.Plan.prefix.rawValue):"))
+    }
+
+    /// Tests that key IN (...) is answered with one multi-key lookup
+    @Test("IN lists are looked up at once")
+    func testInList() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key IN ('date', 'apple', 'missing', NULL)") == ["apple", "date"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key IN ('date', 'apple', 'cherry') ORDER BY key DESC") == ["date", "cherry", "apple"])
+        #expect(executeColumnText(db, "SELECT value FROM kv WHERE key IN (SELECT 'banana' UNION SELECT 'Apricot')") == ["orange", "yellow"])
+        #expect(executeColumnText(db, "SELECT key FROM kv WHERE key COLLATE NOCASE IN ('APPLE', 'apricot')") == ["Apricot", "apple"])
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "EXPLAIN QUERY PLAN SELECT * FROM kv WHERE key IN ('a', 'b', 'c')", -1, &stmt, nil) == SQLITE_OK)
+        defer { sqlite3_finalize(stmt) }
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        let detail = sqlite3_column_text(stmt, 3).map { String(cString: $0) } ?? ""
+        #expect(detail.contains("INDEX \(KeyValueVirtualTable.Plan.keyList.rawValue):"))
+    }
+}
@@ -0,0 +1,137 @@
+import Testing
+import Foundation
+import SQLiteExtensionKit
+@testable import ExampleExtensions
+import CSQLite
+
+/// Integration tests for the memory-mapped column table.
+@Suite("Mapped Column Table Integration Tests")
+struct MappedColumnTableIntegrationTests {
+    /// Helper to write a column file with `rowCount` rows to a temporary path
+    func writeFile(rowCount: Int = 1000) throws -> String {
+        let path = FileManager.default.temporaryDirectory
+            .appendingPathComponent("mmap-table-\(UUID().uuidString).col").path
+        try MappedColumnFile.write(
+            columns: [
+                ("id", .integer, (0..<rowCount).map { .integer(Int64($0) * 10) }),
+                ("score", .real, (0..<rowCount).map { $0 % 7 == 0 ? .null : .real(Double($0) / 4) }),
+                ("kind", .text, (0..<rowCount).map { .text($0 % 2 == 0 ? "even" : "odd") }),
+                ("payload", .blob, (0..<rowCount).map { .blob(Data([UInt8($0 & 0xff), 0xAB])) }),
+            ],
+            to: path
+        )
+        return path
+    }
+
+    /// Helper to create a test database with a table over `path`
+    func createDatabase(path: String) throws -> OpaquePointer? {
+        var db: OpaquePointer?
+        guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db = db else {
+            return nil
+        }
+
+        let database = SQLiteDatabase(db)
+        try MappedColumnTableExtension.register(with: database)
+        guard sqlite3_exec(db, "CREATE VIRTUAL TABLE events USING mmap_table('\(path)')", nil, nil, nil) == SQLITE_OK else {
+            sqlite3_close(db)
+            return nil
+        }
+
+        return db
+    }
+
+    /// Helper to collect the first column of every row as text
+    func executeColumnText(_ db: OpaquePointer, _ sql: String) -> [String] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return []
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        var rows: [String] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            rows.append(sqlite3_column_text(stmt, 0).map { String(cString: $0) } ?? "NULL")
+        }
+        return rows
+    }
+
+    /// Helper to collect the query plan details of a statement
+    func planDetails(_ db: OpaquePointer, _ sql: String) -> [String] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, "EXPLAIN QUERY PLAN \(sql)", -1, &stmt, nil) == SQLITE_OK else {
+            return []
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        var details: [String] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            details.append(sqlite3_column_text(stmt, 3).map { String(cString: $0) } ?? "")
+        }
+        return details
+    }
+
+    /// Tests that every column type reads back from the mapping
+    @Test("Reads columns in place")
+    func testColumns() throws {
+        let path = try writeFile()
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        let db = try #require(try createDatabase(path: path))
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT count(*) FROM events") == ["1000"])
+        #expect(executeColumnText(db, "SELECT id || ',' || kind || ',' || hex(payload) FROM events WHERE rowid = 4") == ["30,odd,03AB"])
+        #expect(executeColumnText(db, "SELECT score FROM events WHERE rowid IN (1, 2, 8)") == ["NULL", "0.25", "NULL"])
+        #expect(executeColumnText(db, "SELECT count(*) FROM events WHERE kind = 'even'") == ["500"])
+        #expect(executeColumnText(db, "SELECT kind FROM events GROUP BY kind ORDER BY kind") == ["even", "odd"])
+    }
+
+    /// Tests rowid ranges and their push-down into bestIndex
+    @Test("Rowid ranges are pushed down")
+    func testRowidRanges() throws {
+        let path = try writeFile()
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        let db = try #require(try createDatabase(path: path))
+        defer { sqlite3_close(db) }
+
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid BETWEEN 10 AND 12") == ["90", "100", "110"])
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid > 998") == ["9980", "9990"])
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid < 2.5") == ["0", "10"])
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid >= 999.5") == ["9990"])
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid = 1001").isEmpty)
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid = 2.5").isEmpty)
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid > 5 AND rowid < 3").isEmpty)
+        #expect(executeColumnText(db, "SELECT id FROM events WHERE rowid > 997 ORDER BY rowid DESC") == ["9990", "9980", "9970"])
+
+        let ranged = planDetails(db, "SELECT id FROM events WHERE rowid BETWEEN 10 AND 20")
+        #expect(ranged.contains { $0.contains("INDEX 20:") })
+        let ordered = planDetails(db, "SELECT id FROM events ORDER BY rowid DESC")
+        #expect(!ordered.contains { $0.contains("TEMP B-TREE") })
+    }
+
+    /// Tests that unreadable or malformed files fail CREATE VIRTUAL TABLE
+    @Test("Invalid files are rejected")
+    func testInvalidFiles() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        defer { sqlite3_close(db) }
+        let connection = try #require(db)
+        try MappedColumnTableExtension.register(with: SQLiteDatabase(connection))
+
+        let missing = "/nonexistent/\(UUID().uuidString).col"
+        #expect(sqlite3_exec(connection, "CREATE VIRTUAL TABLE a USING mmap_table('\(missing)')", nil, nil, nil) != SQLITE_OK)
+        #expect(sqlite3_exec(connection, "CREATE VIRTUAL TABLE b USING mmap_table", nil, nil, nil) != SQLITE_OK)
+
+        let garbage = FileManager.default.temporaryDirectory
+            .appendingPathComponent("mmap-table-\(UUID().uuidString).col").path
+        try Data(repeating: 0x42, count: 4096).write(to: URL(fileURLWithPath: garbage))
+        defer { try? FileManager.default.removeItem(atPath: garbage) }
+        #expect(sqlite3_exec(connection, "CREATE VIRTUAL TABLE c USING mmap_table('\(garbage)')", nil, nil, nil) != SQLITE_OK)
+
+        // A truncated file fails validation instead of reading past the mapping.
+        let path = try writeFile()
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        let contents = try Data(contentsOf: URL(fileURLWithPath: path))
+        try contents.prefix(contents.count / 2).write(to: URL(fileURLWithPath: path))
+        #expect(sqlite3_exec(connection, "CREATE VIRTUAL TABLE d USING mmap_table('\(path)')", nil, nil, nil) != SQLITE_OK)
+    }
+}
@@ -242,4 +242,39 @@ struct MathFunctionsIntegrationTests {
         #expect(result != nil)
         #expect(abs(result! - 576.0) < 0.001)  // 4 * 9 * 16 = 576
     }
+
+    /// Tests parallel_aggregate against the serial aggregates on a database file
+    @Test("Parallel aggregate")
+    func testParallelAggregate() throws {
+        let path = FileManager.default.temporaryDirectory
+            .appendingPathComponent("math-\(UUID().uuidString).db").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        var db: OpaquePointer?
+        guard sqlite3_open(path, &db) == SQLITE_OK, let db else {
+            Issue.record("Could not open \(path)")
+            return
+        }
+        defer { sqlite3_close(db) }
+        try MathFunctionsExtension.register(with: SQLiteDatabase(db))
+
+        // A large mean and small spread, where the naive variance formula loses precision.
+        sqlite3_exec(db, """
+        CREATE TABLE samples (x REAL);
+        WITH RECURSIVE r(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM r WHERE n < 20000)
+        INSERT INTO samples SELECT 1e6 + (n % 100) / 10.0 FROM r;
+        """, nil, nil, nil)
+
+        let serial = try #require(executeScalarDouble(db, "SELECT std_dev(x) FROM samples"))
+        #expect(abs(serial - 2.8866) < 0.001)
+        for threads in [1, 2, 7] {
+            let parallel = try #require(
+                executeScalarDouble(db, "SELECT value FROM parallel_aggregate('std_dev', 'samples', 'x', \(threads))")
+            )
+            #expect(abs(parallel - serial) < 1e-6)
+        }
+
+        sqlite3_exec(db, "CREATE TABLE factors (x REAL); INSERT INTO factors VALUES (2), (3), (4), (5);", nil, nil, nil)
+        #expect(executeScalarDouble(db, "SELECT value FROM parallel_aggregate('product', 'factors', 'x', 3)") == 120)
+    }
 }
+
@@ -126,6 +126,35 @@ struct StringFunctionsIntegrationTests {
         #expect(result4 == 2)
     }
 
+    /// Tests the byte kernels against the Character-based definitions on non-ASCII text
+    /// and inputs longer than one 16-byte block
+    @Test("String functions on Unicode and long text")
+    func testUnicodeAndLongText() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let samples = [
+            "The quick brown fox jumps over the lazy dog, again and again",
+            "  tabs\tand\nnewlines\r\nand  many   spaces between words  ",
+            "naïve café, Ångström und Straße",
+            "e\u{301} combining, 👨‍👩‍👧 family, 🇨🇭 flag",
+            "no\u{A0}break\u{3000}ideographic\u{2003}em\u{2028}line\u{85}next",
+            String(repeating: "abc ", count: 40),
+        ]
+
+        for text in samples {
+            let literal = "'\(text.replacingOccurrences(of: "'", with: "''"))'"
+            #expect(executeScalarText(db, "SELECT reverse(\(literal))") == String(text.reversed()))
+            #expect(executeScalarText(db, "SELECT trim_all(\(literal))") == text.filter { !$0.isWhitespace })
+            let words = text.components(separatedBy: .whitespacesAndNewlines).filter { !$0.isEmpty }.count
+            #expect(executeScalarInt(db, "SELECT word_count(\(literal))") == Int64(words))
+            #expect(executeScalarText(db, "SELECT rot13(rot13(\(literal)))") == text)
+        }
+
+        #expect(executeScalarText(db, "SELECT rot13('Ärger über Zebras, abcdefghijklmnopqrstuvwxyz')")
+            == "Äetre üore Mroenf, nopqrstuvwxyzabcdefghijklm")
+    }
+
     /// Tests string functions with NULL values
     @Test("String functions with NULL")
     func testStringFunctionsWithNull() throws {
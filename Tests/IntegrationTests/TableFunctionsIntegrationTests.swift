@@ -0,0 +1,83 @@
+import Testing
+import Foundation
+import SQLiteExtensionKit
+@testable import ExampleExtensions
+import CSQLite
+
+/// Integration tests for the table-valued function extension.
+@Suite("Table Functions Integration Tests")
+struct TableFunctionsIntegrationTests {
+    /// Helper to create a test database with table functions registered
+    func createDatabase() throws -> OpaquePointer? {
+        var db: OpaquePointer?
+        guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db = db else {
+            return nil
+        }
+
+        let database = SQLiteDatabase(db)
+        try TableFunctionsExtension.register(with: database)
+
+        return db
+    }
+
+    /// Helper to collect the first column of every row as text
+    func texts(_ db: OpaquePointer, _ sql: String) -> [String] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return []
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        var rows: [String] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            rows.append(sqlite3_column_text(stmt, 0).map { String(cString: $0) } ?? "NULL")
+        }
+        return rows
+    }
+
+    /// Helper to collect the first column of every row as integers
+    func integers(_ db: OpaquePointer, _ sql: String) -> [Int64] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return []
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        var rows: [Int64] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            rows.append(sqlite3_column_int64(stmt, 0))
+        }
+        return rows
+    }
+
+    /// Tests splitting text and blobs into lines
+    @Test("split_lines function")
+    func testSplitLines() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(texts(db, "SELECT line FROM split_lines('a' || char(10) || 'bc' || char(13, 10) || char(10) || 'd')") == ["a", "bc", "", "d"])
+        #expect(integers(db, "SELECT line_number FROM split_lines('x' || char(10) || 'y' || char(10))") == [1, 2])
+        #expect(texts(db, "SELECT line FROM split_lines(CAST('one' || char(10) || 'two' AS BLOB))") == ["one", "two"])
+        #expect(texts(db, "SELECT line FROM split_lines('')").isEmpty)
+        #expect(texts(db, "SELECT line FROM split_lines(NULL)").isEmpty)
+
+        // Lines of a large input are produced on demand.
+        #expect(texts(db, "SELECT line FROM split_lines(replace(hex(zeroblob(1000000)), '00', 'x' || char(10))) LIMIT 2") == ["x", "x"])
+    }
+
+    /// Tests integer series with default and explicit steps
+    @Test("series function")
+    func testSeries() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(integers(db, "SELECT value FROM series(1, 5)") == [1, 2, 3, 4, 5])
+        #expect(integers(db, "SELECT value FROM series(1, 10, 3)") == [1, 4, 7, 10])
+        #expect(integers(db, "SELECT value FROM series(5, 1, -2)") == [5, 3, 1])
+        #expect(integers(db, "SELECT value FROM series(1, 5, 0)").isEmpty)
+        #expect(integers(db, "SELECT value FROM series(1) LIMIT 3") == [1, 2, 3])
+        #expect(integers(db, "SELECT value FROM series(9223372036854775806)") == [9223372036854775806, 9223372036854775807])
+        #expect(integers(db, "SELECT sum(value) FROM series(1, 100)") == [5050])
+    }
+}
@@ -0,0 +1,146 @@
+import Testing
+import Foundation
+import SQLiteExtensionKit
+@testable import ExampleExtensions
+import CSQLite
+
+/// Integration tests for window and statistical extension functions.
+@Suite("Window Functions Integration Tests")
+struct WindowFunctionsIntegrationTests {
+    /// Helper to create a test database with window functions and sample data
+    func createDatabase() throws -> OpaquePointer? {
+        var db: OpaquePointer?
+        guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db = db else {
+            return nil
+        }
+
+        let database = SQLiteDatabase(db)
+        try WindowFunctionsExtension.register(with: database)
+
+        let setup = """
+        CREATE TABLE data (id INTEGER PRIMARY KEY, value REAL);
+        INSERT INTO data (value) VALUES (1), (2), (3), (4), (5), (6);
+        """
+        guard sqlite3_exec(db, setup, nil, nil, nil) == SQLITE_OK else {
+            sqlite3_close(db)
+            return nil
+        }
+
+        return db
+    }
+
+    /// Helper to execute SQL and collect the first column of every row as doubles
+    func executeColumnDoubles(_ db: OpaquePointer, _ sql: String) -> [Double?] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return []
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        var values: [Double?] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            if sqlite3_column_type(stmt, 0) == SQLITE_NULL {
+                values.append(nil)
+            } else {
+                values.append(sqlite3_column_double(stmt, 0))
+            }
+        }
+        return values
+    }
+
+    /// Helper to execute SQL and get double result
+    func executeScalarDouble(_ db: OpaquePointer, _ sql: String) -> Double? {
+        executeColumnDoubles(db, sql).first ?? nil
+    }
+
+    /// Tests moving average over a sliding ROWS frame
+    @Test("Moving average over sliding frame")
+    func testMovingAverageFrame() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let values = executeColumnDoubles(
+            db,
+            "SELECT moving_avg(value) OVER (ORDER BY id ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) FROM data"
+        )
+        #expect(values == [1.0, 1.5, 2.5, 3.5, 4.5, 5.5])
+    }
+
+    /// Tests moving average limited to a trailing window size
+    @Test("Moving average with window size")
+    func testMovingAverageWindowSize() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let values = executeColumnDoubles(
+            db,
+            "SELECT moving_avg(value, 3) OVER (ORDER BY id ROWS BETWEEN 3 PRECEDING AND CURRENT ROW) FROM data"
+        )
+        #expect(values == [1.0, 1.5, 2.0, 3.0, 4.0, 5.0])
+
+        // As a plain aggregate it averages the last `window_size` values
+        let aggregate = executeScalarDouble(db, "SELECT moving_avg(value, 2) FROM (SELECT value FROM data ORDER BY id)")
+        #expect(aggregate == 5.5)
+    }
+
+    /// Tests running total with default and sliding frames
+    @Test("Running total")
+    func testRunningTotal() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let cumulative = executeColumnDoubles(db, "SELECT running_total(value) OVER (ORDER BY id) FROM data")
+        #expect(cumulative == [1.0, 3.0, 6.0, 10.0, 15.0, 21.0])
+
+        let sliding = executeColumnDoubles(
+            db,
+            "SELECT running_total(value) OVER (ORDER BY id ROWS BETWEEN 2 PRECEDING AND CURRENT ROW) FROM data"
+        )
+        #expect(sliding == [1.0, 3.0, 6.0, 9.0, 12.0, 15.0])
+
+        let total = executeScalarDouble(db, "SELECT running_total(value) FROM data")
+        #expect(total == 21.0)
+    }
+
+    /// Tests exact percentile and median selection
+    @Test("Exact percentile and median")
+    func testExactPercentiles() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        #expect(executeScalarDouble(db, "SELECT median(value) FROM data") == 3.5)
+        #expect(executeScalarDouble(db, "SELECT median(value) FROM data WHERE id <= 5") == 3.0)
+        #expect(executeScalarDouble(db, "SELECT percentile(value, 0) FROM data") == 1.0)
+        #expect(executeScalarDouble(db, "SELECT percentile(value, 100) FROM data") == 6.0)
+        #expect(executeScalarDouble(db, "SELECT percentile(value, 50) FROM (SELECT value FROM data ORDER BY value DESC)") == 3.0)
+    }
+
+    /// Tests the t-digest estimate against known quantiles of a uniform range
+    @Test("Approximate percentile")
+    func testApproxPercentile() throws {
+        let db = try #require(try createDatabase())
+        defer { sqlite3_close(db) }
+
+        let series = "WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 100000)"
+
+        let p50 = try #require(executeScalarDouble(db, "\(series) SELECT approx_percentile(x, 50) FROM n"))
+        #expect(abs(p50 - 50_000) < 500)
+
+        let p99 = try #require(executeScalarDouble(db, "\(series) SELECT approx_percentile(x, 99) FROM n"))
+        #expect(abs(p99 - 99_000) < 100)
+
+        let fine = try #require(executeScalarDouble(db, "\(series) SELECT approx_percentile(x, 99.9, 500) FROM n"))
+        #expect(abs(fine - 99_900) < 20)
+
+        #expect(executeScalarDouble(db, "SELECT approx_percentile(value, 0) FROM data") == 1.0)
+        #expect(executeScalarDouble(db, "SELECT approx_percentile(value, 100) FROM data") == 6.0)
+        #expect(executeScalarDouble(db, "SELECT approx_percentile(value, 50) FROM data WHERE id <= 5") == 3.0)
+        #expect(executeScalarDouble(db, "SELECT approx_percentile(value, 50) FROM data WHERE id < 0") == nil)
+
+        let grouped = executeColumnDoubles(
+            db,
+            "SELECT approx_percentile(value, 50) FROM data GROUP BY id % 2 ORDER BY id % 2"
+        )
+        #expect(grouped == [4.0, 3.0])
+    }
+}
@@ -263,4 +263,115 @@ struct AggregateFunctionTests {
         let result = executeScalarInt(db, "SELECT my_count(value) FROM numbers")
         #expect(result == 5)
     }
+
+    /// Tests plain-data state stored inline in the aggregate context
+    @Test("Inline aggregate value")
+    func testInlineAggregateValue() throws {
+        let db = try #require(try createDatabaseWithData())
+        defer { sqlite3_close(db) }
+
+        struct MinMax: BitwiseCopyable {
+            var minimum = Int64.max
+            var maximum = Int64.min
+        }
+
+        let database = SQLiteDatabase(db)
+        try database.createAggregateFunction(
+            name: "value_range",
+            argumentCount: 1,
+            step: { context, args in
+                let value = args[0].intValue
+                context.withInlineAggregateValue(initialValue: MinMax()) { state in
+                    state.minimum = min(state.minimum, value)
+                    state.maximum = max(state.maximum, value)
+                }
+            },
+            final: { context in
+                guard let state = context.inlineAggregateValue(MinMax.self) else {
+                    context.resultNull()
+                    return
+                }
+                context.result(state.maximum - state.minimum)
+            }
+        )
+
+        #expect(executeScalarInt(db, "SELECT value_range(value) FROM numbers") == 4)
+        #expect(executeScalarInt(db, "SELECT value_range(value) IS NULL FROM numbers WHERE value > 10") == 1)
+        #expect(
+            executeScalarInt(
+                db,
+                "SELECT sum(r) FROM (SELECT value_range(value) AS r FROM numbers GROUP BY value % 2)"
+            ) == 4 + 2
+        )
+    }
+
+    /// Sum of integers that counts its rows, for testing mergeable aggregates
+    struct CountedSum: MergeableAggregate {
+        var total: Int64 = 0
+        var rows: Int64 = 0
+
+        mutating func step(_ arguments: SQLiteArguments) {
+            total += arguments[0].intValue
+            rows += 1
+        }
+
+        mutating func merge(_ other: CountedSum) {
+            total += other.total
+            rows += other.rows
+        }
+
+        func finalize() -> ColumnValue {
+            rows == 0 ? .null : .integer(total)
+        }
+    }
+
+    /// Tests mergeable aggregates as SQL aggregates and sharded over a database file
+    @Test("Mergeable aggregate")
+    func testMergeableAggregate() throws {
+        let db = try #require(try createDatabaseWithData())
+        defer { sqlite3_close(db) }
+
+        let database = SQLiteDatabase(db)
+        try database.createAggregateFunction(name: "counted_sum", argumentCount: 1, aggregate: CountedSum.self)
+        #expect(executeScalarInt(db, "SELECT counted_sum(value) FROM numbers") == 15)
+        #expect(executeScalarInt(db, "SELECT counted_sum(value) IS NULL FROM numbers WHERE value > 10") == 1)
+
+        // In-memory databases are scanned on the calling connection.
+        let inMemory = try database.parallelAggregate(CountedSum.self, table: "numbers", columns: ["value"], threads: 4)
+        #expect(inMemory.total == 15 && inMemory.rows == 5)
+
+        let path = FileManager.default.temporaryDirectory
+            .appendingPathComponent("parallel-aggregate-\(UUID().uuidString).db").path
+        defer { try? FileManager.default.removeItem(atPath: path) }
+        var fileDB: OpaquePointer?
+        guard sqlite3_open(path, &fileDB) == SQLITE_OK, let fileDB else {
+            Issue.record("Could not open \(path)")
+            return
+        }
+        defer { sqlite3_close(fileDB) }
+        sqlite3_exec(fileDB, """
+        CREATE TABLE "odd ""name""" (n INTEGER);
+        WITH RECURSIVE r(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM r WHERE n < 10000)
+        INSERT INTO "odd ""name""" SELECT n FROM r;
+        DELETE FROM "odd ""name""" WHERE n BETWEEN 2000 AND 2999;
+        """, nil, nil, nil)
+
+        let file = SQLiteDatabase(fileDB)
+        for threads in [1, 3, 8] {
+            let state = try file.parallelAggregate(CountedSum.self, table: "odd \"name\"", columns: ["n"], threads: threads)
+            #expect(state.rows == 9000)
+            #expect(state.total == 50_005_000 - (2000...2999).reduce(0, +))
+        }
+
+        sqlite3_exec(fileDB, "CREATE TABLE empty (n INTEGER)", nil, nil, nil)
+        #expect(try file.parallelAggregate(CountedSum.self, table: "empty", columns: ["n"], threads: 4).rows == 0)
+        #expect(throws: ParallelAggregationError.self) {
+            try file.parallelAggregate(CountedSum.self, table: "missing", columns: ["n"], threads: 4)
+        }
+
+        try file.createParallelAggregateFunction(aggregates: ["Counted_Sum": CountedSum.self])
+        #expect(executeScalarInt(fileDB, "SELECT value IS NULL FROM parallel_aggregate('counted_sum', 'empty', 'n', 2)") == 1)
+        #expect(executeScalarInt(fileDB, "SELECT count(*) FROM parallel_aggregate('counted_sum', 'empty', 'n', 2)") == 1)
+        #expect(executeScalarInt(fileDB, "SELECT value FROM parallel_aggregate('nope', 'empty', 'n')") == nil)
+    }
 }
@@ -0,0 +1,135 @@
+import Testing
+import Foundation
+@testable import SQLiteExtensionKit
+import CSQLite
+
+/// Tests for incremental blob I/O and zero-filled blob results.
+@Suite("Blob Tests")
+struct BlobTests {
+    /// Helper to create a test database with one 1000-byte blob in `files`
+    func createDatabase() -> OpaquePointer? {
+        var db: OpaquePointer?
+        guard sqlite3_open(":memory:", &db) == SQLITE_OK, let db = db else {
+            return nil
+        }
+        sqlite3_exec(db, """
+        CREATE TABLE files (content BLOB, name TEXT UNIQUE);
+        INSERT INTO files VALUES (zeroblob(1000), 'a'), (x'0102030405', 'b');
+        """, nil, nil, nil)
+        return db
+    }
+
+    /// Helper to execute SQL and get integer result
+    func executeScalarInt(_ db: OpaquePointer, _ sql: String) -> Int64? {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return nil
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        guard sqlite3_step(stmt) == SQLITE_ROW else {
+            return nil
+        }
+
+        return sqlite3_column_int64(stmt, 0)
+    }
+
+    /// Tests writing a placeholder in place and reading it back
+    @Test("Write then read")
+    func testWriteThenRead() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+        let database = SQLiteDatabase(db)
+
+        do {
+            let blob = try database.openBlob(table: "files", column: "content", rowid: 1, writable: true)
+            #expect(blob.count == 1000)
+            #expect(blob.isWritable)
+
+            let pattern = (0..<1000).map { UInt8(truncatingIfNeeded: $0) }
+            for start in stride(from: 0, to: 1000, by: 300) {
+                try pattern[start..<min(start + 300, 1000)].withUnsafeBytes { try blob.write($0, at: start) }
+            }
+
+            var readBack = [UInt8](repeating: 0, count: 10)
+            try readBack.withUnsafeMutableBytes { try blob.read(into: $0, at: 500) }
+            #expect(readBack == Array(pattern[500..<510]))
+
+            // Ranges past the end fail rather than truncating.
+            #expect(throws: SQLiteExtensionError.self) {
+                try readBack.withUnsafeMutableBytes { try blob.read(into: $0, at: 995) }
+            }
+        }
+
+        // The handle is closed, and the write is visible to SQL.
+        #expect(executeScalarInt(db, "SELECT hex(substr(content, 257, 2)) = '0001' FROM files WHERE rowid = 1") == 1)
+    }
+
+    /// Tests walking a blob in chunks and moving the handle to another row
+    @Test("Chunks and reopen")
+    func testChunksAndReopen() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+        let blob = try SQLiteDatabase(db).openBlob(table: "files", column: "content", rowid: 1)
+
+        var sizes: [Int] = []
+        try blob.forEachChunk(size: 384) { sizes.append($0.count) }
+        #expect(sizes == [384, 384, 232])
+
+        try blob.reopen(rowid: 2)
+        var bytes: [UInt8] = []
+        try blob.forEachChunk(size: 2) { bytes.append(contentsOf: $0) }
+        #expect(bytes == [1, 2, 3, 4, 5])
+
+        #expect(throws: SQLiteExtensionError.self) {
+            try blob.reopen(rowid: 99)
+        }
+    }
+
+    /// Tests that opening fails for missing rows and that read-only handles refuse writes
+    @Test("Open failures")
+    func testOpenFailures() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+        let database = SQLiteDatabase(db)
+
+        #expect(throws: SQLiteExtensionError.self) {
+            try database.openBlob(table: "files", column: "content", rowid: 99)
+        }
+        #expect(throws: SQLiteExtensionError.self) {
+            try database.openBlob(table: "missing", column: "content", rowid: 1)
+        }
+        // Indexed columns cannot be opened for writing.
+        #expect(throws: SQLiteExtensionError.self) {
+            try database.openBlob(table: "files", column: "name", rowid: 1, writable: true)
+        }
+
+        let blob = try database.openBlob(table: "files", column: "content", rowid: 2)
+        #expect(!blob.isWritable)
+        #expect(throws: SQLiteExtensionError.self) {
+            try [UInt8](repeating: 9, count: 2).withUnsafeBytes { try blob.write($0, at: 0) }
+        }
+
+        // Updating the row invalidates the handle.
+        sqlite3_exec(db, "UPDATE files SET content = x'FF' WHERE rowid = 2", nil, nil, nil)
+        #expect(throws: SQLiteExtensionError.self) {
+            var byte: UInt8 = 0
+            try withUnsafeMutableBytes(of: &byte) { try blob.read(into: $0, at: 0) }
+        }
+    }
+
+    /// Tests returning a zero-filled blob from a function
+    @Test("Zero blob result")
+    func testZeroBlobResult() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        try SQLiteDatabase(db).createScalarFunction(name: "reserve", argumentCount: 1) { context, args in
+            context.resultZeroBlob(count: Int(args[0].intValue))
+        }
+
+        #expect(executeScalarInt(db, "SELECT length(reserve(4096))") == 4096)
+        #expect(executeScalarInt(db, "SELECT reserve(3) = x'000000'") == 1)
+        #expect(executeScalarInt(db, "SELECT length(reserve(-5))") == 0)
+    }
+}
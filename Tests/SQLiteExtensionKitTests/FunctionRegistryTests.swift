@@ -0,0 +1,158 @@
+import Testing
+import Foundation
+import Synchronization
+@testable import SQLiteExtensionKit
+import CSQLite
+
+/// Tests for registering a shared function registry on several connections.
+@Suite("Function Registry Tests")
+struct FunctionRegistryTests {
+    /// Helper to execute SQL and get integer result
+    func executeScalarInt(_ db: OpaquePointer, _ sql: String) -> Int64? {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return nil
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        guard sqlite3_step(stmt) == SQLITE_ROW else {
+            return nil
+        }
+
+        return sqlite3_column_int64(stmt, 0)
+    }
+
+    /// Helper to execute SQL and get text result
+    func executeScalarText(_ db: OpaquePointer, _ sql: String) -> String? {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return nil
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        guard sqlite3_step(stmt) == SQLITE_ROW, let text = sqlite3_column_text(stmt, 0) else {
+            return nil
+        }
+
+        return String(cString: text)
+    }
+
+    /// Orders text by length, then by bytes
+    static let byLength: @Sendable (UnsafeRawBufferPointer, UnsafeRawBufferPointer) -> Int32 = { lhs, rhs in
+        if lhs.count != rhs.count {
+            return lhs.count < rhs.count ? -1 : 1
+        }
+        return lhs.lexicographicallyPrecedes(rhs) ? -1 : (lhs.elementsEqual(rhs) ? 0 : 1)
+    }
+
+    /// Tests one registry registered on many connections, sharing its boxes
+    @Test("Registry shared across connections")
+    func testSharedRegistry() throws {
+        final class CallCounter: Sendable {
+            let count = Atomic<Int>(0)
+        }
+
+        let calls = CallCounter()
+        let registry = SQLiteFunctionRegistry { functions in
+            functions.createScalarFunction(name: "double_it", argumentCount: 1, deterministic: true) { context, args in
+                calls.count.wrappingAdd(1, ordering: .relaxed)
+                context.result(args[0].intValue * 2)
+            }
+            functions.createAggregateFunction(
+                name: "total",
+                argumentCount: 1,
+                step: { context, args in
+                    let value = args[0].intValue
+                    context.withAggregateValue(initialValue: Int64(0)) { $0 += value }
+                },
+                final: { context in
+                    context.result(context.takeAggregateValue(Int64.self) ?? 0)
+                }
+            )
+            functions.createCollation(name: "by_length", compare: Self.byLength)
+        }
+
+        var connections: [OpaquePointer] = []
+        defer { connections.forEach { sqlite3_close($0) } }
+        for _ in 0..<8 {
+            var db: OpaquePointer?
+            #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+            let connection = try #require(db)
+            connections.append(connection)
+            try registry.register(with: SQLiteDatabase(connection))
+        }
+
+        for db in connections {
+            #expect(executeScalarInt(db, "SELECT double_it(21)") == 42)
+            #expect(executeScalarInt(db, "SELECT total(value) FROM (SELECT 1 AS value UNION ALL SELECT 2)") == 3)
+            #expect(
+                executeScalarText(
+                    db,
+                    "SELECT group_concat(w, ',') FROM (SELECT w FROM (SELECT 'ccc' AS w UNION SELECT 'a' UNION SELECT 'bb') ORDER BY w COLLATE by_length)"
+                ) == "a,bb,ccc"
+            )
+        }
+        #expect(calls.count.load(ordering: .relaxed) == connections.count)
+
+        // Closing every connection but one must leave the shared boxes alive.
+        while connections.count > 1 {
+            sqlite3_close(connections.removeLast())
+        }
+        #expect(executeScalarInt(connections[0], "SELECT double_it(5)") == 10)
+    }
+
+    /// Tests collations registered on first use
+    @Test("Lazy collation registration")
+    func testLazyCollations() throws {
+        let registry = SQLiteFunctionRegistry { functions in
+            functions.createCollation(name: "By_Length", compare: Self.byLength)
+        }
+
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        let connection = try #require(db)
+        defer { sqlite3_close(connection) }
+        try registry.register(with: SQLiteDatabase(connection), lazily: true)
+
+        #expect(executeScalarInt(connection, "SELECT 'zz' < 'a' COLLATE by_length") == 0)
+        #expect(executeScalarInt(connection, "SELECT 'a' < 'zz' COLLATE BY_LENGTH") == 1)
+        #expect(executeScalarInt(connection, "SELECT 'a' < 'b' COLLATE missing") == nil)
+    }
+
+    /// Tests that failed registrations leave the box to SQLite's destructor
+    @Test("Registration failure")
+    func testRegistrationFailure() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        let connection = try #require(db)
+        defer { sqlite3_close(connection) }
+        let database = SQLiteDatabase(connection)
+
+        // SQLite rejects more than 127 arguments and destroys the user data itself.
+        #expect(throws: SQLiteExtensionError.self) {
+            try database.createScalarFunction(name: "too_many", argumentCount: 1000) { context, _ in
+                context.resultNull()
+            }
+        }
+        #expect(throws: SQLiteExtensionError.self) {
+            try database.createAggregateFunction(
+                name: "too_many",
+                argumentCount: 1000,
+                step: { _, _ in },
+                final: { context in context.resultNull() }
+            )
+        }
+
+        let registry = SQLiteFunctionRegistry { functions in
+            functions.createScalarFunction(name: "too_many", argumentCount: 1000) { context, _ in
+                context.resultNull()
+            }
+        }
+        #expect(throws: SQLiteExtensionError.self) {
+            try registry.register(with: database)
+        }
+        #expect(throws: SQLiteExtensionError.self) {
+            try registry.register(with: database)
+        }
+    }
+}
@@ -0,0 +1,94 @@
+import Testing
+import Foundation
+@testable import SQLiteExtensionKit
+import CSQLite
+
+/// Tests for the opt-in instrumentation layer and its statistics table.
+@Suite("Instrumentation Tests")
+struct InstrumentationTests {
+    /// Helper to execute SQL and get integer result
+    func executeScalarInt(_ db: OpaquePointer, _ sql: String) -> Int64? {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else {
+            return nil
+        }
+        defer { sqlite3_finalize(stmt) }
+
+        guard sqlite3_step(stmt) == SQLITE_ROW else {
+            return nil
+        }
+
+        return sqlite3_column_int64(stmt, 0)
+    }
+
+    /// Tests counts and histograms for functions and virtual table callbacks
+    @Test("Instrumented callbacks")
+    func testInstrumentation() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        let connection = try #require(db)
+        defer { sqlite3_close(connection) }
+        let database = SQLiteDatabase(connection)
+
+        SQLiteInstrumentation.isEnabled = true
+        try database.createScalarFunction(name: "instrumented_half", argumentCount: 1) { context, args in
+            guard args[0].intValue % 2 == 0 else {
+                throw SQLiteExtensionError.invalidArgumentCount
+            }
+            context.result(args[0].intValue / 2)
+        }
+        try database.createTableValuedFunction(
+            name: "instrumented_range",
+            column: "value INTEGER",
+            parameters: ["count"]
+        ) { arguments in
+            (0..<(arguments[0]?.intValue ?? 0)).lazy.map { ColumnValue.integer($0) }
+        }
+        try database.createScalarFunction(
+            name: "instrumented_square",
+            argumentCount: 1,
+            deterministic: true,
+            memoize: .lru(capacity: 16)
+        ) { context, args in
+            context.result(args[0].intValue * args[0].intValue)
+        }
+        try database.registerInstrumentationTable()
+
+        #expect(executeScalarInt(connection, "SELECT sum(instrumented_half(value * 2)) FROM instrumented_range(100)") == 4950)
+        #expect(executeScalarInt(connection, "SELECT instrumented_half(3)") == nil)
+
+        func statistic(_ column: String, _ name: String, _ callback: String) -> Int64? {
+            executeScalarInt(
+                connection,
+                "SELECT \(column) FROM sqlite_extension_kit_stats WHERE name = '\(name)' AND callback = '\(callback)'"
+            )
+        }
+        #expect(executeScalarInt(connection, "SELECT sum(instrumented_square(value % 4)) FROM instrumented_range(100)") == 350)
+
+        #expect(statistic("calls", "instrumented_half", "function") == 101)
+        #expect(statistic("calls", "instrumented_square", "memo_miss") == 4)
+        #expect(statistic("calls", "instrumented_square", "memo_hit") == 96)
+        #expect(statistic("errors", "instrumented_half", "function") == 1)
+        #expect(statistic("calls", "instrumented_range", "filter") == 1)
+        #expect(statistic("calls", "instrumented_range", "next") == 100)
+        #expect(statistic("calls", "instrumented_range", "column") == 100)
+        #expect(statistic("p50_ns <= p99_ns AND total_ns >= mean_ns", "instrumented_half", "function") == 1)
+        #expect(
+            statistic("(SELECT sum(value) FROM json_each(histogram))", "instrumented_half", "function") == 101
+        )
+
+        let half = try #require(
+            SQLiteInstrumentation.statistics().first { $0.name == "instrumented_half" && $0.callback == "function" }
+        )
+        #expect(half.histogram.count == SQLiteInstrumentation.bucketCount)
+        #expect(half.percentile(0) <= half.percentile(0.5) && half.percentile(0.5) <= half.percentile(1))
+
+        // Disabling stops recording; the probes stay in place.
+        SQLiteInstrumentation.isEnabled = false
+        #expect(executeScalarInt(connection, "SELECT instrumented_half(4)") == 2)
+        let after = try #require(
+            SQLiteInstrumentation.statistics().first { $0.name == "instrumented_half" && $0.callback == "function" }
+        )
+        #expect(after.calls == 101)
+    }
+}
@@ -164,4 +164,38 @@ struct SQLiteValueTests {
 
         #expect(result == Data([0xEF, 0xBE, 0xAD, 0xDE]))
     }
+
+    /// Tests borrowed UTF-8 and blob byte views
+    @Test("Borrowed byte views")
+    func testBorrowedBytes() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        let database = SQLiteDatabase(db)
+        try database.createScalarFunction(name: "utf8_len", argumentCount: 1) { context, args in
+            context.result(Int64(args[0].withUTF8Bytes { $0.count }))
+        }
+        try database.createScalarFunction(name: "blob_sum", argumentCount: 1) { context, args in
+            context.result(args[0].withBlobBytes { bytes in
+                bytes.reduce(Int64(0)) { $0 + Int64($1) }
+            })
+        }
+
+        var stmt: OpaquePointer?
+        sqlite3_prepare_v2(
+            db,
+            "SELECT utf8_len('héllo'), utf8_len(NULL), utf8_len(12345), blob_sum(x'010203'), blob_sum(NULL)",
+            -1,
+            &stmt,
+            nil
+        )
+        defer { sqlite3_finalize(stmt) }
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+
+        #expect(sqlite3_column_int64(stmt, 0) == 6)
+        #expect(sqlite3_column_int64(stmt, 1) == 0)
+        #expect(sqlite3_column_int64(stmt, 2) == 5)
+        #expect(sqlite3_column_int64(stmt, 3) == 6)
+        #expect(sqlite3_column_int64(stmt, 4) == 0)
+    }
 }
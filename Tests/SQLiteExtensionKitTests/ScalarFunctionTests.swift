@@ -1,5 +1,6 @@
 import Testing
 import Foundation
+import Synchronization
 @testable import SQLiteExtensionKit
 import CSQLite
 
@@ -232,4 +233,216 @@ struct ScalarFunctionTests {
         let result2 = executeScalarInt(db, "SELECT is_null_func(42)")
         #expect(result2 == 0)
     }
+
+    /// Tests iterating the borrowed argument view
+    @Test("Borrowed argument view")
+    func testBorrowedArguments() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        let database = SQLiteDatabase(db)
+
+        try database.createScalarFunction(name: "describe_args") { context, args in
+            var parts: [String] = []
+            for index in args.indices {
+                parts.append("\(index):\(args[index].textValue)")
+            }
+            context.result(parts.joined(separator: ","))
+        }
+
+        let result = executeScalarText(db, "SELECT describe_args('a', 2, 3.5)")
+        #expect(result == "0:a,1:2,2:3.5")
+
+        let empty = executeScalarText(db, "SELECT describe_args()")
+        #expect(empty == "")
+    }
+
+    /// Tests the array-based compatibility overload
+    @Test("Array-based scalar function compatibility")
+    func testArrayScalarFunction() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        let database = SQLiteDatabase(db)
+
+        let function: ScalarFunction = { context, args in
+            context.result(Int64(args.count))
+        }
+        try database.createScalarFunction(name: "arg_count", function: function)
+
+        let result = executeScalarInt(db, "SELECT arg_count(1, 2, 3)")
+        #expect(result == 3)
+    }
+
+    /// Tests typed, arity-specialized registration
+    @Test("Typed scalar functions")
+    func testTypedScalarFunctions() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        let database = SQLiteDatabase(db)
+
+        try database.createScalarFunction(name: "answer") { () -> Int64 in 42 }
+        try database.createScalarFunction(name: "typed_add", deterministic: true) { (a: Int64, b: Int64) in
+            a + b
+        }
+        try database.createScalarFunction(name: "typed_join") { (a: String, b: String, c: String) in
+            "\(a)-\(b)-\(c)"
+        }
+        try database.createScalarFunction(name: "or_default") { (value: String?) in
+            value ?? "default"
+        }
+
+        #expect(executeScalarInt(db, "SELECT answer()") == 42)
+        #expect(executeScalarInt(db, "SELECT typed_add(40, 2)") == 42)
+        #expect(executeScalarText(db, "SELECT typed_join('a', 'b', 'c')") == "a-b-c")
+        #expect(executeScalarText(db, "SELECT or_default(NULL)") == "default")
+        #expect(executeScalarText(db, "SELECT or_default('value')") == "value")
+
+        // Non-optional arguments propagate NULL without running the body
+        #expect(executeScalarInt(db, "SELECT typed_add(NULL, 2) IS NULL") == 1)
+
+        // Arity is enforced by SQLite
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "SELECT typed_add(1)", -1, &stmt, nil) == SQLITE_ERROR)
+        sqlite3_finalize(stmt)
+    }
+
+    /// Tests zero-copy results backed by a retained buffer
+    @Test("Result buffer is shared across rows")
+    func testResultBuffer() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        let database = SQLiteDatabase(db)
+        let text = SQLiteResultBuffer("shared payload")
+        let blob = SQLiteResultBuffer(Data([0x01, 0x02, 0x03]))
+
+        try database.createScalarFunction(name: "buffer_text", argumentCount: 0) { context, _ in
+            context.result(text: text)
+        }
+        try database.createScalarFunction(name: "buffer_blob", argumentCount: 0) { context, _ in
+            context.result(blob: blob)
+        }
+
+        #expect(executeScalarText(db, "SELECT buffer_text()") == "shared payload")
+        #expect(executeScalarInt(db, "SELECT length(buffer_blob())") == 3)
+        #expect(executeScalarText(db, "SELECT hex(buffer_blob())") == "010203")
+        #expect(executeScalarInt(db, "SELECT count(*) FROM (SELECT buffer_text() FROM (SELECT 1 UNION ALL SELECT 2))") == 2)
+        #expect(executeScalarInt(db, "SELECT buffer_text() = 'shared payload'") == 1)
+    }
+
+    /// Tests auxiliary data reuse for constant arguments
+    @Test("Auxiliary data is reused for constant arguments")
+    func testAuxiliaryData() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        final class Compiled: @unchecked Sendable {
+            let value: Int64
+            init(_ value: Int64) { self.value = value }
+        }
+        final class BuildCounter: Sendable {
+            let count = Mutex(0)
+        }
+        let builds = BuildCounter()
+
+        let database = SQLiteDatabase(db)
+        try database.createScalarFunction(name: "add_cached", argumentCount: 2) { context, args in
+            let compiled = context.auxiliaryData(forArgument: 1) {
+                builds.count.withLock { $0 += 1 }
+                return Compiled(args[1].intValue)
+            }
+            context.result(args[0].intValue + compiled.value)
+        }
+
+        let sql = """
+        WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 100)
+        SELECT sum(add_cached(x, 1000)) FROM n
+        """
+        #expect(executeScalarInt(db, sql) == 5050 + 100 * 1000)
+        #expect(builds.count.withLock { $0 } == 1)
+
+        builds.count.withLock { $0 = 0 }
+        let perRow = """
+        WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 10)
+        SELECT sum(add_cached(0, x)) FROM n
+        """
+        #expect(executeScalarInt(db, perRow) == 55)
+        #expect(builds.count.withLock { $0 } == 10)
+    }
+
+    /// Tests that a memoized function runs once per distinct argument list
+    @Test("Memoized function results are reused")
+    func testMemoization() throws {
+        let db = try #require(createDatabase())
+        defer { sqlite3_close(db) }
+
+        final class CallCounter: Sendable {
+            let count = Mutex(0)
+        }
+        let calls = CallCounter()
+
+        let database = SQLiteDatabase(db)
+        try database.createScalarFunction(
+            name: "describe",
+            argumentCount: 1,
+            deterministic: true,
+            memoize: .lru(capacity: 2)
+        ) { context, args in
+            calls.count.withLock { $0 += 1 }
+            guard args[0].type != .null else {
+                context.resultError("describe() requires a value")
+                return
+            }
+            context.result("\(args[0].type)-\(args[0].textValue)")
+        }
+
+        let sql = """
+        WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 100)
+        SELECT count(DISTINCT describe(x % 2)) FROM n
+        """
+        #expect(executeScalarInt(db, sql) == 2)
+        #expect(calls.count.withLock { $0 } == 2)
+
+        // Values of different storage classes are different keys.
+        #expect(executeScalarText(db, "SELECT describe(1)") == "integer-1")
+        #expect(executeScalarText(db, "SELECT describe('1')") == "text-1")
+        #expect(calls.count.withLock { $0 } == 3)
+
+        // The least recently used result is evicted.
+        #expect(executeScalarText(db, "SELECT describe(0)") == "integer-0")
+        #expect(calls.count.withLock { $0 } == 4)
+        #expect(executeScalarText(db, "SELECT describe('1')") == "text-1")
+        #expect(calls.count.withLock { $0 } == 4)
+
+        // Errors are not cached.
+        #expect(executeScalarText(db, "SELECT describe(NULL)") == nil)
+        #expect(executeScalarText(db, "SELECT describe(NULL)") == nil)
+        #expect(calls.count.withLock { $0 } == 6)
+
+        #expect(throws: SQLiteExtensionError.self) {
+            try database.createScalarFunction(name: "unstable", memoize: .lru(capacity: 8)) { context, _ in
+                context.result(Int64.random(in: 0..<100))
+            }
+        }
+    }
+
+    /// Tests least-recently-used eviction
+    @Test("LRU cache evicts least recently used entry")
+    func testLRUCache() {
+        let cache = SQLiteLRUCache<String, Int>(capacity: 2)
+        cache.insert(1, forKey: "a")
+        cache.insert(2, forKey: "b")
+        #expect(cache.value(forKey: "a") == 1)
+
+        cache.insert(3, forKey: "c")
+        #expect(cache.count == 2)
+        #expect(cache.value(forKey: "b") == nil)
+        #expect(cache.value(forKey: "a") == 1)
+        #expect(cache.value(forKey: "c") == 3)
+
+        #expect(cache.value(forKey: "d", orInsert: { 4 }) == 4)
+        #expect(cache.value(forKey: "a") == nil)
+    }
 }
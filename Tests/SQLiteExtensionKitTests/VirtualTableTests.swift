@@ -1,5 +1,6 @@
 import Testing
 import CSQLite
+import Synchronization
 @testable import SQLiteExtensionKit
 
 @Suite("Virtual Table Tests")
@@ -30,6 +31,172 @@ struct VirtualTableTests {
 
         #expect(collected == [1, 2, 3])
     }
+
+    @Test("Batch cursor serves rows from columnar buffer")
+    func testBatchCursor() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        defer { sqlite3_close(db) }
+        guard let db else { return }
+
+        let database = SQLiteDatabase(db)
+        try database.registerVirtualTableModule(
+            name: "batch_series",
+            module: BatchSeriesVirtualTable.self
+        )
+
+        #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE series USING batch_series", nil, nil, nil) == SQLITE_OK)
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "SELECT count(*), sum(value), sum(half), max(rowid) FROM series", -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(sqlite3_column_int64(stmt, 0) == 1000)
+        #expect(sqlite3_column_int64(stmt, 1) == 499_500)
+        #expect(sqlite3_column_double(stmt, 2) == 249_750)
+        #expect(sqlite3_column_int64(stmt, 3) == 1000)
+        sqlite3_finalize(stmt)
+
+        #expect(sqlite3_prepare_v2(db, "SELECT label, note FROM series WHERE value = 130", -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(String(cString: sqlite3_column_text(stmt, 0)) == "row-130")
+        #expect(sqlite3_column_type(stmt, 1) == SQLITE_NULL)
+        #expect(sqlite3_step(stmt) == SQLITE_DONE)
+        sqlite3_finalize(stmt)
+
+        #expect(sqlite3_prepare_v2(db, "SELECT value FROM series LIMIT 3", -1, &stmt, nil) == SQLITE_OK)
+        var collected: [Int64] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            collected.append(sqlite3_column_int64(stmt, 0))
+        }
+        sqlite3_finalize(stmt)
+        #expect(collected == [0, 1, 2])
+
+        // Empty strings and blobs stay non-NULL even when no cell has allocated the arena.
+        try database.registerVirtualTableModule(name: "batch_empty", module: EmptyCellsVirtualTable.self)
+        #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE empty USING batch_empty", nil, nil, nil) == SQLITE_OK)
+        #expect(sqlite3_prepare_v2(db, "SELECT typeof(label), typeof(payload), length(payload) FROM empty", -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(String(cString: sqlite3_column_text(stmt, 0)) == "text")
+        #expect(String(cString: sqlite3_column_text(stmt, 1)) == "blob")
+        #expect(sqlite3_column_int64(stmt, 2) == 0)
+        sqlite3_finalize(stmt)
+    }
+
+    @Test("Eof is read once per filter and next")
+    func testCachedEof() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        defer { sqlite3_close(db) }
+        guard let db else { return }
+
+        try SQLiteDatabase(db).registerVirtualTableModule(
+            name: "counted",
+            module: CountedEofVirtualTable.self
+        )
+        #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE counted USING counted", nil, nil, nil) == SQLITE_OK)
+
+        // The inner side of the join is filtered once per outer row, so a stale cached
+        // flag from the end of one scan would hide the rows of the next.
+        var stmt: OpaquePointer?
+        let sql = "SELECT count(*) FROM (VALUES (1), (2)) CROSS JOIN counted"
+        #expect(sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK)
+        CountedEofVirtualTable.eofReads.store(0, ordering: .relaxed)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(sqlite3_column_int64(stmt, 0) == 6)
+        sqlite3_finalize(stmt)
+
+        // Each scan of three rows is one filter and three nexts.
+        #expect(CountedEofVirtualTable.eofReads.load(ordering: .relaxed) == 8)
+    }
+
+    @Test("Closed cursors are reused by later scans")
+    func testCursorPool() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        defer { sqlite3_close(db) }
+        guard let db else { return }
+
+        try SQLiteDatabase(db).registerVirtualTableModule(
+            name: "pooled",
+            module: PooledVirtualTable.self
+        )
+        #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE pooled USING pooled", nil, nil, nil) == SQLITE_OK)
+        PooledVirtualTable.opens.store(0, ordering: .relaxed)
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "SELECT count(*), sum(value) FROM pooled", -1, &stmt, nil) == SQLITE_OK)
+        for _ in 0..<5 {
+            #expect(sqlite3_step(stmt) == SQLITE_ROW)
+            #expect(sqlite3_column_int64(stmt, 0) == 3)
+            #expect(sqlite3_column_int64(stmt, 1) == 6)
+            sqlite3_reset(stmt)
+        }
+        sqlite3_finalize(stmt)
+        #expect(PooledVirtualTable.opens.load(ordering: .relaxed) == 1)
+
+        // Two cursors open at once both come back to the pool.
+        let selfJoin = "SELECT count(*) FROM pooled AS a CROSS JOIN pooled AS b"
+        #expect(sqlite3_prepare_v2(db, selfJoin, -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(sqlite3_column_int64(stmt, 0) == 9)
+        sqlite3_finalize(stmt)
+        #expect(PooledVirtualTable.opens.load(ordering: .relaxed) == 2)
+
+        #expect(sqlite3_prepare_v2(db, selfJoin, -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        sqlite3_finalize(stmt)
+        #expect(PooledVirtualTable.opens.load(ordering: .relaxed) == 2)
+    }
+
+    @Test("Async cursor prefetches batches and stops at LIMIT")
+    func testAsyncCursor() throws {
+        var db: OpaquePointer?
+        #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+        defer { sqlite3_close(db) }
+        guard let db else { return }
+
+        try SQLiteDatabase(db).registerVirtualTableModule(
+            name: "async_series",
+            module: AsyncSeriesVirtualTable.self
+        )
+        let setup = """
+        CREATE VIRTUAL TABLE series USING async_series;
+        CREATE VIRTUAL TABLE broken USING async_series(fail);
+        """
+        #expect(sqlite3_exec(db, setup, nil, nil, nil) == SQLITE_OK)
+
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, "SELECT count(*), sum(value), max(rowid) FROM series", -1, &stmt, nil) == SQLITE_OK)
+        #expect(sqlite3_step(stmt) == SQLITE_ROW)
+        #expect(sqlite3_column_int64(stmt, 0) == 10_000)
+        #expect(sqlite3_column_int64(stmt, 1) == 49_995_000)
+        #expect(sqlite3_column_int64(stmt, 2) == 10_000)
+        sqlite3_finalize(stmt)
+
+        // Closing the cursor stops the producer within the prefetch window: the batch read,
+        // the queued batches, and the one waiting to be queued.
+        AsyncSeriesVirtualTable.producedBatches.store(0, ordering: .relaxed)
+        #expect(sqlite3_prepare_v2(db, "SELECT value FROM series LIMIT 5", -1, &stmt, nil) == SQLITE_OK)
+        var collected: [Int64] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            collected.append(sqlite3_column_int64(stmt, 0))
+        }
+        sqlite3_finalize(stmt)
+        #expect(collected == [0, 1, 2, 3, 4])
+        #expect(AsyncSeriesVirtualTable.producedBatches.load(ordering: .relaxed) <= AsyncSeriesVirtualTable.Cursor.prefetchLimit + 2)
+
+        // The rows before a failure are returned, then the error.
+        #expect(sqlite3_prepare_v2(db, "SELECT value FROM broken", -1, &stmt, nil) == SQLITE_OK)
+        var rows = 0
+        var result = sqlite3_step(stmt)
+        while result == SQLITE_ROW {
+            rows += 1
+            result = sqlite3_step(stmt)
+        }
+        sqlite3_finalize(stmt)
+        #expect(rows == 300)
+        #expect(result == SQLITE_ERROR)
+    }
 }
 
 // MARK: - Test Module
@@ -86,6 +253,254 @@ struct NumbersVirtualTable: VirtualTableModule {
     }
 }
 
+/// Three rows, counting how often the bridge reads `eof`.
+struct CountedEofVirtualTable: VirtualTableModule {
+    static let eofReads = Atomic<Int>(0)
+
+    struct Cursor: VirtualTableCursor {
+        private var index: Int64 = 0
+
+        mutating func filter(
+            indexNumber: Int,
+            indexString: String?,
+            values: [SQLiteValue]
+        ) throws {
+            index = 0
+        }
+
+        mutating func next() throws {
+            index += 1
+        }
+
+        var eof: Bool {
+            CountedEofVirtualTable.eofReads.wrappingAdd(1, ordering: .relaxed)
+            return index >= 3
+        }
+
+        func column(at index: Int) throws -> ColumnValue {
+            .integer(self.index)
+        }
+
+        var rowid: Int64 {
+            index + 1
+        }
+    }
+
+    static var schema: String {
+        "CREATE TABLE x(value INTEGER)"
+    }
+
+    static func create(arguments: [String]) throws -> CountedEofVirtualTable {
+        CountedEofVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> Cursor {
+        Cursor()
+    }
+}
+
+/// Three rows from a cursor that asks to be reused, counting how often the module opens one.
+struct PooledVirtualTable: VirtualTableModule {
+    static let opens = Atomic<Int>(0)
+
+    struct Cursor: VirtualTableCursor {
+        private var rows: [Int64] = []
+        private var index = 0
+
+        mutating func filter(
+            indexNumber: Int,
+            indexString: String?,
+            values: [SQLiteValue]
+        ) throws {
+            rows.removeAll(keepingCapacity: true)
+            rows.append(contentsOf: [1, 2, 3])
+            index = 0
+        }
+
+        mutating func next() throws {
+            index += 1
+        }
+
+        var eof: Bool {
+            index >= rows.count
+        }
+
+        func column(at index: Int) throws -> ColumnValue {
+            .integer(rows[self.index])
+        }
+
+        var rowid: Int64 {
+            rows[index]
+        }
+
+        mutating func reset() -> Bool {
+            rows.removeAll(keepingCapacity: true)
+            return true
+        }
+    }
+
+    static var schema: String {
+        "CREATE TABLE x(value INTEGER)"
+    }
+
+    static func create(arguments: [String]) throws -> PooledVirtualTable {
+        PooledVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> Cursor {
+        PooledVirtualTable.opens.wrappingAdd(1, ordering: .relaxed)
+        return Cursor()
+    }
+}
+
+/// 10,000 rows in batches of 100 from an async sequence, counting the batches produced.
+/// With a module argument, the sequence fails after its third batch.
+struct AsyncSeriesVirtualTable: VirtualTableModule {
+    static let producedBatches = Atomic<Int>(0)
+
+    let failing: Bool
+
+    struct Batches: AsyncSequence, Sendable {
+        let failing: Bool
+
+        struct AsyncIterator: AsyncIteratorProtocol {
+            let failing: Bool
+            var start: Int64 = 0
+
+            mutating func next() async throws -> [VirtualTableRow]? {
+                guard start < 10_000 else { return nil }
+                if failing && start >= 300 {
+                    throw SQLiteExtensionError.sqliteError(code: SQLITE_IOERR)
+                }
+                await Task.yield()
+                let end = start + 100
+                defer { start = end }
+                AsyncSeriesVirtualTable.producedBatches.wrappingAdd(1, ordering: .relaxed)
+                return (start..<end).map { VirtualTableRow(rowid: $0 + 1, columns: [.integer($0)]) }
+            }
+        }
+
+        func makeAsyncIterator() -> AsyncIterator {
+            AsyncIterator(failing: failing)
+        }
+    }
+
+    struct Cursor: AsyncVirtualTableCursor {
+        static let prefetchLimit = 2
+
+        let failing: Bool
+
+        func batches(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws -> Batches {
+            Batches(failing: failing)
+        }
+    }
+
+    static var schema: String {
+        "CREATE TABLE x(value INTEGER)"
+    }
+
+    static func create(arguments: [String]) throws -> AsyncSeriesVirtualTable {
+        AsyncSeriesVirtualTable(failing: arguments.count > 3)
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> Cursor {
+        Cursor(failing: failing)
+    }
+}
+
+// MARK: - Batch Test Module
+
+struct BatchSeriesVirtualTable: VirtualTableModule {
+    struct SeriesCursor: BatchVirtualTableCursor {
+        static let columnCount = 4
+        static let batchCapacity = 64
+
+        private var nextValue: Int64 = 0
+
+        mutating func filter(
+            indexNumber: Int,
+            indexString: String?,
+            values: [SQLiteValue]
+        ) throws {
+            nextValue = 0
+        }
+
+        mutating func fillBatch(_ batch: VirtualTableBatch) throws {
+            while !batch.isFull && nextValue < 1000 {
+                let row = batch.appendRow(rowid: nextValue + 1)
+                batch.setInteger(nextValue, column: 0, row: row)
+                batch.setReal(Double(nextValue) / 2, column: 1, row: row)
+                try batch.setText("row-\(nextValue)", column: 2, row: row)
+                nextValue += 1
+            }
+        }
+    }
+
+    static var schema: String {
+        "CREATE TABLE x(value INTEGER, half REAL, label TEXT, note TEXT)"
+    }
+
+    static func create(arguments: [String]) throws -> BatchSeriesVirtualTable {
+        BatchSeriesVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> SeriesCursor {
+        SeriesCursor()
+    }
+}
+
+struct EmptyCellsVirtualTable: VirtualTableModule {
+    struct Cursor: BatchVirtualTableCursor {
+        static let columnCount = 2
+
+        private var filled = false
+
+        mutating func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+            filled = false
+        }
+
+        mutating func fillBatch(_ batch: VirtualTableBatch) throws {
+            guard !filled else { return }
+            let row = batch.appendRow(rowid: 1)
+            try batch.setText("", column: 0, row: row)
+            try batch.setBlob(bytes: UnsafeRawBufferPointer(start: nil, count: 0), column: 1, row: row)
+            filled = true
+        }
+    }
+
+    static var schema: String {
+        "CREATE TABLE x(label TEXT, payload BLOB)"
+    }
+
+    static func create(arguments: [String]) throws -> EmptyCellsVirtualTable {
+        EmptyCellsVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> Cursor {
+        Cursor()
+    }
+}
+
 @Test("Virtual table supports inserts, updates, and deletes")
 func testVirtualTableWrites() throws {
     var db: OpaquePointer?
@@ -132,6 +547,357 @@ func testVirtualTableWrites() throws {
     #expect(rows.first?.2 == "one updated")
 }
 
+@Test("Transaction hooks let writes be staged and flushed once")
+func testVirtualTableTransactions() throws {
+    var db: OpaquePointer?
+    #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+    defer { sqlite3_close(db) }
+    guard let db else { return }
+
+    let database = SQLiteDatabase(db)
+    try database.registerVirtualTableModule(
+        name: "staged",
+        module: StagedWritesVirtualTable.self
+    )
+
+    #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE t USING staged", nil, nil, nil) == SQLITE_OK)
+
+    func summary() -> (Int64, Int64) {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, "SELECT count(*), coalesce(max(flushes), 0) FROM t", -1, &stmt, nil) == SQLITE_OK else {
+            return (-1, -1)
+        }
+        defer { sqlite3_finalize(stmt) }
+        guard sqlite3_step(stmt) == SQLITE_ROW else { return (-1, -1) }
+        return (sqlite3_column_int64(stmt, 0), sqlite3_column_int64(stmt, 1))
+    }
+
+    let bulk = """
+    WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 10000)
+    INSERT INTO t(value) SELECT x FROM n
+    """
+    #expect(sqlite3_exec(db, bulk, nil, nil, nil) == SQLITE_OK)
+    #expect(summary() == (10_000, 1))
+
+    // An explicit transaction flushes once at COMMIT, however many statements it spans.
+    #expect(sqlite3_exec(db, "BEGIN; INSERT INTO t(value) VALUES (1); INSERT INTO t(value) VALUES (2); COMMIT", nil, nil, nil) == SQLITE_OK)
+    #expect(summary() == (10_002, 2))
+
+    #expect(sqlite3_exec(db, "BEGIN; INSERT INTO t(value) VALUES (3); ROLLBACK", nil, nil, nil) == SQLITE_OK)
+    #expect(summary() == (10_002, 2))
+
+    // Rolling back to a savepoint discards only the writes made after it.
+    let savepoints = """
+    BEGIN;
+    INSERT INTO t(value) VALUES (4);
+    SAVEPOINT s;
+    INSERT INTO t(value) VALUES (5);
+    ROLLBACK TO s;
+    COMMIT;
+    """
+    #expect(sqlite3_exec(db, savepoints, nil, nil, nil) == SQLITE_OK)
+    #expect(summary() == (10_003, 3))
+}
+
+@Test("Bulk writable table receives inserts in batches")
+func testBulkWritableInserts() throws {
+    var db: OpaquePointer?
+    #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+    defer { sqlite3_close(db) }
+    guard let db else { return }
+
+    let database = SQLiteDatabase(db)
+    try database.registerVirtualTableModule(
+        name: "columns",
+        module: ColumnStoreVirtualTable.self
+    )
+
+    #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE c USING columns", nil, nil, nil) == SQLITE_OK)
+
+    func integers(_ sql: String) -> [Int64] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return [] }
+        defer { sqlite3_finalize(stmt) }
+        var values: [Int64] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            for column in 0..<sqlite3_column_count(stmt) {
+                values.append(sqlite3_column_int64(stmt, column))
+            }
+        }
+        return values
+    }
+
+    let bulk = """
+    WITH RECURSIVE n(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM n WHERE x < 1000)
+    INSERT INTO c(id, label) SELECT x * 2, 'row-' || x FROM n
+    """
+    #expect(sqlite3_exec(db, bulk, nil, nil, nil) == SQLITE_OK)
+    #expect(sqlite3_last_insert_rowid(db) == 1000)
+    // 1000 rows in batches of 300: three full batches and one flushed at commit.
+    #expect(integers("SELECT count(*), sum(id), max(rowid), max(batches) FROM c") == [1000, 1_001_000, 1000, 4])
+
+    // A requested rowid is kept, and staged rows are visible to the next read.
+    #expect(sqlite3_exec(db, "BEGIN; INSERT INTO c(rowid, id, label) VALUES (5000, 7, 'seven')", nil, nil, nil) == SQLITE_OK)
+    #expect(sqlite3_last_insert_rowid(db) == 5000)
+    #expect(integers("SELECT rowid, id FROM c WHERE label = 'seven'") == [5000, 7])
+    #expect(sqlite3_exec(db, "INSERT INTO c(id, label) VALUES (8, 'eight'); ROLLBACK", nil, nil, nil) == SQLITE_OK)
+    #expect(integers("SELECT count(*) FROM c WHERE label = 'eight'") == [0])
+}
+
+// MARK: - Bulk Writable Test Module
+
+/// Stores rows column by column, the way a columnar backing store would.
+struct ColumnStoreVirtualTable: BulkWritableVirtualTable {
+    final class Store: @unchecked Sendable {
+        var rowids: [Int64] = []
+        var ids: [Int64] = []
+        var labels: [String] = []
+        var nextRowID: Int64 = 1
+        var batches: Int64 = 0
+    }
+
+    struct StoreCursor: VirtualTableCursor {
+        let store: Store
+        private var index = 0
+
+        init(store: Store) {
+            self.store = store
+        }
+
+        mutating func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+            index = 0
+        }
+
+        mutating func next() throws {
+            index += 1
+        }
+
+        var eof: Bool {
+            index >= store.rowids.count
+        }
+
+        func column(at columnIndex: Int) throws -> ColumnValue {
+            switch columnIndex {
+            case 0: .integer(store.ids[index])
+            case 1: .text(store.labels[index])
+            default: .integer(store.batches)
+            }
+        }
+
+        var rowid: Int64 {
+            store.rowids[index]
+        }
+    }
+
+    static let insertBatchCapacity = 300
+
+    private let store = Store()
+
+    static var schema: String {
+        "CREATE TABLE x(id INTEGER, label TEXT, batches INTEGER HIDDEN)"
+    }
+
+    static func create(arguments: [String]) throws -> ColumnStoreVirtualTable {
+        ColumnStoreVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> StoreCursor {
+        StoreCursor(store: store)
+    }
+
+    mutating func assignRowID(requested: Int64?) throws -> Int64 {
+        let rowid = requested ?? store.nextRowID
+        store.nextRowID = max(store.nextRowID, rowid + 1)
+        return rowid
+    }
+
+    mutating func insertBatch(_ rows: RowBatch) throws {
+        for row in 0..<rows.count {
+            store.rowids.append(rows.rowid(at: row))
+            store.ids.append(rows.integer(column: 0, row: row))
+            store.labels.append(rows.text(column: 1, row: row))
+        }
+        store.batches += 1
+    }
+}
+
+@Test("IndexInfo reports used columns, right-hand values, and IN lists")
+func testIndexInfoDetails() throws {
+    var db: OpaquePointer?
+    #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+    defer { sqlite3_close(db) }
+    guard let db else { return }
+
+    let database = SQLiteDatabase(db)
+    try database.registerVirtualTableModule(
+        name: "planner",
+        module: PlanRecordingVirtualTable.self
+    )
+    #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE p USING planner", nil, nil, nil) == SQLITE_OK)
+
+    func plans(_ sql: String) -> [IndexInfo] {
+        PlanRecordingVirtualTable.plans.withLock { $0 = [] }
+        var stmt: OpaquePointer?
+        #expect(sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK)
+        sqlite3_finalize(stmt)
+        return PlanRecordingVirtualTable.plans.withLock { $0 }
+    }
+
+    let projection = try #require(plans("SELECT b, d FROM p").last)
+    #expect(!projection.usesColumn(0))
+    #expect(projection.usesColumn(1))
+    #expect(!projection.usesColumn(2))
+    #expect(projection.usesColumn(3))
+
+    let collated = try #require(plans("SELECT a FROM p WHERE b = 'x' COLLATE NOCASE").last)
+    #expect(collated.constraints.first { $0.column == 1 }?.collation == "NOCASE")
+
+    let literal = try #require(plans("SELECT a FROM p WHERE c = 42").last)
+    let constraint = try #require(literal.constraints.first { $0.column == 2 })
+    #expect(constraint.collation == "BINARY")
+    if case .integer(let value)? = constraint.rightHandValue {
+        #expect(value == 42)
+    } else {
+        Issue.record("Expected an integer right-hand value")
+    }
+    #expect(!constraint.isInList)
+
+    let list = plans("SELECT a FROM p WHERE a IN (1, 2, 3)")
+    #expect(list.contains { info in info.constraints.contains { $0.op == .eq && $0.isInList } })
+
+    #expect(plans("SELECT a FROM p GROUP BY a").contains { $0.distinct == .grouped })
+}
+
+// MARK: - Plan Recording Test Module
+
+/// Records every IndexInfo it is asked to plan.
+struct PlanRecordingVirtualTable: VirtualTableModule {
+    static let plans = Mutex<[IndexInfo]>([])
+
+    typealias Cursor = NumbersVirtualTable.NumbersCursor
+
+    static var schema: String {
+        "CREATE TABLE x(a INTEGER, b INTEGER, c INTEGER, d INTEGER)"
+    }
+
+    static func create(arguments: [String]) throws -> PlanRecordingVirtualTable {
+        PlanRecordingVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        Self.plans.withLock { $0.append(indexInfo) }
+        return indexInfo
+    }
+
+    func open() throws -> Cursor {
+        Cursor()
+    }
+}
+
+// MARK: - Staged Writes Test Module
+
+/// Buffers inserts for the whole transaction and appends them to `committed` on commit.
+struct StagedWritesVirtualTable: VirtualTableModule {
+    final class Store: @unchecked Sendable {
+        var committed: [Int64] = []
+        var pending: [Int64] = []
+        var savepoints: [(level: Int, count: Int)] = []
+        var flushes: Int64 = 0
+    }
+
+    struct StagedCursor: VirtualTableCursor {
+        let store: Store
+        private var index = 0
+
+        init(store: Store) {
+            self.store = store
+        }
+
+        mutating func filter(indexNumber: Int, indexString: String?, values: [SQLiteValue]) throws {
+            index = 0
+        }
+
+        mutating func next() throws {
+            index += 1
+        }
+
+        var eof: Bool {
+            index >= store.committed.count
+        }
+
+        func column(at columnIndex: Int) throws -> ColumnValue {
+            columnIndex == 0 ? .integer(store.committed[index]) : .integer(store.flushes)
+        }
+
+        var rowid: Int64 {
+            Int64(index + 1)
+        }
+    }
+
+    private let store = Store()
+
+    static var schema: String {
+        "CREATE TABLE x(value INTEGER, flushes INTEGER HIDDEN)"
+    }
+
+    static func create(arguments: [String]) throws -> StagedWritesVirtualTable {
+        StagedWritesVirtualTable()
+    }
+
+    func bestIndex(_ indexInfo: IndexInfo) -> IndexInfo {
+        indexInfo
+    }
+
+    func open() throws -> StagedCursor {
+        StagedCursor(store: store)
+    }
+
+    mutating func update(_ operation: VirtualTableUpdateOperation) throws -> VirtualTableUpdateOutcome {
+        guard case let .insert(_, values) = operation else {
+            return .readOnly
+        }
+        store.pending.append(values[0].intValue)
+        return .handled(rowid: Int64(store.committed.count + store.pending.count))
+    }
+
+    mutating func begin() throws {
+        store.pending = []
+    }
+
+    mutating func commit() throws {
+        // SQLite also commits the transaction that created the table, with nothing staged.
+        store.savepoints = []
+        guard !store.pending.isEmpty else { return }
+        store.committed += store.pending
+        store.pending = []
+        store.flushes += 1
+    }
+
+    mutating func rollback() throws {
+        store.pending = []
+        store.savepoints = []
+    }
+
+    mutating func savepoint(_ level: Int) throws {
+        store.savepoints.removeAll { $0.level >= level }
+        store.savepoints.append((level, store.pending.count))
+    }
+
+    mutating func release(savepoint level: Int) throws {
+        store.savepoints.removeAll { $0.level >= level }
+    }
+
+    mutating func rollback(toSavepoint level: Int) throws {
+        guard let slot = store.savepoints.firstIndex(where: { $0.level >= level }) else { return }
+        store.pending.removeSubrange(store.savepoints[slot].count...)
+        store.savepoints.removeSubrange((slot + 1)...)
+    }
+}
+
 // MARK: - Writable Test Module
 
 struct KeyValueVirtualTable: VirtualTableModule {
@@ -307,3 +1073,55 @@ struct KeyValueVirtualTable: VirtualTableModule {
         }
     }
 }
+
+@Test("Table-valued function pulls rows lazily from its sequence")
+func testTableValuedFunction() throws {
+    var db: OpaquePointer?
+    #expect(sqlite3_open(":memory:", &db) == SQLITE_OK)
+    defer { sqlite3_close(db) }
+    guard let db else { return }
+
+    let pulled = Atomic<Int>(0)
+    let database = SQLiteDatabase(db)
+    try database.createTableValuedFunction(
+        name: "squares",
+        columns: ["n INTEGER", "square INTEGER"],
+        parameters: ["count", "offset"]
+    ) { arguments in
+        let count = arguments[0]?.intValue ?? 0
+        let offset = arguments[1]?.intValue ?? 0
+        return (0..<count).lazy.map { n -> [ColumnValue] in
+            pulled.wrappingAdd(1, ordering: .relaxed)
+            return [.integer(n + offset), .integer(n * n)]
+        }
+    }
+
+    func integers(_ sql: String) -> [Int64] {
+        var stmt: OpaquePointer?
+        guard sqlite3_prepare_v2(db, sql, -1, &stmt, nil) == SQLITE_OK else { return [] }
+        defer { sqlite3_finalize(stmt) }
+        var values: [Int64] = []
+        while sqlite3_step(stmt) == SQLITE_ROW {
+            for column in 0..<sqlite3_column_count(stmt) {
+                values.append(sqlite3_column_int64(stmt, column))
+            }
+        }
+        return values
+    }
+
+    #expect(integers("SELECT square FROM squares(1000000000) LIMIT 10") == [0, 1, 4, 9, 16, 25, 36, 49, 64, 81])
+    #expect(pulled.load(ordering: .relaxed) <= 11)
+
+    // Parameters are readable as hidden columns; omitted ones arrive as nil.
+    #expect(integers("SELECT n, count, offset FROM squares(2, 100)") == [100, 2, 100, 101, 2, 100])
+    #expect(integers("SELECT n FROM squares(3)") == [0, 1, 2])
+    #expect(integers("SELECT n FROM squares WHERE count = 2 AND offset = 5") == [5, 6])
+    #expect(integers("SELECT count(*) FROM squares") == [0])
+
+    // A parameter supplied by a join forces the plan that binds it.
+    #expect(sqlite3_exec(db, "CREATE TABLE sizes(size INTEGER); INSERT INTO sizes VALUES (1), (3)", nil, nil, nil) == SQLITE_OK)
+    #expect(integers("SELECT sizes.size, squares.n FROM sizes, squares WHERE squares.count = sizes.size") == [1, 0, 3, 0, 3, 1, 3, 2])
+
+    // The function is eponymous-only.
+    #expect(sqlite3_exec(db, "CREATE VIRTUAL TABLE s USING squares", nil, nil, nil) != SQLITE_OK)
+}